@@ -0,0 +1,147 @@
+#include <benchmark/benchmark.h>
+#include <datadog/clock.h>
+#include <datadog/datadog_agent_config.h>
+#include <datadog/event_scheduler.h>
+#include <datadog/http_client.h>
+#include <datadog/logger.h>
+#include <datadog/runtime_id.h>
+#include <datadog/tracer_signature.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "datadog/datadog_agent.h"
+#include "datadog/span_data.h"
+
+namespace {
+namespace dd = datadog::tracing;
+
+struct NullLogger : public dd::Logger {
+  void log_error(const LogFunc&) override {}
+  void log_startup(const LogFunc&) override {}
+  void log_error(const dd::Error&) override {}
+  void log_error(dd::StringView) override {}
+};
+
+// `NullHTTPClient` discards requests without responding to them.
+struct NullHTTPClient : public dd::HTTPClient {
+  dd::Expected<void> post(const URL&, HeadersSetter, std::string,
+                          ResponseHandler, ErrorHandler,
+                          std::chrono::steady_clock::time_point) override {
+    return {};
+  }
+  void drain(std::chrono::steady_clock::time_point) override {}
+  std::string config() const override {
+    return R"({"type": "NullHTTPClient"})";
+  }
+};
+
+// `ManualEventScheduler` never invokes the flush callback by itself. The
+// benchmark invokes it instead.
+struct ManualEventScheduler : public dd::EventScheduler {
+  std::function<void()> flush;
+
+  Cancel schedule_recurring_event(std::chrono::steady_clock::duration,
+                                  std::function<void()> callback) override {
+    flush = std::move(callback);
+    return []() {};
+  }
+  std::string config() const override {
+    return R"({"type": "ManualEventScheduler"})";
+  }
+};
+
+struct Agent {
+  std::shared_ptr<ManualEventScheduler> event_scheduler;
+  std::unique_ptr<dd::DatadogAgent> agent;
+};
+
+// Return a `DatadogAgent` whose buffer limit is large enough that no chunk is
+// dropped between flushes, and that encodes flushes using the specified number
+// of `encoding_threads`.
+std::unique_ptr<Agent> make_agent(int encoding_threads = 1) {
+  auto result = std::make_unique<Agent>();
+  result->event_scheduler = std::make_shared<ManualEventScheduler>();
+  dd::DatadogAgentConfig config;
+  config.http_client = std::make_shared<NullHTTPClient>();
+  config.event_scheduler = result->event_scheduler;
+  config.remote_configuration_enabled = false;
+  config.max_buffered_spans = 1'000'000;
+  config.max_buffered_bytes = std::size_t(1) << 30;
+  config.encoding_threads = encoding_threads;
+  const auto logger = std::make_shared<NullLogger>();
+  const auto finalized = dd::finalize_config(config, logger, dd::default_clock);
+  const dd::TracerSignature signature(dd::RuntimeID::generate(), "bench",
+                                      "prod");
+  result->agent = std::make_unique<dd::DatadogAgent>(
+      *finalized, logger, signature,
+      std::vector<std::shared_ptr<datadog::remote_config::Listener>>{});
+  return result;
+}
+
+// The `DatadogAgent` shared by the threads of a benchmark run.
+std::unique_ptr<Agent> shared_agent;
+
+// Return a trace chunk consisting of one span.
+std::vector<std::unique_ptr<dd::SpanData>> make_chunk(std::uint64_t span_id) {
+  auto span = std::make_unique<dd::SpanData>();
+  span->service = "checkout-service";
+  span->name = "http.request";
+  span->resource = "GET /api/v2/cart/{id}";
+  span->span_id = span_id;
+  span->numeric_tags.emplace("_sampling_priority_v1", 1);
+  std::vector<std::unique_ptr<dd::SpanData>> chunk;
+  chunk.push_back(std::move(span));
+  return chunk;
+}
+
+// The benchmark `BM_DatadogAgentSend` sends trace chunks to one
+// `DatadogAgent` from each of a varying number of threads. The first thread
+// also flushes periodically, as the event scheduler would, so that the
+// buffered chunks don't grow without bound.
+void BM_DatadogAgentSend(benchmark::State& state) {
+  const bool first_thread = state.thread_index() == 0;
+  if (first_thread) {
+    shared_agent = make_agent();
+  }
+  std::uint64_t span_id = 0;
+  for (auto _ : state) {
+    auto result = shared_agent->agent->send(make_chunk(++span_id), nullptr);
+    benchmark::DoNotOptimize(result);
+    if (first_thread && span_id % 256 == 0) {
+      shared_agent->event_scheduler->flush();
+    }
+  }
+  if (first_thread) {
+    shared_agent.reset();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DatadogAgentSend)->ThreadRange(1, 64)->UseRealTime();
+
+// The benchmark `BM_DatadogAgentFlush` measures a flush of a varying number of
+// buffered trace chunks, encoded by a varying number of threads.
+void BM_DatadogAgentFlush(benchmark::State& state) {
+  const auto num_chunks = static_cast<std::uint64_t>(state.range(0));
+  const auto agent = make_agent(static_cast<int>(state.range(1)));
+  std::uint64_t span_id = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (std::uint64_t i = 0; i < num_chunks; ++i) {
+      (void)agent->agent->send(make_chunk(++span_id), nullptr);
+    }
+    state.ResumeTiming();
+    agent->event_scheduler->flush();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DatadogAgentFlush)
+    ->ArgsProduct({benchmark::CreateRange(1 << 10, 1 << 16, 4), {1, 2, 4}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
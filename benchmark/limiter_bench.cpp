@@ -0,0 +1,62 @@
+#include <benchmark/benchmark.h>
+#include <datadog/clock.h>
+
+#include <memory>
+#include <mutex>
+
+#include "datadog/limiter.h"
+
+namespace {
+namespace dd = datadog::tracing;
+
+// The `Limiter` shared by the threads of a benchmark run. Its rate is high
+// enough that most requests are allowed, as for a service that is sampled
+// below its configured limit.
+std::unique_ptr<dd::Limiter> shared_limiter;
+std::mutex shared_limiter_mutex;
+
+void set_up(const benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_limiter =
+        std::make_unique<dd::Limiter>(dd::default_clock, 1000000000.0);
+  }
+}
+
+void tear_down(const benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_limiter.reset();
+  }
+}
+
+// Each thread calls `Limiter::allow` under one mutex, as the samplers did
+// before `Limiter` was thread-safe. It's kept here as a baseline.
+void BM_LimiterAllowLocked(benchmark::State& state) {
+  set_up(state);
+  for (auto _ : state) {
+    std::lock_guard<std::mutex> lock(shared_limiter_mutex);
+    benchmark::DoNotOptimize(shared_limiter->allow());
+  }
+  tear_down(state);
+}
+BENCHMARK(BM_LimiterAllowLocked)
+    ->Threads(1)
+    ->Threads(8)
+    ->Threads(32)
+    ->Threads(64)
+    ->UseRealTime();
+
+void BM_LimiterAllow(benchmark::State& state) {
+  set_up(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(shared_limiter->allow());
+  }
+  tear_down(state);
+}
+BENCHMARK(BM_LimiterAllow)
+    ->Threads(1)
+    ->Threads(8)
+    ->Threads(32)
+    ->Threads(64)
+    ->UseRealTime();
+
+}  // namespace
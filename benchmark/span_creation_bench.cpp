@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+#include <datadog/collector.h>
+#include <datadog/logger.h>
+#include <datadog/span.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "datadog/span_data.h"
+
+namespace {
+namespace dd = datadog::tracing;
+
+struct NullLogger : public dd::Logger {
+  void log_error(const LogFunc&) override {}
+  void log_startup(const LogFunc&) override {}
+  void log_error(const dd::Error&) override {}
+  void log_error(dd::StringView) override {}
+};
+
+struct DiscardingCollector : public dd::Collector {
+  dd::Expected<void> send(
+      std::vector<std::unique_ptr<dd::SpanData>>&& spans,
+      const std::shared_ptr<dd::TraceSampler>& /*response_handler*/) override {
+    spans.clear();
+    return {};
+  }
+
+  std::string config() const override {
+    return R"({"type": "DiscardingCollector"})";
+  }
+};
+
+// The `Tracer` shared by the threads of a benchmark run.
+std::unique_ptr<dd::Tracer> shared_tracer;
+
+// The benchmark `BM_CreateSpan` creates and finishes a trace of two spans from
+// each of a varying number of threads sharing one `Tracer`. Each trace reads
+// the tracer's configuration several times, so this measures contention on
+// the configuration as well as on the rest of span creation.
+void BM_CreateSpan(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    dd::TracerConfig config;
+    config.service = "benchmark";
+    config.logger = std::make_shared<NullLogger>();
+    config.collector = std::make_shared<DiscardingCollector>();
+    const auto finalized = dd::finalize_config(config);
+    shared_tracer = std::make_unique<dd::Tracer>(*finalized);
+  }
+  for (auto _ : state) {
+    auto root = shared_tracer->create_span();
+    auto child = root.create_child();
+    benchmark::DoNotOptimize(child.id());
+  }
+  if (state.thread_index() == 0) {
+    shared_tracer.reset();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CreateSpan)->ThreadRange(1, 64)->UseRealTime();
+
+}  // namespace
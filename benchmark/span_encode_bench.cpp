@@ -0,0 +1,165 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <string>
+
+#include "datadog/msgpack.h"
+#include "datadog/span_data.h"
+
+namespace {
+namespace dd = datadog::tracing;
+namespace msgpack = datadog::tracing::msgpack;
+
+// Return a span whose shape resembles that of a typical HTTP server span.
+dd::SpanData make_span() {
+  dd::SpanData span;
+  span.service = "checkout-service";
+  span.service_type = "web";
+  span.name = "http.request";
+  span.resource = "GET /api/v2/cart/{id}";
+  span.trace_id = dd::TraceID{0x0123456789ABCDEFULL, 0x65A1B2C300000000ULL};
+  span.span_id = 0x1122334455667788ULL;
+  span.parent_id = 0x8877665544332211ULL;
+  span.start.wall = std::chrono::system_clock::now();
+  span.duration = std::chrono::microseconds(1234);
+  span.tags = {{"env", "prod"},
+               {"version", "1.42.0"},
+               {"language", "cpp"},
+               {"component", "nginx"},
+               {"http.method", "GET"},
+               {"http.status_code", "200"},
+               {"http.url", "https://example.com/api/v2/cart/1234"},
+               {"runtime-id", "a7d1c8a2-30f3-4b11-8a6c-4fa1c0f1b1a2"},
+               {"_dd.p.dm", "-0"},
+               {"_dd.p.tid", "65a1b2c300000000"}};
+  span.numeric_tags = {{"_sampling_priority_v1", 1},
+                       {"_dd.agent_psr", 1},
+                       {"_dd.top_level", 1},
+                       {"process_id", 4242}};
+  return span;
+}
+
+// `encode_generic` is how `msgpack_encode` was implemented before field names
+// were pre-encoded: each key is encoded at runtime through the variadic
+// `msgpack::pack_map`. It's kept here as a baseline.
+dd::Expected<void> encode_generic(std::string& destination,
+                                  const dd::SpanData& span) {
+  const auto nanoseconds = [](auto duration) {
+    return std::uint64_t(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+            .count());
+  };
+  return msgpack::pack_map(
+      destination, "service",
+      [&](auto& buffer) { return msgpack::pack_string(buffer, span.service); },
+      "name",
+      [&](auto& buffer) { return msgpack::pack_string(buffer, span.name); },
+      "resource",
+      [&](auto& buffer) { return msgpack::pack_string(buffer, span.resource); },
+      "trace_id",
+      [&](auto& buffer) {
+        msgpack::pack_integer(buffer, span.trace_id.low);
+        return dd::Expected<void>{};
+      },
+      "span_id",
+      [&](auto& buffer) {
+        msgpack::pack_integer(buffer, span.span_id);
+        return dd::Expected<void>{};
+      },
+      "parent_id",
+      [&](auto& buffer) {
+        msgpack::pack_integer(buffer, span.parent_id);
+        return dd::Expected<void>{};
+      },
+      "start",
+      [&](auto& buffer) {
+        msgpack::pack_integer(buffer,
+                              nanoseconds(span.start.wall.time_since_epoch()));
+        return dd::Expected<void>{};
+      },
+      "duration",
+      [&](auto& buffer) {
+        msgpack::pack_integer(buffer, nanoseconds(span.duration));
+        return dd::Expected<void>{};
+      },
+      "error",
+      [&](auto& buffer) {
+        msgpack::pack_integer(buffer, std::int32_t(span.error));
+        return dd::Expected<void>{};
+      },
+      "meta",
+      [&](auto& buffer) {
+        return msgpack::pack_map(buffer, span.tags,
+                                 [](std::string& buffer, const auto& value) {
+                                   return msgpack::pack_string(buffer, value);
+                                 });
+      },
+      "metrics",
+      [&](auto& buffer) {
+        return msgpack::pack_map(buffer, span.numeric_tags,
+                                 [](std::string& buffer, const auto& value) {
+                                   msgpack::pack_double(buffer, value);
+                                   return dd::Expected<void>{};
+                                 });
+      },
+      "type",
+      [&](auto& buffer) {
+        return msgpack::pack_string(buffer, span.service_type);
+      });
+}
+
+// Each iteration encodes one span into a fresh buffer, as happens for a
+// single-span trace chunk.
+void BM_SpanEncode_Generic(benchmark::State& state) {
+  const dd::SpanData span = make_span();
+  for (auto _ : state) {
+    std::string buffer;
+    auto result = encode_generic(buffer, span);
+    benchmark::DoNotOptimize(result);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SpanEncode_Generic);
+
+void BM_SpanEncode(benchmark::State& state) {
+  const dd::SpanData span = make_span();
+  for (auto _ : state) {
+    std::string buffer;
+    auto result = dd::msgpack_encode(buffer, span);
+    benchmark::DoNotOptimize(result);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SpanEncode);
+
+// Each iteration appends one span to a buffer that is reused across
+// iterations, as happens when a flush encodes many chunks into one payload.
+void BM_SpanEncodeAppend_Generic(benchmark::State& state) {
+  const dd::SpanData span = make_span();
+  std::string buffer;
+  for (auto _ : state) {
+    buffer.clear();
+    auto result = encode_generic(buffer, span);
+    benchmark::DoNotOptimize(result);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SpanEncodeAppend_Generic);
+
+void BM_SpanEncodeAppend(benchmark::State& state) {
+  const dd::SpanData span = make_span();
+  std::string buffer;
+  for (auto _ : state) {
+    buffer.clear();
+    auto result = dd::msgpack_encode(buffer, span);
+    benchmark::DoNotOptimize(result);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SpanEncodeAppend);
+
+}  // namespace
@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+#include <datadog/span_matcher.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "datadog/span_data.h"
+#include "datadog/span_matcher_index.h"
+
+namespace {
+namespace dd = datadog::tracing;
+
+// Sampling rules of the kind delivered by remote configuration: mostly one
+// rule per service, with a few for operations and resources across services.
+std::vector<dd::SpanMatcher> make_rules() {
+  std::vector<dd::SpanMatcher> rules;
+  for (int i = 0; i < 300; ++i) {
+    dd::SpanMatcher rule;
+    if (i % 10 == 0) {
+      rule.name = "operation-" + std::to_string(i) + ".*";
+      rule.resource = "GET /api/v" + std::to_string(i) + "/*";
+    } else {
+      rule.service = "service-" + std::to_string(i);
+      rule.name = "http.request";
+    }
+    rules.push_back(std::move(rule));
+  }
+  return rules;
+}
+
+// A span that matches the last of the rules.
+dd::SpanData make_span() {
+  dd::SpanData span;
+  span.service = "service-299";
+  span.name = "http.request";
+  span.resource = "GET /api/v2/users/1234";
+  return span;
+}
+
+// `SpanMatcher::match` applied to each rule in turn is how sampling rules
+// were matched before `SpanMatcherIndex`. It's kept here as a baseline.
+void BM_MatchRulesLinear(benchmark::State& state) {
+  const auto rules = make_rules();
+  const auto span = make_span();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(std::find_if(
+        rules.begin(), rules.end(),
+        [&](const dd::SpanMatcher& rule) { return rule.match(span); }));
+  }
+}
+BENCHMARK(BM_MatchRulesLinear);
+
+void BM_MatchRulesIndexed(benchmark::State& state) {
+  dd::SpanMatcherIndex index;
+  for (const auto& rule : make_rules()) {
+    index.add(rule);
+  }
+  const auto span = make_span();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(index.find(span));
+  }
+}
+BENCHMARK(BM_MatchRulesIndexed);
+
+}  // namespace
@@ -0,0 +1,81 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+#include "datadog/span_data.h"
+
+namespace {
+namespace dd = datadog::tracing;
+
+// The tags of a typical HTTP server span, as they would be set one at a time
+// by an integration and then by the tracer when the trace segment finishes.
+const std::array<std::pair<dd::StringView, dd::StringView>, 12> tags = {{
+    {"component", "nginx"},
+    {"span.kind", "server"},
+    {"http.method", "GET"},
+    {"http.url", "https://example.com/api/v2/cart/1234"},
+    {"http.status_code", "200"},
+    {"http.useragent", "Mozilla/5.0 (X11; Linux x86_64)"},
+    {"env", "prod"},
+    {"version", "1.42.0"},
+    {"_dd.p.dm", "-0"},
+    {"_dd.p.tid", "65a1b2c300000000"},
+    {"language", "cpp"},
+    {"runtime-id", "a7d1c8a2-30f3-4b11-8a6c-4fa1c0f1b1a2"},
+}};
+
+using UnorderedTags = std::unordered_map<std::string, std::string>;
+
+// `Span::set_tag` and `Span::lookup_tag`, as they were implemented when
+// `SpanData::tags` was a `std::unordered_map`.
+void set_tag(UnorderedTags& map, dd::StringView key, dd::StringView value) {
+  map.insert_or_assign(std::string(key), std::string(value));
+}
+const std::string& lookup_tag(const UnorderedTags& map, dd::StringView key) {
+  return map.find(std::string(key))->second;
+}
+
+// `Span::set_tag` and `Span::lookup_tag`, as they are implemented now.
+void set_tag(dd::SpanTags& map, dd::StringView key, dd::StringView value) {
+  dd::assign(map[key], value);
+}
+const std::string& lookup_tag(const dd::SpanTags& map, dd::StringView key) {
+  return map.find(key)->second;
+}
+
+// Set each tag, look up one of them, and then visit all of them in the way
+// that serialization does.
+template <typename Map>
+std::size_t tag_and_visit(Map& map) {
+  for (const auto& [key, value] : tags) {
+    set_tag(map, key, value);
+  }
+  std::size_t size = lookup_tag(map, "env").size();
+  for (const auto& [key, value] : map) {
+    size += key.size() + value.size();
+  }
+  return size;
+}
+
+// `std::unordered_map` is how `SpanData::tags` was implemented before
+// `TagMap`. It's kept here as a baseline.
+void BM_TagsUnorderedMap(benchmark::State& state) {
+  for (auto _ : state) {
+    UnorderedTags map;
+    benchmark::DoNotOptimize(tag_and_visit(map));
+  }
+}
+BENCHMARK(BM_TagsUnorderedMap);
+
+void BM_TagsTagMap(benchmark::State& state) {
+  for (auto _ : state) {
+    dd::SpanTags map;
+    benchmark::DoNotOptimize(tag_and_visit(map));
+  }
+}
+BENCHMARK(BM_TagsTagMap);
+
+}  // namespace
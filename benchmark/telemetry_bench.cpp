@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+#include <datadog/event_scheduler.h>
+#include <datadog/http_client.h>
+#include <datadog/logger.h>
+#include <datadog/telemetry/configuration.h>
+#include <datadog/telemetry/metrics.h>
+#include <datadog/telemetry/telemetry.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace {
+namespace dd = datadog::tracing;
+namespace telemetry = datadog::telemetry;
+
+struct NullLogger : public dd::Logger {
+  void log_error(const LogFunc&) override {}
+  void log_startup(const LogFunc&) override {}
+  void log_error(const dd::Error&) override {}
+  void log_error(dd::StringView) override {}
+};
+
+// `NullHTTPClient` discards requests without responding to them.
+struct NullHTTPClient : public dd::HTTPClient {
+  dd::Expected<void> post(const URL&, HeadersSetter, std::string,
+                          ResponseHandler, ErrorHandler,
+                          std::chrono::steady_clock::time_point) override {
+    return {};
+  }
+  void drain(std::chrono::steady_clock::time_point) override {}
+  std::string config() const override {
+    return R"({"type": "NullHTTPClient"})";
+  }
+};
+
+// `NullEventScheduler` never invokes its callbacks.
+struct NullEventScheduler : public dd::EventScheduler {
+  Cancel schedule_recurring_event(std::chrono::steady_clock::duration,
+                                  std::function<void()>) override {
+    return []() {};
+  }
+  std::string config() const override {
+    return R"({"type": "NullEventScheduler"})";
+  }
+};
+
+// Telemetry is a process-wide singleton, so initialize it once for all of the
+// benchmarks.
+void init_telemetry() {
+  static const bool initialized = [] {
+    telemetry::init(*telemetry::finalize_config(),
+                    std::make_shared<NullLogger>(),
+                    std::make_shared<NullHTTPClient>(),
+                    std::make_shared<NullEventScheduler>(),
+                    *dd::HTTPClient::URL::parse("http://localhost:8126"));
+    return true;
+  }();
+  (void)initialized;
+}
+
+const telemetry::Counter spans_created{"spans_created", "tracers", true};
+const telemetry::counter::Handle spans_created_handle{
+    spans_created, {"integration_name:datadog"}};
+
+// Incrementing a counter by name and tags is how every span was counted before
+// `telemetry::counter::Handle`. It's kept here as a baseline.
+void BM_TelemetryCounterByName(benchmark::State& state) {
+  init_telemetry();
+  for (auto _ : state) {
+    telemetry::counter::increment(spans_created, {"integration_name:datadog"});
+  }
+}
+BENCHMARK(BM_TelemetryCounterByName)->ThreadRange(1, 64)->UseRealTime();
+
+void BM_TelemetryCounterHandle(benchmark::State& state) {
+  init_telemetry();
+  for (auto _ : state) {
+    telemetry::counter::increment(spans_created_handle);
+  }
+}
+BENCHMARK(BM_TelemetryCounterHandle)->ThreadRange(1, 64)->UseRealTime();
+
+}  // namespace
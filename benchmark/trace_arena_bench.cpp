@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+#include <datadog/collector.h>
+#include <datadog/logger.h>
+#include <datadog/span.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "datadog/span_data.h"
+
+namespace {
+namespace dd = datadog::tracing;
+
+struct NullLogger : public dd::Logger {
+  void log_error(const LogFunc&) override {}
+  void log_startup(const LogFunc&) override {}
+  void log_error(const dd::Error&) override {}
+  void log_error(dd::StringView) override {}
+};
+
+// `DiscardingCollector` destroys the spans sent to it, which releases their
+// arena, if any.
+struct DiscardingCollector : public dd::Collector {
+  dd::Expected<void> send(
+      std::vector<std::unique_ptr<dd::SpanData>>&& spans,
+      const std::shared_ptr<dd::TraceSampler>& /*response_handler*/) override {
+    spans.clear();
+    return {};
+  }
+
+  std::string config() const override {
+    return R"({"type": "DiscardingCollector"})";
+  }
+};
+
+// The benchmark `BM_TraceWithTags` creates a trace of a root span and 19
+// children, each having ten tags, with or without a trace arena.
+void BM_TraceWithTags(benchmark::State& state) {
+  dd::TracerConfig config;
+  config.service = "benchmark";
+  config.logger = std::make_shared<NullLogger>();
+  config.collector = std::make_shared<DiscardingCollector>();
+  config.use_trace_arena = state.range(0) != 0;
+  const auto finalized = dd::finalize_config(config);
+  dd::Tracer tracer{*finalized};
+
+  std::vector<std::string> keys;
+  for (int i = 0; i < 10; ++i) {
+    keys.push_back("benchmark.tag." + std::to_string(i));
+  }
+  const std::string value = "a value too long to be stored inline";
+  for (auto _ : state) {
+    auto root = tracer.create_span();
+    std::vector<dd::Span> children;
+    children.reserve(19);
+    for (int i = 0; i < 19; ++i) {
+      children.push_back(root.create_child());
+    }
+    for (const auto& key : keys) {
+      root.set_tag(key, value);
+      for (auto& child : children) {
+        child.set_tag(key, value);
+      }
+    }
+  }
+}
+BENCHMARK(BM_TraceWithTags)->Arg(0)->Arg(1);
+
+}  // namespace
@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+#include <datadog/clock.h>
+#include <datadog/sampling_decision.h>
+#include <datadog/trace_sampler_config.h>
+
+#include <memory>
+#include <string>
+
+#include "datadog/collector_response.h"
+#include "datadog/span_data.h"
+#include "datadog/trace_sampler.h"
+
+namespace {
+namespace dd = datadog::tracing;
+
+// The `TraceSampler` shared by the threads of a benchmark run. It has no
+// sampling rules, so every decision uses the Agent's sample rates.
+std::shared_ptr<dd::TraceSampler> shared_sampler;
+
+// The benchmark `BM_TraceSamplerAgentRate` decides whether to keep traces
+// whose service is one of many to which the Agent has assigned a rate, from a
+// varying number of threads sharing one `TraceSampler`.
+void BM_TraceSamplerAgentRate(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    const auto config = dd::finalize_config(dd::TraceSamplerConfig{});
+    shared_sampler =
+        std::make_shared<dd::TraceSampler>(*config, dd::default_clock);
+    dd::CollectorResponse response;
+    for (int i = 0; i < 100; ++i) {
+      response.sample_rate_by_key[dd::CollectorResponse::key(
+          "service-with-a-long-name-" + std::to_string(i), "production")] =
+          dd::Rate::one();
+    }
+    shared_sampler->handle_collector_response(response);
+  }
+
+  dd::SpanData span;
+  span.service = "service-with-a-long-name-42";
+  span.tags["env"] = "production";
+  for (auto _ : state) {
+    ++span.trace_id.low;
+    benchmark::DoNotOptimize(shared_sampler->decide(span));
+  }
+
+  if (state.thread_index() == 0) {
+    shared_sampler.reset();
+  }
+}
+BENCHMARK(BM_TraceSamplerAgentRate)->ThreadRange(1, 64)->UseRealTime();
+
+}  // namespace
@@ -11,6 +11,7 @@
 // Typical usage of `DatadogAgentConfig` is implicit as part of `TracerConfig`.
 // See `tracer_config.h`.
 
+#include <cstddef>
 #include <memory>
 
 #include "clock.h"
@@ -22,14 +23,41 @@
 namespace datadog::tracing {
 
 class EventScheduler;
+class HostEventLoop;
 class Logger;
 
+// The version of the Datadog Agent's traces endpoint to which traces are sent.
+enum class TraceApiVersion {
+  // "/v0.4/traces": Each span is a map whose strings are sent in full.
+  V0_4,
+  // "/v0.5/traces": Each payload begins with a table of the distinct strings
+  // in it, and spans refer to strings by their index in the table.
+  V0_5,
+};
+
+// What `DatadogAgent` does with trace chunks when buffering another chunk
+// until the next flush would exceed a limit on the buffered spans or bytes.
+enum class TraceBufferOverflowPolicy {
+  // Drop the chunk that does not fit.
+  DROP_NEWEST,
+  // Drop the oldest buffered chunks until the new chunk fits.
+  DROP_OLDEST,
+  // Drop the oldest buffered chunks that were sampled out (have a sampling
+  // priority of zero or less, and no span kept by a span sampling rule) until
+  // the new chunk fits. If that's not enough, drop the new chunk.
+  DROP_UNSAMPLED_FIRST,
+};
+
 struct DatadogAgentConfig {
   // The `HTTPClient` used to submit traces to the Datadog Agent. If this
   // library was built with libcurl (the default), then `http_client` is
   // optional: a `Curl` instance will be used if `http_client` is left null.
   // If this library was built without libcurl, then `http_client` is required
-  // not to be null.
+  // not to be null, unless `url` refers to a unix domain socket (the "unix" or
+  // "http+unix" scheme), in which case a built-in client that does not use
+  // libcurl is used if `http_client` is left null, except on Windows. That
+  // client is only a fallback for builds without libcurl: builds with libcurl
+  // use `Curl` for unix domain sockets, too.
   std::shared_ptr<HTTPClient> http_client = nullptr;
   // The `EventScheduler` used to periodically submit batches of traces to the
   // Datadog Agent. If `event_scheduler` is null, then a
@@ -60,6 +88,101 @@ struct DatadogAgentConfig {
   // How often, in seconds, to query the Datadog Agent for remote configuration
   // updates.
   Optional<double> remote_configuration_poll_interval_seconds;
+  // Which version of the Datadog Agent's traces endpoint to use. `V0_5`
+  // produces smaller payloads when spans share many strings, such as service
+  // names and tags. If the Datadog Agent does not support `V0_5`, then the
+  // tracer falls back to `V0_4`. The default is `V0_4`.
+  Optional<TraceApiVersion> trace_api_version;
+  // Whether to MessagePack encode each trace chunk as soon as it is sent to
+  // the `DatadogAgent`, rather than all at once when traces are flushed. This
+  // releases the memory of finished spans right away, and spreads the cost of
+  // encoding across the threads that finish traces instead of the flushing
+  // thread. The default is `false`.
+  Optional<bool> serialize_on_send;
+  // The maximum number of spans buffered between flushes. The default is
+  // 100000.
+  Optional<std::size_t> max_buffered_spans;
+  // The maximum size, in bytes, of the MessagePack encoded trace chunks
+  // buffered between flushes. The default is 25 MiB, which is the largest
+  // payload that the Datadog Agent accepts by default.
+  Optional<std::size_t> max_buffered_bytes;
+  // Which trace chunks to drop when `max_buffered_spans` or
+  // `max_buffered_bytes` would be exceeded. Dropped chunks are counted in the
+  // "trace_chunks_dropped" telemetry metric, and those that were sampled out
+  // are reported to the Datadog Agent so that it can adjust its statistics.
+  // The default is `DROP_NEWEST`.
+  Optional<TraceBufferOverflowPolicy> buffer_overflow_policy;
+  // Whether the tracer computes trace stats (the number of hits and errors,
+  // and the distribution of durations, of spans per service, operation,
+  // resource, and HTTP status code) and sends them to the Datadog Agent,
+  // instead of the Agent computing them from the traces it receives. Traces
+  // that are sampled out then are not sent to the Agent, except for any spans
+  // kept by span sampling rules. Overridden by the
+  // `DD_TRACE_STATS_COMPUTATION_ENABLED` environment variable. The default is
+  // `false`.
+  Optional<bool> stats_computation_enabled;
+  // Whether to compress the bodies of requests that send traces, trace stats,
+  // and telemetry to the Datadog Agent, in the gzip format. Compression is
+  // available only if this library was built with zlib (the
+  // `DD_TRACE_ENABLE_ZLIB` CMake option); enabling it otherwise is an error.
+  // The default is `false`.
+  Optional<bool> compression_enabled;
+  // The zlib compression level, between 1 (fastest) and 9 (smallest). The
+  // default is 1, which already shrinks MessagePack encoded traces several
+  // times over.
+  Optional<int> compression_level;
+  // Request bodies smaller than this many bytes are sent uncompressed. The
+  // default is 1024.
+  Optional<std::size_t> compression_min_bytes;
+  // Whether to flush buffered traces as soon as a payload's worth of them is
+  // buffered, and to adapt the interval between flushes so that payloads stay
+  // between `flush_min_payload_bytes` and `flush_max_payload_bytes`. The
+  // interval then varies between a quarter of and four times
+  // `flush_interval_milliseconds`, and backs off while the Datadog Agent
+  // responds that it is overloaded (status 429 or 503). The default is
+  // `false`.
+  Optional<bool> adaptive_flush_enabled;
+  // With adaptive flushing, the interval between flushes grows after a
+  // payload smaller than this many bytes. The default is 64 KiB.
+  Optional<std::size_t> flush_min_payload_bytes;
+  // With adaptive flushing, traces are flushed once this many bytes of them
+  // are buffered. The default is 2 MiB.
+  Optional<std::size_t> flush_max_payload_bytes;
+  // With adaptive flushing, traces are flushed once this many spans are
+  // buffered. The default is 10000.
+  Optional<std::size_t> flush_max_spans;
+  // How many times to retry sending a payload of traces after a network error
+  // or a 5xx response from the Datadog Agent. The first retry is delayed by
+  // about `flush_interval_milliseconds`, and each later retry twice as long as
+  // the previous one. Zero disables retries. The default is 3.
+  Optional<int> max_trace_retries;
+  // The most bytes of trace payloads held for retrying. A payload that fails
+  // when there isn't room for it is dropped. The default is 8 MiB.
+  Optional<std::size_t> retry_buffer_max_bytes;
+  // How many threads, including the flushing thread, encode the trace chunks
+  // of a large flush. The chunks are divided among the threads, each encoding
+  // its share into its own buffer, and the buffers are then concatenated. This
+  // applies only to the "/v0.4/traces" API, since v0.5 chunks share a table
+  // of strings, and only when `serialize_on_send` is `false`. The default is
+  // 1, i.e. the flushing thread alone encodes the chunks.
+  Optional<int> encoding_threads;
+  // Whether to schedule events, and send requests, with one thread shared by
+  // every tracer in the process that enables this option, rather than with
+  // threads of this tracer's own. This applies to the `DatadogAgent` and to
+  // telemetry, except where `http_client` or `event_scheduler` is specified.
+  // The shared thread invokes the scheduled callbacks, such as flushes, one at
+  // a time, so a slow callback delays the others. The shared HTTP client logs
+  // errors to the logger, and uses the clock, of the tracer that first enabled
+  // this option; those of the tracers that enable it later are not used by
+  // it. The default is `false`.
+  Optional<bool> shared_event_loop;
+  // If not null, the program's own event loop, which schedules the events, and
+  // sends the requests, of the `DatadogAgent` and of telemetry, except where
+  // `http_client` or `event_scheduler` is specified. The tracer then starts no
+  // threads of its own for them. This takes precedence over
+  // `shared_event_loop`. See `host_event_loop.h`. Not available on Windows,
+  // where `finalize_config` rejects it.
+  std::shared_ptr<HostEventLoop> host_event_loop;
 };
 
 class FinalizedDatadogAgentConfig {
@@ -80,15 +203,47 @@ class FinalizedDatadogAgentConfig {
   std::chrono::steady_clock::duration request_timeout;
   std::chrono::steady_clock::duration shutdown_timeout;
   std::chrono::steady_clock::duration remote_configuration_poll_interval;
+  TraceApiVersion trace_api_version;
+  bool serialize_on_send;
+  std::size_t max_buffered_spans;
+  std::size_t max_buffered_bytes;
+  TraceBufferOverflowPolicy buffer_overflow_policy;
   std::unordered_map<ConfigName, std::vector<ConfigMetadata>> metadata;
 
   // Origin detection
   Optional<std::string> admission_controller_uid;
 
-  // Indicate if stats computation should be delegated to the Agent.
-  // This feature is not supported yet, however, we need to inform the Agent to
-  // not compute stats when APM Tracing `DD_APM_TRACING_ENABLED` is disabled.
+  // Whether the tracer computes trace stats and sends them to the Agent.
   bool stats_computation_enabled;
+  // Whether to inform the Agent that it must not compute trace stats. This is
+  // the case when the tracer computes them, and also when APM Tracing
+  // (`DD_APM_TRACING_ENABLED`) is disabled.
+  bool client_computed_stats;
+
+  // If set, the zlib level at which request bodies of at least
+  // `compression_min_bytes` bytes are compressed.
+  Optional<int> compression_level;
+  std::size_t compression_min_bytes;
+
+  // Whether traces are flushed per `FlushPolicy`, rather than every
+  // `flush_interval`, and the policy's payload targets.
+  bool adaptive_flush_enabled;
+  std::size_t flush_min_payload_bytes;
+  std::size_t flush_max_payload_bytes;
+  std::size_t flush_max_spans;
+
+  // How many times a payload of traces is retried, and how many bytes of them
+  // are held for retrying.
+  int max_trace_retries;
+  std::size_t retry_buffer_max_bytes;
+
+  // How many threads encode the trace chunks of a large flush.
+  int encoding_threads;
+
+  // Whether `event_scheduler`, and `http_client` if it wasn't specified, are
+  // those of the process-wide `EventLoop`, or of the `HostEventLoop`.
+  bool shared_event_loop;
+  bool host_event_loop;
 };
 
 Expected<FinalizedDatadogAgentConfig> finalize_config(
@@ -79,6 +79,19 @@ struct Error {
     BAGGAGE_MAXIMUM_BYTES_REACHED = 54,
     BAGGAGE_MAXIMUM_ITEMS_REACHED = 55,
     REMOTE_CONFIGURATION_INVALID_JSON = 56,
+    DATADOG_AGENT_INVALID_TRACE_BUFFER_LIMIT = 57,
+    DATADOG_AGENT_INVALID_COMPRESSION = 58,
+    PAYLOAD_COMPRESSION_FAILURE = 59,
+    UNIX_SOCKET_HTTP_CLIENT_SETUP_FAILED = 60,
+    UNIX_SOCKET_HTTP_CLIENT_NOT_RUNNING = 61,
+    UNIX_SOCKET_REQUEST_SETUP_FAILED = 62,
+    UNIX_SOCKET_REQUEST_FAILURE = 63,
+    UNIX_SOCKET_DEADLINE_EXCEEDED = 64,
+    DATADOG_AGENT_INVALID_FLUSH_POLICY = 65,
+    DATADOG_AGENT_INVALID_MAX_TRACE_RETRIES = 66,
+    DATADOG_AGENT_INVALID_ENCODING_THREADS = 67,
+    HOST_EVENT_LOOP_SETUP_FAILED = 68,
+    DATADOG_AGENT_HOST_EVENT_LOOP_UNSUPPORTED = 69,
   };
 
   Code code;
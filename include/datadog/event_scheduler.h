@@ -1,7 +1,7 @@
 #pragma once
 
 // `EventScheduler` is an interface that allows a specified function-like object
-// to be invoked at regular intervals.
+// to be invoked at regular intervals, or once after a delay.
 //
 // `DatadogAgent` uses an `EventScheduler` to periodically send batches of
 // traces to the Datadog Agent, and to poll it for Remote Configuration updates.
@@ -28,6 +28,16 @@ class EventScheduler {
       std::chrono::steady_clock::duration interval,
       std::function<void()> callback) = 0;
 
+  // Arrange for the specified `callback` to be invoked once, after the
+  // specified `delay`. Return a function-like object that can be invoked
+  // without arguments to prevent the invocation of `callback`, if it hasn't
+  // happened yet.
+  //
+  // The default implementation schedules a recurring event having `delay` as
+  // its interval, and cancels that event once it has invoked `callback`.
+  virtual Cancel schedule_event(std::chrono::steady_clock::duration delay,
+                                std::function<void()> callback);
+
   // Return a JSON representation of this object's configuration. The JSON
   // representation is an object with the following properties:
   // - "type" is the unmangled, qualified name of the most-derived class, e.g.
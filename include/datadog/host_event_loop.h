@@ -0,0 +1,107 @@
+#pragma once
+
+// This component provides a class, `HostEventLoop`, that allows a program to
+// run the tracer's scheduled events and HTTP requests on the program's own
+// event loop, e.g. one based on `epoll`, instead of on threads that the tracer
+// starts.
+//
+// The program creates a `HostEventLoop` and assigns it to
+// `DatadogAgentConfig::host_event_loop`. The tracer then schedules its events
+// on the `HostEventLoop`, and sends its requests through the `HostEventLoop`'s
+// HTTP client, which is a libcurl client that doesn't start a thread. The
+// program's event loop does the following, over and over:
+//
+//     std::vector<HostEventLoop::FileDescriptor> fds;
+//     loop->file_descriptors(fds);
+//     const auto timeout = loop->timeout();
+//     // ... wait until one of `fds` is ready, or until `timeout` elapses ...
+//     loop->process_events();
+//
+// The set of file descriptors changes as connections are opened and closed,
+// and so `file_descriptors` is called before each wait. One of the file
+// descriptors becomes readable when another thread schedules an event or sends
+// a request, so that the program's thread calls `process_events` sooner.
+//
+// `process_events` invokes the callbacks of the events that are due, and of
+// the requests that are done, on the calling thread. It doesn't block.
+// `timeout`, `file_descriptors`, and `process_events` must not be called by
+// more than one thread at a time.
+//
+// When a tracer is destroyed on a thread other than the one calling
+// `process_events`, it waits for its outstanding requests to finish. It does so
+// by performing them itself, on the destroying thread, for up to
+// `DatadogAgentConfig::shutdown_timeout_milliseconds`. Meanwhile, a call to
+// `process_events` on another thread waits. A tracer may also be destroyed
+// from within a callback invoked by `process_events`. It then doesn't wait:
+// its outstanding requests instead finish during later calls to
+// `process_events`.
+//
+// If this library was built without libcurl, then a `HostEventLoop` has no
+// HTTP client, and only the tracer's scheduled events run on it.
+//
+// This component is not available on Windows.
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "clock.h"
+#include "optional.h"
+
+namespace datadog {
+namespace tracing {
+
+class EventLoop;
+class EventScheduler;
+class HTTPClient;
+class Logger;
+
+class HostEventLoop {
+ public:
+  // A file descriptor, and the readiness for which to wait on it.
+  struct FileDescriptor {
+    int fd;
+    bool readable;
+    bool writable;
+  };
+
+ private:
+  struct Pipe;
+
+  std::shared_ptr<Pipe> wake_pipe_;
+  std::shared_ptr<EventLoop> loop_;
+
+ public:
+  // Create a loop whose HTTP client logs errors to the specified `logger`, and
+  // measures request deadlines with the specified `clock`.
+  explicit HostEventLoop(const std::shared_ptr<Logger>& logger,
+                         const Clock& clock = default_clock);
+  ~HostEventLoop();
+
+  HostEventLoop(const HostEventLoop&) = delete;
+  HostEventLoop& operator=(const HostEventLoop&) = delete;
+
+  // Replace the contents of the specified `fds` with the file descriptors that
+  // the program's event loop is to wait on before calling `process_events`.
+  void file_descriptors(std::vector<FileDescriptor>& fds) const;
+
+  // Return how long the program's event loop may wait before calling
+  // `process_events`, if none of the file descriptors is ready, or null if it
+  // may wait indefinitely.
+  Optional<std::chrono::steady_clock::duration> timeout() const;
+
+  // Invoke the callbacks of the scheduled events that are due, and make
+  // whatever progress on the outstanding requests can be made without
+  // blocking.
+  void process_events();
+
+  // Return the `EventScheduler` whose events are run by `process_events`.
+  std::shared_ptr<EventScheduler> event_scheduler() const;
+
+  // Return the HTTP client whose requests are performed by `process_events`,
+  // or null if this library was built without libcurl.
+  std::shared_ptr<HTTPClient> http_client() const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
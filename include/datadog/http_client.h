@@ -10,6 +10,8 @@
 
 #include <chrono>
 #include <functional>
+#include <memory>
+#include <string>
 
 #include "error.h"
 #include "expected.h"
@@ -53,6 +55,15 @@ class HTTPClient {
       ResponseHandler on_response, ErrorHandler on_error,
       std::chrono::steady_clock::time_point deadline) = 0;
 
+  // Send a POST request as `post` does, except that the specified `body` is
+  // shared with the caller, e.g. so that the caller can send it again, rather
+  // than moved into the request. The default implementation copies `body` and
+  // calls `post`. The built-in clients send `body` without copying it.
+  virtual Expected<void> post_shared(
+      const URL& url, HeadersSetter set_headers,
+      std::shared_ptr<const std::string> body, ResponseHandler on_response,
+      ErrorHandler on_error, std::chrono::steady_clock::time_point deadline);
+
   // Wait until there are no more outstanding requests, or until the specified
   // `deadline`.
   virtual void drain(std::chrono::steady_clock::time_point deadline) = 0;
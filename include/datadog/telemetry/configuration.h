@@ -6,6 +6,7 @@
 #include <datadog/telemetry/product.h>
 
 #include <chrono>
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -67,6 +68,12 @@ struct FinalizedConfiguration {
   tracing::Optional<std::string> install_type;
   tracing::Optional<std::string> install_time;
 
+  // If set, the zlib level at which payloads of at least
+  // `compression_min_bytes` bytes are gzip compressed. These are taken from
+  // the Datadog Agent configuration, because telemetry is sent to the Agent.
+  tracing::Optional<int> compression_level;
+  std::size_t compression_min_bytes = 0;
+
   friend tracing::Expected<FinalizedConfiguration> finalize_config(
       const Configuration&);
 };
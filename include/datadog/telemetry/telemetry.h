@@ -9,7 +9,9 @@
 #include <datadog/telemetry/metrics.h>
 #include <datadog/tracer_signature.h>
 
+#include <atomic>
 #include <memory>
+#include <string>
 #include <vector>
 
 /// Telemetry functions are responsibles for handling internal telemetry data to
@@ -108,8 +110,38 @@ void error(std::string message, std::string stacktrace);
 /// Counters can be useful for tracking the total number of an event occurring
 /// in one time interval. For example, the amount of requests, errors or jobs
 /// processed every 10 seconds.
+namespace details {
+struct CounterCell;
+}
+
 namespace counter {
 
+/// A `Handle` is a counter bound to a set of tags, for counters that are
+/// incremented often. The counter's storage is looked up the first time the
+/// handle is incremented, after which incrementing it is a relaxed atomic add
+/// that neither allocates nor locks.
+///
+/// A `Handle` refers to its `Counter`, which must outlive it. Handles are
+/// meant to be defined at namespace scope alongside their counters.
+class Handle final {
+  friend void increment(const Handle& handle);
+
+  const Counter& counter_;
+  std::vector<std::string> tags_;
+  mutable std::atomic<details::CounterCell*> cell_;
+
+ public:
+  explicit Handle(const Counter& counter, std::vector<std::string> tags = {});
+  Handle(const Handle&) = delete;
+  Handle& operator=(const Handle&) = delete;
+};
+
+/// Increments the counter of the specified `handle` by 1, with the handle's
+/// tags.
+///
+/// @param `handle` the counter and tags to increment.
+void increment(const Handle& handle);
+
 /// Increments the specified counter by 1.
 ///
 /// @param `counter` the counter to increment.
@@ -171,6 +203,11 @@ void set(const Rate& rate, const std::vector<std::string>&, uint64_t value);
 /// The `distribution` namespace provides support for statistical distribution.
 /// Distribution can be useful for tracking things like response times or
 /// payload sizes.
+///
+/// The values added between two heartbeats are summarized in a sketch of
+/// bounded size, rather than kept. The values reported are thus approximate:
+/// each is within 1% of a value that was added. If more than 1024 values were
+/// added, then 1024 values taken at evenly spaced ranks are reported instead.
 namespace distribution {
 
 /// Adds a value to the distribution.
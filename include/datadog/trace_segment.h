@@ -106,6 +106,8 @@ class TraceSegment {
                bool tracing_enabled = true);
 
   const SpanDefaults& defaults() const;
+  // Return the same object as `defaults`, for spans to share.
+  const std::shared_ptr<const SpanDefaults>& shared_defaults() const;
   const Optional<std::string>& hostname() const;
   const Optional<std::string>& origin() const;
   Optional<SamplingDecision> sampling_decision() const;
@@ -60,6 +60,7 @@ class Tracer {
   bool baggage_extraction_enabled_;
   bool tracing_enabled_;
   HttpEndpointCalculationMode resource_renaming_mode_;
+  bool use_trace_arena_;
 
  public:
   // Create a tracer configured using the specified `config`, and optionally:
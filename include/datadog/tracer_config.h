@@ -180,8 +180,10 @@ struct TracerConfig {
   Optional<std::size_t> baggage_max_bytes;
 
   /// The event scheduler used for scheduling recurring tasks.
-  /// By default, it uses `ThreadedEventScheduler`, which runs tasks on a
-  /// separate thread.
+  /// By default, it uses `ThreadedEventScheduler`, which runs tasks on
+  /// separate threads, unless `agent.shared_event_loop` is enabled or
+  /// `agent.host_event_loop` is specified, in which case it uses the agent's
+  /// event scheduler.
   std::shared_ptr<EventScheduler> event_scheduler;
 
   /// `tracing_enabled` indicates whether APM traces and APM trace metrics
@@ -203,6 +205,12 @@ struct TracerConfig {
   // This option is ignored if `resource_renaming_enabled` is not `true`.
   Optional<bool> resource_renaming_always_simplified_endpoint;
 
+  // Whether the spans of each trace segment, and their tags, are allocated
+  // from a per-segment arena that is freed all at once after the segment's
+  // spans are sent, instead of individually from the heap. This is disabled
+  // by default.
+  Optional<bool> use_trace_arena;
+
   /// A mapping of process-specific tags used to uniquely identify processes.
   ///
   /// The `process_tags` map allows associating arbitrary string-based keys and
@@ -254,6 +262,7 @@ class FinalizedTracerConfig final {
   bool tracing_enabled;
   HttpEndpointCalculationMode resource_renaming_mode;
   std::unordered_map<std::string, std::string> process_tags;
+  bool use_trace_arena;
 };
 
 // Return a `FinalizedTracerConfig` from the specified `config` and from any
@@ -0,0 +1,80 @@
+#include "agent_sample_rates.h"
+
+#include "collector_response.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+const StringView service_prefix = "service:";
+const StringView environment_prefix = ",env:";
+
+// `KeyHasher` computes the 64-bit FNV-1a hash of a string given in parts.
+class KeyHasher {
+  std::uint64_t hash_ = 14695981039346656037ULL;
+
+ public:
+  KeyHasher& operator<<(StringView text) {
+    for (const char c : text) {
+      hash_ ^= static_cast<unsigned char>(c);
+      hash_ *= 1099511628211ULL;
+    }
+    return *this;
+  }
+
+  std::uint64_t hash() const { return hash_; }
+};
+
+std::uint64_t hash_key(StringView service, StringView environment) {
+  KeyHasher hasher;
+  hasher << service_prefix << service << environment_prefix << environment;
+  return hasher.hash();
+}
+
+// Return whether the specified `key` is equal to
+// `CollectorResponse::key(service, environment)`.
+bool key_equals(StringView key, StringView service, StringView environment) {
+  if (key.size() != service_prefix.size() + service.size() +
+                        environment_prefix.size() + environment.size()) {
+    return false;
+  }
+  for (const StringView part :
+       {service_prefix, service, environment_prefix, environment}) {
+    if (key.substr(0, part.size()) != part) {
+      return false;
+    }
+    key.remove_prefix(part.size());
+  }
+  return true;
+}
+
+}  // namespace
+
+AgentSampleRates::AgentSampleRates(const CollectorResponse& response,
+                                   const Optional<Rate>& previous_default_rate)
+    : default_rate_(previous_default_rate) {
+  rates_.reserve(response.sample_rate_by_key.size());
+  for (const auto& [key, rate] : response.sample_rate_by_key) {
+    KeyHasher hasher;
+    hasher << key;
+    rates_.emplace(hasher.hash(), std::make_pair(key, rate));
+    if (key == CollectorResponse::key_of_default_rate) {
+      default_rate_ = rate;
+    }
+  }
+}
+
+Optional<Rate> AgentSampleRates::find(StringView service,
+                                      StringView environment) const {
+  const auto [begin, end] = rates_.equal_range(hash_key(service, environment));
+  for (auto entry = begin; entry != end; ++entry) {
+    const auto& [key, rate] = entry->second;
+    if (key_equals(key, service, environment)) {
+      return rate;
+    }
+  }
+  return nullopt;
+}
+
+}  // namespace tracing
+}  // namespace datadog
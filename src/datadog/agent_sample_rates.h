@@ -0,0 +1,48 @@
+#pragma once
+
+// This component provides a class, `AgentSampleRates`, that is a table of the
+// sample rates that the Datadog Agent assigns to each service in each
+// environment. See `CollectorResponse` in `collector_response.h`.
+//
+// `TraceSampler` consults the table for every trace that no sampling rule
+// matches, so `AgentSampleRates::find` does not allocate. Rates are keyed by a
+// hash of the key that `CollectorResponse::key` would produce, computed
+// without producing it.
+
+#include <datadog/optional.h>
+#include <datadog/rate.h>
+#include <datadog/string_view.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace datadog {
+namespace tracing {
+
+struct CollectorResponse;
+
+class AgentSampleRates {
+  // Each entry is the (key, rate) for a key having the hash that maps to it.
+  std::unordered_multimap<std::uint64_t, std::pair<std::string, Rate>> rates_;
+  Optional<Rate> default_rate_;
+
+ public:
+  // Create an empty table.
+  AgentSampleRates() = default;
+  // Create a table containing the rates in the specified `response`. If
+  // `response` does not contain a default rate, then use the specified
+  // `previous_default_rate` instead.
+  AgentSampleRates(const CollectorResponse& response,
+                   const Optional<Rate>& previous_default_rate);
+
+  // Return the rate for the specified `service` in the specified
+  // `environment`, or return `nullopt` if there is none.
+  Optional<Rate> find(StringView service, StringView environment) const;
+
+  const Optional<Rate>& default_rate() const { return default_rate_; }
+};
+
+}  // namespace tracing
+}  // namespace datadog
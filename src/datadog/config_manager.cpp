@@ -291,7 +291,8 @@ ConfigManager::ConfigManager(const FinalizedTracerConfig& config)
           std::make_shared<TraceSampler>(config.trace_sampler, clock_)),
       rules_(config.trace_sampler.rules),
       span_defaults_(std::make_shared<SpanDefaults>(config.defaults)),
-      report_traces_(config.report_traces) {
+      report_traces_(config.report_traces),
+      snapshot_(make_snapshot()) {
   // Extract winning value (last entry) from each config's metadata history
   for (const auto& [name, metadata_vec] : config.metadata) {
     if (!metadata_vec.empty()) {
@@ -328,28 +329,29 @@ Optional<std::string> ConfigManager::on_update(const Configuration& config) {
 
 void ConfigManager::on_revert(const Configuration&) { apply_update({}); }
 
+std::shared_ptr<const ConfigManager::Snapshot> ConfigManager::make_snapshot()
+    const {
+  return std::make_shared<const Snapshot>(Snapshot{
+      trace_sampler_, span_defaults_.value(), report_traces_.value()});
+}
+
 std::shared_ptr<TraceSampler> ConfigManager::trace_sampler() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return trace_sampler_;
+  return snapshot_.get().trace_sampler;
 }
 
 std::shared_ptr<const SpanDefaults> ConfigManager::span_defaults() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return span_defaults_.value();
+  return snapshot_.get().span_defaults;
 }
 
-bool ConfigManager::report_traces() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return report_traces_.value();
-}
+bool ConfigManager::report_traces() { return snapshot_.get().report_traces; }
 
 void ConfigManager::apply_update(const ConfigManager::Update& conf) {
   std::vector<ConfigMetadata> metadata;
 
-  // TODO: We're doing too much while holding the lock. Refactor to reduce lock
-  // contention.
+  // Readers use the previously published snapshot until this update publishes
+  // its own, so holding `update_mutex_` here doesn't block them.
   {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(update_mutex_);
 
     // NOTE(@dmehala): Sampling rules are generally not well specified.
     //
@@ -441,6 +443,8 @@ void ConfigManager::apply_update(const ConfigManager::Update& conf) {
                               ConfigMetadata::Origin::REMOTE_CONFIG);
       }
     }
+
+    snapshot_.publish(make_snapshot());
   }
 
   telemetry::capture_configuration_change(metadata);
@@ -456,10 +460,10 @@ void ConfigManager::reset_config(ConfigName name, T& conf,
 }
 
 nlohmann::json ConfigManager::config_json() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return nlohmann::json{{"defaults", to_json(*span_defaults_.value())},
-                        {"trace_sampler", trace_sampler_->config_json()},
-                        {"report_traces", report_traces_.value()}};
+  const Snapshot& current = snapshot_.get();
+  return nlohmann::json{{"defaults", to_json(*current.span_defaults)},
+                        {"trace_sampler", current.trace_sampler->config_json()},
+                        {"report_traces", current.report_traces}};
 }
 
 }  // namespace tracing
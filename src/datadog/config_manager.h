@@ -2,8 +2,13 @@
 
 // The `ConfigManager` class is designed to handle configuration update
 // and provide access to the current configuration.
-// It utilizes a mutex to ensure thread safety when updating or accessing
-// the configuration.
+//
+// The current configuration is an immutable `Snapshot`. An update builds a new
+// snapshot and then publishes it, so that the configuration can be read
+// without waiting on an update in progress. Each thread caches the most recent
+// snapshot that it has read from each `ConfigManager`, and reading the
+// configuration locks only when a newer snapshot has been published since.
+// The cached snapshots are released when the `ConfigManager` is destroyed.
 
 #include <datadog/clock.h>
 #include <datadog/optional.h>
@@ -11,9 +16,11 @@
 #include <datadog/span_defaults.h>
 #include <datadog/tracer_config.h>
 
+#include <memory>
 #include <mutex>
 
 #include "json.hpp"
+#include "published.h"
 
 namespace datadog {
 namespace tracing {
@@ -32,6 +39,14 @@ class ConfigManager : public remote_config::Listener {
     Optional<std::vector<TraceSamplerRule>> trace_sampling_rules;
   };
 
+  // The `Snapshot` struct is the configuration published by an update. A
+  // published snapshot is never modified.
+  struct Snapshot final {
+    std::shared_ptr<TraceSampler> trace_sampler;
+    std::shared_ptr<const SpanDefaults> span_defaults;
+    bool report_traces;
+  };
+
  private:
   // A class template for managing dynamic configuration values.
   //
@@ -65,7 +80,9 @@ class ConfigManager : public remote_config::Listener {
     void operator=(const Value& rhs) { current_value_ = rhs; }
   };
 
-  mutable std::mutex mutex_;
+  // `update_mutex_` serializes updates, and guards the data members that only
+  // updates use, which are those declared after it other than `snapshot_`.
+  mutable std::mutex update_mutex_;
   Clock clock_;
   std::unordered_map<ConfigName, ConfigMetadata> default_metadata_;
 
@@ -75,11 +92,18 @@ class ConfigManager : public remote_config::Listener {
   DynamicConfig<std::shared_ptr<const SpanDefaults>> span_defaults_;
   DynamicConfig<bool> report_traces_;
 
+  Published<Snapshot> snapshot_;
+
  private:
   template <typename T>
   void reset_config(ConfigName name, T& conf,
                     std::vector<ConfigMetadata>& metadata);
 
+  // Return a snapshot made from the current values of the configuration. The
+  // behavior is undefined unless `update_mutex_` is locked by the caller, or
+  // the caller is the constructor.
+  std::shared_ptr<const Snapshot> make_snapshot() const;
+
  public:
   ConfigManager(const FinalizedTracerConfig& config);
   ~ConfigManager() override{};
@@ -3,16 +3,21 @@
 #include <datadog/dict_reader.h>
 #include <datadog/dict_writer.h>
 #include <datadog/logger.h>
+#include <datadog/telemetry/telemetry.h>
 
+#include <algorithm>
 #include <condition_variable>
+#include <limits>
 #include <list>
 #include <mutex>
 #include <system_error>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "json.hpp"
 #include "string_util.h"
+#include "telemetry_metrics.h"
 
 namespace datadog::tracing {
 
@@ -88,12 +93,26 @@ void throw_on_error(CURLcode result) {
   }
 }
 
+// The greatest number of idle request handles kept for one endpoint.
+constexpr std::size_t max_idle_handles_per_endpoint = 4;
+
+namespace counters {
+const telemetry::counter::Handle new_connection{
+    metrics::tracer::http_client::requests, {"connection:new"}};
+const telemetry::counter::Handle reused_connection{
+    metrics::tracer::http_client::requests, {"connection:reused"}};
+}  // namespace counters
+
 }  // namespace
 
 CURL *CurlLibrary::easy_init() { return curl_easy_init(); }
 
 void CurlLibrary::easy_cleanup(CURL *handle) { curl_easy_cleanup(handle); }
 
+CURLcode CurlLibrary::easy_getinfo_num_connects(CURL *curl, long *count) {
+  return curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, count);
+}
+
 CURLcode CurlLibrary::easy_getinfo_private(CURL *curl, char **user_data) {
   return curl_easy_getinfo(curl, CURLINFO_PRIVATE, user_data);
 }
@@ -162,6 +181,10 @@ CURLcode CurlLibrary::easy_setopt_writefunction(CURL *handle,
   return curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, on_write);
 }
 
+CURLcode CurlLibrary::easy_setopt_tcp_keepalive(CURL *handle, long enabled) {
+  return curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, enabled);
+}
+
 CURLcode CurlLibrary::easy_setopt_timeout_ms(CURL *handle, long timeout_ms) {
   return curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, timeout_ms);
 }
@@ -185,6 +208,13 @@ CURLMcode CurlLibrary::multi_cleanup(CURLM *multi_handle) {
   return curl_multi_cleanup(multi_handle);
 }
 
+CURLMcode CurlLibrary::multi_fdset(CURLM *multi_handle, fd_set *read_fd_set,
+                                   fd_set *write_fd_set, fd_set *exc_fd_set,
+                                   int *max_fd) {
+  return curl_multi_fdset(multi_handle, read_fd_set, write_fd_set, exc_fd_set,
+                          max_fd);
+}
+
 CURLMsg *CurlLibrary::multi_info_read(CURLM *multi_handle, int *msgs_in_queue) {
   return curl_multi_info_read(multi_handle, msgs_in_queue);
 }
@@ -212,10 +242,21 @@ const char *CurlLibrary::multi_strerror(CURLMcode error) {
   return curl_multi_strerror(error);
 }
 
+CURLMcode CurlLibrary::multi_timeout(CURLM *multi_handle, long *milliseconds) {
+  return curl_multi_timeout(multi_handle, milliseconds);
+}
+
 CURLMcode CurlLibrary::multi_wakeup(CURLM *multi_handle) {
   return curl_multi_wakeup(multi_handle);
 }
 
+#if LIBCURL_VERSION_NUM >= 0x080800
+CURLMcode CurlLibrary::multi_waitfds(CURLM *multi_handle, curl_waitfd *ufds,
+                                     unsigned size, unsigned *fd_count) {
+  return curl_multi_waitfds(multi_handle, ufds, size, fd_count);
+}
+#endif
+
 curl_slist *CurlLibrary::slist_append(curl_slist *list, const char *string) {
   return curl_slist_append(list, string);
 }
@@ -239,33 +280,62 @@ class CurlImpl {
   std::list<CURL *> new_handles_;
   bool shutting_down_;
   int num_active_handles_;
+  // `num_running_handles_` is used only by the thread that drives the event
+  // loop.
+  int num_running_handles_;
   const ProxyConfiguration proxy_config_;
   std::condition_variable no_requests_;
+  // `event_loop_` is not running if this object was created `Curl::Driven`.
   std::thread event_loop_;
+  // `driver_` is the thread that most recently called `perform`, i.e.
+  // `event_loop_` or the thread that drives this object.
+  std::thread::id driver_;
+
+  // `EasyHandle` is a libcurl "easy handle" together with the options that it
+  // keeps from one request to the next: those of its endpoint, and its list of
+  // request headers.
+  struct EasyHandle {
+    CurlLibrary *curl = nullptr;
+    CURL *handle = nullptr;
+    // `endpoint` is the scheme and authority of the URLs that `handle` is
+    // configured for.
+    std::string endpoint;
+    // `headers` is the list of `header_lines`. `next_header_lines` are the
+    // headers of the next request, which are compared with `header_lines` so
+    // that only the headers that changed are copied into `headers`.
+    curl_slist *headers = nullptr;
+    std::vector<std::string> header_lines;
+    std::vector<std::string> next_header_lines;
+
+    ~EasyHandle();
+    void update_headers();
+  };
+
+  // `idle_handles_` are the handles not in use by a request, by endpoint.
+  std::unordered_map<std::string, std::vector<std::unique_ptr<EasyHandle>>>
+      idle_handles_;
 
   struct Request {
-    CurlLibrary *curl = nullptr;
-    curl_slist *request_headers = nullptr;
-    std::string request_body;
+    std::unique_ptr<EasyHandle> handle;
+    // `request_body` might be shared with the caller of `post_shared`.
+    std::shared_ptr<const std::string> request_body;
     ResponseHandler on_response;
     ErrorHandler on_error;
     char error_buffer[CURL_ERROR_SIZE] = "";
     std::unordered_map<std::string, std::string> response_headers_lower;
     std::string response_body;
     std::chrono::steady_clock::time_point deadline;
-
-    ~Request();
   };
 
+  // `HeaderWriter` writes request headers as lines of the form "Key: Value",
+  // reusing the storage of the lines of the previous request.
   class HeaderWriter : public DictWriter {
-    curl_slist *list_ = nullptr;
-    std::string buffer_;
-    CurlLibrary &curl_;
+    std::vector<std::string> &lines_;
+    std::size_t size_ = 0;
 
    public:
-    explicit HeaderWriter(CurlLibrary &curl);
+    explicit HeaderWriter(std::vector<std::string> &lines);
     ~HeaderWriter();
-    curl_slist *release();
     void set(StringView key, StringView value) override;
   };
 
@@ -282,7 +352,11 @@ class CurlImpl {
   };
 
   void run();
-  void configure_handle(CURL *handle, Request &request, const URL &url);
+  std::unique_ptr<EasyHandle> acquire_handle(const URL &url,
+                                             std::string endpoint);
+  void release_handle(std::unique_ptr<EasyHandle> handle);
+  void configure_endpoint(EasyHandle &handle, const URL &url);
+  void configure_request(Request &request, const URL &url);
   void handle_message(const CURLMsg &);
   CURLcode log_on_error(CURLcode result);
   CURLMcode log_on_error(CURLMcode result);
@@ -295,15 +369,30 @@ class CurlImpl {
  public:
   explicit CurlImpl(const std::shared_ptr<Logger> &, const Clock &,
                     CurlLibrary &, const Curl::ThreadGenerator &);
+  CurlImpl(const std::shared_ptr<Logger> &, const Clock &, CurlLibrary &,
+           Curl::Driven);
   ~CurlImpl();
 
   Expected<void> post(const URL &url, HeadersSetter set_headers,
-                      std::string body, ResponseHandler on_response,
-                      ErrorHandler on_error,
+                      std::shared_ptr<const std::string> body,
+                      ResponseHandler on_response, ErrorHandler on_error,
                       std::chrono::steady_clock::time_point deadline);
 
   void drain(std::chrono::steady_clock::time_point deadline);
 
+  // Add the requests posted since the previous call to the multi-handle, and
+  // then make progress on their transfers. Return `false` if this object is
+  // shutting down, in which case no transfers are performed.
+  bool perform();
+  void wait(std::chrono::steady_clock::duration timeout);
+  void wakeup();
+  void file_descriptors(std::vector<Curl::FileDescriptor> &fds);
+  Optional<std::chrono::steady_clock::duration> timeout();
+
+  // Return the number of requests that have been added to the multi-handle
+  // but are not yet done.
+  std::size_t num_outstanding() const;
+
   void clear_requests();
 };
 
@@ -319,19 +408,56 @@ Curl::Curl(const std::shared_ptr<Logger> &logger, const Clock &clock,
            CurlLibrary &curl, const Curl::ThreadGenerator &make_thread)
     : impl_(new CurlImpl{logger, clock, curl, make_thread}) {}
 
+Curl::Curl(const std::shared_ptr<Logger> &logger, const Clock &clock,
+           Driven driven)
+    : Curl(logger, clock, libcurl, driven) {}
+
+Curl::Curl(const std::shared_ptr<Logger> &logger, const Clock &clock,
+           CurlLibrary &curl, Driven driven)
+    : impl_(new CurlImpl{logger, clock, curl, driven}) {}
+
 Curl::~Curl() { delete impl_; }
 
 Expected<void> Curl::post(const URL &url, HeadersSetter set_headers,
                           std::string body, ResponseHandler on_response,
                           ErrorHandler on_error,
                           std::chrono::steady_clock::time_point deadline) {
-  return impl_->post(url, set_headers, body, on_response, on_error, deadline);
+  return impl_->post(url, std::move(set_headers),
+                     std::make_shared<const std::string>(std::move(body)),
+                     std::move(on_response), std::move(on_error), deadline);
+}
+
+Expected<void> Curl::post_shared(
+    const URL &url, HeadersSetter set_headers,
+    std::shared_ptr<const std::string> body, ResponseHandler on_response,
+    ErrorHandler on_error, std::chrono::steady_clock::time_point deadline) {
+  return impl_->post(url, std::move(set_headers), std::move(body),
+                     std::move(on_response), std::move(on_error), deadline);
 }
 
 void Curl::drain(std::chrono::steady_clock::time_point deadline) {
   impl_->drain(deadline);
 }
 
+std::size_t Curl::perform() {
+  impl_->perform();
+  return impl_->num_outstanding();
+}
+
+void Curl::wait(std::chrono::steady_clock::duration timeout) {
+  impl_->wait(timeout);
+}
+
+void Curl::wakeup() { impl_->wakeup(); }
+
+void Curl::file_descriptors(std::vector<FileDescriptor> &fds) {
+  impl_->file_descriptors(fds);
+}
+
+Optional<std::chrono::steady_clock::duration> Curl::timeout() {
+  return impl_->timeout();
+}
+
 std::string Curl::config() const {
   return nlohmann::json::object({{"type", "datadog::tracing::Curl"}}).dump();
 }
@@ -343,6 +469,7 @@ CurlImpl::CurlImpl(const std::shared_ptr<Logger> &logger, const Clock &clock,
       clock_(clock),
       shutting_down_(false),
       num_active_handles_(0),
+      num_running_handles_(0),
       proxy_config_(load_proxy_configuration()) {
   curl_.global_init(CURL_GLOBAL_ALL);
   multi_handle_ = curl_.multi_init();
@@ -369,6 +496,25 @@ CurlImpl::CurlImpl(const std::shared_ptr<Logger> &logger, const Clock &clock,
   }
 }
 
+CurlImpl::CurlImpl(const std::shared_ptr<Logger> &logger, const Clock &clock,
+                   CurlLibrary &curl, Curl::Driven)
+    : curl_(curl),
+      logger_(logger),
+      clock_(clock),
+      shutting_down_(false),
+      num_active_handles_(0),
+      num_running_handles_(0),
+      proxy_config_(load_proxy_configuration()) {
+  curl_.global_init(CURL_GLOBAL_ALL);
+  multi_handle_ = curl_.multi_init();
+  if (multi_handle_ == nullptr) {
+    logger_->log_error(Error{
+        Error::CURL_HTTP_CLIENT_SETUP_FAILED,
+        "Unable to initialize a curl multi-handle for sending requests."});
+    curl_.global_cleanup();
+  }
+}
+
 CurlImpl::~CurlImpl() {
   if (multi_handle_ == nullptr) {
     // We're not running; nothing to shut down.
@@ -379,55 +525,55 @@ CurlImpl::~CurlImpl() {
     std::lock_guard<std::mutex> lock(mutex_);
     shutting_down_ = true;
   }
-  log_on_error(curl_.multi_wakeup(multi_handle_));
-  event_loop_.join();
+  if (event_loop_.joinable()) {
+    log_on_error(curl_.multi_wakeup(multi_handle_));
+    event_loop_.join();
+  } else {
+    // Whoever drove this object has stopped doing so. Take ownership of the
+    // requests posted since, so that they're cleaned up with the others.
+    perform();
+    clear_requests();
+  }
 
+  idle_handles_.clear();
   log_on_error(curl_.multi_cleanup(multi_handle_));
   curl_.global_cleanup();
 }
 
 Expected<void> CurlImpl::post(
-    const HTTPClient::URL &url, HeadersSetter set_headers, std::string body,
-    ResponseHandler on_response, ErrorHandler on_error,
-    std::chrono::steady_clock::time_point deadline) try {
+    const HTTPClient::URL &url, HeadersSetter set_headers,
+    std::shared_ptr<const std::string> body, ResponseHandler on_response,
+    ErrorHandler on_error, std::chrono::steady_clock::time_point deadline) try {
   if (multi_handle_ == nullptr) {
     return Error{Error::CURL_HTTP_CLIENT_NOT_RUNNING,
                  "Unable to send request via libcurl because the HTTP client "
                  "failed to start."};
   }
 
-  HeaderWriter writer{curl_};
-  set_headers(writer);
-  auto cleanup_list = [&](auto list) { curl_.slist_free_all(list); };
-  std::unique_ptr<curl_slist, decltype(cleanup_list)> headers{
-      writer.release(), std::move(cleanup_list)};
-
   auto request = std::make_unique<Request>();
+  request->handle = acquire_handle(url, url.scheme + "://" + url.authority);
+  if (!request->handle) {
+    return Error{Error::CURL_REQUEST_SETUP_FAILED,
+                 "unable to initialize a curl handle for request sending"};
+  }
+
+  {
+    HeaderWriter writer{request->handle->next_header_lines};
+    set_headers(writer);
+  }
+  request->handle->update_headers();
 
-  request->curl = &curl_;
-  request->request_headers = headers.get();
   request->request_body = std::move(body);
   request->on_response = std::move(on_response);
   request->on_error = std::move(on_error);
   request->deadline = std::move(deadline);
 
-  auto cleanup_handle = [&](auto handle) { curl_.easy_cleanup(handle); };
-  std::unique_ptr<CURL, decltype(cleanup_handle)> handle{
-      curl_.easy_init(), std::move(cleanup_handle)};
-
-  if (!handle) {
-    return Error{Error::CURL_REQUEST_SETUP_FAILED,
-                 "unable to initialize a curl handle for request sending"};
-  }
-
-  configure_handle(handle.get(), *request, url);
+  configure_request(*request, url);
 
   {
     std::lock_guard<std::mutex> lock(mutex_);
-    new_handles_.emplace_back(handle.get());
+    new_handles_.emplace_back(request->handle->handle);
   }
-  std::ignore = headers.release();
-  std::ignore = handle.release();
   std::ignore = request.release();
 
   log_on_error(curl_.multi_wakeup(multi_handle_));
@@ -437,20 +583,42 @@ Expected<void> CurlImpl::post(
   return Error{Error::CURL_REQUEST_SETUP_FAILED, curl_.easy_strerror(error)};
 }
 
-void CurlImpl::configure_handle(CURL *handle, Request &request,
-                                const URL &url) {
-  throw_on_error(curl_.easy_setopt_httpheader(handle, request.request_headers));
-  throw_on_error(curl_.easy_setopt_private(handle, &request));
-  throw_on_error(curl_.easy_setopt_errorbuffer(handle, request.error_buffer));
+std::unique_ptr<CurlImpl::EasyHandle> CurlImpl::acquire_handle(
+    const URL &url, std::string endpoint) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = idle_handles_.find(endpoint);
+    if (found != idle_handles_.end() && !found->second.empty()) {
+      std::unique_ptr<EasyHandle> handle = std::move(found->second.back());
+      found->second.pop_back();
+      return handle;
+    }
+  }
+
+  auto handle = std::make_unique<EasyHandle>();
+  handle->curl = &curl_;
+  handle->handle = curl_.easy_init();
+  if (handle->handle == nullptr) {
+    return nullptr;
+  }
+  handle->endpoint = std::move(endpoint);
+  configure_endpoint(*handle, url);
+  return handle;
+}
+
+void CurlImpl::release_handle(std::unique_ptr<EasyHandle> handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &idle = idle_handles_[handle->endpoint];
+  if (idle.size() < max_idle_handles_per_endpoint) {
+    idle.push_back(std::move(handle));
+  }
+}
+
+void CurlImpl::configure_endpoint(EasyHandle &easy, const URL &url) {
+  CURL *const handle = easy.handle;
   throw_on_error(curl_.easy_setopt_post(handle, 1));
-  throw_on_error(curl_.easy_setopt_postfieldsize(
-      handle, static_cast<long>(request.request_body.size())));
-  throw_on_error(
-      curl_.easy_setopt_postfields(handle, request.request_body.data()));
   throw_on_error(curl_.easy_setopt_headerfunction(handle, &on_read_header));
-  throw_on_error(curl_.easy_setopt_headerdata(handle, &request));
   throw_on_error(curl_.easy_setopt_writefunction(handle, &on_read_body));
-  throw_on_error(curl_.easy_setopt_writedata(handle, &request));
 
   throw_on_error(curl_.easy_setopt_noproxy(
       handle, proxy_config_.no_proxy ? proxy_config_.no_proxy->c_str() : ""));
@@ -460,6 +628,24 @@ void CurlImpl::configure_handle(CURL *handle, Request &request,
   if (is_unix_socket(url)) {
     throw_on_error(
         curl_.easy_setopt_unix_socket_path(handle, url.authority.c_str()));
+  } else {
+    throw_on_error(curl_.easy_setopt_tcp_keepalive(handle, 1));
+  }
+}
+
+void CurlImpl::configure_request(Request &request, const URL &url) {
+  CURL *const handle = request.handle->handle;
+  throw_on_error(curl_.easy_setopt_httpheader(handle, request.handle->headers));
+  throw_on_error(curl_.easy_setopt_private(handle, &request));
+  throw_on_error(curl_.easy_setopt_errorbuffer(handle, request.error_buffer));
+  throw_on_error(curl_.easy_setopt_postfieldsize(
+      handle, static_cast<long>(request.request_body->size())));
+  throw_on_error(
+      curl_.easy_setopt_postfields(handle, request.request_body->data()));
+  throw_on_error(curl_.easy_setopt_headerdata(handle, &request));
+  throw_on_error(curl_.easy_setopt_writedata(handle, &request));
+
+  if (is_unix_socket(url)) {
     // The authority section of the URL is ignored when a unix domain socket is
     // to be used.
     throw_on_error(
@@ -472,14 +658,14 @@ void CurlImpl::configure_handle(CURL *handle, Request &request,
 
 void CurlImpl::clear_requests() {
   for (const auto &handle : request_handles_) {
+    log_on_error(curl_.multi_remove_handle(multi_handle_, handle));
+
+    // Deleting the request cleans up its handle.
     char *user_data;
     if (log_on_error(curl_.easy_getinfo_private(handle, &user_data)) ==
         CURLE_OK) {
       delete reinterpret_cast<Request *>(user_data);
     }
-
-    log_on_error(curl_.multi_remove_handle(multi_handle_, handle));
-    curl_.easy_cleanup(handle);
   }
 
   request_handles_.clear();
@@ -489,6 +675,12 @@ void CurlImpl::drain(std::chrono::steady_clock::time_point deadline) {
   log_on_error(curl_.multi_wakeup(multi_handle_));
 
   std::unique_lock<std::mutex> lock(mutex_);
+  if (std::this_thread::get_id() == driver_) {
+    // The requests make progress only when this thread performs them, which
+    // it can't do while waiting here, e.g. in a callback of the `EventLoop`
+    // that drives this object. They instead finish once the callback returns.
+    return;
+  }
   no_requests_.wait_until(lock, deadline, [this]() {
     curl_.multi_wakeup(multi_handle_);
     return num_active_handles_ == 0 && new_handles_.empty();
@@ -551,86 +743,206 @@ CURLMcode CurlImpl::log_on_error(CURLMcode result) {
 }
 
 void CurlImpl::run() {
-  int num_active_handles = 0;
-  int num_messages_remaining = 0;
+  constexpr auto max_wait = std::chrono::seconds(10);
 
-  bool shutting_down = false;
-  CURLMsg *message = nullptr;
-  constexpr int max_wait_milliseconds = 10'000;
+  while (perform()) {
+    wait(max_wait);
+  }
 
-  std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+  // We're shutting down. Clean up any remaining request handles.
+  clear_requests();
+}
+
+bool CurlImpl::perform() {
+  if (multi_handle_ == nullptr) {
+    return false;
+  }
+
+  int num_messages_remaining = 0;
+  CURLMsg *message = nullptr;
   std::list<CURL *> handles_to_process;
 
-  while (true) {
-    lock.lock();
-    shutting_down = shutting_down_;
-
-    handles_to_process.splice(handles_to_process.begin(), new_handles_);
-    assert(new_handles_.empty());
-
-    num_active_handles_ =
-        num_active_handles + static_cast<int>(handles_to_process.size());
-    lock.unlock();
-
-    no_requests_.notify_all();
-
-    // New requests might have been added while we were sleeping.
-    for (; !handles_to_process.empty(); handles_to_process.pop_front()) {
-      CURL *handle = handles_to_process.front();
-      char *user_data;
-      if (log_on_error(curl_.easy_getinfo_private(handle, &user_data)) !=
-          CURLE_OK) {
-        curl_.easy_cleanup(handle);
-        continue;
-      }
-
-      auto *request = reinterpret_cast<Request *>(user_data);
-      const auto timeout = request->deadline - clock_().tick;
-      if (timeout <= std::chrono::steady_clock::time_point::duration::zero()) {
-        std::string error_message;
-        error_message +=
-            "Request deadline exceeded before request was even added to "
-            "libcurl "
-            "event loop. Deadline was ";
-        error_message += std::to_string(
-            -std::chrono::duration_cast<std::chrono::nanoseconds>(timeout)
-                 .count());
-        error_message += " nanoseconds ago.";
-        request->on_error(
-            Error{Error::CURL_DEADLINE_EXCEEDED_BEFORE_REQUEST_START,
-                  std::move(error_message)});
-
-        curl_.easy_cleanup(handle);
-        delete request;
-
-        continue;
-      }
-
-      log_on_error(curl_.easy_setopt_timeout_ms(
-          handle,
-          static_cast<long>(
-              std::chrono::duration_cast<std::chrono::milliseconds>(timeout)
-                  .count())));
-      log_on_error(curl_.multi_add_handle(multi_handle_, handle));
-      request_handles_.insert(handle);
+  std::unique_lock<std::mutex> lock(mutex_);
+  const bool shutting_down = shutting_down_;
+  driver_ = std::this_thread::get_id();
+
+  handles_to_process.splice(handles_to_process.begin(), new_handles_);
+  assert(new_handles_.empty());
+
+  num_active_handles_ =
+      num_running_handles_ + static_cast<int>(handles_to_process.size());
+  lock.unlock();
+
+  no_requests_.notify_all();
+
+  // New requests might have been added while we were sleeping.
+  for (; !handles_to_process.empty(); handles_to_process.pop_front()) {
+    CURL *handle = handles_to_process.front();
+    char *user_data;
+    if (log_on_error(curl_.easy_getinfo_private(handle, &user_data)) !=
+        CURLE_OK) {
+      curl_.easy_cleanup(handle);
+      continue;
     }
 
-    if (shutting_down) break;
+    auto *request = reinterpret_cast<Request *>(user_data);
+    const auto timeout = request->deadline - clock_().tick;
+    if (timeout <= std::chrono::steady_clock::time_point::duration::zero()) {
+      std::string error_message;
+      error_message +=
+          "Request deadline exceeded before request was even added to "
+          "libcurl "
+          "event loop. Deadline was ";
+      error_message += std::to_string(
+          -std::chrono::duration_cast<std::chrono::nanoseconds>(timeout)
+               .count());
+      error_message += " nanoseconds ago.";
+      request->on_error(
+          Error{Error::CURL_DEADLINE_EXCEEDED_BEFORE_REQUEST_START,
+                std::move(error_message)});
+
+      release_handle(std::move(request->handle));
+      delete request;
+
+      continue;
+    }
+
+    log_on_error(curl_.easy_setopt_timeout_ms(
+        handle,
+        static_cast<long>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(timeout)
+                .count())));
+    log_on_error(curl_.multi_add_handle(multi_handle_, handle));
+    request_handles_.insert(handle);
+  }
+
+  if (shutting_down) {
+    return false;
+  }
+
+  log_on_error(curl_.multi_perform(multi_handle_, &num_running_handles_));
+
+  // If a request is done or errored out, curl will enqueue a "message" for
+  // us to handle. Handle any pending messages.
+  while ((message = curl_.multi_info_read(multi_handle_,
+                                          &num_messages_remaining))) {
+    handle_message(*message);
+  }
+  return true;
+}
 
-    log_on_error(curl_.multi_perform(multi_handle_, &num_active_handles));
+void CurlImpl::wait(std::chrono::steady_clock::duration timeout) {
+  if (multi_handle_ == nullptr) {
+    return;
+  }
+
+  // Round up, so that a timeout of less than a millisecond doesn't make the
+  // caller spin.
+  const auto milliseconds = std::chrono::ceil<std::chrono::milliseconds>(
+      std::max(timeout, std::chrono::steady_clock::duration::zero()));
+  const auto max_milliseconds = std::chrono::milliseconds(
+      std::numeric_limits<int>::max());
+  log_on_error(curl_.multi_poll(
+      multi_handle_, nullptr, 0,
+      static_cast<int>(std::min(milliseconds, max_milliseconds).count()),
+      nullptr));
+}
 
-    // If a request is done or errored out, curl will enqueue a "message" for
-    // us to handle. Handle any pending messages.
-    while ((message = curl_.multi_info_read(multi_handle_,
-                                            &num_messages_remaining))) {
-      handle_message(*message);
+void CurlImpl::wakeup() {
+  if (multi_handle_ != nullptr) {
+    log_on_error(curl_.multi_wakeup(multi_handle_));
+  }
+}
+
+void CurlImpl::file_descriptors(std::vector<Curl::FileDescriptor> &fds) {
+  if (multi_handle_ == nullptr) {
+    return;
+  }
+
+#if LIBCURL_VERSION_NUM >= 0x080800
+  std::vector<curl_waitfd> waitfds(8);
+  unsigned fd_count = 0;
+  CURLMcode result;
+  while ((result = curl_.multi_waitfds(
+              multi_handle_, waitfds.data(),
+              static_cast<unsigned>(waitfds.size()), &fd_count)) ==
+             CURLM_OUT_OF_MEMORY &&
+         fd_count > waitfds.size()) {
+    // `waitfds` was too small. `fd_count` is the size that it needs to be.
+    waitfds.resize(fd_count);
+  }
+  if (log_on_error(result) != CURLM_OK) {
+    return;
+  }
+  for (unsigned i = 0; i < fd_count; ++i) {
+    const auto &waitfd = waitfds[i];
+    fds.push_back(Curl::FileDescriptor{
+        static_cast<int>(waitfd.fd), (waitfd.events & CURL_WAIT_POLLIN) != 0,
+        (waitfd.events & CURL_WAIT_POLLOUT) != 0});
+  }
+#else
+  // `curl_multi_waitfds` was introduced in libcurl 8.8.0. Older versions
+  // expose the multi-handle's file descriptors only as an `fd_set`.
+  fd_set readable;
+  fd_set writable;
+  fd_set exceptional;
+  FD_ZERO(&readable);
+  FD_ZERO(&writable);
+  FD_ZERO(&exceptional);
+  int max_fd = -1;
+  if (log_on_error(curl_.multi_fdset(multi_handle_, &readable, &writable,
+                                     &exceptional, &max_fd)) != CURLM_OK) {
+    return;
+  }
+  for (int fd = 0; fd <= max_fd; ++fd) {
+    const bool is_readable = FD_ISSET(fd, &readable);
+    const bool is_writable = FD_ISSET(fd, &writable);
+    if (is_readable || is_writable) {
+      fds.push_back(Curl::FileDescriptor{fd, is_readable, is_writable});
     }
-    log_on_error(curl_.multi_poll(multi_handle_, nullptr, 0,
-                                  max_wait_milliseconds, nullptr));
   }
+#endif
+}
 
-  // We're shutting down. Clean up any remaining request handles.
-  clear_requests();
+Optional<std::chrono::steady_clock::duration> CurlImpl::timeout() {
+  if (multi_handle_ == nullptr) {
+    return nullopt;
+  }
+
+  long milliseconds = -1;
+  if (log_on_error(curl_.multi_timeout(multi_handle_, &milliseconds)) !=
+      CURLM_OK) {
+    milliseconds = -1;
+  }
+#if LIBCURL_VERSION_NUM < 0x080800
+  // A transfer can be in progress without having a file descriptor in the
+  // `fd_set`, e.g. while it's resolving a host name. libcurl then recommends
+  // performing again after a short while.
+  if (num_running_handles_ != 0) {
+    constexpr long poll_milliseconds = 100;
+    int max_fd = -1;
+    fd_set readable;
+    fd_set writable;
+    fd_set exceptional;
+    FD_ZERO(&readable);
+    FD_ZERO(&writable);
+    FD_ZERO(&exceptional);
+    if (curl_.multi_fdset(multi_handle_, &readable, &writable, &exceptional,
+                          &max_fd) == CURLM_OK &&
+        max_fd == -1 &&
+        (milliseconds < 0 || milliseconds > poll_milliseconds)) {
+      milliseconds = poll_milliseconds;
+    }
+  }
+#endif
+  if (milliseconds < 0) {
+    return nullopt;
+  }
+  return std::chrono::milliseconds(milliseconds);
+}
+
+std::size_t CurlImpl::num_outstanding() const {
+  return request_handles_.size();
 }
 
 void CurlImpl::handle_message(const CURLMsg &message) {
@@ -668,31 +980,79 @@ void CurlImpl::handle_message(const CURLMsg &message) {
                         std::move(request.response_body));
   }
 
+  long num_connects;
+  if (log_on_error(curl_.easy_getinfo_num_connects(request_handle,
+                                                   &num_connects)) ==
+      CURLE_OK) {
+    telemetry::counter::increment(num_connects == 0
+                                      ? counters::reused_connection
+                                      : counters::new_connection);
+  }
+
   log_on_error(curl_.multi_remove_handle(multi_handle_, request_handle));
-  curl_.easy_cleanup(request_handle);
   request_handles_.erase(request_handle);
+  release_handle(std::move(request.handle));
   delete &request;
 }
 
-CurlImpl::Request::~Request() { curl->slist_free_all(request_headers); }
-
-CurlImpl::HeaderWriter::HeaderWriter(CurlLibrary &curl) : curl_(curl) {}
+CurlImpl::EasyHandle::~EasyHandle() {
+  curl->slist_free_all(headers);
+  if (handle != nullptr) {
+    curl->easy_cleanup(handle);
+  }
+}
 
-CurlImpl::HeaderWriter::~HeaderWriter() { curl_.slist_free_all(list_); }
+void CurlImpl::EasyHandle::update_headers() {
+  // Keep the part of `headers` that is the same as the beginning of
+  // `next_header_lines`, and replace the rest.
+  std::size_t num_kept = 0;
+  curl_slist *last_kept = nullptr;
+  while (num_kept < header_lines.size() &&
+         num_kept < next_header_lines.size() &&
+         header_lines[num_kept] == next_header_lines[num_kept]) {
+    last_kept = last_kept == nullptr ? headers : last_kept->next;
+    ++num_kept;
+  }
+  if (num_kept == header_lines.size() &&
+      num_kept == next_header_lines.size()) {
+    return;
+  }
 
-curl_slist *CurlImpl::HeaderWriter::release() {
-  auto list = list_;
-  list_ = nullptr;
-  return list;
+  if (last_kept == nullptr) {
+    curl->slist_free_all(headers);
+    headers = nullptr;
+  } else {
+    curl->slist_free_all(last_kept->next);
+    last_kept->next = nullptr;
+  }
+  header_lines.swap(next_header_lines);
+  for (std::size_t i = num_kept; i < header_lines.size(); ++i) {
+    curl_slist *const appended =
+        curl->slist_append(headers, header_lines[i].c_str());
+    if (appended == nullptr) {
+      curl->slist_free_all(headers);
+      headers = nullptr;
+      header_lines.clear();
+      throw CURLE_OUT_OF_MEMORY;
+    }
+    headers = appended;
+  }
 }
 
-void CurlImpl::HeaderWriter::set(StringView key, StringView value) {
-  buffer_.clear();
-  buffer_ += key;
-  buffer_ += ": ";
-  buffer_ += value;
+CurlImpl::HeaderWriter::HeaderWriter(std::vector<std::string> &lines)
+    : lines_(lines) {}
+
+CurlImpl::HeaderWriter::~HeaderWriter() { lines_.resize(size_); }
 
-  list_ = curl_.slist_append(list_, buffer_.c_str());
+void CurlImpl::HeaderWriter::set(StringView key, StringView value) {
+  if (size_ == lines_.size()) {
+    lines_.emplace_back();
+  }
+  std::string &line = lines_[size_++];
+  line.clear();
+  line += key;
+  line += ": ";
+  line += value;
 }
 
 CurlImpl::HeaderReader::HeaderReader(
@@ -2,18 +2,28 @@
 
 // This component provides a `class`, `Curl`, that implements the `HTTPClient`
 // interface in terms of [libcurl](https://curl.se/libcurl)]. `class Curl`
-// manages a thread that is used as the event loop for libcurl.
+// manages a thread that is used as the event loop for libcurl, unless it's
+// created in its "driven" mode, in which case another thread, such as that of
+// an `EventLoop`, drives it through the `DrivenHTTPClient` interface.
+//
+// libcurl keeps open connections in a cache that belongs to the event loop,
+// so a request can reuse the connection of an earlier request to the same
+// endpoint. `class Curl` also reuses request handles: when a request finishes,
+// its handle is kept in a pool for the request's endpoint, with the endpoint's
+// options (proxy, unix domain socket, TCP keep-alive) and the request's header
+// list still set.
 //
 // If this library was built in a mode that does not include libcurl, then this
 // file and its implementation, `curl.cpp`, will not be included.
 
 #include <curl/curl.h>
 #include <datadog/clock.h>
-#include <datadog/http_client.h>
 
 #include <memory>
 #include <thread>
 
+#include "driven_http_client.h"
+
 namespace datadog::tracing {
 
 // `class CurlLibrary` has one member function for every libcurl function used
@@ -38,6 +48,7 @@ class CurlLibrary {
 
   virtual void easy_cleanup(CURL *handle);
   virtual CURL *easy_init();
+  virtual CURLcode easy_getinfo_num_connects(CURL *curl, long *count);
   virtual CURLcode easy_getinfo_private(CURL *curl, char **user_data);
   virtual CURLcode easy_getinfo_response_code(CURL *curl, long *code);
   virtual CURLcode easy_setopt_errorbuffer(CURL *handle, char *buffer);
@@ -54,12 +65,16 @@ class CurlLibrary {
   virtual CURLcode easy_setopt_url(CURL *handle, const char *url);
   virtual CURLcode easy_setopt_writedata(CURL *handle, void *data);
   virtual CURLcode easy_setopt_writefunction(CURL *handle, WriteCallback);
+  virtual CURLcode easy_setopt_tcp_keepalive(CURL *handle, long enabled);
   virtual CURLcode easy_setopt_timeout_ms(CURL *handle, long timeout_ms);
   virtual const char *easy_strerror(CURLcode error);
   virtual void global_cleanup();
   virtual CURLcode global_init(long flags);
   virtual CURLMcode multi_add_handle(CURLM *multi_handle, CURL *easy_handle);
   virtual CURLMcode multi_cleanup(CURLM *multi_handle);
+  virtual CURLMcode multi_fdset(CURLM *multi_handle, fd_set *read_fd_set,
+                                fd_set *write_fd_set, fd_set *exc_fd_set,
+                                int *max_fd);
   virtual CURLMsg *multi_info_read(CURLM *multi_handle, int *msgs_in_queue);
   virtual CURLM *multi_init();
   virtual CURLMcode multi_perform(CURLM *multi_handle, int *running_handles);
@@ -68,7 +83,12 @@ class CurlLibrary {
                                int *numfds);
   virtual CURLMcode multi_remove_handle(CURLM *multi_handle, CURL *easy_handle);
   virtual const char *multi_strerror(CURLMcode error);
+  virtual CURLMcode multi_timeout(CURLM *multi_handle, long *milliseconds);
   virtual CURLMcode multi_wakeup(CURLM *multi_handle);
+#if LIBCURL_VERSION_NUM >= 0x080800
+  virtual CURLMcode multi_waitfds(CURLM *multi_handle, curl_waitfd *ufds,
+                                  unsigned size, unsigned *fd_count);
+#endif
   virtual curl_slist *slist_append(curl_slist *list, const char *string);
   virtual void slist_free_all(curl_slist *list);
 };
@@ -76,16 +96,23 @@ class CurlLibrary {
 class CurlImpl;
 class Logger;
 
-class Curl : public HTTPClient {
+class Curl : public DrivenHTTPClient {
   CurlImpl *impl_;
 
  public:
   using ThreadGenerator = std::function<std::thread(std::function<void()> &&)>;
 
+  // `Driven` selects the constructor of a `Curl` that does not start a thread.
+  // Its requests progress only while another thread calls `perform` and
+  // `wait`.
+  struct Driven {};
+
   explicit Curl(const std::shared_ptr<Logger> &, const Clock &);
   Curl(const std::shared_ptr<Logger> &, const Clock &, CurlLibrary &);
   Curl(const std::shared_ptr<Logger> &, const Clock &, CurlLibrary &,
        const ThreadGenerator &);
+  Curl(const std::shared_ptr<Logger> &, const Clock &, Driven);
+  Curl(const std::shared_ptr<Logger> &, const Clock &, CurlLibrary &, Driven);
   ~Curl();
 
   Curl(const Curl &) = delete;
@@ -95,8 +122,25 @@ class Curl : public HTTPClient {
                       ErrorHandler on_error,
                       std::chrono::steady_clock::time_point deadline) override;
 
+  Expected<void> post_shared(
+      const URL &url, HeadersSetter set_headers,
+      std::shared_ptr<const std::string> body, ResponseHandler on_response,
+      ErrorHandler on_error,
+      std::chrono::steady_clock::time_point deadline) override;
+
+  // Wait until the outstanding requests are done, or until the specified
+  // `deadline`. Return immediately if called on the thread that performs the
+  // requests, since they can't progress while that thread waits.
   void drain(std::chrono::steady_clock::time_point deadline) override;
 
+  // The behavior of `perform`, `wait`, `file_descriptors`, and `timeout` is
+  // undefined unless this object was created `Driven`.
+  std::size_t perform() override;
+  void wait(std::chrono::steady_clock::duration timeout) override;
+  void wakeup() override;
+  void file_descriptors(std::vector<FileDescriptor> &fds) override;
+  Optional<std::chrono::steady_clock::duration> timeout() override;
+
   std::string config() const override;
 };
 
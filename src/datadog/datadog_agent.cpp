@@ -8,17 +8,24 @@
 #include <datadog/telemetry/telemetry.h>
 #include <datadog/tracer.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstring>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 
 #include "collector_response.h"
+#include "gzip.h"
 #include "json.hpp"
 #include "msgpack.h"
 #include "platform_util.h"
 #include "span_data.h"
+#include "string_table.h"
+#include "tags.h"
 #include "telemetry_metrics.h"
 #include "trace_sampler.h"
 
@@ -27,16 +34,23 @@ namespace tracing {
 namespace {
 
 constexpr StringView traces_api_path = "/v0.4/traces";
+constexpr StringView traces_v05_api_path = "/v0.5/traces";
 constexpr StringView remote_configuration_path = "/v0.7/config";
+constexpr StringView stats_api_path = "/v0.6/stats";
+
+// Flushes of fewer bytes of trace chunks than this are encoded by the flushing
+// thread alone, even if there is an encoding pool.
+constexpr std::size_t parallel_encoding_min_bytes = 256 * 1024;
 
 void set_content_type_json(DictWriter& headers) {
   headers.set("Content-Type", "application/json");
 }
 
-HTTPClient::URL traces_endpoint(const HTTPClient::URL& agent_url) {
-  auto traces_url = agent_url;
-  append(traces_url.path, traces_api_path);
-  return traces_url;
+HTTPClient::URL agent_endpoint(const HTTPClient::URL& agent_url,
+                               StringView api_path) {
+  auto endpoint = agent_url;
+  append(endpoint.path, api_path);
+  return endpoint;
 }
 
 HTTPClient::URL remote_configuration_endpoint(
@@ -48,13 +62,207 @@ HTTPClient::URL remote_configuration_endpoint(
 
 Expected<void> msgpack_encode(
     std::string& destination,
-    const std::vector<DatadogAgent::TraceChunk>& trace_chunks) {
+    const std::deque<DatadogAgent::TraceChunk>& trace_chunks) {
   return msgpack::pack_array(destination, trace_chunks,
                              [](auto& destination, const auto& chunk) {
                                return msgpack_encode(destination, chunk.spans);
                              });
 }
 
+// Append to the specified `destination` the MessagePack encoding of the
+// specified `trace_chunks`, as above, but using the threads of the specified
+// `pool`. The chunks are divided into contiguous parts of about the same
+// encoded size, a few per thread so that a thread that finishes early can take
+// another. The `destination` is grown once to the size of the whole encoding,
+// and each part is copied into its own slice of it by the thread that encoded
+// the part, so that the flushing thread doesn't copy the payload again. If the
+// parts don't fit their slices, then log an error to the specified `logger` and
+// encode the chunks on this thread alone instead.
+Expected<void> msgpack_encode(
+    std::string& destination,
+    const std::deque<DatadogAgent::TraceChunk>& trace_chunks, WorkerPool& pool,
+    Logger& logger) {
+  std::size_t total_size = 0;
+  for (const auto& chunk : trace_chunks) {
+    total_size += chunk.info.size;
+  }
+  if (total_size < parallel_encoding_min_bytes || trace_chunks.size() < 2) {
+    return msgpack_encode(destination, trace_chunks);
+  }
+
+  const std::size_t num_parts =
+      std::min(trace_chunks.size(), pool.concurrency() * 4);
+  // Part `i` consists of the chunks from index `bounds[i]` up to, but not
+  // including, index `bounds[i + 1]`.
+  std::vector<std::size_t> bounds{0};
+  std::vector<std::size_t> part_sizes{0};
+  for (std::size_t i = 0; i < trace_chunks.size(); ++i) {
+    part_sizes.back() += trace_chunks[i].info.size;
+    if (part_sizes.back() * num_parts >= total_size &&
+        bounds.size() < num_parts && i + 1 < trace_chunks.size()) {
+      bounds.push_back(i + 1);
+      part_sizes.push_back(0);
+    }
+  }
+  bounds.push_back(trace_chunks.size());
+
+  const std::size_t original_size = destination.size();
+  auto result = msgpack::pack_array(destination, trace_chunks.size());
+  if (!result) {
+    return result;
+  }
+  // Part `i` is copied to `destination` starting at offset `offsets[i]`.
+  std::vector<std::size_t> offsets{destination.size()};
+  for (const std::size_t part_size : part_sizes) {
+    offsets.push_back(offsets.back() + part_size);
+  }
+  destination.resize(offsets.back());
+  char* const slices = &destination[0];
+
+  std::vector<Optional<Error>> errors(part_sizes.size());
+  std::atomic<bool> size_mismatch{false};
+  pool.run(part_sizes.size(), [&](std::size_t part) {
+    std::string buffer;
+    buffer.reserve(part_sizes[part]);
+    for (std::size_t i = bounds[part]; i < bounds[part + 1]; ++i) {
+      auto result = msgpack_encode(buffer, trace_chunks[i].spans);
+      if (auto* error = result.if_error()) {
+        errors[part] = std::move(*error);
+        return;
+      }
+    }
+    if (buffer.size() != part_sizes[part]) {
+      size_mismatch = true;
+      return;
+    }
+    std::memcpy(slices + offsets[part], buffer.data(), buffer.size());
+  });
+  for (auto& error : errors) {
+    if (error) {
+      destination.resize(original_size);
+      return std::move(*error);
+    }
+  }
+  if (size_mismatch) {
+    // A chunk's encoding differs in size from what was accounted for when it
+    // was queued. This isn't expected, but if it happens, fall back to
+    // encoding on this thread alone.
+    logger.log_error(
+        "Trace chunks encoded to a size other than the one accounted for when "
+        "they were queued. Encoding them without the encoding threads.");
+    destination.resize(original_size);
+    return msgpack_encode(destination, trace_chunks);
+  }
+  return result;
+}
+
+// Append to the specified `destination` a "/v0.5/traces" payload containing
+// the specified `trace_chunks`. The payload is an array of two elements: the
+// table of strings used by the spans, and then the array of trace chunks.
+Expected<void> msgpack_encode_v05(
+    std::string& destination,
+    const std::deque<DatadogAgent::TraceChunk>& trace_chunks) {
+  // The string table is complete only after all of the spans are encoded, but
+  // it precedes them in the payload.
+  StringTable strings;
+  std::string encoded_chunks;
+  auto result = msgpack::pack_array(
+      encoded_chunks, trace_chunks, [&](auto& destination, const auto& chunk) {
+        return msgpack_encode_v05(destination, strings, chunk.spans);
+      });
+  if (!result) {
+    return result;
+  }
+
+  destination.reserve(destination.size() + msgpack::array_header_size(2) +
+                      strings.encoded_size() + encoded_chunks.size());
+  result = msgpack::pack_array(destination, 2);
+  if (!result) {
+    return result;
+  }
+  result = msgpack_encode(destination, strings);
+  if (!result) {
+    return result;
+  }
+  destination += encoded_chunks;
+  return result;
+}
+
+// Return whether the trace chunk consisting of the specified `spans` is sampled
+// out, i.e. its sampling priority is zero or less.
+bool is_p0(const std::vector<std::unique_ptr<SpanData>>& spans) {
+  if (spans.empty()) {
+    return false;
+  }
+  // The sampling decision is recorded on the local root span, which is first.
+  const auto& root_tags = spans.front()->numeric_tags;
+  const auto priority = root_tags.find(tags::internal::sampling_priority);
+  return priority != root_tags.end() && priority->second <= 0;
+}
+
+bool is_span_sampled(const SpanData& span) {
+  return span.numeric_tags.count(tags::internal::span_sampling_mechanism) != 0;
+}
+
+// Return a description of the trace chunk consisting of the specified `spans`,
+// whose MessagePack encoding has the specified `size`.
+DatadogAgent::ChunkInfo describe_chunk(
+    const std::vector<std::unique_ptr<SpanData>>& spans, std::size_t size) {
+  DatadogAgent::ChunkInfo info;
+  info.num_spans = spans.size();
+  info.size = size;
+  info.p0 = is_p0(spans);
+  info.span_sampled = std::any_of(
+      spans.begin(), spans.end(),
+      [](const auto& span) { return is_span_sampled(*span); });
+  return info;
+}
+
+// Return the size of the MessagePack encoding of the specified `spans`.
+std::size_t encoded_size(const std::vector<std::unique_ptr<SpanData>>& spans) {
+  std::size_t size = msgpack::array_header_size(spans.size());
+  for (const auto& span : spans) {
+    size += msgpack_encoded_size(*span);
+  }
+  return size;
+}
+
+// Remove from the specified `items` the elements at the specified ascending
+// `indices`.
+template <typename Items>
+void erase_indices(Items& items, const std::vector<std::size_t>& indices) {
+  if (indices.empty()) {
+    return;
+  }
+  if (indices.back() + 1 == indices.size()) {
+    // The indices are a prefix of `items`.
+    items.erase(items.begin(), items.begin() + indices.size());
+    return;
+  }
+
+  std::size_t next_index = 0;
+  std::size_t kept = indices.front();
+  for (std::size_t i = indices.front(); i < items.size(); ++i) {
+    if (next_index < indices.size() && indices[next_index] == i) {
+      ++next_index;
+      continue;
+    }
+    items[kept++] = std::move(items[i]);
+  }
+  items.erase(items.begin() + kept, items.end());
+}
+
+StringView to_string_view(TraceBufferOverflowPolicy policy) {
+  switch (policy) {
+    case TraceBufferOverflowPolicy::DROP_OLDEST:
+      return "drop_oldest";
+    case TraceBufferOverflowPolicy::DROP_UNSAMPLED_FIRST:
+      return "drop_unsampled_first";
+    default:
+      return "drop_newest";
+  }
+}
+
 std::variant<CollectorResponse, std::string> parse_agent_traces_response(
     StringView body) try {
   nlohmann::json response = nlohmann::json::parse(body);
@@ -150,14 +358,26 @@ DatadogAgent::DatadogAgent(
     const std::vector<std::shared_ptr<rc::Listener>>& rc_listeners)
     : clock_(config.clock),
       logger_(logger),
-      traces_endpoint_(traces_endpoint(config.url)),
+      traces_endpoint_(agent_endpoint(config.url, traces_api_path)),
+      traces_v05_endpoint_(agent_endpoint(config.url, traces_v05_api_path)),
+      trace_api_version_(std::make_shared<std::atomic<TraceApiVersion>>(
+          config.trace_api_version)),
       remote_configuration_endpoint_(remote_configuration_endpoint(config.url)),
+      stats_endpoint_(agent_endpoint(config.url, stats_api_path)),
       http_client_(config.http_client),
       event_scheduler_(config.event_scheduler),
       flush_interval_(config.flush_interval),
       request_timeout_(config.request_timeout),
       shutdown_timeout_(config.shutdown_timeout),
-      remote_config_(tracer_signature, rc_listeners, logger) {
+      remote_config_(tracer_signature, rc_listeners, logger),
+      serialize_on_send_(config.serialize_on_send),
+      encoded_api_version_(config.trace_api_version),
+      encoding_duration_(std::chrono::steady_clock::duration::zero()),
+      max_buffered_spans_(config.max_buffered_spans),
+      max_buffered_bytes_(config.max_buffered_bytes),
+      overflow_policy_(config.buffer_overflow_policy),
+      compression_level_(config.compression_level),
+      compression_min_bytes_(config.compression_min_bytes) {
   assert(logger_);
 
   // Set HTTP headers
@@ -167,9 +387,12 @@ DatadogAgent::DatadogAgent(
                    tracer_signature.library_language_version);
   headers_.emplace("Datadog-Meta-Tracer-Version",
                    tracer_signature.library_version);
-  if (config.stats_computation_enabled) {
+  if (config.client_computed_stats) {
     headers_.emplace("Datadog-Client-Computed-Stats", "yes");
   }
+  if (config.stats_computation_enabled) {
+    stats_concentrator_ = std::make_unique<StatsConcentrator>(tracer_signature);
+  }
 
   // Origin Detection headers are not necessary when Unix Domain Socket (UDS)
   // is used to communicate with the Datadog Agent.
@@ -190,8 +413,32 @@ DatadogAgent::DatadogAgent(
     }
   }
 
-  tasks_.emplace_back(event_scheduler_->schedule_recurring_event(
-      config.flush_interval, [this]() { flush(); }));
+  // The flush task uses these, and might run as soon as it is scheduled.
+  if (config.encoding_threads > 1) {
+    encoding_pool_ = std::make_unique<WorkerPool>(
+        static_cast<std::size_t>(config.encoding_threads));
+  }
+
+  if (config.max_trace_retries > 0 && config.retry_buffer_max_bytes > 0) {
+    retry_queue_ = std::make_shared<RetryQueue<TracePayload>>(
+        RetryQueue<TracePayload>::Config{
+            config.flush_interval, config.flush_interval * 32,
+            config.max_trace_retries, config.retry_buffer_max_bytes});
+  }
+
+  if (config.adaptive_flush_enabled) {
+    flush_policy_ = std::make_shared<FlushPolicy>(
+        FlushPolicy::Config{config.flush_interval,
+                            config.flush_min_payload_bytes,
+                            config.flush_max_payload_bytes,
+                            config.flush_max_spans},
+        clock_().tick);
+    tasks_.emplace_back(event_scheduler_->schedule_recurring_event(
+        flush_policy_->tick(), [this]() { flush_if_due(); }));
+  } else {
+    tasks_.emplace_back(event_scheduler_->schedule_recurring_event(
+        config.flush_interval, [this]() { flush(); }));
+  }
 
   if (config.remote_configuration_enabled) {
     tasks_.emplace_back(event_scheduler_->schedule_recurring_event(
@@ -208,6 +455,9 @@ DatadogAgent::~DatadogAgent() {
   }
 
   flush();
+  if (stats_concentrator_) {
+    flush_stats(/*force=*/true);
+  }
 
   http_client_->drain(deadline);
 }
@@ -215,17 +465,326 @@ DatadogAgent::~DatadogAgent() {
 Expected<void> DatadogAgent::send(
     std::vector<std::unique_ptr<SpanData>>&& spans,
     const std::shared_ptr<TraceSampler>& response_handler) {
+  if (stats_concentrator_) {
+    stats_concentrator_->add(spans);
+    if (!drop_p0_spans(spans)) {
+      return nullopt;
+    }
+  }
+
+  if (serialize_on_send_) {
+    return encode_chunk(std::move(spans), response_handler);
+  }
+
+  const ChunkInfo info = describe_chunk(spans, encoded_size(spans));
+  if (try_reserve(info)) {
+    push_chunk(TraceChunk{std::move(spans), response_handler, info});
+    return nullopt;
+  }
+  if (overflow_policy_ == TraceBufferOverflowPolicy::DROP_NEWEST) {
+    record_drop(info);
+    return nullopt;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (make_room(info)) {
+    collect_pushed_chunks();
+    trace_chunks_.push_back(
+        TraceChunk{std::move(spans), response_handler, info});
+  }
+  return nullopt;
+}
+
+bool DatadogAgent::try_reserve(const ChunkInfo& chunk) {
+  const auto reserve = [](std::atomic<std::size_t>& total, std::size_t amount,
+                          std::size_t limit) {
+    std::size_t current = total.load(std::memory_order_relaxed);
+    do {
+      if (amount > limit || current > limit - amount) {
+        return false;
+      }
+    } while (!total.compare_exchange_weak(current, current + amount,
+                                          std::memory_order_relaxed));
+    return true;
+  };
+
+  if (!reserve(buffered_spans_, chunk.num_spans, max_buffered_spans_)) {
+    return false;
+  }
+  if (!reserve(buffered_bytes_, chunk.size, max_buffered_bytes_)) {
+    buffered_spans_.fetch_sub(chunk.num_spans, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void DatadogAgent::push_chunk(TraceChunk&& chunk) {
+  auto node = std::make_unique<PushedChunk>(
+      PushedChunk{std::move(chunk),
+                  pushed_chunks_.load(std::memory_order_relaxed)});
+  while (!pushed_chunks_.compare_exchange_weak(node->next, node.get(),
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+  }
+  node.release();
+}
+
+void DatadogAgent::collect_pushed_chunks() {
+  PushedChunk* node =
+      pushed_chunks_.exchange(nullptr, std::memory_order_acquire);
+  // The most recently pushed chunk is on top of the stack. Reverse the stack,
+  // so that chunks are buffered in the order they were sent.
+  PushedChunk* oldest = nullptr;
+  while (node) {
+    PushedChunk* const next = node->next;
+    node->next = oldest;
+    oldest = node;
+    node = next;
+  }
+  while (oldest) {
+    std::unique_ptr<PushedChunk> owned(oldest);
+    oldest = owned->next;
+    trace_chunks_.push_back(std::move(owned->chunk));
+  }
+}
+
+Expected<void> DatadogAgent::encode_chunk(
+    std::vector<std::unique_ptr<SpanData>>&& spans,
+    const std::shared_ptr<TraceSampler>& response_handler) {
+  // Take ownership of the spans, so that they're destroyed once encoded.
+  const auto chunk = std::move(spans);
+  const auto beg = std::chrono::steady_clock::now();
+
+  // A v0.4 chunk does not depend on the other chunks in its payload, and so
+  // can be encoded without holding the lock. A v0.5 chunk shares the string
+  // table of its payload.
+  std::string encoded;
+  if (*trace_api_version_ == TraceApiVersion::V0_4) {
+    auto result = msgpack_encode(encoded, chunk);
+    if (!result) {
+      return result;
+    }
+  }
+
   std::lock_guard<std::mutex> lock(mutex_);
-  trace_chunks_.push_back(TraceChunk{std::move(spans), response_handler});
+  if (encoded_chunk_infos_.empty()) {
+    encoded_api_version_ = *trace_api_version_;
+    encoded_chunks_.assign(msgpack::array32_header_size, '\0');
+    encoded_chunks_begin_ = 0;
+    // Any strings left are those of dropped chunks.
+    encoded_strings_.clear();
+    encoded_chunk_strings_.clear();
+    encoded_strings_unused_ = false;
+  }
+
+  const bool v05 = encoded_api_version_ == TraceApiVersion::V0_5;
+  std::vector<std::uint32_t> strings;
+  if (v05 || encoded.empty()) {
+    // Either the chunk belongs in a v0.5 payload, or the API version changed
+    // after the chunk was encoded above.
+    encoded.clear();
+    Expected<void> result;
+    if (v05) {
+      encoded_strings_.record(&strings);
+      result = msgpack_encode_v05(encoded, encoded_strings_, chunk);
+      encoded_strings_.record(nullptr);
+    } else {
+      result = msgpack_encode(encoded, chunk);
+    }
+    if (!result) {
+      encoded_strings_unused_ |= v05;
+      return result;
+    }
+  }
+
+  const ChunkInfo info = describe_chunk(chunk, encoded.size());
+  if (!make_room(info)) {
+    encoded_strings_unused_ |= v05;
+    return nullopt;
+  }
+  encoded_chunks_ += encoded;
+  encoded_chunk_infos_.push_back(info);
+  if (v05) {
+    encoded_chunk_strings_.push_back(std::move(strings));
+  }
+  encoded_response_handlers_.insert(response_handler);
+  encoding_duration_ += std::chrono::steady_clock::now() - beg;
   return nullopt;
 }
 
+bool DatadogAgent::drop_p0_spans(
+    std::vector<std::unique_ptr<SpanData>>& spans) {
+  if (!is_p0(spans)) {
+    return true;
+  }
+
+  const std::size_t num_spans = spans.size();
+  spans.erase(std::remove_if(
+                  spans.begin(), spans.end(),
+                  [](const auto& span) { return !is_span_sampled(*span); }),
+              spans.end());
+
+  if (spans.empty()) {
+    p0_dropped_traces_.fetch_add(1, std::memory_order_relaxed);
+  }
+  p0_dropped_spans_.fetch_add(num_spans - spans.size(),
+                              std::memory_order_relaxed);
+  return !spans.empty();
+}
+
+bool DatadogAgent::make_room(const ChunkInfo& chunk) {
+  const auto fits = [&](std::size_t spans, std::size_t bytes) {
+    return spans + chunk.num_spans <= max_buffered_spans_ &&
+           bytes + chunk.size <= max_buffered_bytes_;
+  };
+
+  if (try_reserve(chunk)) {
+    return true;
+  }
+
+  if (overflow_policy_ != TraceBufferOverflowPolicy::DROP_NEWEST) {
+    // Select chunks to drop, oldest first, until the new chunk would fit.
+    // Buffered chunks are dropped only if doing so makes room.
+    collect_pushed_chunks();
+    const bool unsampled_only =
+        overflow_policy_ == TraceBufferOverflowPolicy::DROP_UNSAMPLED_FIRST;
+    std::vector<std::size_t> indices;
+    std::size_t spans = buffered_spans_.load(std::memory_order_relaxed);
+    std::size_t bytes = buffered_bytes_.load(std::memory_order_relaxed);
+    const std::size_t num_chunks = num_buffered_chunks();
+    for (std::size_t i = 0; i < num_chunks && !fits(spans, bytes); ++i) {
+      const ChunkInfo& buffered = buffered_chunk(i);
+      if (unsampled_only && (!buffered.p0 || buffered.span_sampled)) {
+        continue;
+      }
+      indices.push_back(i);
+      spans -= buffered.num_spans;
+      bytes -= buffered.size;
+    }
+    if (fits(spans, bytes)) {
+      drop_buffered_chunks(indices);
+      if (try_reserve(chunk)) {
+        return true;
+      }
+    }
+  }
+
+  record_drop(chunk);
+  return false;
+}
+
+std::size_t DatadogAgent::num_buffered_chunks() const {
+  return serialize_on_send_ ? encoded_chunk_infos_.size()
+                            : trace_chunks_.size();
+}
+
+const DatadogAgent::ChunkInfo& DatadogAgent::buffered_chunk(
+    std::size_t index) const {
+  return serialize_on_send_ ? encoded_chunk_infos_[index]
+                            : trace_chunks_[index].info;
+}
+
+void DatadogAgent::drop_buffered_chunks(
+    const std::vector<std::size_t>& indices) {
+  for (const std::size_t index : indices) {
+    const ChunkInfo& chunk = buffered_chunk(index);
+    release(chunk);
+    record_drop(chunk);
+  }
+
+  if (serialize_on_send_) {
+    drop_encoded_chunks(indices);
+  } else {
+    erase_indices(trace_chunks_, indices);
+  }
+}
+
+void DatadogAgent::drop_encoded_chunks(
+    const std::vector<std::size_t>& indices) {
+  if (indices.empty()) {
+    return;
+  }
+
+  if (encoded_api_version_ == TraceApiVersion::V0_5) {
+    erase_indices(encoded_chunk_strings_, indices);
+    encoded_strings_unused_ = true;
+  }
+
+  if (indices.back() + 1 == indices.size()) {
+    // Dropping the oldest chunks is the common case. Rather than shifting the
+    // remaining chunks each time, move the header's reserved space past the
+    // dropped chunks, and reclaim the space only once it's large.
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+      encoded_chunks_begin_ += encoded_chunk_infos_[i].size;
+    }
+    if (encoded_chunks_begin_ > encoded_chunks_.size() / 2) {
+      encoded_chunks_.erase(0, encoded_chunks_begin_);
+      encoded_chunks_begin_ = 0;
+    }
+    erase_indices(encoded_chunk_infos_, indices);
+    return;
+  }
+
+  // Shift each remaining chunk over the dropped chunks preceding it.
+  std::size_t next_index = 0;
+  std::size_t source = encoded_chunks_begin_ + msgpack::array32_header_size;
+  std::size_t destination = source;
+  for (std::size_t i = 0; i < encoded_chunk_infos_.size(); ++i) {
+    const std::size_t size = encoded_chunk_infos_[i].size;
+    if (next_index < indices.size() && indices[next_index] == i) {
+      ++next_index;
+    } else {
+      if (destination != source) {
+        std::copy_n(encoded_chunks_.begin() + source, size,
+                    encoded_chunks_.begin() + destination);
+      }
+      destination += size;
+    }
+    source += size;
+  }
+  encoded_chunks_.resize(destination);
+  erase_indices(encoded_chunk_infos_, indices);
+}
+
+void DatadogAgent::release(const ChunkInfo& chunk) {
+  buffered_spans_.fetch_sub(chunk.num_spans, std::memory_order_relaxed);
+  buffered_bytes_.fetch_sub(chunk.size, std::memory_order_relaxed);
+}
+
+void DatadogAgent::record_drop(const ChunkInfo& chunk) {
+  telemetry::counter::increment(metrics::tracer::trace_chunks_dropped,
+                                {"reason:overfull_buffer"});
+  if (chunk.p0) {
+    p0_dropped_traces_.fetch_add(1, std::memory_order_relaxed);
+    p0_dropped_spans_.fetch_add(chunk.num_spans, std::memory_order_relaxed);
+  }
+}
+
+DatadogAgent::P0Drops DatadogAgent::take_p0_drops() {
+  P0Drops p0_drops;
+  p0_drops.traces = p0_dropped_traces_.exchange(0, std::memory_order_relaxed);
+  p0_drops.spans = p0_dropped_spans_.exchange(0, std::memory_order_relaxed);
+  return p0_drops;
+}
+
 std::string DatadogAgent::config() const {
+  const bool v05 = *trace_api_version_ == TraceApiVersion::V0_5;
+  const auto& traces_url = v05 ? traces_v05_endpoint_ : traces_endpoint_;
   // clang-format off
   return nlohmann::json::object({
     {"type", "datadog::tracing::DatadogAgent"},
     {"config", nlohmann::json::object({
-      {"traces_url", (traces_endpoint_.scheme + "://" + traces_endpoint_.authority + traces_endpoint_.path)},
+      {"traces_url", (traces_url.scheme + "://" + traces_url.authority + traces_url.path)},
+      {"trace_api_version", v05 ? "v0.5" : "v0.4"},
+      {"serialize_on_send", serialize_on_send_},
+      {"max_buffered_spans", max_buffered_spans_},
+      {"max_buffered_bytes", max_buffered_bytes_},
+      {"buffer_overflow_policy", to_string_view(overflow_policy_)},
+      {"stats_computation_enabled", stats_concentrator_ != nullptr},
+      {"compression_level", compression_level_.value_or(0)},
+      {"adaptive_flush_enabled", flush_policy_ != nullptr},
+      {"trace_retries_enabled", retry_queue_ != nullptr},
+      {"encoding_threads", encoding_pool_ ? encoding_pool_->concurrency() : 1},
       {"remote_configuration_url", (remote_configuration_endpoint_.scheme + "://" + remote_configuration_endpoint_.authority + remote_configuration_endpoint_.path)},
       {"flush_interval_milliseconds", std::chrono::duration_cast<std::chrono::milliseconds>(flush_interval_).count() },
       {"request_timeout_milliseconds", std::chrono::duration_cast<std::chrono::milliseconds>(request_timeout_).count() },
@@ -238,15 +797,47 @@ std::string DatadogAgent::config() const {
 }
 
 void DatadogAgent::flush() {
-  std::vector<TraceChunk> trace_chunks;
+  retry_traces();
+  if (serialize_on_send_) {
+    flush_encoded_chunks();
+  } else {
+    flush_trace_chunks();
+  }
+  if (stats_concentrator_) {
+    flush_stats(/*force=*/false);
+  }
+}
+
+void DatadogAgent::flush_if_due() {
+  if (flush_policy_->should_flush(
+          clock_().tick, buffered_bytes_.load(std::memory_order_relaxed),
+          buffered_spans_.load(std::memory_order_relaxed))) {
+    flush();
+    return;
+  }
+  retry_traces();
+  if (stats_concentrator_) {
+    flush_stats(/*force=*/false);
+  }
+}
+
+void DatadogAgent::flush_trace_chunks() {
+  std::deque<TraceChunk> trace_chunks;
+  P0Drops p0_drops;
   {
     std::lock_guard<std::mutex> lock(mutex_);
+    collect_pushed_chunks();
+    if (trace_chunks_.empty()) {
+      // Any dropped chunks will be reported with the next payload.
+      return;
+    }
     using std::swap;
     swap(trace_chunks, trace_chunks_);
-  }
-
-  if (trace_chunks.empty()) {
-    return;
+    // Chunks reserved but not yet pushed remain accounted for.
+    for (const auto& chunk : trace_chunks) {
+      release(chunk.info);
+    }
+    p0_drops = take_p0_drops();
   }
 
   // Ideally:
@@ -255,10 +846,17 @@ void DatadogAgent::flush() {
   /*  msgpack_encode(body, trace_chunks);*/
   /*});*/
 
+  const TraceApiVersion api_version = *trace_api_version_;
   std::string body;
 
   auto beg = std::chrono::steady_clock::now();
-  auto encode_result = msgpack_encode(body, trace_chunks);
+  auto encode_result =
+      api_version == TraceApiVersion::V0_5
+          ? msgpack_encode_v05(body, trace_chunks)
+          : (encoding_pool_
+                 ? msgpack_encode(body, trace_chunks, *encoding_pool_,
+                                  *logger_)
+                 : msgpack_encode(body, trace_chunks));
   auto end = std::chrono::steady_clock::now();
 
   telemetry::distribution::add(
@@ -280,24 +878,167 @@ void DatadogAgent::flush() {
     response_handlers.insert(std::move(chunk.response_handler));
   }
 
+  const bool compressed = compress(body);
+  post_traces(TracePayload{std::make_shared<const std::string>(std::move(body)),
+                           compressed, trace_chunks.size(), api_version,
+                           std::move(response_handlers), p0_drops},
+              /*failures=*/0);
+}
+
+void DatadogAgent::flush_encoded_chunks() {
+  std::string encoded_chunks;
+  std::size_t num_chunks;
+  TraceApiVersion api_version;
+  StringTable strings;
+  std::deque<std::vector<std::uint32_t>> chunk_strings;
+  bool strings_unused;
+  std::unordered_set<std::shared_ptr<TraceSampler>> response_handlers;
+  std::chrono::steady_clock::duration encoding_duration;
+  std::size_t begin;
+  P0Drops p0_drops;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (encoded_chunk_infos_.empty()) {
+      return;
+    }
+    using std::swap;
+    swap(encoded_chunks, encoded_chunks_);
+    swap(strings, encoded_strings_);
+    swap(chunk_strings, encoded_chunk_strings_);
+    strings_unused = std::exchange(encoded_strings_unused_, false);
+    swap(response_handlers, encoded_response_handlers_);
+    num_chunks = encoded_chunk_infos_.size();
+    encoded_chunk_infos_.clear();
+    begin = encoded_chunks_begin_;
+    api_version = encoded_api_version_;
+    encoding_duration = std::exchange(
+        encoding_duration_, std::chrono::steady_clock::duration::zero());
+    p0_drops = take_p0_drops();
+    buffered_spans_.store(0, std::memory_order_relaxed);
+    buffered_bytes_.store(0, std::memory_order_relaxed);
+  }
+
+  encoded_chunks.erase(0, begin);
+  msgpack::write_array32_header(&encoded_chunks[0],
+                                static_cast<std::uint32_t>(num_chunks));
+
+  std::string body;
+  if (api_version == TraceApiVersion::V0_5) {
+    if (strings_unused) {
+      // Chunks were dropped after they were encoded. Send only the strings of
+      // the chunks that remain.
+      std::vector<bool> used(strings.size(), false);
+      for (const auto& indices : chunk_strings) {
+        for (const std::uint32_t index : indices) {
+          used[index] = true;
+        }
+      }
+      strings.retain(used);
+    }
+    // The string table precedes the chunks in the payload.
+    body.reserve(msgpack::array_header_size(2) + strings.encoded_size() +
+                 encoded_chunks.size());
+    (void)msgpack::pack_array(body, 2);
+    (void)msgpack_encode(body, strings);
+    body += encoded_chunks;
+  } else {
+    body = std::move(encoded_chunks);
+  }
+
+  telemetry::distribution::add(
+      metrics::tracer::trace_chunk_serialization_duration,
+      std::chrono::duration_cast<std::chrono::microseconds>(encoding_duration)
+          .count());
+  telemetry::distribution::add(metrics::tracer::trace_chunk_serialized_bytes,
+                               static_cast<uint64_t>(body.size()));
+
+  const bool compressed = compress(body);
+  post_traces(TracePayload{std::make_shared<const std::string>(std::move(body)),
+                           compressed, num_chunks, api_version,
+                           std::move(response_handlers), p0_drops},
+              /*failures=*/0);
+}
+
+void DatadogAgent::post_traces(TracePayload payload, int failures) {
+  const bool compressed = payload.compressed;
+  const std::size_t num_chunks = payload.num_chunks;
+  const TraceApiVersion api_version = payload.api_version;
+  const P0Drops p0_drops = payload.p0_drops;
+  auto response_handlers = payload.response_handlers;
+  auto body = payload.body;
+
+  // If retries are enabled, then the payload is kept until the request
+  // completes, so that it can be sent again without encoding it again. Its
+  // body is shared with the request rather than copied.
+  std::shared_ptr<TracePayload> retained;
+  if (retry_queue_) {
+    retained = std::make_shared<TracePayload>(std::move(payload));
+  }
+
+  // This is invoked when the request fails in a way that might not recur,
+  // i.e. a network error or a 5xx response, or the HTTP client failing to
+  // send the request at all.
+  auto retry = [retry_queue = retry_queue_, retained, failures,
+                clock = clock_]() {
+    if (!retry_queue) {
+      return;
+    }
+    // The Agent might have counted the dropped P0 traces reported with the
+    // failed request. Report them at most once.
+    retained->p0_drops = P0Drops{};
+    const std::size_t size = retained->body->size();
+    switch (retry_queue->push(std::move(*retained), size, failures + 1,
+                              clock().tick)) {
+      case RetryQueue<TracePayload>::Outcome::QUEUED:
+        telemetry::counter::increment(metrics::tracer::api::retries);
+        break;
+      case RetryQueue<TracePayload>::Outcome::TOO_MANY_FAILURES:
+        telemetry::counter::increment(metrics::tracer::api::retries_dropped,
+                                      {"reason:max_retries"});
+        break;
+      case RetryQueue<TracePayload>::Outcome::FULL:
+        telemetry::counter::increment(metrics::tracer::api::retries_dropped,
+                                      {"reason:buffer_full"});
+        break;
+    }
+  };
+
   // This is the callback for setting request headers.
-  // It's invoked synchronously (before `post` returns).
+  // It's invoked synchronously (before `post` returns). The headers that are
+  // the same for every request come first, so that the HTTP client can keep
+  // them from one request to the next.
   auto set_request_headers = [&](DictWriter& writer) {
-    writer.set("X-Datadog-Trace-Count", std::to_string(trace_chunks.size()));
     for (const auto& [key, value] : headers_) {
       writer.set(key, value);
     }
+    if (compressed) {
+      writer.set("Content-Encoding", "gzip");
+    }
+    writer.set("X-Datadog-Trace-Count", std::to_string(num_chunks));
+    if (p0_drops.traces != 0) {
+      writer.set("Datadog-Client-Dropped-P0-Traces",
+                 std::to_string(p0_drops.traces));
+      writer.set("Datadog-Client-Dropped-P0-Spans",
+                 std::to_string(p0_drops.spans));
+    }
   };
 
   // This is the callback for the HTTP response. It's invoked
   // asynchronously.
   auto on_response = [samplers = std::move(response_handlers),
-                      logger = logger_](int response_status,
-                                        const DictReader& /*response_headers*/,
-                                        std::string response_body) {
+                      logger = logger_, api_version,
+                      shared_api_version = trace_api_version_,
+                      flush_policy = flush_policy_, retry](
+                         int response_status,
+                         const DictReader& /*response_headers*/,
+                         std::string response_body) {
+    if (flush_policy) {
+      flush_policy->on_response(response_status);
+    }
     if (response_status >= 500) {
       telemetry::counter::increment(metrics::tracer::api::responses,
                                     {"status_code:5xx"});
+      retry();
     } else if (response_status >= 400) {
       telemetry::counter::increment(metrics::tracer::api::responses,
                                     {"status_code:4xx"});
@@ -311,6 +1052,18 @@ void DatadogAgent::flush() {
       telemetry::counter::increment(metrics::tracer::api::responses,
                                     {"status_code:1xx"});
     }
+    if (response_status == 404 && api_version == TraceApiVersion::V0_5) {
+      // The Datadog Agent does not support v0.5. Send subsequent payloads to
+      // v0.4 instead. The traces in this payload are lost.
+      auto expected = TraceApiVersion::V0_5;
+      if (shared_api_version->compare_exchange_strong(expected,
+                                                      TraceApiVersion::V0_4)) {
+        logger->log_error(
+            "The Datadog Agent does not support the \"/v0.5/traces\" "
+            "endpoint. Falling back to \"/v0.4/traces\".");
+      }
+      return;
+    }
     if (response_status != 200) {
       logger->log_error([&](auto& stream) {
         stream << "Unexpected response status " << response_status
@@ -346,28 +1099,113 @@ void DatadogAgent::flush() {
   // This is the callback for if something goes wrong sending the
   // request or retrieving the response. It's invoked
   // asynchronously.
-  auto on_error = [logger = logger_](Error error) {
+  auto on_error = [logger = logger_, retry](Error error) {
     telemetry::counter::increment(metrics::tracer::api::errors,
                                   {"type:network"});
     logger->log_error(error.with_prefix(
         "Error occurred during HTTP request for submitting traces: "));
+    retry();
   };
 
   telemetry::counter::increment(metrics::tracer::api::requests);
   telemetry::distribution::add(metrics::tracer::api::bytes_sent,
-                               static_cast<uint64_t>(body.size()));
+                               static_cast<uint64_t>(body->size()));
 
-  auto post_result =
-      http_client_->post(traces_endpoint_, std::move(set_request_headers),
-                         std::move(body), std::move(on_response),
-                         std::move(on_error), clock_().tick + request_timeout_);
+  const auto& endpoint = api_version == TraceApiVersion::V0_5
+                             ? traces_v05_endpoint_
+                             : traces_endpoint_;
+  auto post_result = http_client_->post_shared(
+      endpoint, std::move(set_request_headers), std::move(body),
+      std::move(on_response), std::move(on_error),
+      clock_().tick + request_timeout_);
   if (auto* error = post_result.if_error()) {
     // NOTE(@dmehala): `technical` is a better kind of errors.
     telemetry::counter::increment(metrics::tracer::api::errors,
                                   {"type:network"});
     logger_->log_error(
         error->with_prefix("Unexpected error submitting traces: "));
+    retry();
+  }
+}
+
+void DatadogAgent::retry_traces() {
+  if (!retry_queue_) {
+    return;
+  }
+  for (auto& entry : retry_queue_->take_due(clock_().tick)) {
+    if (entry.payload.api_version == TraceApiVersion::V0_5 &&
+        *trace_api_version_ == TraceApiVersion::V0_4) {
+      // The payload is encoded for "/v0.5/traces", which the Datadog Agent
+      // turned out not to support after the payload failed.
+      telemetry::counter::increment(metrics::tracer::api::retries_dropped,
+                                    {"reason:unsupported_api_version"});
+      continue;
+    }
+    post_traces(std::move(entry.payload), entry.failures);
+  }
+}
+
+void DatadogAgent::flush_stats(bool force) {
+  auto payloads = stats_concentrator_->flush(clock_().wall, force);
+  if (auto* error = payloads.if_error()) {
+    logger_->log_error(error->with_prefix("Unable to encode trace stats: "));
+    return;
+  }
+  for (auto& payload : *payloads) {
+    post_stats(std::move(payload));
+  }
+}
+
+void DatadogAgent::post_stats(std::string body) {
+  const bool compressed = compress(body);
+  auto set_request_headers = [&](DictWriter& writer) {
+    for (const auto& [key, value] : headers_) {
+      writer.set(key, value);
+    }
+    if (compressed) {
+      writer.set("Content-Encoding", "gzip");
+    }
+  };
+
+  auto on_response = [logger = logger_](int response_status,
+                                        const DictReader& /*response_headers*/,
+                                        std::string response_body) {
+    if (response_status < 200 || response_status >= 300) {
+      logger->log_error([&](auto& stream) {
+        stream << "Unexpected response status " << response_status
+               << " in Datadog Agent response to trace stats with body "
+                  "(if any, starts on next line):\n"
+               << response_body;
+      });
+    }
+  };
+
+  auto on_error = [logger = logger_](Error error) {
+    logger->log_error(error.with_prefix(
+        "Error occurred during HTTP request for submitting trace stats: "));
+  };
+
+  auto post_result =
+      http_client_->post(stats_endpoint_, std::move(set_request_headers),
+                         std::move(body), std::move(on_response),
+                         std::move(on_error), clock_().tick + request_timeout_);
+  if (auto* error = post_result.if_error()) {
+    logger_->log_error(
+        error->with_prefix("Unexpected error submitting trace stats: "));
+  }
+}
+
+bool DatadogAgent::compress(std::string& body) const {
+  if (!compression_level_ || body.size() < compression_min_bytes_) {
+    return false;
+  }
+  auto compressed = gzip(body, *compression_level_);
+  if (auto* error = compressed.if_error()) {
+    logger_->log_error(error->with_prefix("Sending a payload uncompressed: "));
+    return false;
   }
+  body = std::move(*compressed);
+  return true;
 }
 
 void DatadogAgent::get_and_apply_remote_configuration_updates() {
@@ -8,20 +8,28 @@
 
 #include <datadog/clock.h>
 #include <datadog/collector.h>
+#include <datadog/datadog_agent_config.h>
 #include <datadog/event_scheduler.h>
 #include <datadog/http_client.h>
 #include <datadog/tracer_signature.h>
 
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <unordered_set>
 #include <vector>
 
+#include "flush_policy.h"
 #include "remote_config/remote_config.h"
+#include "retry_queue.h"
+#include "stats_concentrator.h"
+#include "string_table.h"
+#include "worker_pool.h"
 
 namespace datadog {
 namespace tracing {
 
-class FinalizedDatadogAgentConfig;
 class Logger;
 struct SpanData;
 class TraceSampler;
@@ -29,22 +37,75 @@ struct TracerSignature;
 
 class DatadogAgent : public Collector {
  public:
+  // `ChunkInfo` describes a trace chunk awaiting the next flush.
+  struct ChunkInfo {
+    std::size_t num_spans;
+    // MessagePack encoded size, in bytes.
+    std::size_t size;
+    // Whether the chunk's sampling priority is zero or less.
+    bool p0;
+    // Whether any span in the chunk was kept by a span sampling rule.
+    bool span_sampled;
+  };
+
   struct TraceChunk {
     std::vector<std::unique_ptr<SpanData>> spans;
     std::shared_ptr<TraceSampler> response_handler;
+    ChunkInfo info;
+  };
+
+  // `P0Drops` counts the chunks having a sampling priority of zero or less
+  // that were dropped since the last flush, and their spans.
+  struct P0Drops {
+    std::size_t traces = 0;
+    std::size_t spans = 0;
   };
 
  private:
+  // `PushedChunk` is a node of the stack of chunks pushed by `send`.
+  struct PushedChunk {
+    TraceChunk chunk;
+    PushedChunk* next;
+  };
+
+  // `TracePayload` is an encoded request body of trace chunks, together with
+  // what's needed to send it again should sending it fail. `body` is shared
+  // with the request that sends it, and `api_version` is that of the endpoint
+  // that it's sent to.
+  struct TracePayload {
+    std::shared_ptr<const std::string> body;
+    bool compressed;
+    std::size_t num_chunks;
+    TraceApiVersion api_version;
+    std::unordered_set<std::shared_ptr<TraceSampler>> response_handlers;
+    P0Drops p0_drops;
+  };
+
   std::mutex mutex_;
   Clock clock_;
   std::shared_ptr<Logger> logger_;
-  std::vector<TraceChunk> trace_chunks_;
+  // `send` pushes trace chunks onto `pushed_chunks_` without locking
+  // `mutex_`. Whoever next locks `mutex_` to inspect the buffered chunks moves
+  // them, in the order they were sent, to the end of `trace_chunks_`.
+  std::atomic<PushedChunk*> pushed_chunks_{nullptr};
+  std::deque<TraceChunk> trace_chunks_;
   HTTPClient::URL traces_endpoint_;
+  HTTPClient::URL traces_v05_endpoint_;
+  // `trace_api_version_` is shared with the HTTP response handler, which might
+  // downgrade it to v0.4 if the Datadog Agent does not support v0.5.
+  std::shared_ptr<std::atomic<TraceApiVersion>> trace_api_version_;
   HTTPClient::URL remote_configuration_endpoint_;
+  HTTPClient::URL stats_endpoint_;
   std::shared_ptr<HTTPClient> http_client_;
   std::shared_ptr<EventScheduler> event_scheduler_;
   std::vector<EventScheduler::Cancel> tasks_;
   std::chrono::steady_clock::duration flush_interval_;
+  // `flush_policy_` is null unless adaptive flushing is enabled, in which case
+  // it decides when to flush, and is shared with the HTTP response handler.
+  std::shared_ptr<FlushPolicy> flush_policy_;
+  // `retry_queue_` is null unless retries are enabled, in which case it holds
+  // the payloads to send again, and is shared with the HTTP response handler.
+  std::shared_ptr<RetryQueue<TracePayload>> retry_queue_;
   std::chrono::steady_clock::duration request_timeout_;
   std::chrono::steady_clock::duration shutdown_timeout_;
 
@@ -52,7 +113,97 @@ class DatadogAgent : public Collector {
 
   std::unordered_map<std::string, std::string> headers_;
 
+  // When `serialize_on_send_` is true, `send` encodes each trace chunk into
+  // `encoded_chunks_` instead of appending it to `trace_chunks_`.
+  // `encoded_chunks_` contains space reserved for the header of the array of
+  // chunks, at offset `encoded_chunks_begin_`, which is written when the
+  // chunks are flushed. Any bytes before the header belong to dropped chunks.
+  // The remaining members describe the chunks in `encoded_chunks_`.
+  bool serialize_on_send_;
+  std::string encoded_chunks_;
+  std::size_t encoded_chunks_begin_ = 0;
+  std::deque<ChunkInfo> encoded_chunk_infos_;
+  TraceApiVersion encoded_api_version_;
+  StringTable encoded_strings_;
+  // For a v0.5 payload, `encoded_chunk_strings_` holds, for each chunk, the
+  // indices of the strings in `encoded_strings_` that the chunk uses.
+  // `encoded_strings_unused_` is whether `encoded_strings_` might contain
+  // strings of chunks that were dropped.
+  std::deque<std::vector<std::uint32_t>> encoded_chunk_strings_;
+  bool encoded_strings_unused_ = false;
+  std::unordered_set<std::shared_ptr<TraceSampler>> encoded_response_handlers_;
+  std::chrono::steady_clock::duration encoding_duration_;
+
+  // `encoding_pool_` is null unless more than one thread encodes the trace
+  // chunks of a large flush.
+  std::unique_ptr<WorkerPool> encoding_pool_;
+
+  // The chunks awaiting the next flush, whether in `trace_chunks_` or in
+  // `encoded_chunks_`, are limited in their total number of spans and bytes.
+  // When a chunk would exceed a limit, `overflow_policy_` decides which chunks
+  // are dropped. The totals are reserved by `send` before a chunk is pushed,
+  // and released when the chunk is flushed or dropped.
+  std::size_t max_buffered_spans_;
+  std::size_t max_buffered_bytes_;
+  TraceBufferOverflowPolicy overflow_policy_;
+  std::atomic<std::size_t> buffered_spans_{0};
+  std::atomic<std::size_t> buffered_bytes_{0};
+  std::atomic<std::size_t> p0_dropped_traces_{0};
+  std::atomic<std::size_t> p0_dropped_spans_{0};
+
+  // `stats_concentrator_` is null unless the tracer computes trace stats.
+  std::unique_ptr<StatsConcentrator> stats_concentrator_;
+
+  // Request bodies of at least `compression_min_bytes_` bytes are gzip
+  // compressed at `compression_level_`, unless it is null.
+  Optional<int> compression_level_;
+  std::size_t compression_min_bytes_;
+
+  // Remove from the specified `spans` those that needn't be sent to the Datadog
+  // Agent because the chunk is sampled out and its trace stats are computed
+  // by the tracer. Return whether any span remains.
+  bool drop_p0_spans(std::vector<std::unique_ptr<SpanData>>& spans);
+
+  Expected<void> encode_chunk(
+      std::vector<std::unique_ptr<SpanData>>&& spans,
+      const std::shared_ptr<TraceSampler>& response_handler);
+
+  // Return whether the chunk described by the specified `chunk` fits within
+  // the buffer limits. If so, account for it as buffered.
+  bool try_reserve(const ChunkInfo& chunk);
+  void push_chunk(TraceChunk&& chunk);
+  void record_drop(const ChunkInfo& chunk);
+  P0Drops take_p0_drops();
+
+  // The following functions require that `mutex_` is locked.
+  void collect_pushed_chunks();
+  // `make_room` returns whether the chunk described by the specified `chunk`
+  // may be buffered, after dropping buffered chunks per `overflow_policy_` if
+  // necessary. If it returns `true`, the chunk is accounted for as buffered.
+  // Otherwise, the chunk is accounted for as dropped.
+  bool make_room(const ChunkInfo& chunk);
+  std::size_t num_buffered_chunks() const;
+  const ChunkInfo& buffered_chunk(std::size_t index) const;
+  // Drop the buffered chunks at the specified ascending `indices`.
+  void drop_buffered_chunks(const std::vector<std::size_t>& indices);
+  void drop_encoded_chunks(const std::vector<std::size_t>& indices);
+  void release(const ChunkInfo& chunk);
+
   void flush();
+  // Flush if `flush_policy_` says so. Otherwise, flush only trace stats.
+  void flush_if_due();
+  void flush_trace_chunks();
+  void flush_encoded_chunks();
+  // Send the specified `payload`, which has failed to be sent the specified
+  // number of `failures` times before.
+  void post_traces(TracePayload payload, int failures);
+  // Send again the payloads in `retry_queue_` that are due.
+  void retry_traces();
+  void flush_stats(bool force);
+  void post_stats(std::string body);
+  // Replace the specified `body` with its gzip compression if compression is
+  // enabled and `body` is large enough. Return whether `body` was compressed.
+  bool compress(std::string& body) const;
 
  public:
   DatadogAgent(const FinalizedDatadogAgentConfig&,
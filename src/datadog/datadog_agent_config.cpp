@@ -1,9 +1,15 @@
 #include <datadog/datadog_agent_config.h>
 #include <datadog/environment.h>
+#include <datadog/host_event_loop.h>
 
 #include "default_http_client.h"
+#include "event_loop.h"
+#include "gzip.h"
 #include "parse_util.h"
 #include "threaded_event_scheduler.h"
+#ifndef _WIN32
+#include "unix_socket_http_client.h"
+#endif
 
 namespace datadog::tracing {
 
@@ -59,6 +65,11 @@ Expected<DatadogAgentConfig> load_datadog_agent_env_config() {
     env_config.remote_configuration_poll_interval_seconds = *res;
   }
 
+  if (auto stats_enabled =
+          lookup(environment::DD_TRACE_STATS_COMPUTATION_ENABLED)) {
+    env_config.stats_computation_enabled = !falsy(*stats_enabled);
+  }
+
   if (Optional<std::string> agent_url =
           build_agent_url_from_environment_variables()) {
     env_config.url = *std::move(agent_url);
@@ -79,23 +90,38 @@ Expected<FinalizedDatadogAgentConfig> finalize_config(
 
   result.clock = clock;
 
-  if (!user_config.http_client) {
-    result.http_client = default_http_client(logger, clock);
-    // `default_http_client` might return a `Curl` instance depending on how
-    // this library was built. If it returns `nullptr`, then there's no
-    // built-in default, and so the user must provide a value.
-    if (!result.http_client) {
-      return Error{Error::DATADOG_AGENT_NULL_HTTP_CLIENT,
-                   "DatadogAgent: HTTP client cannot be null."};
-    }
-  } else {
-    result.http_client = user_config.http_client;
+  // The scheduler and HTTP client of the host's event loop, or else of the
+  // shared event loop, are used unless the user specified their own.
+  std::shared_ptr<EventScheduler> loop_event_scheduler;
+  std::shared_ptr<HTTPClient> loop_http_client;
+  result.host_event_loop = false;
+#ifndef _WIN32
+  if (user_config.host_event_loop) {
+    result.host_event_loop = true;
+    loop_event_scheduler = user_config.host_event_loop->event_scheduler();
+    loop_http_client = user_config.host_event_loop->http_client();
+  }
+#else
+  if (user_config.host_event_loop) {
+    return Error{Error::DATADOG_AGENT_HOST_EVENT_LOOP_UNSUPPORTED,
+                 "DatadogAgent: A host event loop is not supported on "
+                 "Windows."};
+  }
+#endif
+  result.shared_event_loop = !result.host_event_loop &&
+                             user_config.shared_event_loop.value_or(false);
+  if (result.shared_event_loop) {
+    const auto event_loop = EventLoop::shared(logger, clock);
+    loop_event_scheduler = event_loop;
+    loop_http_client = event_loop->http_client();
   }
 
-  if (!user_config.event_scheduler) {
-    result.event_scheduler = std::make_shared<ThreadedEventScheduler>();
-  } else {
+  if (user_config.event_scheduler) {
     result.event_scheduler = user_config.event_scheduler;
+  } else if (loop_event_scheduler) {
+    result.event_scheduler = loop_event_scheduler;
+  } else {
+    result.event_scheduler = std::make_shared<ThreadedEventScheduler>();
   }
 
   result.remote_configuration_listeners =
@@ -154,6 +180,26 @@ Expected<FinalizedDatadogAgentConfig> finalize_config(
       value_or(env_config->remote_configuration_enabled,
                user_config.remote_configuration_enabled, true);
 
+  result.trace_api_version =
+      user_config.trace_api_version.value_or(TraceApiVersion::V0_4);
+  result.serialize_on_send = user_config.serialize_on_send.value_or(false);
+
+  result.max_buffered_spans = user_config.max_buffered_spans.value_or(100000);
+  if (result.max_buffered_spans == 0) {
+    return Error{Error::DATADOG_AGENT_INVALID_TRACE_BUFFER_LIMIT,
+                 "DatadogAgent: The maximum number of buffered spans must be "
+                 "positive."};
+  }
+  result.max_buffered_bytes =
+      user_config.max_buffered_bytes.value_or(25 * 1024 * 1024);
+  if (result.max_buffered_bytes == 0) {
+    return Error{Error::DATADOG_AGENT_INVALID_TRACE_BUFFER_LIMIT,
+                 "DatadogAgent: The maximum number of buffered bytes must be "
+                 "positive."};
+  }
+  result.buffer_overflow_policy = user_config.buffer_overflow_policy.value_or(
+      TraceBufferOverflowPolicy::DROP_NEWEST);
+
   const auto [origin, url] =
       pick(env_config->url, user_config.url, "http://localhost:8126");
   auto parsed_url = HTTPClient::URL::parse(url);
@@ -164,6 +210,28 @@ Expected<FinalizedDatadogAgentConfig> finalize_config(
   result.metadata[ConfigName::AGENT_URL] = {
       ConfigMetadata(ConfigName::AGENT_URL, url, origin)};
 
+  if (user_config.http_client) {
+    result.http_client = user_config.http_client;
+  } else if (loop_http_client) {
+    result.http_client = loop_http_client;
+  } else {
+    result.http_client = default_http_client(logger, clock);
+    // `default_http_client` might return a `Curl` instance depending on how
+    // this library was built. If it returns `nullptr`, then there's no
+    // built-in default, and so the user must provide a value, unless the
+    // Datadog Agent is listening on a unix domain socket.
+#ifndef _WIN32
+    if (!result.http_client && UnixSocketHTTPClient::supports(result.url)) {
+      result.http_client =
+          std::make_shared<UnixSocketHTTPClient>(logger, clock);
+    }
+#endif
+    if (!result.http_client) {
+      return Error{Error::DATADOG_AGENT_NULL_HTTP_CLIENT,
+                   "DatadogAgent: HTTP client cannot be null."};
+    }
+  }
+
   // Starting Datadog Agent 7.62.0, the admission controller inject a unique
   // identifier through `DD_EXTERNAL_ENV`. This uid is used for origin
   // detection.
@@ -171,8 +239,63 @@ Expected<FinalizedDatadogAgentConfig> finalize_config(
     result.admission_controller_uid = std::string(*external_env);
   }
 
-  // Not supported yet but required for APM tracing disablement.
-  result.stats_computation_enabled = false;
+  result.stats_computation_enabled =
+      value_or(env_config->stats_computation_enabled,
+               user_config.stats_computation_enabled, false);
+  result.client_computed_stats = result.stats_computation_enabled;
+
+  if (user_config.compression_enabled.value_or(false)) {
+    if (!gzip_available) {
+      return Error{Error::DATADOG_AGENT_INVALID_COMPRESSION,
+                   "DatadogAgent: Payload compression requires this library "
+                   "to be built with zlib (DD_TRACE_ENABLE_ZLIB)."};
+    }
+    const int level = user_config.compression_level.value_or(1);
+    if (level < 1 || level > 9) {
+      return Error{Error::DATADOG_AGENT_INVALID_COMPRESSION,
+                   "DatadogAgent: Compression level must be between 1 and 9."};
+    }
+    result.compression_level = level;
+  }
+  result.compression_min_bytes =
+      user_config.compression_min_bytes.value_or(1024);
+
+  result.adaptive_flush_enabled =
+      user_config.adaptive_flush_enabled.value_or(false);
+  result.flush_min_payload_bytes =
+      user_config.flush_min_payload_bytes.value_or(64 * 1024);
+  result.flush_max_payload_bytes =
+      user_config.flush_max_payload_bytes.value_or(2 * 1024 * 1024);
+  result.flush_max_spans = user_config.flush_max_spans.value_or(10000);
+  // The flush policy's limits are used only by adaptive flushing.
+  if (result.adaptive_flush_enabled) {
+    if (result.flush_max_payload_bytes == 0 || result.flush_max_spans == 0) {
+      return Error{Error::DATADOG_AGENT_INVALID_FLUSH_POLICY,
+                   "DatadogAgent: The maximum number of bytes and spans per "
+                   "payload must be positive."};
+    }
+    if (result.flush_min_payload_bytes > result.flush_max_payload_bytes) {
+      return Error{Error::DATADOG_AGENT_INVALID_FLUSH_POLICY,
+                   "DatadogAgent: The minimum payload size must not exceed "
+                   "the maximum payload size."};
+    }
+  }
+
+  result.max_trace_retries = user_config.max_trace_retries.value_or(3);
+  if (result.max_trace_retries < 0) {
+    return Error{Error::DATADOG_AGENT_INVALID_MAX_TRACE_RETRIES,
+                 "DatadogAgent: The maximum number of trace retries must not "
+                 "be negative."};
+  }
+  result.retry_buffer_max_bytes =
+      user_config.retry_buffer_max_bytes.value_or(8 * 1024 * 1024);
+
+  result.encoding_threads = user_config.encoding_threads.value_or(1);
+  if (result.encoding_threads < 1) {
+    return Error{Error::DATADOG_AGENT_INVALID_ENCODING_THREADS,
+                 "DatadogAgent: The number of encoding threads must be at "
+                 "least one."};
+  }
 
   return result;
 }
@@ -0,0 +1,230 @@
+#include "ddsketch.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// Protocol buffers wire types.
+constexpr std::uint32_t varint_wire_type = 0;
+constexpr std::uint32_t fixed64_wire_type = 1;
+constexpr std::uint32_t length_delimited_wire_type = 2;
+
+// Field numbers of the messages in "sketches-go/ddsketch/pb/ddsketch.proto".
+namespace fields {
+namespace sketch {
+constexpr std::uint32_t mapping = 1;
+constexpr std::uint32_t positive_values = 2;
+constexpr std::uint32_t zero_count = 4;
+}  // namespace sketch
+namespace index_mapping {
+constexpr std::uint32_t gamma = 1;
+}  // namespace index_mapping
+namespace store {
+constexpr std::uint32_t contiguous_bin_counts = 2;
+constexpr std::uint32_t contiguous_bin_index_offset = 3;
+}  // namespace store
+}  // namespace fields
+
+void append_varint(std::string& destination, std::uint64_t value) {
+  while (value >= 0x80) {
+    destination += static_cast<char>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  destination += static_cast<char>(value);
+}
+
+void append_key(std::string& destination, std::uint32_t field,
+                std::uint32_t wire_type) {
+  append_varint(destination, (field << 3) | wire_type);
+}
+
+// Append the specified `value` as eight little-endian bytes.
+void append_fixed64(std::string& destination, double value) {
+  std::uint64_t bits;
+  static_assert(sizeof bits == sizeof value, "double must be 64 bits");
+  std::memcpy(&bits, &value, sizeof bits);
+  for (int i = 0; i < 8; ++i) {
+    destination += static_cast<char>((bits >> (8 * i)) & 0xFF);
+  }
+}
+
+void append_double_field(std::string& destination, std::uint32_t field,
+                         double value) {
+  append_key(destination, field, fixed64_wire_type);
+  append_fixed64(destination, value);
+}
+
+// Append a "sint32" field, which is "ZigZag" encoded so that small negative
+// numbers have short encodings.
+void append_sint32_field(std::string& destination, std::uint32_t field,
+                         std::int32_t value) {
+  append_key(destination, field, varint_wire_type);
+  append_varint(destination, (static_cast<std::uint32_t>(value) << 1) ^
+                                 static_cast<std::uint32_t>(value >> 31));
+}
+
+void append_message_field(std::string& destination, std::uint32_t field,
+                          const std::string& message) {
+  append_key(destination, field, length_delimited_wire_type);
+  append_varint(destination, message.size());
+  destination += message;
+}
+
+}  // namespace
+
+DDSketch::DDSketch(double relative_accuracy, std::size_t max_num_bins)
+    : relative_accuracy_(relative_accuracy),
+      gamma_((1 + relative_accuracy) / (1 - relative_accuracy)),
+      multiplier_(1 / std::log(gamma_)),
+      min_indexable_value_(std::numeric_limits<double>::min() * gamma_),
+      max_num_bins_(max_num_bins) {
+  assert(relative_accuracy > 0 && relative_accuracy < 1);
+  assert(max_num_bins > 0);
+}
+
+std::int32_t DDSketch::index(double value) const {
+  return static_cast<std::int32_t>(std::floor(std::log(value) * multiplier_));
+}
+
+double DDSketch::lower_bound(std::int32_t index) const {
+  return std::exp(index / multiplier_);
+}
+
+double DDSketch::representative(std::int32_t index) const {
+  return lower_bound(index) * (1 + relative_accuracy_);
+}
+
+void DDSketch::add_to_bin(std::int32_t index, double count) {
+  if (bins_.empty()) {
+    bins_.push_back(0);
+    offset_ = index;
+  }
+
+  const std::int64_t highest = std::max<std::int64_t>(
+      index, std::int64_t(offset_) + std::int64_t(bins_.size()) - 1);
+  const std::int64_t lowest_allowed =
+      highest - std::int64_t(max_num_bins_) + 1;
+
+  if (offset_ < lowest_allowed) {
+    // Collapse the lowest bins into the lowest remaining bin.
+    const std::size_t num_collapsed = std::min<std::size_t>(
+        std::size_t(lowest_allowed - offset_), bins_.size());
+    const double collapsed_count = std::accumulate(
+        bins_.begin(), bins_.begin() + num_collapsed, 0.0);
+    bins_.erase(bins_.begin(), bins_.begin() + num_collapsed);
+    if (bins_.empty()) {
+      bins_.push_back(0);
+    }
+    offset_ = static_cast<std::int32_t>(lowest_allowed);
+    bins_.front() += collapsed_count;
+  }
+
+  index = static_cast<std::int32_t>(
+      std::max(std::int64_t(index), lowest_allowed));
+  if (index < offset_) {
+    bins_.insert(bins_.begin(), std::size_t(offset_ - index), 0);
+    offset_ = index;
+  } else if (index >= offset_ + std::int64_t(bins_.size())) {
+    bins_.resize(std::size_t(index - offset_) + 1, 0);
+  }
+  bins_[std::size_t(index - offset_)] += count;
+}
+
+void DDSketch::add(double value) {
+  if (value < min_indexable_value_) {
+    zero_count_ += 1;
+  } else {
+    add_to_bin(index(value), 1);
+  }
+  count_ += 1;
+}
+
+double DDSketch::count() const { return count_; }
+
+bool DDSketch::empty() const { return count_ == 0; }
+
+double DDSketch::quantile(double quantile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+
+  const double rank = quantile * (count_ - 1);
+  double cumulative_count = zero_count_;
+  if (rank < cumulative_count) {
+    return 0;
+  }
+  for (std::size_t i = 0; i < bins_.size(); ++i) {
+    cumulative_count += bins_[i];
+    if (cumulative_count > rank) {
+      return representative(offset_ + std::int32_t(i));
+    }
+  }
+  return representative(offset_ + std::int32_t(bins_.size()) - 1);
+}
+
+std::vector<double> DDSketch::values(std::size_t max_size) const {
+  const std::size_t size =
+      std::min(max_size, static_cast<std::size_t>(std::llround(count_)));
+  std::vector<double> result;
+  result.reserve(size);
+
+  // The `k`th value is the one having rank `(k + 0.5) * count_ / size`. When
+  // `size` is `count_`, that's every counted value.
+  const double step = size == 0 ? 0 : count_ / double(size);
+  double next_rank = step / 2;
+  double cumulative_count = zero_count_;
+  while (result.size() < size && next_rank < cumulative_count) {
+    result.push_back(0);
+    next_rank += step;
+  }
+  for (std::size_t i = 0; i < bins_.size() && result.size() < size; ++i) {
+    cumulative_count += bins_[i];
+    const double value = representative(offset_ + std::int32_t(i));
+    while (result.size() < size && next_rank < cumulative_count) {
+      result.push_back(value);
+      next_rank += step;
+    }
+  }
+  return result;
+}
+
+void DDSketch::clear() {
+  bins_.clear();
+  offset_ = 0;
+  zero_count_ = 0;
+  count_ = 0;
+}
+
+void DDSketch::encode_protobuf(std::string& destination) const {
+  // The index offset and interpolation of the mapping have their default
+  // values, zero and `NONE`, and so are omitted.
+  std::string mapping;
+  append_double_field(mapping, fields::index_mapping::gamma, gamma_);
+  append_message_field(destination, fields::sketch::mapping, mapping);
+
+  if (!bins_.empty()) {
+    std::string counts;
+    for (const double count : bins_) {
+      append_fixed64(counts, count);
+    }
+    std::string store;
+    append_message_field(store, fields::store::contiguous_bin_counts, counts);
+    append_sint32_field(store, fields::store::contiguous_bin_index_offset,
+                        offset_);
+    append_message_field(destination, fields::sketch::positive_values, store);
+  }
+
+  if (zero_count_ != 0) {
+    append_double_field(destination, fields::sketch::zero_count, zero_count_);
+  }
+}
+
+}  // namespace tracing
+}  // namespace datadog
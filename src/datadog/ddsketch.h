@@ -0,0 +1,86 @@
+#pragma once
+
+// This component provides a class, `DDSketch`, that summarizes a distribution
+// of non-negative values, such as durations, in a bounded amount of memory.
+// Any quantile of the distribution can be estimated from the summary to within
+// a configured relative accuracy. See [the DDSketch paper][1].
+//
+// Values are counted in bins whose boundaries grow geometrically: the bin of a
+// value `x` has index `floor(log(x) / log(gamma))`, where
+// `gamma = (1 + relative_accuracy) / (1 - relative_accuracy)`. The bin counts
+// are kept in a contiguous array. If the array would span more than
+// `max_num_bins` bins, then the lowest bins are collapsed into one, so that
+// the accuracy of the highest quantiles is preserved.
+//
+// `DDSketch` can be serialized as the protocol buffers `DDSketch` message
+// understood by the Datadog Agent, e.g. in the "OkSummary" and "ErrorSummary"
+// of client-computed trace stats.
+//
+// [1]: https://arxiv.org/abs/1908.10693
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+class DDSketch {
+  double relative_accuracy_;
+  double gamma_;
+  // `multiplier_` is `1 / log(gamma_)`.
+  double multiplier_;
+  // Values less than `min_indexable_value_` are counted in `zero_count_`.
+  double min_indexable_value_;
+  std::size_t max_num_bins_;
+  // `bins_[i]` is the count of the bin whose index is `offset_ + i`.
+  std::vector<double> bins_;
+  std::int32_t offset_ = 0;
+  double zero_count_ = 0;
+  double count_ = 0;
+
+  std::int32_t index(double value) const;
+  double lower_bound(std::int32_t index) const;
+  // Return the value that represents the values counted in the bin having the
+  // specified `index`.
+  double representative(std::int32_t index) const;
+  void add_to_bin(std::int32_t index, double count);
+
+ public:
+  static constexpr double default_relative_accuracy = 0.01;
+  static constexpr std::size_t default_max_num_bins = 2048;
+
+  explicit DDSketch(double relative_accuracy = default_relative_accuracy,
+                    std::size_t max_num_bins = default_max_num_bins);
+
+  // Count the specified `value`. Negative values are counted as zero.
+  void add(double value);
+
+  // Return the number of values counted.
+  double count() const;
+  bool empty() const;
+
+  // Return an estimate of the specified `quantile` of the counted values,
+  // where `quantile` is between zero and one, inclusive. Return zero if no
+  // values have been counted.
+  double quantile(double quantile) const;
+
+  // Return values, in increasing order, whose distribution approximates that
+  // of the counted values. If at most the specified `max_size` values were
+  // counted, then there is one value for each counted value, to within the
+  // relative accuracy. Otherwise, there are `max_size` values, taken at
+  // evenly spaced ranks.
+  std::vector<double> values(std::size_t max_size) const;
+
+  // Forget all counted values.
+  void clear();
+
+  // Append to the specified `destination` the protocol buffers encoding of
+  // this sketch as a `DDSketch` message, as defined in the "sketches-go"
+  // library.
+  void encode_protobuf(std::string& destination) const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -1,11 +1,11 @@
 #pragma once
 
-// This component defines a function, `default_http_client`, that returns either
-// a `Curl` instance or `nullptr` depending on whether libcurl was included in
-// the build.
+// This component defines functions, `default_http_client` and
+// `default_driven_http_client`, that return either a `Curl` instance or
+// `nullptr` depending on whether libcurl was included in the build.
 //
-// `default_http_client` is implemented in either `default_http_client_curl.cpp`
-// or `default_http_client_null.cpp`.
+// They are implemented in either `default_http_client_curl.cpp` or
+// `default_http_client_null.cpp`.
 
 #include <datadog/clock.h>
 
@@ -14,11 +14,17 @@
 namespace datadog {
 namespace tracing {
 
+class DrivenHTTPClient;
 class HTTPClient;
 class Logger;
 
 std::shared_ptr<HTTPClient> default_http_client(
     const std::shared_ptr<Logger>& logger, const Clock& clock);
 
+// Return a client that, unlike that returned by `default_http_client`, does
+// not have a thread of its own. See `driven_http_client.h`.
+std::shared_ptr<DrivenHTTPClient> default_driven_http_client(
+    const std::shared_ptr<Logger>& logger, const Clock& clock);
+
 }  // namespace tracing
 }  // namespace datadog
@@ -2,8 +2,8 @@
 #include "default_http_client.h"
 
 // This file is included in the build when libcurl is included in the build.
-// It provides an implementation of `default_http_client` that returns a
-// `Curl` instance.
+// It provides implementations of `default_http_client` and
+// `default_driven_http_client` that return a `Curl` instance.
 //
 // If libcurl is not included in the build, then `default_http_client_null.cpp`
 // will be built instead.
@@ -16,5 +16,10 @@ std::shared_ptr<HTTPClient> default_http_client(
   return std::make_shared<Curl>(logger, clock);
 }
 
+std::shared_ptr<DrivenHTTPClient> default_driven_http_client(
+    const std::shared_ptr<Logger>& logger, const Clock& clock) {
+  return std::make_shared<Curl>(logger, clock, Curl::Driven{});
+}
+
 }  // namespace tracing
 }  // namespace datadog
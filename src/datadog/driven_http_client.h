@@ -0,0 +1,53 @@
+#pragma once
+
+// This component provides an interface, `DrivenHTTPClient`, for an
+// `HTTPClient` that does not have a thread of its own. Instead, its requests
+// progress while another thread, such as that of an `EventLoop`, alternately
+// calls `perform` and `wait`. A thread that waits by other means, such as that
+// of a `HostEventLoop`, instead waits on the `file_descriptors` for up to the
+// `timeout`.
+//
+// `Curl` implements `DrivenHTTPClient`. Unless it's created in its "driven"
+// mode, though, it drives itself with its own thread.
+
+#include <datadog/host_event_loop.h>
+#include <datadog/http_client.h>
+#include <datadog/optional.h>
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+class DrivenHTTPClient : public HTTPClient {
+ public:
+  using FileDescriptor = HostEventLoop::FileDescriptor;
+
+  // Make whatever progress on the outstanding requests can be made without
+  // blocking, and invoke the handlers of the requests that are done. Return
+  // the number of requests that are still outstanding.
+  virtual std::size_t perform() = 0;
+
+  // Block until `perform` might make progress, until `wakeup` is called, or
+  // until the specified `timeout` elapses, whichever is first.
+  virtual void wait(std::chrono::steady_clock::duration timeout) = 0;
+
+  // Interrupt the current call to `wait`, or else the next one. `wakeup` may
+  // be called from any thread.
+  virtual void wakeup() = 0;
+
+  // Append to the specified `fds` the file descriptors on which `perform`
+  // might make progress once they're ready. Requests posted since the previous
+  // call to `perform` are not accounted for; whoever posts them is expected to
+  // arrange for `perform` to be called.
+  virtual void file_descriptors(std::vector<FileDescriptor>& fds) = 0;
+
+  // Return how long `perform` may be postponed if none of the
+  // `file_descriptors` is ready, or null if indefinitely.
+  virtual Optional<std::chrono::steady_clock::duration> timeout() = 0;
+};
+
+}  // namespace tracing
+}  // namespace datadog
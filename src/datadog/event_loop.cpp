@@ -0,0 +1,328 @@
+#include "event_loop.h"
+
+#include <algorithm>
+
+#include "default_http_client.h"
+#include "json.hpp"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// The loop's thread wakes up at least this often, even if there's nothing to
+// do.
+constexpr auto max_wait = std::chrono::seconds(10);
+
+// Events due within the same `resolution` are dispatched together.
+constexpr auto resolution = std::chrono::milliseconds(10);
+
+// `destroyed_by_callback` is set on a loop's thread when one of the loop's own
+// callbacks releases the last reference to it. The thread then returns without
+// touching the loop again.
+thread_local bool destroyed_by_callback = false;
+
+}  // namespace
+
+// `HostedHTTPClient` is the HTTP client of an `EventLoop` that has no thread.
+// It lets the program know when a request is posted, since nothing would
+// otherwise be waiting on the underlying client. It drains the underlying
+// client by driving it on the calling thread, since the program's thread
+// might be the one waiting.
+class EventLoop::HostedHTTPClient : public HTTPClient {
+  std::shared_ptr<EventLoop> loop_;
+
+  // Wake the program if the specified `result` of posting a request is
+  // success. Return `result`.
+  Expected<void> woken(Expected<void> result) {
+    if (result) {
+      std::lock_guard<std::mutex> lock(loop_->mutex_);
+      loop_->wake();
+    }
+    return result;
+  }
+
+ public:
+  explicit HostedHTTPClient(std::shared_ptr<EventLoop> loop)
+      : loop_(std::move(loop)) {}
+
+  Expected<void> post(const URL& url, HeadersSetter set_headers,
+                      std::string body, ResponseHandler on_response,
+                      ErrorHandler on_error,
+                      std::chrono::steady_clock::time_point deadline) override {
+    return woken(loop_->http_client_->post(
+        url, std::move(set_headers), std::move(body), std::move(on_response),
+        std::move(on_error), deadline));
+  }
+
+  Expected<void> post_shared(
+      const URL& url, HeadersSetter set_headers,
+      std::shared_ptr<const std::string> body, ResponseHandler on_response,
+      ErrorHandler on_error,
+      std::chrono::steady_clock::time_point deadline) override {
+    return woken(loop_->http_client_->post_shared(
+        url, std::move(set_headers), std::move(body), std::move(on_response),
+        std::move(on_error), deadline));
+  }
+
+  void drain(std::chrono::steady_clock::time_point deadline) override {
+    {
+      std::lock_guard<std::mutex> lock(loop_->mutex_);
+      if (std::this_thread::get_id() == loop_->driver_) {
+        // This thread is in `process_events`, which holds `drive_mutex_`
+        // and might be performing requests already. The requests instead
+        // finish the next time the program processes events.
+        return;
+      }
+    }
+    std::lock_guard<std::mutex> lock(loop_->drive_mutex_);
+    auto& client = *loop_->http_client_;
+    while (client.perform() != 0) {
+      const auto remaining = deadline - std::chrono::steady_clock::now();
+      if (remaining <= std::chrono::steady_clock::duration::zero()) {
+        break;
+      }
+      client.wait(remaining);
+    }
+  }
+
+  std::string config() const override {
+    return loop_->http_client_->config();
+  }
+};
+
+EventLoop::EventLoop(std::shared_ptr<DrivenHTTPClient> http_client)
+    : http_client_(std::move(http_client)),
+      woken_(false),
+      upcoming_(resolution, std::chrono::steady_clock::now()),
+      shutting_down_(false),
+      thread_([this]() { run(); }) {}
+
+EventLoop::EventLoop(std::shared_ptr<DrivenHTTPClient> http_client,
+                     std::function<void()> on_wake)
+    : http_client_(std::move(http_client)),
+      on_wake_(std::move(on_wake)),
+      woken_(false),
+      upcoming_(resolution, std::chrono::steady_clock::now()),
+      shutting_down_(false) {}
+
+EventLoop::~EventLoop() {
+  if (!thread_.joinable()) {
+    // Nothing is driving this loop but `process_events`.
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+    wake();
+  }
+  if (std::this_thread::get_id() == thread_.get_id()) {
+    // A callback invoked by `thread_` released the last reference to this
+    // loop. The thread can't join itself, and will stop once the callback
+    // returns.
+    destroyed_by_callback = true;
+    thread_.detach();
+    return;
+  }
+  thread_.join();
+}
+
+std::shared_ptr<EventLoop> EventLoop::shared(
+    const std::shared_ptr<Logger>& logger, const Clock& clock) {
+  static std::mutex mutex;
+  static std::weak_ptr<EventLoop> instance;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto loop = instance.lock();
+  if (!loop) {
+    loop = std::make_shared<EventLoop>(
+        default_driven_http_client(logger, clock));
+    instance = loop;
+  }
+  return loop;
+}
+
+std::shared_ptr<HTTPClient> EventLoop::http_client() {
+  if (!http_client_) {
+    return nullptr;
+  }
+  if (on_wake_) {
+    return std::make_shared<HostedHTTPClient>(shared_from_this());
+  }
+  return std::shared_ptr<HTTPClient>(shared_from_this(), http_client_.get());
+}
+
+void EventLoop::file_descriptors(
+    std::vector<DrivenHTTPClient::FileDescriptor>& fds) {
+  if (http_client_) {
+    std::lock_guard<std::mutex> lock(drive_mutex_);
+    http_client_->file_descriptors(fds);
+  }
+}
+
+Optional<std::chrono::steady_clock::duration> EventLoop::timeout() {
+  std::lock_guard<std::mutex> drive_lock(drive_mutex_);
+  Optional<std::chrono::steady_clock::duration> result;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    result = next_timeout();
+  }
+  if (http_client_) {
+    if (const auto client_timeout = http_client_->timeout()) {
+      result = result ? std::min(*result, *client_timeout) : *client_timeout;
+    }
+  }
+  return result;
+}
+
+void EventLoop::process_events() {
+  std::lock_guard<std::mutex> drive_lock(drive_mutex_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  dispatch(lock);
+  if (http_client_) {
+    lock.unlock();
+    http_client_->perform();
+    lock.lock();
+  }
+  // Response handlers are invoked by `perform`, so this thread remains the
+  // `driver_` until now.
+  driver_ = std::thread::id();
+}
+
+EventScheduler::Cancel EventLoop::schedule_recurring_event(
+    std::chrono::steady_clock::duration interval,
+    std::function<void()> callback) {
+  return schedule(interval, interval, std::move(callback));
+}
+
+EventScheduler::Cancel EventLoop::schedule_event(
+    std::chrono::steady_clock::duration delay, std::function<void()> callback) {
+  return schedule(delay, std::chrono::steady_clock::duration::zero(),
+                  std::move(callback));
+}
+
+EventScheduler::Cancel EventLoop::schedule(
+    std::chrono::steady_clock::duration delay,
+    std::chrono::steady_clock::duration interval,
+    std::function<void()> callback) {
+  auto event = std::make_shared<Event>();
+  event->callback = std::move(callback);
+  event->interval = interval;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    event->next = std::chrono::steady_clock::now() + delay;
+    upcoming_.add(event->next, event);
+    wake();
+  }
+
+  // Return a cancellation function. It waits for any running invocation of
+  // the callback to finish, unless it's called on the loop's thread.
+  return [this, event = std::move(event)]() mutable {
+    if (!event) {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    event->cancelled = true;
+    if (std::this_thread::get_id() != driver_) {
+      event_done_.wait(lock, [&event]() { return !event->running; });
+    }
+    event.reset();
+  };
+}
+
+std::string EventLoop::config() const {
+  auto config = nlohmann::json::object(
+      {{"resolution_milliseconds",
+        std::chrono::duration_cast<std::chrono::milliseconds>(resolution)
+            .count()}});
+  if (http_client_) {
+    config["http_client"] = nlohmann::json::parse(http_client_->config());
+  }
+  return nlohmann::json::object(
+             {{"type", "datadog::tracing::EventLoop"}, {"config", config}})
+      .dump();
+}
+
+void EventLoop::wake() {
+  if (on_wake_) {
+    on_wake_();
+  } else if (http_client_) {
+    http_client_->wakeup();
+  } else {
+    woken_ = true;
+    wakeup_.notify_one();
+  }
+}
+
+void EventLoop::dispatch(std::unique_lock<std::mutex>& lock) {
+  driver_ = std::this_thread::get_id();
+  const auto now = std::chrono::steady_clock::now();
+  for (auto& event : upcoming_.advance(now)) {
+    if (event->cancelled) {
+      continue;
+    }
+    if (event->interval > std::chrono::steady_clock::duration::zero()) {
+      // Skip any recurrences that are already past, e.g. if a callback took
+      // longer than the interval.
+      do {
+        event->next += event->interval;
+      } while (event->next <= now);
+      upcoming_.add(event->next, event);
+    }
+
+    event->running = true;
+    lock.unlock();
+    event->callback();
+    if (destroyed_by_callback) {
+      return;
+    }
+    lock.lock();
+    event->running = false;
+    event_done_.notify_all();
+  }
+}
+
+Optional<std::chrono::steady_clock::duration> EventLoop::next_timeout() const {
+  const auto next = upcoming_.next_due();
+  if (!next) {
+    return nullopt;
+  }
+  return std::max(*next - std::chrono::steady_clock::now(),
+                  std::chrono::steady_clock::duration::zero());
+}
+
+void EventLoop::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (!shutting_down_) {
+    dispatch(lock);
+    if (destroyed_by_callback) {
+      return;
+    }
+
+    std::chrono::steady_clock::duration timeout = max_wait;
+    if (const auto next = next_timeout()) {
+      timeout = std::min(timeout, *next);
+    }
+
+    if (http_client_) {
+      // A response handler might destroy this loop, and with it the loop's
+      // reference to the client.
+      const auto client = http_client_;
+      lock.unlock();
+      client->perform();
+      if (destroyed_by_callback) {
+        return;
+      }
+      client->wait(timeout);
+      lock.lock();
+    } else {
+      wakeup_.wait_for(lock, timeout, [this]() { return woken_; });
+      woken_ = false;
+    }
+  }
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,143 @@
+#pragma once
+
+// This component provides a class, `EventLoop`, that implements the
+// `EventScheduler` interface in terms of a single thread, which also drives
+// the requests of an optional `DrivenHTTPClient`.
+//
+// A process that has many tracers would otherwise have, for each of them, the
+// threads of a `ThreadedEventScheduler` and of an HTTP client, nearly all of
+// them idle. Tracers configured with `DatadogAgentConfig::shared_event_loop`
+// instead share the process-wide `EventLoop` returned by `EventLoop::shared`:
+// their `DatadogAgent` and telemetry schedule their events on it, and send
+// their requests through its HTTP client.
+//
+// The loop's thread waits for whichever is first: the next scheduled event,
+// or progress on the HTTP client's requests. Scheduled events are kept in a
+// `TimerWheel`, as in `ThreadedEventScheduler`, but their callbacks are
+// invoked on the loop's thread, one at a time. A slow callback delays the
+// other events and the HTTP client's requests.
+//
+// An `EventLoop` is owned by whoever holds a `std::shared_ptr` to it, or to
+// its HTTP client. Destroying the `EventLoop` stops and joins its thread, or,
+// if it's destroyed by one of its own callbacks, lets the thread finish alone.
+// Requests that are still outstanding then are abandoned without their
+// handlers being invoked, so owners are expected to `drain` the HTTP client
+// before releasing it, as `DatadogAgent` does.
+//
+// An `EventLoop` can instead be created without a thread, in which case it's
+// driven by a `HostEventLoop`: the program's thread calls `process_events`
+// whenever one of the `file_descriptors` is ready or the `timeout` elapses.
+// Scheduling an event or posting a request then invokes the `on_wake` function
+// given to the constructor, rather than interrupting a thread.
+
+#include <datadog/clock.h>
+#include <datadog/event_scheduler.h>
+#include <datadog/optional.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "driven_http_client.h"
+#include "timer_wheel.h"
+
+namespace datadog {
+namespace tracing {
+
+class HTTPClient;
+class Logger;
+
+class EventLoop : public EventScheduler,
+                  public std::enable_shared_from_this<EventLoop> {
+  struct Event {
+    std::function<void()> callback;
+    // `interval` is zero for a one-shot event.
+    std::chrono::steady_clock::duration interval;
+    // When the event is next due.
+    std::chrono::steady_clock::time_point next;
+    bool cancelled = false;
+    bool running = false;
+  };
+
+  class HostedHTTPClient;
+
+  std::shared_ptr<DrivenHTTPClient> http_client_;
+  // `on_wake_` is set only if this loop is driven by `process_events`.
+  std::function<void()> on_wake_;
+  // `drive_mutex_` is locked by whichever thread is driving `http_client_`
+  // from outside of `thread_`, i.e. in `process_events` or in a `drain`.
+  std::mutex drive_mutex_;
+  std::mutex mutex_;
+  // `woken_` and `wakeup_` are used to wait only if there's no `http_client_`.
+  bool woken_;
+  std::condition_variable wakeup_;
+  std::condition_variable event_done_;
+  TimerWheel<std::shared_ptr<Event>> upcoming_;
+  bool shutting_down_;
+  // `driver_` is the thread that is invoking the events' callbacks. If this
+  // loop has no thread, then `driver_` is set only during `process_events`.
+  std::thread::id driver_;
+  std::thread thread_;
+
+  Cancel schedule(std::chrono::steady_clock::duration delay,
+                  std::chrono::steady_clock::duration interval,
+                  std::function<void()> callback);
+  // Interrupt the loop's thread if it's waiting. The behavior is undefined
+  // unless `mutex_` is locked.
+  void wake();
+  // Invoke the callbacks of the events that are due. The behavior is undefined
+  // unless `lock` holds `mutex_`.
+  void dispatch(std::unique_lock<std::mutex>& lock);
+  // Return how long until the next event is due, or null if there is none. The
+  // behavior is undefined unless `mutex_` is locked.
+  Optional<std::chrono::steady_clock::duration> next_timeout() const;
+  void run();
+
+ public:
+  // Create a loop that drives the specified `http_client`, which may be null.
+  explicit EventLoop(std::shared_ptr<DrivenHTTPClient> http_client);
+  // Create a loop that has no thread, and that drives the specified
+  // `http_client`, which may be null, only when `process_events` is called.
+  // Invoke the specified `on_wake` whenever `process_events` is to be called
+  // sooner than `timeout` indicates.
+  EventLoop(std::shared_ptr<DrivenHTTPClient> http_client,
+            std::function<void()> on_wake);
+  ~EventLoop();
+
+  // Return the process-wide `EventLoop`, creating it if there isn't one. The
+  // loop exists for as long as something holds it or its HTTP client, and so
+  // the next call after that creates another. When it's created, the loop's
+  // HTTP client is the default for this library's build, i.e. a `Curl`
+  // instance that logs to the specified `logger` and uses the specified
+  // `clock`, or null if this library was built without libcurl. The `logger`
+  // and `clock` are used only by the call that creates the loop. Later
+  // callers share its HTTP client, which keeps logging to the first caller's
+  // `logger` and using its `clock`, while the loop exists.
+  static std::shared_ptr<EventLoop> shared(const std::shared_ptr<Logger>& logger,
+                                           const Clock& clock);
+
+  // Return the HTTP client driven by this loop, or null if there is none. The
+  // returned pointer shares the ownership of this loop.
+  std::shared_ptr<HTTPClient> http_client();
+
+  // The following are used only if this loop was created without a thread.
+  // See `HostEventLoop`.
+  void file_descriptors(std::vector<DrivenHTTPClient::FileDescriptor>& fds);
+  Optional<std::chrono::steady_clock::duration> timeout();
+  void process_events();
+
+  Cancel schedule_recurring_event(std::chrono::steady_clock::duration interval,
+                                  std::function<void()> callback) override;
+
+  Cancel schedule_event(std::chrono::steady_clock::duration delay,
+                        std::function<void()> callback) override;
+
+  std::string config() const override;
+};
+
+}  // namespace tracing
+}  // namespace datadog
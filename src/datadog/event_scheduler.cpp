@@ -0,0 +1,67 @@
+#include <datadog/event_scheduler.h>
+
+#include <memory>
+#include <mutex>
+
+namespace datadog {
+namespace tracing {
+
+EventScheduler::Cancel EventScheduler::schedule_event(
+    std::chrono::steady_clock::duration delay, std::function<void()> callback) {
+  struct State {
+    std::mutex mutex;
+    // Whether `callback` has been invoked, or the event cancelled.
+    bool done = false;
+    // Cancels the recurring event. Null until `schedule_recurring_event`
+    // returns, or after it's been invoked.
+    Cancel cancel;
+  };
+  auto state = std::make_shared<State>();
+
+  Cancel cancel = schedule_recurring_event(
+      delay, [state, callback = std::move(callback)]() {
+        Cancel cancel;
+        {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          if (state->done) {
+            return;
+          }
+          state->done = true;
+          cancel = std::move(state->cancel);
+          state->cancel = nullptr;
+        }
+        callback();
+        // If the event fired before `schedule_recurring_event` returned, then
+        // it's cancelled below instead.
+        if (cancel) {
+          cancel();
+        }
+      });
+
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (!state->done) {
+      state->cancel = std::move(cancel);
+      cancel = nullptr;
+    }
+  }
+  if (cancel) {
+    cancel();
+  }
+
+  return [state]() {
+    Cancel cancel;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->done = true;
+      cancel = std::move(state->cancel);
+      state->cancel = nullptr;
+    }
+    if (cancel) {
+      cancel();
+    }
+  };
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -24,8 +24,7 @@ namespace {
 // to the specified `span_tags` and log a diagnostic using the specified
 // `logger`.
 void handle_trace_tags(StringView trace_tags, ExtractedData& result,
-                       std::unordered_map<std::string, std::string>& span_tags,
-                       Logger& logger) {
+                       SpanTags& span_tags, Logger& logger) {
   auto maybe_trace_tags = decode_tags(trace_tags);
   if (auto* error = maybe_trace_tags.if_error()) {
     logger.log_error(*error);
@@ -108,9 +107,8 @@ Optional<std::uint64_t> parse_trace_id_high(const std::string& value) {
   return nullopt;
 }
 
-Expected<ExtractedData> extract_datadog(
-    const DictReader& headers,
-    std::unordered_map<std::string, std::string>& span_tags, Logger& logger) {
+Expected<ExtractedData> extract_datadog(const DictReader& headers,
+                                        SpanTags& span_tags, Logger& logger) {
   ExtractedData result;
   result.style = PropagationStyle::DATADOG;
 
@@ -169,9 +167,8 @@ Expected<ExtractedData> extract_datadog(
   return result;
 }
 
-Expected<ExtractedData> extract_b3(
-    const DictReader& headers, std::unordered_map<std::string, std::string>&,
-    Logger&) {
+Expected<ExtractedData> extract_b3(const DictReader& headers, SpanTags&,
+                                   Logger&) {
   ExtractedData result;
   result.style = PropagationStyle::B3;
 
@@ -211,8 +208,7 @@ Expected<ExtractedData> extract_b3(
   return result;
 }
 
-Expected<ExtractedData> extract_none(
-    const DictReader&, std::unordered_map<std::string, std::string>&, Logger&) {
+Expected<ExtractedData> extract_none(const DictReader&, SpanTags&, Logger&) {
   ExtractedData result;
   result.style = PropagationStyle::NONE;
   return result;
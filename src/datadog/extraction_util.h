@@ -14,6 +14,8 @@
 #include <utility>
 #include <vector>
 
+#include "span_data.h"
+
 namespace datadog {
 namespace tracing {
 
@@ -28,20 +30,17 @@ Optional<std::uint64_t> parse_trace_id_high(const std::string& value);
 // Return trace information parsed from the specified `headers` in the Datadog
 // propagation style. Use the specified `span_tags` and `logger` to report
 // warnings. If an error occurs, return an `Error`.
-Expected<ExtractedData> extract_datadog(
-    const DictReader& headers,
-    std::unordered_map<std::string, std::string>& span_tags, Logger& logger);
+Expected<ExtractedData> extract_datadog(const DictReader& headers,
+                                        SpanTags& span_tags, Logger& logger);
 
 // Return trace information parsed from the specified `headers` in the B3
 // multi-header propagation style. If an error occurs, return an `Error`.
-Expected<ExtractedData> extract_b3(
-    const DictReader& headers, std::unordered_map<std::string, std::string>&,
-    Logger&);
+Expected<ExtractedData> extract_b3(const DictReader& headers, SpanTags&,
+                                   Logger&);
 
 // Return an `ExtractedData` whose only non-default field is
 // `style = PropagationStyle::NONE`.
-Expected<ExtractedData> extract_none(
-    const DictReader&, std::unordered_map<std::string, std::string>&, Logger&);
+Expected<ExtractedData> extract_none(const DictReader&, SpanTags&, Logger&);
 
 // Return a string that can be used as the argument to `Error::with_prefix` for
 // errors occurring while extracting trace information in the specified `style`
@@ -0,0 +1,51 @@
+#include "flush_policy.h"
+
+#include <algorithm>
+
+namespace datadog {
+namespace tracing {
+
+FlushPolicy::FlushPolicy(const Config& config,
+                         std::chrono::steady_clock::time_point now)
+    : config_(config), interval_(config.interval), last_flush_(now) {}
+
+std::chrono::steady_clock::duration FlushPolicy::tick() const {
+  return config_.interval / 4;
+}
+
+bool FlushPolicy::should_flush(std::chrono::steady_clock::time_point now,
+                               std::size_t buffered_bytes,
+                               std::size_t buffered_spans) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const bool full = backoff_ == 1 &&
+                    (buffered_bytes >= config_.max_payload_bytes ||
+                     buffered_spans >= config_.max_spans);
+  if (!full && now - last_flush_ < interval_ * backoff_) {
+    return false;
+  }
+
+  if (full) {
+    interval_ = std::max(config_.interval / 4, interval_ / 2);
+  } else if (buffered_bytes < config_.min_payload_bytes) {
+    interval_ = std::min(config_.interval * 4, interval_ * 2);
+  }
+  last_flush_ = now;
+  return true;
+}
+
+void FlushPolicy::on_response(int status) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (status == 429 || status == 503) {
+    backoff_ = std::min(max_backoff, backoff_ * 2);
+  } else if (status >= 200 && status < 300) {
+    backoff_ = 1;
+  }
+}
+
+std::chrono::steady_clock::duration FlushPolicy::interval() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return interval_ * backoff_;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,71 @@
+#pragma once
+
+// This component provides a `class`, `FlushPolicy`, that decides when
+// `DatadogAgent` flushes its buffered trace chunks, if adaptive flushing is
+// enabled (see `DatadogAgentConfig::adaptive_flush_enabled`).
+//
+// `DatadogAgent` consults its `FlushPolicy` on every tick of a recurring
+// event. A flush is due when enough bytes or spans are buffered, or when the
+// current interval has elapsed since the previous flush. The interval adapts
+// so that payloads stay within a target size range: it doubles after a flush
+// smaller than the range, and halves after a flush that was due to the amount
+// buffered. It stays between a quarter of and four times the configured
+// interval.
+//
+// When the Datadog Agent responds to a flush with status 429 (Too Many
+// Requests) or 503 (Service Unavailable), the policy backs off: each such
+// response doubles the interval, up to `max_backoff` times, and the amount
+// buffered no longer makes a flush due. The next successful response ends the
+// backoff.
+//
+// `FlushPolicy` is safe to use from multiple threads, since responses are
+// delivered on the HTTP client's thread.
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+namespace datadog {
+namespace tracing {
+
+class FlushPolicy {
+ public:
+  struct Config {
+    std::chrono::steady_clock::duration interval;
+    std::size_t min_payload_bytes;
+    std::size_t max_payload_bytes;
+    std::size_t max_spans;
+  };
+
+  static constexpr int max_backoff = 8;
+
+ private:
+  mutable std::mutex mutex_;
+  Config config_;
+  std::chrono::steady_clock::duration interval_;
+  int backoff_ = 1;
+  std::chrono::steady_clock::time_point last_flush_;
+
+ public:
+  FlushPolicy(const Config& config, std::chrono::steady_clock::time_point now);
+
+  // Return how often `should_flush` is meant to be called.
+  std::chrono::steady_clock::duration tick() const;
+
+  // Return whether buffered trace chunks having the specified
+  // `buffered_bytes` and `buffered_spans` are to be flushed at the specified
+  // `now`. If so, adapt the interval as though they were flushed.
+  bool should_flush(std::chrono::steady_clock::time_point now,
+                    std::size_t buffered_bytes, std::size_t buffered_spans);
+
+  // Back off, or stop backing off, according to the specified HTTP response
+  // `status` of a flush.
+  void on_response(int status);
+
+  // Return the time that must elapse between flushes that are not due to the
+  // amount buffered, including any backoff.
+  std::chrono::steady_clock::duration interval() const;
+};
+
+}  // namespace tracing
+}  // namespace datadog
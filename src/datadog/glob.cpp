@@ -4,8 +4,30 @@
 
 namespace datadog {
 namespace tracing {
+namespace {
 
-bool glob_match(StringView pattern, StringView subject) {
+char lower(char c) {
+  return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+// Return whether the specified `subject` is equal to the specified
+// `lowercase` string, ignoring the case of `subject`.
+bool equals_lowercase(StringView subject, StringView lowercase) {
+  if (subject.size() != lowercase.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < subject.size(); ++i) {
+    if (lower(subject[i]) != lowercase[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// If `PatternIsLowercase`, then the pattern characters are compared without
+// first being lowercased.
+template <bool PatternIsLowercase>
+bool backtracking_match(StringView pattern, StringView subject) {
   // This is a backtracking implementation of the glob matching algorithm.
   // The glob pattern language supports `*` and `?`, but no escape sequences.
   //
@@ -40,7 +62,9 @@ bool glob_match(StringView pattern, StringView subject) {
           }
           break;
         default:
-          if (s < s_size && tolower(subject[s]) == tolower(pattern_char)) {
+          if (s < s_size &&
+              lower(subject[s]) ==
+                  (PatternIsLowercase ? pattern_char : lower(pattern_char))) {
             ++p;
             ++s;
             continue;
@@ -58,5 +82,62 @@ bool glob_match(StringView pattern, StringView subject) {
   return true;
 }
 
+}  // namespace
+
+bool glob_match(StringView pattern, StringView subject) {
+  return backtracking_match<false>(pattern, subject);
+}
+
+GlobPattern::GlobPattern(StringView pattern) : kind_(Kind::GENERAL) {
+  text_.reserve(pattern.size());
+  for (const char c : pattern) {
+    text_.push_back(lower(c));
+  }
+
+  const std::size_t first = text_.find_first_not_of('*');
+  if (first == std::string::npos) {
+    kind_ = text_.empty() ? Kind::EXACT : Kind::ANY;
+    return;
+  }
+  const std::size_t last = text_.find_last_not_of('*');
+  const StringView middle = StringView(text_).substr(first, last + 1 - first);
+  if (middle.find_first_of("*?") != StringView::npos) {
+    return;
+  }
+
+  const bool leading_star = first != 0;
+  const bool trailing_star = last + 1 != text_.size();
+  if (leading_star && trailing_star) {
+    return;
+  }
+  if (leading_star) {
+    kind_ = Kind::SUFFIX;
+  } else if (trailing_star) {
+    kind_ = Kind::PREFIX;
+  } else {
+    kind_ = Kind::EXACT;
+  }
+  text_ = std::string(middle);
+}
+
+bool GlobPattern::match(StringView subject) const {
+  switch (kind_) {
+    case Kind::ANY:
+      return true;
+    case Kind::EXACT:
+      return equals_lowercase(subject, text_);
+    case Kind::PREFIX:
+      return subject.size() >= text_.size() &&
+             equals_lowercase(subject.substr(0, text_.size()), text_);
+    case Kind::SUFFIX:
+      return subject.size() >= text_.size() &&
+             equals_lowercase(subject.substr(subject.size() - text_.size()),
+                              text_);
+    case Kind::GENERAL:
+      break;
+  }
+  return backtracking_match<true>(text_, subject);
+}
+
 }  // namespace tracing
 }  // namespace datadog
@@ -10,9 +10,18 @@
 //
 // The patterns are here called "glob patterns," though they are different from
 // the patterns used in Unix shells.
+//
+// Matching is case-insensitive.
+//
+// This component also provides a class, `GlobPattern`, that is a glob pattern
+// prepared for matching many subjects. `GlobPattern` lowercases the pattern
+// once, and recognizes the common forms "*", "literal", "prefix*", and
+// "*suffix", which it matches without backtracking.
 
 #include <datadog/string_view.h>
 
+#include <string>
+
 namespace datadog {
 namespace tracing {
 
@@ -21,5 +30,28 @@ namespace tracing {
 // glob `pattern`.
 bool glob_match(StringView pattern, StringView subject);
 
+class GlobPattern {
+  enum class Kind { ANY, EXACT, PREFIX, SUFFIX, GENERAL };
+
+  Kind kind_;
+  // The lowercase literal part of the pattern for `EXACT`, `PREFIX`, and
+  // `SUFFIX`, or the entire lowercase pattern for `GENERAL`.
+  std::string text_;
+
+ public:
+  explicit GlobPattern(StringView pattern);
+
+  // Return whether the specified `subject` matches this pattern. This is
+  // equivalent to `glob_match(pattern, subject)`.
+  bool match(StringView subject) const;
+
+  // Return whether this pattern contains no wildcards, in which case it
+  // matches only strings equal to `literal()`, ignoring case.
+  bool is_exact() const { return kind_ == Kind::EXACT; }
+  // Return the lowercase text of this pattern. The behavior is undefined
+  // unless `is_exact()`.
+  const std::string& literal() const { return text_; }
+};
+
 }  // namespace tracing
 }  // namespace datadog
@@ -0,0 +1,28 @@
+#pragma once
+
+// This component provides a function, `gzip`, that compresses a request body
+// in the gzip format, so that it can be sent with the header
+// "Content-Encoding: gzip".
+//
+// `gzip` is implemented using zlib in `gzip_zlib.cpp` if this library was
+// built with the `DD_TRACE_ENABLE_ZLIB` CMake option, and otherwise in
+// `gzip_null.cpp`, where compression is unavailable.
+
+#include <datadog/expected.h>
+#include <datadog/string_view.h>
+
+#include <string>
+
+namespace datadog {
+namespace tracing {
+
+// Whether this library was built with zlib, so that `gzip` can succeed.
+extern const bool gzip_available;
+
+// Return the gzip compression of the specified `data` at the specified zlib
+// compression `level`, which is between 1 (fastest) and 9 (smallest). Return
+// an error if compression fails or is unavailable.
+Expected<std::string> gzip(StringView data, int level);
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,19 @@
+#include "gzip.h"
+
+// This file is included in the build when zlib is not included in the build.
+// Payload compression is then unavailable, and `DatadogAgentConfig` rejects
+// a configuration that enables it.
+
+namespace datadog {
+namespace tracing {
+
+const bool gzip_available = false;
+
+Expected<std::string> gzip(StringView, int) {
+  return Error{Error::PAYLOAD_COMPRESSION_FAILURE,
+               "This library was built without zlib, so it cannot compress "
+               "payloads."};
+}
+
+}  // namespace tracing
+}  // namespace datadog
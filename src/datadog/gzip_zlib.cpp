@@ -0,0 +1,46 @@
+#include "gzip.h"
+
+#include <zlib.h>
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// Adding 16 to the default window size of 2^15 bytes tells zlib to write a
+// gzip header and trailer instead of a zlib wrapper.
+constexpr int gzip_window_bits = 15 + 16;
+constexpr int default_memory_level = 8;
+
+}  // namespace
+
+const bool gzip_available = true;
+
+Expected<std::string> gzip(StringView data, int level) {
+  z_stream stream{};
+  if (deflateInit2(&stream, level, Z_DEFLATED, gzip_window_bits,
+                   default_memory_level, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return Error{Error::PAYLOAD_COMPRESSION_FAILURE,
+                 "Unable to initialize zlib for gzip compression."};
+  }
+
+  // `deflateBound` is large enough for the output of a single call to
+  // `deflate` with `Z_FINISH`.
+  std::string result;
+  result.resize(deflateBound(&stream, static_cast<uLong>(data.size())));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&result[0]);
+  stream.avail_out = static_cast<uInt>(result.size());
+
+  const int status = deflate(&stream, Z_FINISH);
+  result.resize(stream.total_out);
+  deflateEnd(&stream);
+  if (status != Z_STREAM_END) {
+    return Error{Error::PAYLOAD_COMPRESSION_FAILURE,
+                 "zlib was unable to gzip compress a payload."};
+  }
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,104 @@
+#include <datadog/host_event_loop.h>
+#include <datadog/logger.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "default_http_client.h"
+#include "event_loop.h"
+
+namespace datadog {
+namespace tracing {
+
+// `Pipe` is how other threads wake the program's event loop. It's shared with
+// the `EventLoop`, which might outlive the `HostEventLoop` if a tracer still
+// holds it.
+struct HostEventLoop::Pipe {
+  int read_fd = -1;
+  int write_fd = -1;
+
+  explicit Pipe(Logger& logger) {
+    int fds[2];
+    if (::pipe(fds) != 0) {
+      std::string message;
+      message += "Unable to create a pipe for the host event loop: ";
+      message += std::strerror(errno);
+      logger.log_error(
+          Error{Error::HOST_EVENT_LOOP_SETUP_FAILED, std::move(message)});
+      return;
+    }
+    for (const int fd : fds) {
+      ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+      ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    read_fd = fds[0];
+    write_fd = fds[1];
+  }
+
+  ~Pipe() {
+    if (read_fd >= 0) {
+      ::close(read_fd);
+      ::close(write_fd);
+    }
+  }
+
+  void wake() {
+    if (write_fd < 0) {
+      return;
+    }
+    // If the pipe is full, then the program is already going to wake up.
+    const char byte = 0;
+    [[maybe_unused]] const auto result = ::write(write_fd, &byte, 1);
+  }
+
+  void drain() {
+    if (read_fd < 0) {
+      return;
+    }
+    char buffer[64];
+    while (::read(read_fd, buffer, sizeof buffer) > 0) {
+    }
+  }
+};
+
+HostEventLoop::HostEventLoop(const std::shared_ptr<Logger>& logger,
+                             const Clock& clock)
+    : wake_pipe_(std::make_shared<Pipe>(*logger)),
+      loop_(std::make_shared<EventLoop>(
+          default_driven_http_client(logger, clock),
+          [pipe = wake_pipe_]() { pipe->wake(); })) {}
+
+HostEventLoop::~HostEventLoop() = default;
+
+void HostEventLoop::file_descriptors(std::vector<FileDescriptor>& fds) const {
+  fds.clear();
+  if (wake_pipe_->read_fd >= 0) {
+    fds.push_back(FileDescriptor{wake_pipe_->read_fd, true, false});
+  }
+  loop_->file_descriptors(fds);
+}
+
+Optional<std::chrono::steady_clock::duration> HostEventLoop::timeout() const {
+  return loop_->timeout();
+}
+
+void HostEventLoop::process_events() {
+  // Drain the pipe first, so that a wakeup that happens while events are
+  // being processed is not lost.
+  wake_pipe_->drain();
+  loop_->process_events();
+}
+
+std::shared_ptr<EventScheduler> HostEventLoop::event_scheduler() const {
+  return loop_;
+}
+
+std::shared_ptr<HTTPClient> HostEventLoop::http_client() const {
+  return loop_->http_client();
+}
+
+}  // namespace tracing
+}  // namespace datadog
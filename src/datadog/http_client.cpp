@@ -97,5 +97,13 @@ Expected<HTTPClient::URL> HTTPClient::URL::parse(StringView input) {
       std::move(path), std::move(query)};
 }
 
+Expected<void> HTTPClient::post_shared(
+    const URL& url, HeadersSetter set_headers,
+    std::shared_ptr<const std::string> body, ResponseHandler on_response,
+    ErrorHandler on_error, std::chrono::steady_clock::time_point deadline) {
+  return post(url, std::move(set_headers), *body, std::move(on_response),
+              std::move(on_error), deadline);
+}
+
 }  // namespace tracing
 }  // namespace datadog
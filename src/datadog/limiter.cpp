@@ -6,24 +6,33 @@
 
 namespace datadog {
 namespace tracing {
+namespace {
+
+std::int64_t period_of(std::chrono::steady_clock::time_point time) {
+  return std::chrono::time_point_cast<std::chrono::seconds>(time)
+      .time_since_epoch()
+      .count();
+}
+
+}  // namespace
 
 Limiter::Limiter(const Clock& clock, int max_tokens, double refresh_rate,
                  int tokens_per_refresh)
     : clock_(clock),
-      num_tokens_(max_tokens),
       max_tokens_(max_tokens),
-      tokens_per_refresh_(tokens_per_refresh),
-      previous_rates_(9, 1.0) {
+      full_at_(0),
+      previous_rates_(9, 1.0),
+      num_allowed_(0),
+      num_requested_(0) {
   // calculate refresh interval: (1/rate) * tokens per refresh as nanoseconds
-  refresh_interval_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                          std::chrono::duration_cast<std::chrono::nanoseconds>(
-                              std::chrono::seconds(1)) /
-                          refresh_rate) *
-                      tokens_per_refresh_;
-
-  auto now = clock_().tick;
-  next_refresh_ = now + refresh_interval_;
-  current_period_ = std::chrono::time_point_cast<std::chrono::seconds>(now);
+  token_interval_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::seconds(1)) /
+      refresh_rate);
+  refresh_interval_ = token_interval_ * tokens_per_refresh;
+
+  start_ = clock_().tick;
+  current_period_ = period_of(start_);
   previous_rates_sum_ =
       std::accumulate(previous_rates_.begin(), previous_rates_.end(), 0.0);
 }
@@ -35,64 +44,83 @@ Limiter::Limiter(const Clock& clock, double allowed_per_second)
 Limiter::Result Limiter::allow() { return allow(1); }
 
 Limiter::Result Limiter::allow(int tokens_requested) {
-  auto now = clock_().tick;
-
-  // update effective rate calculations
-  auto intervals = std::chrono::duration_cast<std::chrono::seconds>(
-                       std::chrono::time_point_cast<std::chrono::seconds>(now) -
-                       current_period_)
-                       .count();
-  if (intervals > 0) {
-    if (std::size_t(intervals) >= previous_rates_.size()) {
-      std::fill(previous_rates_.begin() + 1, previous_rates_.end(), 1.0);
-    } else {
-      std::move_backward(previous_rates_.begin(),
-                         previous_rates_.end() - intervals,
-                         previous_rates_.end());
-      if (num_requested_ > 0) {
-        previous_rates_[intervals - 1] =
-            double(num_allowed_) / double(num_requested_);
-      } else {
-        previous_rates_[intervals - 1] = 1.0;
-      }
-      if (intervals - 2 > 0) {
-        std::fill(previous_rates_.begin(),
-                  previous_rates_.begin() + intervals - 2, 1.0);
-      }
-    }
-    previous_rates_sum_ =
-        std::accumulate(previous_rates_.begin(), previous_rates_.end(), 0.0);
-    num_allowed_ = 0;
-    num_requested_ = 0;
-    current_period_ = now;
+  const auto now = clock_().tick;
+
+  const std::int64_t period = period_of(now);
+  if (period > current_period_.load(std::memory_order_acquire)) {
+    begin_period(period);
   }
 
-  num_requested_++;
-  // refill "tokens"
-  if (now >= next_refresh_) {
-    intervals = (now - next_refresh_).count() / refresh_interval_.count() + 1;
-    if (intervals > 0) {
-      next_refresh_ += refresh_interval_ * intervals;
-      num_tokens_ += static_cast<int>(intervals * tokens_per_refresh_);
-      if (num_tokens_ > max_tokens_) {
-        num_tokens_ = max_tokens_;
-      }
+  const int num_requested = num_requested_.fetch_add(1) + 1;
+  const bool allowed = take(now, tokens_requested);
+  const int num_allowed =
+      allowed ? num_allowed_.fetch_add(1) + 1 : num_allowed_.load();
+
+  // `effective_rate` is guaranteed to be between 0.0 and 1.0. A concurrent
+  // `begin_period` can reset one counter but not yet the other, so the rate
+  // of the current period is clamped.
+  const double current_rate =
+      std::min(1.0, double(num_allowed) / double(num_requested));
+  double effective_rate = (previous_rates_sum_.load() + current_rate) /
+                          (previous_rates_.size() + 1);
+
+  return {allowed, *Rate::from(effective_rate)};
+}
+
+bool Limiter::take(std::chrono::steady_clock::time_point now, int tokens) {
+  // Tokens are refreshed only at whole multiples of `refresh_interval_`, so
+  // measure time in those.
+  const auto elapsed =
+      std::max(now - start_, std::chrono::steady_clock::duration::zero());
+  const std::int64_t refreshed_at =
+      (elapsed / refresh_interval_ * refresh_interval_).count();
+  const std::int64_t cost = tokens * token_interval_.count();
+  const std::int64_t capacity = max_tokens_ * token_interval_.count();
+
+  std::int64_t full_at = full_at_.load(std::memory_order_relaxed);
+  for (;;) {
+    const std::int64_t next_full_at = std::max(full_at, refreshed_at) + cost;
+    if (next_full_at - refreshed_at > capacity) {
+      return false;
+    }
+    if (full_at_.compare_exchange_weak(full_at, next_full_at,
+                                       std::memory_order_relaxed)) {
+      return true;
     }
   }
-  // determine if allowed or not
-  bool allowed = false;
-  if (num_tokens_ >= tokens_requested) {
-    allowed = true;
-    num_allowed_++;
-    num_tokens_ -= tokens_requested;
-  }
+}
 
-  // `effective_rate` is guaranteed to be between 0.0 and 1.0.
-  double effective_rate =
-      (previous_rates_sum_ + double(num_allowed_) / double(num_requested_)) /
-      (previous_rates_.size() + 1);
+void Limiter::begin_period(std::int64_t period) {
+  std::lock_guard<std::mutex> lock(period_mutex_);
+  const std::int64_t current_period = current_period_.load();
+  if (period <= current_period) {
+    // Another thread got here first.
+    return;
+  }
 
-  return {allowed, *Rate::from(effective_rate)};
+  const int num_allowed = num_allowed_.exchange(0);
+  const int num_requested = num_requested_.exchange(0);
+  const std::int64_t intervals = period - current_period;
+  if (std::size_t(intervals) >= previous_rates_.size()) {
+    std::fill(previous_rates_.begin() + 1, previous_rates_.end(), 1.0);
+  } else {
+    std::move_backward(previous_rates_.begin(),
+                       previous_rates_.end() - intervals,
+                       previous_rates_.end());
+    if (num_requested > 0) {
+      previous_rates_[intervals - 1] =
+          std::min(1.0, double(num_allowed) / double(num_requested));
+    } else {
+      previous_rates_[intervals - 1] = 1.0;
+    }
+    if (intervals - 2 > 0) {
+      std::fill(previous_rates_.begin(),
+                previous_rates_.begin() + intervals - 2, 1.0);
+    }
+  }
+  previous_rates_sum_ =
+      std::accumulate(previous_rates_.begin(), previous_rates_.end(), 0.0);
+  current_period_.store(period, std::memory_order_release);
 }
 
 }  // namespace tracing
@@ -6,11 +6,22 @@
 // `Limiter` is used by the `TraceSampler` and the `SpanSampler` to enforce
 // their respective `max_per_second` configuration parameters.
 //
+// `Limiter` is safe to use from multiple threads without synchronization.
+// Taking tokens is a compare-and-swap on a single "theoretical arrival time",
+// as in the [generic cell rate algorithm][2], which is equivalent to a token
+// bucket. The effective rate is computed from per-second counters that are
+// rolled over by whichever thread first notices that a second has passed.
+//
 // [1]: https://en.wikipedia.org/wiki/Token_bucket
+// [2]: https://en.wikipedia.org/wiki/Generic_cell_rate_algorithm
 
 #include <datadog/clock.h>
 #include <datadog/rate.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
 #include <vector>
 
 namespace datadog {
@@ -31,18 +42,32 @@ class Limiter {
   Result allow(int tokens);
 
  private:
+  // Return whether the specified number of `tokens` can be taken at the
+  // specified time `now`, and if so take them.
+  bool take(std::chrono::steady_clock::time_point now, int tokens);
+  // Roll the effective rate calculation forward to the specified `period`.
+  void begin_period(std::int64_t period);
+
   Clock clock_;
-  int num_tokens_;
   int max_tokens_;
   std::chrono::steady_clock::duration refresh_interval_;
-  int tokens_per_refresh_;
-  std::chrono::steady_clock::time_point next_refresh_;
+  // The time it takes to refresh one token.
+  std::chrono::steady_clock::duration token_interval_;
+  // Tokens are refreshed at whole multiples of `refresh_interval_` after
+  // `start_`.
+  std::chrono::steady_clock::time_point start_;
+  // The time, relative to `start_` and in units of
+  // `steady_clock::duration`, at which the bucket would be full if no more
+  // tokens were taken.
+  std::atomic<std::int64_t> full_at_;
   // effective rate fields
+  std::mutex period_mutex_;
   std::vector<double> previous_rates_;
-  double previous_rates_sum_;
-  std::chrono::steady_clock::time_point current_period_;
-  int num_allowed_ = 0;
-  int num_requested_ = 0;
+  std::atomic<double> previous_rates_sum_;
+  // The current period, in whole seconds of `steady_clock`.
+  std::atomic<std::int64_t> current_period_;
+  std::atomic<int> num_allowed_;
+  std::atomic<int> num_requested_;
 };
 
 }  // namespace tracing
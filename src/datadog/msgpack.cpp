@@ -2,6 +2,7 @@
 
 #include <datadog/error.h>
 
+#include <algorithm>
 #include <cassert>
 #include <climits>
 #include <limits>
@@ -12,15 +13,42 @@ namespace tracing {
 namespace msgpack {
 namespace {
 // MessagePack values are prefixed by a byte naming their type.
+// The "FIX" types are masks that carry their value (or their length) in the
+// low bits of the type byte itself.
 namespace types {
+constexpr auto ARRAY16 = std::byte(0xDC);
 constexpr auto ARRAY32 = std::byte(0xDD);
+constexpr auto BIN8 = std::byte(0xC4);
+constexpr auto BIN16 = std::byte(0xC5);
+constexpr auto BIN32 = std::byte(0xC6);
+constexpr auto BOOL_FALSE = std::byte(0xC2);
+constexpr auto BOOL_TRUE = std::byte(0xC3);
 constexpr auto DOUBLE = std::byte(0xCB);
+constexpr auto FIXARRAY = std::byte(0x90);
+constexpr auto FIXMAP = std::byte(0x80);
+constexpr auto FIXSTR = std::byte(0xA0);
+constexpr auto INT8 = std::byte(0xD0);
+constexpr auto INT16 = std::byte(0xD1);
+constexpr auto INT32 = std::byte(0xD2);
 constexpr auto INT64 = std::byte(0xD3);
+constexpr auto MAP16 = std::byte(0xDE);
 constexpr auto MAP32 = std::byte(0xDF);
+constexpr auto STR8 = std::byte(0xD9);
+constexpr auto STR16 = std::byte(0xDA);
 constexpr auto STR32 = std::byte(0xDB);
+constexpr auto UINT8 = std::byte(0xCC);
+constexpr auto UINT16 = std::byte(0xCD);
+constexpr auto UINT32 = std::byte(0xCE);
 constexpr auto UINT64 = std::byte(0xCF);
 }  // namespace types
 
+// Largest values that fit in the "FIX" variants of each type.
+constexpr std::size_t max_fixarray_size = 15;
+constexpr std::size_t max_fixmap_size = 15;
+constexpr std::size_t max_fixstr_size = 31;
+constexpr std::uint64_t max_positive_fixint = 127;
+constexpr std::int64_t min_negative_fixint = -32;
+
 std::string make_overflow_message(StringView type, std::size_t actual,
                                   std::size_t max) {
   std::string message;
@@ -58,20 +86,59 @@ void push_number_big_endian(std::string& buffer, Integer integer) {
   buffer.append(buf, sizeof buf);
 }
 
+void push_type(std::string& buffer, std::byte type) {
+  buffer.push_back(static_cast<char>(type));
+}
+
+// Append to the specified `buffer` the specified "FIX" `type` having the
+// specified `value` stored in its low bits.
+void push_fix_type(std::string& buffer, std::byte type, std::uint8_t value) {
+  buffer.push_back(static_cast<char>(type | std::byte(value)));
+}
+
 }  // namespace
 
 void pack_integer(std::string& buffer, std::int64_t value) {
-  buffer.push_back(static_cast<char>(types::INT64));
-  push_number_big_endian(buffer, static_cast<std::int64_t>(value));
+  if (value >= 0) {
+    pack_integer(buffer, static_cast<std::uint64_t>(value));
+  } else if (value >= min_negative_fixint) {
+    // A negative fixint is the value's own two's complement byte.
+    buffer.push_back(static_cast<char>(value));
+  } else if (value >= std::numeric_limits<std::int8_t>::min()) {
+    push_type(buffer, types::INT8);
+    push_number_big_endian(buffer, static_cast<std::int8_t>(value));
+  } else if (value >= std::numeric_limits<std::int16_t>::min()) {
+    push_type(buffer, types::INT16);
+    push_number_big_endian(buffer, static_cast<std::int16_t>(value));
+  } else if (value >= std::numeric_limits<std::int32_t>::min()) {
+    push_type(buffer, types::INT32);
+    push_number_big_endian(buffer, static_cast<std::int32_t>(value));
+  } else {
+    push_type(buffer, types::INT64);
+    push_number_big_endian(buffer, value);
+  }
 }
 
 void pack_integer(std::string& buffer, std::uint64_t value) {
-  buffer.push_back(static_cast<char>(types::UINT64));
-  push_number_big_endian(buffer, static_cast<std::uint64_t>(value));
+  if (value <= max_positive_fixint) {
+    buffer.push_back(static_cast<char>(value));
+  } else if (value <= std::numeric_limits<std::uint8_t>::max()) {
+    push_type(buffer, types::UINT8);
+    push_number_big_endian(buffer, static_cast<std::uint8_t>(value));
+  } else if (value <= std::numeric_limits<std::uint16_t>::max()) {
+    push_type(buffer, types::UINT16);
+    push_number_big_endian(buffer, static_cast<std::uint16_t>(value));
+  } else if (value <= std::numeric_limits<std::uint32_t>::max()) {
+    push_type(buffer, types::UINT32);
+    push_number_big_endian(buffer, static_cast<std::uint32_t>(value));
+  } else {
+    push_type(buffer, types::UINT64);
+    push_number_big_endian(buffer, value);
+  }
 }
 
 void pack_double(std::string& buffer, double value) {
-  buffer.push_back(static_cast<char>(types::DOUBLE));
+  push_type(buffer, types::DOUBLE);
 
   // The following is lifted from the "msgpack-c" project.
   // See "pack_double" in
@@ -101,34 +168,148 @@ Expected<void> pack_string(std::string& buffer, const char* begin,
     return Error{Error::MESSAGEPACK_ENCODE_FAILURE,
                  make_overflow_message("string", size, max)};
   }
-  buffer.push_back(static_cast<char>(types::STR32));
-  push_number_big_endian(buffer, static_cast<std::uint32_t>(size));
+  if (size <= max_fixstr_size) {
+    push_fix_type(buffer, types::FIXSTR, static_cast<std::uint8_t>(size));
+  } else if (size <= std::numeric_limits<std::uint8_t>::max()) {
+    push_type(buffer, types::STR8);
+    push_number_big_endian(buffer, static_cast<std::uint8_t>(size));
+  } else if (size <= std::numeric_limits<std::uint16_t>::max()) {
+    push_type(buffer, types::STR16);
+    push_number_big_endian(buffer, static_cast<std::uint16_t>(size));
+  } else {
+    push_type(buffer, types::STR32);
+    push_number_big_endian(buffer, static_cast<std::uint32_t>(size));
+  }
   buffer.append(begin, size);
   return {};
 }
 
+Expected<void> pack_binary(std::string& buffer, StringView bytes) {
+  const std::size_t size = bytes.size();
+  const auto max = std::numeric_limits<std::uint32_t>::max();
+  if (size > max) {
+    return Error{Error::MESSAGEPACK_ENCODE_FAILURE,
+                 make_overflow_message("binary", size, max)};
+  }
+  if (size <= std::numeric_limits<std::uint8_t>::max()) {
+    push_type(buffer, types::BIN8);
+    push_number_big_endian(buffer, static_cast<std::uint8_t>(size));
+  } else if (size <= std::numeric_limits<std::uint16_t>::max()) {
+    push_type(buffer, types::BIN16);
+    push_number_big_endian(buffer, static_cast<std::uint16_t>(size));
+  } else {
+    push_type(buffer, types::BIN32);
+    push_number_big_endian(buffer, static_cast<std::uint32_t>(size));
+  }
+  append(buffer, bytes);
+  return {};
+}
+
+void pack_bool(std::string& buffer, bool value) {
+  push_type(buffer, value ? types::BOOL_TRUE : types::BOOL_FALSE);
+}
+
 Expected<void> pack_array(std::string& buffer, std::size_t size) {
   const auto max = std::numeric_limits<std::uint32_t>::max();
   if (size > max) {
     return Error{Error::MESSAGEPACK_ENCODE_FAILURE,
                  make_overflow_message("array", size, max)};
   }
-  buffer.push_back(static_cast<char>(types::ARRAY32));
-  push_number_big_endian(buffer, static_cast<std::uint32_t>(size));
+  if (size <= max_fixarray_size) {
+    push_fix_type(buffer, types::FIXARRAY, static_cast<std::uint8_t>(size));
+  } else if (size <= std::numeric_limits<std::uint16_t>::max()) {
+    push_type(buffer, types::ARRAY16);
+    push_number_big_endian(buffer, static_cast<std::uint16_t>(size));
+  } else {
+    push_type(buffer, types::ARRAY32);
+    push_number_big_endian(buffer, static_cast<std::uint32_t>(size));
+  }
   return {};
 }
 
+void write_array32_header(char* destination, std::uint32_t size) {
+  std::string header;
+  push_type(header, types::ARRAY32);
+  push_number_big_endian(header, size);
+  assert(header.size() == array32_header_size);
+  std::copy(header.begin(), header.end(), destination);
+}
+
 Expected<void> pack_map(std::string& buffer, std::size_t size) {
   const auto max = std::numeric_limits<std::uint32_t>::max();
   if (size > max) {
     return Error{Error::MESSAGEPACK_ENCODE_FAILURE,
                  make_overflow_message("map", size, max)};
   }
-  buffer.push_back(static_cast<char>(types::MAP32));
-  push_number_big_endian(buffer, static_cast<std::uint32_t>(size));
+  if (size <= max_fixmap_size) {
+    push_fix_type(buffer, types::FIXMAP, static_cast<std::uint8_t>(size));
+  } else if (size <= std::numeric_limits<std::uint16_t>::max()) {
+    push_type(buffer, types::MAP16);
+    push_number_big_endian(buffer, static_cast<std::uint16_t>(size));
+  } else {
+    push_type(buffer, types::MAP32);
+    push_number_big_endian(buffer, static_cast<std::uint32_t>(size));
+  }
   return {};
 }
 
+std::size_t integer_size(std::uint64_t value) {
+  if (value <= max_positive_fixint) {
+    return 1;
+  } else if (value <= std::numeric_limits<std::uint8_t>::max()) {
+    return 2;
+  } else if (value <= std::numeric_limits<std::uint16_t>::max()) {
+    return 3;
+  } else if (value <= std::numeric_limits<std::uint32_t>::max()) {
+    return 5;
+  }
+  return 9;
+}
+
+std::size_t integer_size(std::int64_t value) {
+  if (value >= 0) {
+    return integer_size(static_cast<std::uint64_t>(value));
+  } else if (value >= min_negative_fixint) {
+    return 1;
+  } else if (value >= std::numeric_limits<std::int8_t>::min()) {
+    return 2;
+  } else if (value >= std::numeric_limits<std::int16_t>::min()) {
+    return 3;
+  } else if (value >= std::numeric_limits<std::int32_t>::min()) {
+    return 5;
+  }
+  return 9;
+}
+
+std::size_t string_size(std::size_t length) {
+  if (length <= max_fixstr_size) {
+    return 1 + length;
+  } else if (length <= std::numeric_limits<std::uint8_t>::max()) {
+    return 2 + length;
+  } else if (length <= std::numeric_limits<std::uint16_t>::max()) {
+    return 3 + length;
+  }
+  return 5 + length;
+}
+
+std::size_t array_header_size(std::size_t size) {
+  if (size <= max_fixarray_size) {
+    return 1;
+  } else if (size <= std::numeric_limits<std::uint16_t>::max()) {
+    return 3;
+  }
+  return 5;
+}
+
+std::size_t map_header_size(std::size_t size) {
+  if (size <= max_fixmap_size) {
+    return 1;
+  } else if (size <= std::numeric_limits<std::uint16_t>::max()) {
+    return 3;
+  }
+  return 5;
+}
+
 }  // namespace msgpack
 }  // namespace tracing
 }  // namespace datadog
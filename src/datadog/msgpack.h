@@ -9,10 +9,17 @@
 //
 // Only encoding is provided, and only for the types required by `SpanData` and
 // `DatadogAgent`.
+//
+// Integers, strings, arrays, and maps are encoded using the smallest
+// representation that the protocol allows for their value or length, e.g.
+// "fixint" for small integers and "fixstr" for short strings. Most of a
+// span's keys, tags, and small numbers thus cost one byte of header instead of
+// five or nine.
 
 #include <datadog/expected.h>
 #include <datadog/string_view.h>
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <string>
@@ -32,8 +39,42 @@ Expected<void> pack_string(std::string& buffer, StringView value);
 Expected<void> pack_string(std::string& buffer, const char* begin,
                            std::size_t size);
 
+// Append to the specified `buffer` the specified `bytes` as a MessagePack
+// "bin" value, rather than as a string.
+Expected<void> pack_binary(std::string& buffer, StringView bytes);
+
+void pack_bool(std::string& buffer, bool value);
+
 Expected<void> pack_array(std::string& buffer, std::size_t size);
 
+// The size, in bytes, of an array header written by `write_array32_header`.
+constexpr std::size_t array32_header_size = 5;
+
+// Write to the specified `destination` the header of an array having the
+// specified `size`, using the five byte "array 32" representation even if a
+// smaller one would do. This allows space for an array's header to be reserved
+// before its elements are encoded, and the header to be written afterwards.
+// `destination` must have room for `array32_header_size` bytes.
+void write_array32_header(char* destination, std::uint32_t size);
+
+// Return the MessagePack encoding of the specified string `literal`, computed
+// at compile time. `literal` must be shorter than 32 characters, so that it
+// is encoded as a "fixstr". The result can be appended to a buffer in place of
+// calling `pack_string`.
+template <std::size_t Size>
+constexpr std::array<char, Size> make_fixstr(const char (&literal)[Size]);
+
+// Return the number of bytes that `pack_integer`, `pack_string`,
+// `pack_array`, `pack_map`, and `pack_double` append for a value of the
+// specified magnitude or length. These allow callers to reserve the exact
+// size of an encoding before producing it.
+std::size_t integer_size(std::uint64_t value);
+std::size_t integer_size(std::int64_t value);
+std::size_t string_size(std::size_t length);
+std::size_t array_header_size(std::size_t size);
+std::size_t map_header_size(std::size_t size);
+constexpr std::size_t double_size = 9;
+
 // Append to the specified `buffer` a MessagePack encoded array having the
 // specified `values`, where for each element of `values` the specified
 // `pack_value` function appends the value. `pack_value` is invoked with two
@@ -153,6 +194,19 @@ inline Expected<void> pack_map_suffix(std::string&) {
   return {};
 }
 
+template <std::size_t Size>
+constexpr std::array<char, Size> make_fixstr(const char (&literal)[Size]) {
+  // `Size` includes the null terminator, which is not encoded. The one byte
+  // header takes its place.
+  static_assert(Size - 1 < 32, "fixstr must be shorter than 32 characters");
+  std::array<char, Size> encoded{};
+  encoded[0] = static_cast<char>(0xA0 | (Size - 1));
+  for (std::size_t i = 0; i + 1 < Size; ++i) {
+    encoded[i + 1] = literal[i];
+  }
+  return encoded;
+}
+
 inline void pack_integer(std::string& buffer, std::int32_t value) {
   pack_integer(buffer, std::int64_t(value));
 }
@@ -0,0 +1,78 @@
+#pragma once
+
+// This component provides a class template, `Published`, that holds an
+// immutable value that is read often from many threads and replaced seldom.
+//
+// `Published<T>::publish` replaces the value. `Published<T>::get` returns the
+// current value without locking, unless the value has been replaced since the
+// calling thread last read it. Each `Published<T>` object has, in its
+// `ThreadSlots`, a cached reference to the value that each thread most recently
+// read from it, along with the version of that value. Reading the value
+// compares the cached version with the current version, and copies the
+// current value into the cache only when they differ. The cached references
+// are released when the `Published<T>` object is destroyed.
+//
+// `std::atomic<std::shared_ptr<T>>` would serve the same purpose, but it is
+// not available in C++17, and the C++17 `std::atomic_load` overloads for
+// `std::shared_ptr` are implemented with a pool of locks.
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "thread_slots.h"
+
+namespace datadog {
+namespace tracing {
+
+template <typename T>
+class Published {
+  struct Cache {
+    std::uint64_t version = 0;
+    std::shared_ptr<const T> value;
+  };
+
+  // `mutex_` guards `value_`, and is held only while `value_` is copied or
+  // replaced.
+  mutable std::mutex mutex_;
+  std::shared_ptr<const T> value_;
+  // `version_` is incremented whenever `value_` is replaced.
+  std::atomic<std::uint64_t> version_;
+  mutable ThreadSlots<Cache> caches_;
+
+ public:
+  explicit Published(std::shared_ptr<const T> value)
+      : value_(std::move(value)), version_(1) {}
+
+  Published(const Published&) = delete;
+  Published& operator=(const Published&) = delete;
+
+  // Replace the value with the specified `value`.
+  void publish(std::shared_ptr<const T> value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    value_ = std::move(value);
+    version_.fetch_add(1, std::memory_order_release);
+  }
+
+  // Return the current value, as cached by the calling thread. The returned
+  // reference is valid until the calling thread calls `get` again on this
+  // object, or until this object is destroyed.
+  const T& get() const {
+    Cache& cache = caches_.local();
+    const std::uint64_t version = version_.load(std::memory_order_acquire);
+    if (cache.version != version) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // `version_` might have been incremented after it was loaded above, but
+      // `value_` is at least as recent as `version`, so the cache is at worst
+      // refreshed again on the next call.
+      cache.version = version;
+      cache.value = value_;
+    }
+    return *cache.value;
+  }
+};
+
+}  // namespace tracing
+}  // namespace datadog
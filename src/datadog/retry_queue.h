@@ -0,0 +1,128 @@
+#pragma once
+
+// This component provides a class template, `RetryQueue`, that holds payloads
+// whose submission failed until they are due to be submitted again.
+//
+// `DatadogAgent` uses a `RetryQueue` of encoded trace payloads, so that traces
+// are not lost when the Datadog Agent is briefly unavailable, such as while it
+// restarts.
+//
+// The delay before a payload is retried grows exponentially with the number of
+// times that it has failed, up to a maximum, and is randomized ("jittered")
+// between half of and all of that, so that tracers that failed together don't
+// retry together. A payload is dropped instead of queued when it has failed
+// too many times, or when the queue does not have room for its size.
+//
+// `RetryQueue` is safe to use from multiple threads, since failures are
+// delivered on the HTTP client's thread.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "random.h"
+
+namespace datadog {
+namespace tracing {
+
+template <typename Payload>
+class RetryQueue {
+ public:
+  using Duration = std::chrono::steady_clock::duration;
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  struct Config {
+    // The delay before the first retry. Each later retry is delayed twice as
+    // long as the previous one, up to `max_delay`.
+    Duration initial_delay;
+    Duration max_delay;
+    // The number of times a payload is retried before it is dropped.
+    int max_retries;
+    // The most bytes of payloads held at once.
+    std::size_t max_bytes;
+  };
+
+  enum class Outcome { QUEUED, TOO_MANY_FAILURES, FULL };
+
+  struct Entry {
+    Payload payload;
+    std::size_t size;
+    // The number of times submitting `payload` has failed.
+    int failures;
+    TimePoint due;
+  };
+
+ private:
+  std::mutex mutex_;
+  Config config_;
+  std::deque<Entry> entries_;
+  std::size_t size_ = 0;
+
+ public:
+  explicit RetryQueue(const Config& config) : config_(config) {}
+
+  // Queue the specified `payload`, which is `size` bytes and has failed the
+  // specified number of `failures` times, to be retried after a delay from the
+  // specified `now`. Return whether it was queued, or why it was dropped.
+  Outcome push(Payload&& payload, std::size_t size, int failures,
+               TimePoint now) {
+    if (failures > config_.max_retries) {
+      return Outcome::TOO_MANY_FAILURES;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (size > config_.max_bytes - std::min(size_, config_.max_bytes)) {
+      return Outcome::FULL;
+    }
+    size_ += size;
+    entries_.push_back(
+        Entry{std::move(payload), size, failures, now + delay(failures)});
+    return Outcome::QUEUED;
+  }
+
+  // Remove and return the entries due to be retried at the specified `now`,
+  // in the order in which they were queued.
+  std::vector<Entry> take_due(TimePoint now) {
+    std::vector<Entry> due;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto not_due = std::stable_partition(
+        entries_.begin(), entries_.end(),
+        [now](const Entry& entry) { return entry.due <= now; });
+    for (auto entry = entries_.begin(); entry != not_due; ++entry) {
+      size_ -= entry->size;
+      due.push_back(std::move(*entry));
+    }
+    entries_.erase(entries_.begin(), not_due);
+    return due;
+  }
+
+  // Return the number of bytes of payloads queued.
+  std::size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+  // Return the delay before retrying a payload that has failed the specified
+  // number of `failures` times, which is at least half of the exponential
+  // delay, and at most all of it.
+  Duration delay(int failures) const {
+    Duration delay = config_.initial_delay;
+    for (int i = 1; i < failures && delay < config_.max_delay; ++i) {
+      delay *= 2;
+    }
+    delay = std::min(delay, config_.max_delay);
+    const auto half = delay.count() / 2;
+    return Duration(delay.count() - half +
+                    static_cast<Duration::rep>(
+                        random_uint64() %
+                        static_cast<std::uint64_t>(half + 1)));
+  }
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -2,6 +2,7 @@
 #include <datadog/optional.h>
 #include <datadog/span.h>
 #include <datadog/span_config.h>
+#include <datadog/span_defaults.h>
 #include <datadog/string_view.h>
 #include <datadog/trace_segment.h>
 
@@ -44,8 +45,8 @@ Span::~Span() {
 }
 
 Span Span::create_child(const SpanConfig& config) const {
-  auto span_data = std::make_unique<SpanData>();
-  span_data->apply_config(trace_segment_->defaults(), config, clock_);
+  auto span_data = SpanData::make(data_->arena());
+  span_data->apply_config(trace_segment_->shared_defaults(), config, clock_);
   span_data->trace_id = data_->trace_id;
   span_data->parent_id = data_->span_id;
   span_data->span_id = generate_span_id_();
@@ -89,33 +90,30 @@ const std::string& Span::name() const { return data_->name; }
 const std::string& Span::resource_name() const { return data_->resource; }
 
 Optional<StringView> Span::lookup_tag(StringView name) const {
-  const auto found = data_->tags.find(std::string(name));
-  if (found == data_->tags.end()) {
-    return nullopt;
-  }
-  return found->second;
+  return data_->find_tag(name);
 }
 
 Optional<double> Span::lookup_metric(StringView name) const {
-  const auto found = data_->numeric_tags.find(std::string(name));
-  if (found == data_->numeric_tags.end()) {
-    return nullopt;
-  }
-  return found->second;
+  return data_->find_numeric_tag(name);
 }
 
 void Span::set_tag(StringView name, StringView value) {
-  data_->tags.insert_or_assign(std::string(name), std::string(value));
+  assign(data_->tags[name], value);
 }
 
 void Span::set_metric(StringView name, double value) {
-  data_->numeric_tags.insert_or_assign(std::string(name), value);
+  data_->numeric_tags[name] = value;
 }
 
-void Span::remove_tag(StringView name) { data_->tags.erase(std::string(name)); }
+void Span::remove_tag(StringView name) {
+  if (data_->defaults && data_->defaults->tags.count(std::string(name))) {
+    data_->copy_default_tags();
+  }
+  data_->tags.erase(name);
+}
 
 void Span::remove_metric(StringView name) {
-  data_->numeric_tags.erase(std::string(name));
+  data_->numeric_tags.erase(name);
 }
 
 void Span::set_service_name(StringView service) {
@@ -133,24 +131,24 @@ void Span::set_resource_name(StringView resource) {
 void Span::set_error(bool is_error) {
   data_->error = is_error;
   if (!is_error) {
-    data_->tags.erase("error.message");
-    data_->tags.erase("error.type");
+    data_->tags.erase(tags::error_message);
+    data_->tags.erase(tags::error_type);
   }
 }
 
 void Span::set_error_message(StringView message) {
   data_->error = true;
-  data_->tags.insert_or_assign("error.message", std::string(message));
+  assign(data_->tags[tags::error_message], message);
 }
 
 void Span::set_error_type(StringView type) {
   data_->error = true;
-  data_->tags.insert_or_assign("error.type", std::string(type));
+  assign(data_->tags[tags::error_type], type);
 }
 
 void Span::set_error_stack(StringView type) {
   data_->error = true;
-  data_->tags.insert_or_assign("error.stack", std::string(type));
+  assign(data_->tags[tags::error_stack], type);
 }
 
 void Span::set_name(StringView value) { assign(data_->name, value); }
@@ -5,58 +5,407 @@
 #include <datadog/span_defaults.h>
 #include <datadog/string_view.h>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <vector>
 
 #include "msgpack.h"
+#include "string_table.h"
 #include "tags.h"
 
 namespace datadog {
 namespace tracing {
 namespace {
 
-Optional<StringView> lookup(
-    const std::string& key,
-    const std::unordered_map<std::string, std::string>& map) {
-  const auto found = map.find(key);
-  if (found != map.end()) {
-    return found->second;
+// Return a pointer to the value of the element of the specified `tags` whose
+// name is the specified `name`, or return null if there is none. `tags` is a
+// sequence of pairs.
+template <typename Tags>
+auto find_shared(const Tags& tags, StringView name)
+    -> decltype(&tags.begin()->second) {
+  for (const auto& item : tags) {
+    if (item.first == name) {
+      return &item.second;
+    }
   }
-  return nullopt;
+  return nullptr;
+}
+
+// Invoke the specified `visit` with the name and value of each string tag of
+// the specified `span`, including the tags that it shares with other spans.
+// Stop at the first error returned by `visit`, and return it.
+template <typename Visit>
+Expected<void> for_each_tag(const SpanData& span, Visit&& visit) {
+  const SharedSpanTags* const segment = span.segment_tags.get();
+  const auto in_segment = [&](StringView name) {
+    return segment && find_shared(segment->tags, name);
+  };
+
+  Expected<void> result;
+  if (segment) {
+    for (const auto& [name, value] : segment->tags) {
+      result = visit(name, value);
+      if (!result) return result;
+    }
+  }
+  for (const auto& [name, value] : span.tags) {
+    if (in_segment(name)) continue;
+    result = visit(name, value);
+    if (!result) return result;
+  }
+  if (span.defaults) {
+    for (const auto& [name, value] : span.defaults->tags) {
+      if (in_segment(name) || span.tags.count(name)) continue;
+      result = visit(name, value);
+      if (!result) return result;
+    }
+  }
+  return result;
+}
+
+// Invoke the specified `visit` with the name and value of each numeric tag of
+// the specified `span`, including the tags that it shares with other spans.
+// Stop at the first error returned by `visit`, and return it.
+template <typename Visit>
+Expected<void> for_each_numeric_tag(const SpanData& span, Visit&& visit) {
+  const SharedSpanTags* const segment = span.segment_tags.get();
+
+  Expected<void> result;
+  if (segment) {
+    for (const auto& [name, value] : segment->numeric_tags) {
+      result = visit(name, value);
+      if (!result) return result;
+    }
+  }
+  for (const auto& [name, value] : span.numeric_tags) {
+    if (segment && find_shared(segment->numeric_tags, name)) continue;
+    result = visit(name, value);
+    if (!result) return result;
+  }
+  return result;
+}
+
+std::size_t count_tags(const SpanData& span) {
+  std::size_t count = 0;
+  for_each_tag(span, [&](StringView, StringView) {
+    ++count;
+    return Expected<void>{};
+  });
+  return count;
+}
+
+std::size_t count_numeric_tags(const SpanData& span) {
+  std::size_t count = 0;
+  for_each_numeric_tag(span, [&](StringView, double) {
+    ++count;
+    return Expected<void>{};
+  });
+  return count;
+}
+
+Expected<void> pack_tag(std::string& destination, StringView name,
+                        StringView value) {
+  Expected<void> result = msgpack::pack_string(destination, name);
+  if (!result) return result;
+  return msgpack::pack_string(destination, value);
+}
+
+Expected<void> pack_numeric_tag(std::string& destination, StringView name,
+                                double value) {
+  Expected<void> result = msgpack::pack_string(destination, name);
+  if (!result) return result;
+  msgpack::pack_double(destination, value);
+  return result;
+}
+
+// The names of the fields of an encoded span, MessagePack encoded at compile
+// time. Every span has the fields up to and including `type`, in that order.
+// `span_links` is present only when the span has links.
+namespace keys {
+constexpr auto service = msgpack::make_fixstr("service");
+constexpr auto name = msgpack::make_fixstr("name");
+constexpr auto resource = msgpack::make_fixstr("resource");
+constexpr auto trace_id = msgpack::make_fixstr("trace_id");
+constexpr auto span_id = msgpack::make_fixstr("span_id");
+constexpr auto parent_id = msgpack::make_fixstr("parent_id");
+constexpr auto start = msgpack::make_fixstr("start");
+constexpr auto duration = msgpack::make_fixstr("duration");
+constexpr auto error = msgpack::make_fixstr("error");
+constexpr auto meta = msgpack::make_fixstr("meta");
+constexpr auto metrics = msgpack::make_fixstr("metrics");
+constexpr auto type = msgpack::make_fixstr("type");
+constexpr auto span_links = msgpack::make_fixstr("span_links");
+}  // namespace keys
+
+constexpr std::size_t num_required_fields = 12;
+
+constexpr std::size_t required_keys_size =
+    keys::service.size() + keys::name.size() + keys::resource.size() +
+    keys::trace_id.size() + keys::span_id.size() + keys::parent_id.size() +
+    keys::start.size() + keys::duration.size() + keys::error.size() +
+    keys::meta.size() + keys::metrics.size() + keys::type.size();
+
+template <std::size_t Size>
+void pack_key(std::string& destination, const std::array<char, Size>& key) {
+  destination.append(key.data(), key.size());
+}
+
+std::uint64_t start_nanoseconds(const SpanData& span) {
+  return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           span.start.wall.time_since_epoch())
+                           .count());
+}
+
+std::uint64_t duration_nanoseconds(const SpanData& span) {
+  return std::uint64_t(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(span.duration)
+          .count());
+}
+
+// Return the number of bytes that `encode` will append for the specified
+// `span`. Span links are not accounted for, since they're rare.
+std::size_t encoded_size(const SpanData& span) {
+  std::size_t size = msgpack::map_header_size(num_required_fields + 1) +
+                     required_keys_size;
+
+  size += msgpack::string_size(span.service.size()) +
+          msgpack::string_size(span.name.size()) +
+          msgpack::string_size(span.resource.size()) +
+          msgpack::string_size(span.service_type.size());
+
+  size += msgpack::integer_size(span.trace_id.low) +
+          msgpack::integer_size(span.span_id) +
+          msgpack::integer_size(span.parent_id) +
+          msgpack::integer_size(start_nanoseconds(span)) +
+          msgpack::integer_size(duration_nanoseconds(span)) +
+          msgpack::integer_size(std::int64_t(span.error));
+
+  std::size_t num_tags = 0;
+  for_each_tag(span, [&](StringView name, StringView value) {
+    ++num_tags;
+    size +=
+        msgpack::string_size(name.size()) + msgpack::string_size(value.size());
+    return Expected<void>{};
+  });
+  size += msgpack::map_header_size(num_tags);
+
+  std::size_t num_numeric_tags = 0;
+  for_each_numeric_tag(span, [&](StringView name, double) {
+    ++num_numeric_tags;
+    size += msgpack::string_size(name.size()) + msgpack::double_size;
+    return Expected<void>{};
+  });
+  size += msgpack::map_header_size(num_numeric_tags);
+
+  return size;
+}
+
+// Make room in the specified `destination` for at least the specified `size`
+// additional bytes. Capacity grows geometrically, so that repeatedly encoding
+// into the same buffer does not reallocate on every call.
+void reserve_additional(std::string& destination, std::size_t size) {
+  const std::size_t required = destination.size() + size;
+  if (required > destination.capacity()) {
+    destination.reserve(std::max(required, 2 * destination.capacity()));
+  }
+}
+
+Expected<void> encode(std::string& destination, const SpanData& span) {
+  Expected<void> result = msgpack::pack_map(
+      destination, span.span_links.empty() ? num_required_fields
+                                           : num_required_fields + 1);
+  if (!result) return result;
+
+  pack_key(destination, keys::service);
+  result = msgpack::pack_string(destination, span.service);
+  if (!result) return result;
+
+  pack_key(destination, keys::name);
+  result = msgpack::pack_string(destination, span.name);
+  if (!result) return result;
+
+  pack_key(destination, keys::resource);
+  result = msgpack::pack_string(destination, span.resource);
+  if (!result) return result;
+
+  pack_key(destination, keys::trace_id);
+  msgpack::pack_integer(destination, span.trace_id.low);
+  pack_key(destination, keys::span_id);
+  msgpack::pack_integer(destination, span.span_id);
+  pack_key(destination, keys::parent_id);
+  msgpack::pack_integer(destination, span.parent_id);
+  pack_key(destination, keys::start);
+  msgpack::pack_integer(destination, start_nanoseconds(span));
+  pack_key(destination, keys::duration);
+  msgpack::pack_integer(destination, duration_nanoseconds(span));
+  pack_key(destination, keys::error);
+  msgpack::pack_integer(destination, std::int32_t(span.error));
+
+  pack_key(destination, keys::meta);
+  result = msgpack::pack_map(destination, count_tags(span));
+  if (!result) return result;
+  result = for_each_tag(span, [&](StringView name, StringView value) {
+    return pack_tag(destination, name, value);
+  });
+  if (!result) return result;
+
+  pack_key(destination, keys::metrics);
+  result = msgpack::pack_map(destination, count_numeric_tags(span));
+  if (!result) return result;
+  result = for_each_numeric_tag(span, [&](StringView name, double value) {
+    return pack_numeric_tag(destination, name, value);
+  });
+  if (!result) return result;
+
+  pack_key(destination, keys::type);
+  result = msgpack::pack_string(destination, span.service_type);
+  if (!result || span.span_links.empty()) return result;
+
+  pack_key(destination, keys::span_links);
+  return msgpack::pack_array(
+      destination, span.span_links,
+      [](std::string& destination, const SpanLink& link) {
+        return msgpack_encode(destination, link);
+      });
+}
+
+// Number of elements in a span encoded in the "/v0.5/traces" format.
+constexpr std::size_t num_v05_fields = 12;
+
+const StringView span_links_tag = "_dd.span_links";
+
+void pack_index(std::string& destination, StringTable& strings,
+                StringView text) {
+  msgpack::pack_integer(destination, std::uint64_t(strings.index(text)));
+}
+
+// Each `SpanData` is preceded by the `TraceArena` it was allocated from, if
+// any. The prefix is padded to preserve the alignment of the `SpanData`.
+constexpr std::size_t allocation_prefix_size = alignof(std::max_align_t);
+static_assert(sizeof(TraceArena*) <= allocation_prefix_size,
+              "arena pointer must fit in the allocation prefix");
+
+TraceArena*& allocation_arena(void* span) {
+  return *reinterpret_cast<TraceArena**>(static_cast<char*>(span) -
+                                         allocation_prefix_size);
 }
 
 }  // namespace
 
+SpanData::SpanData(TraceArena* arena)
+    : tags(SpanTags::allocator_type(arena)),
+      numeric_tags(SpanNumericTags::allocator_type(arena)) {}
+
+std::unique_ptr<SpanData> SpanData::make(TraceArena* arena) {
+  return std::unique_ptr<SpanData>(new (arena) SpanData(arena));
+}
+
+TraceArena* SpanData::arena() const { return tags.get_allocator().arena(); }
+
+void* SpanData::operator new(std::size_t size) {
+  return operator new(size, nullptr);
+}
+
+void* SpanData::operator new(std::size_t size, TraceArena* arena) {
+  void* const allocation =
+      arena ? arena->allocate(allocation_prefix_size + size,
+                              alignof(std::max_align_t))
+            : ::operator new(allocation_prefix_size + size);
+  void* const span = static_cast<char*>(allocation) + allocation_prefix_size;
+  allocation_arena(span) = arena;
+  if (arena) {
+    arena->retain();
+  }
+  return span;
+}
+
+void SpanData::operator delete(void* pointer) noexcept {
+  if (!pointer) {
+    return;
+  }
+  if (TraceArena* const arena = allocation_arena(pointer)) {
+    arena->release();
+  } else {
+    ::operator delete(static_cast<char*>(pointer) - allocation_prefix_size);
+  }
+}
+
+void SpanData::operator delete(void* pointer, TraceArena*) noexcept {
+  operator delete(pointer);
+}
+
 Optional<StringView> SpanData::environment() const {
-  return lookup(tags::environment, tags);
+  return find_tag(tags::environment);
 }
 
 Optional<StringView> SpanData::version() const {
-  return lookup(tags::version, tags);
+  return find_tag(tags::version);
+}
+
+Optional<StringView> SpanData::find_tag(StringView name) const {
+  if (segment_tags) {
+    if (const auto* found = find_shared(segment_tags->tags, name)) {
+      return StringView(*found);
+    }
+  }
+  const auto found = tags.find(name);
+  if (found != tags.end()) {
+    return found->second;
+  }
+  if (defaults) {
+    // `std::unordered_map` can't be searched using a `StringView`.
+    const auto found_default = defaults->tags.find(std::string(name));
+    if (found_default != defaults->tags.end()) {
+      return found_default->second;
+    }
+  }
+  return nullopt;
+}
+
+Optional<double> SpanData::find_numeric_tag(StringView name) const {
+  if (segment_tags) {
+    if (const auto* found = find_shared(segment_tags->numeric_tags, name)) {
+      return *found;
+    }
+  }
+  const auto found = numeric_tags.find(name);
+  if (found != numeric_tags.end()) {
+    return found->second;
+  }
+  return nullopt;
 }
 
-void SpanData::apply_config(const SpanDefaults& defaults,
+void SpanData::copy_default_tags() {
+  if (defaults) {
+    for (const auto& item : defaults->tags) {
+      tags.insert(item);
+    }
+    defaults.reset();
+  }
+}
+
+void SpanData::apply_config(const std::shared_ptr<const SpanDefaults>& defaults,
                             const SpanConfig& config, const Clock& clock) {
   std::string version;
   if (config.service) {
     service = *config.service;
     version = config.version.value_or("");
   } else {
-    service = defaults.service;
-    version = defaults.version;
+    service = defaults->service;
+    version = defaults->version;
   }
 
   if (!version.empty()) {
     tags.insert_or_assign(tags::version, version);
   }
 
-  name = config.name.value_or(defaults.name);
+  name = config.name.value_or(defaults->name);
 
-  for (const auto& item : defaults.tags) {
-    tags.insert(item);
-  }
-  std::string environment = config.environment.value_or(defaults.environment);
+  this->defaults = defaults;
+  std::string environment =
+      config.environment.value_or(defaults->environment);
   if (!environment.empty()) {
     tags.insert_or_assign(tags::environment, environment);
   }
@@ -66,7 +415,7 @@ void SpanData::apply_config(const SpanDefaults& defaults,
   }
 
   resource = config.resource.value_or(name);
-  service_type = config.service_type.value_or(defaults.service_type);
+  service_type = config.service_type.value_or(defaults->service_type);
   if (config.start) {
     start = *config.start;
   } else {
@@ -75,95 +424,80 @@ void SpanData::apply_config(const SpanDefaults& defaults,
 }
 
 Expected<void> msgpack_encode(std::string& destination, const SpanData& span) {
-  auto pack_service = [&](auto& destination) {
-    return msgpack::pack_string(destination, span.service);
-  };
-  auto pack_name = [&](auto& destination) {
-    return msgpack::pack_string(destination, span.name);
-  };
-  auto pack_resource = [&](auto& destination) {
-    return msgpack::pack_string(destination, span.resource);
-  };
-  auto pack_trace_id = [&](auto& destination) {
-    msgpack::pack_integer(destination, span.trace_id.low);
-    return Expected<void>{};
-  };
-  auto pack_span_id = [&](auto& destination) {
-    msgpack::pack_integer(destination, span.span_id);
-    return Expected<void>{};
-  };
-  auto pack_parent_id = [&](auto& destination) {
-    msgpack::pack_integer(destination, span.parent_id);
-    return Expected<void>{};
-  };
-  auto pack_start = [&](auto& destination) {
-    msgpack::pack_integer(
-        destination,
-        std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
-                          span.start.wall.time_since_epoch())
-                          .count()));
-    return Expected<void>{};
-  };
-  auto pack_duration = [&](auto& destination) {
-    msgpack::pack_integer(
-        destination,
-        std::uint64_t(
-            std::chrono::duration_cast<std::chrono::nanoseconds>(span.duration)
-                .count()));
-    return Expected<void>{};
-  };
-  auto pack_error = [&](auto& destination) {
-    msgpack::pack_integer(destination, std::int32_t(span.error));
-    return Expected<void>{};
-  };
-  auto pack_meta = [&](auto& destination) {
-    return msgpack::pack_map(destination, span.tags,
-                             [](std::string& destination, const auto& value) {
-                               return msgpack::pack_string(destination, value);
-                             });
-  };
-  auto pack_metrics = [&](auto& destination) {
-    return msgpack::pack_map(destination, span.numeric_tags,
-                             [](std::string& destination, const auto& value) {
-                               msgpack::pack_double(destination, value);
-                               return Expected<void>{};
+  reserve_additional(destination, encoded_size(span));
+  return encode(destination, span);
+}
+
+std::size_t msgpack_encoded_size(const SpanData& span) {
+  return encoded_size(span);
+}
+
+Expected<void> msgpack_encode(
+    std::string& destination,
+    const std::vector<std::unique_ptr<SpanData>>& spans) {
+  std::size_t size = msgpack::array_header_size(spans.size());
+  for (const auto& span_ptr : spans) {
+    assert(span_ptr);
+    size += encoded_size(*span_ptr);
+  }
+  reserve_additional(destination, size);
+
+  return msgpack::pack_array(destination, spans,
+                             [](auto& destination, const auto& span_ptr) {
+                               return encode(destination, *span_ptr);
                              });
-  };
-  auto pack_type = [&](auto& destination) {
-    return msgpack::pack_string(destination, span.service_type);
-  };
+}
 
-  Expected<void> result =
-      msgpack::pack_map(destination, span.span_links.empty() ? 12 : 13);
+Expected<void> msgpack_encode_v05(std::string& destination,
+                                  StringTable& strings, const SpanData& span) {
+  // The order of the fields is defined by the format.
+  Expected<void> result = msgpack::pack_array(destination, num_v05_fields);
   if (!result) return result;
 
-  result = msgpack::pack_map_suffix(
-      destination, "service", pack_service, "name", pack_name, "resource",
-      pack_resource, "trace_id", pack_trace_id, "span_id", pack_span_id,
-      "parent_id", pack_parent_id, "start", pack_start, "duration",
-      pack_duration, "error", pack_error, "meta", pack_meta, "metrics",
-      pack_metrics, "type", pack_type);
+  pack_index(destination, strings, span.service);
+  pack_index(destination, strings, span.name);
+  pack_index(destination, strings, span.resource);
+  msgpack::pack_integer(destination, span.trace_id.low);
+  msgpack::pack_integer(destination, span.span_id);
+  msgpack::pack_integer(destination, span.parent_id);
+  msgpack::pack_integer(destination, start_nanoseconds(span));
+  msgpack::pack_integer(destination, duration_nanoseconds(span));
+  msgpack::pack_integer(destination, std::int32_t(span.error));
+
+  const bool has_links = !span.span_links.empty();
+  const std::size_t num_tags = count_tags(span);
+  result = msgpack::pack_map(destination, has_links ? num_tags + 1 : num_tags);
   if (!result) return result;
+  for_each_tag(span, [&](StringView name, StringView value) {
+    pack_index(destination, strings, name);
+    pack_index(destination, strings, value);
+    return Expected<void>{};
+  });
+  if (has_links) {
+    pack_index(destination, strings, span_links_tag);
+    pack_index(destination, strings, to_json(span.span_links));
+  }
 
-  if (span.span_links.empty()) return result;
+  result = msgpack::pack_map(destination, count_numeric_tags(span));
+  if (!result) return result;
+  for_each_numeric_tag(span, [&](StringView name, double value) {
+    pack_index(destination, strings, name);
+    msgpack::pack_double(destination, value);
+    return Expected<void>{};
+  });
 
-  auto pack_span_links = [&](auto& destination) {
-    return msgpack::pack_array(
-        destination, span.span_links,
-        [](std::string& destination, const SpanLink& link) {
-          return msgpack_encode(destination, link);
-        });
-  };
-  return msgpack::pack_map_suffix(destination, "span_links", pack_span_links);
+  pack_index(destination, strings, span.service_type);
+  return result;
 }
 
-Expected<void> msgpack_encode(
-    std::string& destination,
+Expected<void> msgpack_encode_v05(
+    std::string& destination, StringTable& strings,
     const std::vector<std::unique_ptr<SpanData>>& spans) {
   return msgpack::pack_array(destination, spans,
-                             [](auto& destination, const auto& span_ptr) {
+                             [&](auto& destination, const auto& span_ptr) {
                                assert(span_ptr);
-                               return msgpack_encode(destination, *span_ptr);
+                               return msgpack_encode_v05(destination, strings,
+                                                         *span_ptr);
                              });
 }
 
@@ -11,16 +11,32 @@
 
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "span_link.h"
+#include "tag_map.h"
+#include "trace_arena.h"
 
 namespace datadog {
 namespace tracing {
 
 struct SpanConfig;
 struct SpanDefaults;
+class StringTable;
+
+// The tags of a span. Their storage is allocated from the span's `TraceArena`,
+// if it has one. Most spans have no more tags than fit inline.
+using SpanTags = TagMap<std::string, 8>;
+using SpanNumericTags = TagMap<double, 4>;
+
+// `SharedSpanTags` are tags that every span of a trace segment has, such as
+// those identifying the process. The spans refer to one `SharedSpanTags`
+// rather than each having a copy of its tags.
+struct SharedSpanTags {
+  std::vector<std::pair<std::string, std::string>> tags;
+  std::vector<std::pair<std::string, double>> numeric_tags;
+};
 
 struct SpanData {
   std::string service;
@@ -33,25 +49,72 @@ struct SpanData {
   TimePoint start;
   Duration duration = Duration::zero();
   bool error = false;
-  std::unordered_map<std::string, std::string> tags;
-  std::unordered_map<std::string, double> numeric_tags;
+  SpanTags tags;
+  SpanNumericTags numeric_tags;
   std::vector<SpanLink> span_links;
+  // Tags that this span shares with other spans, and that are encoded along
+  // with its own. The `tags` of `defaults` apply unless overridden by `tags`.
+  // `segment_tags` are set when the trace segment finishes, and override both
+  // `tags` and `numeric_tags`.
+  std::shared_ptr<const SpanDefaults> defaults;
+  std::shared_ptr<const SharedSpanTags> segment_tags;
+
+  SpanData() = default;
+  // Allocate this span's tags from the specified `arena`, if not null.
+  explicit SpanData(TraceArena* arena);
+
+  // Return a new `SpanData` that, if the specified `arena` is not null, is
+  // allocated from `arena` along with its tags, and keeps `arena` alive.
+  static std::unique_ptr<SpanData> make(TraceArena* arena);
+
+  // Return the arena from which this span's tags are allocated, or null.
+  TraceArena* arena() const;
+
+  // A `SpanData` is allocated with a prefix that records the `TraceArena` it
+  // was allocated from, if any, so that deleting it releases the arena.
+  static void* operator new(std::size_t size);
+  static void* operator new(std::size_t size, TraceArena* arena);
+  static void operator delete(void* pointer) noexcept;
+  static void operator delete(void* pointer, TraceArena* arena) noexcept;
 
   Optional<StringView> environment() const;
   Optional<StringView> version() const;
 
+  // Return the value of the tag or numeric tag having the specified `name`,
+  // including the tags shared with other spans, or return `nullopt` if there
+  // is no such tag.
+  Optional<StringView> find_tag(StringView name) const;
+  Optional<double> find_numeric_tag(StringView name) const;
+
+  // Copy the tags of `defaults` into `tags`, except those overridden by `tags`,
+  // and then stop sharing them. This allows a default tag to be removed.
+  void copy_default_tags();
+
   // Modify the properties of this object to honor the specified `config` and
   // `defaults`. The properties of `config`, if set, override the properties of
   // `defaults`. Use the specified `clock` to provide a start none of none is
-  // specified in `config`.
-  void apply_config(const SpanDefaults& defaults, const SpanConfig& config,
-                    const Clock& clock);
+  // specified in `config`. This object shares the tags of `defaults` rather
+  // than copying them.
+  void apply_config(const std::shared_ptr<const SpanDefaults>& defaults,
+                    const SpanConfig& config, const Clock& clock);
 };
 
 // Append to the specified `destination` the MessagePack representation of the
 // specified `span`.
 Expected<void> msgpack_encode(std::string& destination, const SpanData& span);
 
+// Return the number of bytes in the MessagePack representation of the
+// specified `span`, not counting its span links, if any.
+std::size_t msgpack_encoded_size(const SpanData& span);
+
+// Append to the specified `destination` the "/v0.5/traces" MessagePack
+// representation of the specified `span`. In that representation, a span is an
+// array of its fields, and each of its strings is replaced by its index in the
+// specified `strings`, which is added to as needed. Span links, which the
+// format lacks a field for, are encoded as JSON in the "_dd.span_links" tag.
+Expected<void> msgpack_encode_v05(std::string& destination,
+                                  StringTable& strings, const SpanData& span);
+
 // Append to the specified `destination` the MessagePack representation of an
 // array containing each of the specified `spans`. The behavior is undefined
 // if any span is `nullptr`.
@@ -59,5 +122,13 @@ Expected<void> msgpack_encode(
     std::string& destination,
     const std::vector<std::unique_ptr<SpanData>>& spans);
 
+// Append to the specified `destination` the "/v0.5/traces" MessagePack
+// representation of an array containing each of the specified `spans`, adding
+// their strings to the specified `strings`. The behavior is undefined if any
+// span is `nullptr`.
+Expected<void> msgpack_encode_v05(
+    std::string& destination, StringTable& strings,
+    const std::vector<std::unique_ptr<SpanData>>& spans);
+
 }  // namespace tracing
 }  // namespace datadog
@@ -3,6 +3,8 @@
 #include <cstddef>
 #include <string>
 
+#include "hex.h"
+#include "json.hpp"
 #include "msgpack.h"
 
 namespace datadog::tracing {
@@ -75,4 +77,24 @@ Expected<void> msgpack_encode(std::string& destination, const SpanLink& link) {
   return result;
 }
 
+std::string to_json(const std::vector<SpanLink>& links) {
+  auto result = nlohmann::json::array();
+  for (const SpanLink& link : links) {
+    auto& item = result.emplace_back(nlohmann::json::object({
+        {"trace_id", link.context.trace_id.hex_padded()},
+        {"span_id", hex_padded(link.context.span_id)},
+    }));
+    if (!link.attributes.empty()) {
+      item["attributes"] = link.attributes;
+    }
+    if (link.context.tracestate && !link.context.tracestate->empty()) {
+      item["tracestate"] = *link.context.tracestate;
+    }
+    if (link.context.flags) {
+      item["flags"] = *link.context.flags;
+    }
+  }
+  return result.dump();
+}
+
 }  // namespace datadog::tracing
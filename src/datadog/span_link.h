@@ -6,6 +6,9 @@
 
 #include <datadog/span.h>
 
+#include <string>
+#include <vector>
+
 namespace datadog::tracing {
 
 class SpanLink {
@@ -19,4 +22,9 @@ class SpanLink {
 
 Expected<void> msgpack_encode(std::string& destination, const SpanLink& link);
 
+// Return a JSON array describing the specified `links`. This is how span links
+// are sent in trace formats that lack a dedicated field for them, such as the
+// "/v0.5/traces" format, where they're sent as the "_dd.span_links" tag.
+std::string to_json(const std::vector<SpanLink>& links);
+
 }  // namespace datadog::tracing
@@ -24,8 +24,8 @@ bool SpanMatcher::match(const SpanData& span) const {
          is_match(resource, span.resource) &&
          std::all_of(tags.begin(), tags.end(), [&](const auto& entry) {
            const auto& [name, pattern] = entry;
-           auto found = span.tags.find(name);
-           return found != span.tags.end() && is_match(pattern, found->second);
+           const auto found = span.find_tag(name);
+           return found && is_match(pattern, *found);
          });
 }
 
@@ -0,0 +1,100 @@
+#include "span_matcher_index.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "span_data.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// Return the 64-bit FNV-1a hash of the lowercase form of the specified `text`.
+std::uint64_t lowercase_hash(StringView text) {
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (const char c : text) {
+    hash ^= static_cast<unsigned char>(
+        std::tolower(static_cast<unsigned char>(c)));
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+const std::vector<std::size_t>* find_positions(
+    const std::unordered_map<std::uint64_t, std::vector<std::size_t>>& index,
+    StringView key) {
+  if (index.empty()) {
+    return nullptr;
+  }
+  const auto found = index.find(lowercase_hash(key));
+  if (found == index.end()) {
+    return nullptr;
+  }
+  return &found->second;
+}
+
+}  // namespace
+
+SpanMatcherIndex::CompiledMatcher::CompiledMatcher(const SpanMatcher& matcher)
+    : service(matcher.service),
+      name(matcher.name),
+      resource(matcher.resource) {
+  tags.reserve(matcher.tags.size());
+  for (const auto& [key, pattern] : matcher.tags) {
+    tags.emplace_back(key, GlobPattern(pattern));
+  }
+}
+
+bool SpanMatcherIndex::CompiledMatcher::match(const SpanData& span) const {
+  return service.match(span.service) && name.match(span.name) &&
+         resource.match(span.resource) &&
+         std::all_of(tags.begin(), tags.end(), [&](const auto& entry) {
+           const auto& [key, pattern] = entry;
+           const auto found = span.find_tag(key);
+           return found && pattern.match(*found);
+         });
+}
+
+void SpanMatcherIndex::add(const SpanMatcher& matcher) {
+  const std::size_t position = matchers_.size();
+  const CompiledMatcher& compiled = matchers_.emplace_back(matcher);
+  if (compiled.service.is_exact()) {
+    by_service_[lowercase_hash(compiled.service.literal())].push_back(
+        position);
+  } else if (compiled.name.is_exact()) {
+    by_name_[lowercase_hash(compiled.name.literal())].push_back(position);
+  } else {
+    unindexed_.push_back(position);
+  }
+}
+
+Optional<std::size_t> SpanMatcherIndex::find(const SpanData& span) const {
+  // Each matcher is in at most one of these, so visiting them in merged
+  // order visits each candidate once, in the order in which they were added.
+  const Positions* lists[] = {find_positions(by_service_, span.service),
+                              find_positions(by_name_, span.name),
+                              &unindexed_};
+  std::size_t cursors[] = {0, 0, 0};
+
+  for (;;) {
+    std::size_t next = matchers_.size();
+    std::size_t next_list = 0;
+    for (std::size_t i = 0; i < 3; ++i) {
+      if (lists[i] && cursors[i] < lists[i]->size() &&
+          (*lists[i])[cursors[i]] < next) {
+        next = (*lists[i])[cursors[i]];
+        next_list = i;
+      }
+    }
+    if (next == matchers_.size()) {
+      return nullopt;
+    }
+    ++cursors[next_list];
+    if (matchers_[next].match(span)) {
+      return next;
+    }
+  }
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,69 @@
+#pragma once
+
+// This component provides a class, `SpanMatcherIndex`, that finds the first of
+// a sequence of `SpanMatcher` that matches a given span.
+//
+// Trace sampling rules and span sampling rules are each a sequence of
+// `SpanMatcher`, of which the first that matches a span determines how the
+// span is sampled. There can be hundreds of rules, particularly when they are
+// delivered by remote configuration, and most of them name a particular
+// service or operation. `SpanMatcherIndex` compiles each `SpanMatcher` into
+// `GlobPattern`s when it is added, and indexes the `SpanMatcher` by its
+// service, or failing that by its name, if the pattern contains no wildcards.
+// Finding a match then examines only the `SpanMatcher` whose literal service
+// or name is that of the span, and those that are not indexed, in the order in
+// which they were added.
+
+#include <datadog/optional.h>
+#include <datadog/span_matcher.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "glob.h"
+
+namespace datadog {
+namespace tracing {
+
+struct SpanData;
+
+class SpanMatcherIndex {
+  struct CompiledMatcher {
+    GlobPattern service;
+    GlobPattern name;
+    GlobPattern resource;
+    std::vector<std::pair<std::string, GlobPattern>> tags;
+
+    explicit CompiledMatcher(const SpanMatcher&);
+    bool match(const SpanData&) const;
+  };
+
+  // The positions of matchers in `matchers_`, in increasing order.
+  using Positions = std::vector<std::size_t>;
+
+  std::vector<CompiledMatcher> matchers_;
+  // The keys are case-insensitive hashes of literal patterns. Distinct
+  // literals may collide, which is harmless because every candidate is
+  // matched in full.
+  std::unordered_map<std::uint64_t, Positions> by_service_;
+  std::unordered_map<std::uint64_t, Positions> by_name_;
+  Positions unindexed_;
+
+ public:
+  // Append the specified `matcher` to the sequence of matchers.
+  void add(const SpanMatcher& matcher);
+
+  // Return the position, in the order in which they were added, of the first
+  // matcher that matches the specified `span`, or return `nullopt` if none
+  // match.
+  Optional<std::size_t> find(const SpanData& span) const;
+
+  std::size_t size() const { return matchers_.size(); }
+};
+
+}  // namespace tracing
+}  // namespace datadog
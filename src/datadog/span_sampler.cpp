@@ -9,16 +9,12 @@
 namespace datadog {
 namespace tracing {
 
-SpanSampler::SynchronizedLimiter::SynchronizedLimiter(const Clock& clock,
-                                                      double max_per_second)
-    : limiter(clock, max_per_second) {}
-
 SpanSampler::Rule::Rule(const FinalizedSpanSamplerConfig::Rule& rule,
                         const Clock& clock)
     : FinalizedSpanSamplerConfig::Rule(rule),
-      limiter_(max_per_second ? std::make_unique<SynchronizedLimiter>(
-                                    clock, *max_per_second)
-                              : nullptr) {}
+      limiter_(max_per_second
+                   ? std::make_unique<Limiter>(clock, *max_per_second)
+                   : nullptr) {}
 
 SamplingDecision SpanSampler::Rule::decide(const SpanData& span) {
   SamplingDecision decision;
@@ -38,8 +34,7 @@ SamplingDecision SpanSampler::Rule::decide(const SpanData& span) {
     return decision;
   }
 
-  std::lock_guard<std::mutex> lock(limiter_->mutex);
-  const auto result = limiter_->limiter.allow();
+  const auto result = limiter_->allow();
   if (result.allowed) {
     decision.priority = int(SamplingPriority::USER_KEEP);
   } else {
@@ -54,14 +49,13 @@ SpanSampler::SpanSampler(const FinalizedSpanSamplerConfig& config,
                          const Clock& clock) {
   for (const auto& rule : config.rules) {
     rules_.push_back(Rule{rule, clock});
+    rule_index_.add(rule);
   }
 }
 
 SpanSampler::Rule* SpanSampler::match(const SpanData& span) {
-  const auto found = std::find_if(rules_.begin(), rules_.end(),
-                                  [&](Rule& rule) { return rule.match(span); });
-  if (found != rules_.end()) {
-    return &*found;
+  if (const auto found = rule_index_.find(span)) {
+    return &rules_[*found];
   }
   return nullptr;
 }
@@ -23,25 +23,18 @@
 #include <datadog/span_sampler_config.h>
 
 #include <memory>
-#include <mutex>
 
 #include "json.hpp"
 #include "limiter.h"
+#include "span_matcher_index.h"
 
 namespace datadog {
 namespace tracing {
 
 class SpanSampler {
  public:
-  struct SynchronizedLimiter {
-    std::mutex mutex;
-    Limiter limiter;
-
-    SynchronizedLimiter(const Clock&, double max_per_second);
-  };
-
   class Rule : public FinalizedSpanSamplerConfig::Rule {
-    std::unique_ptr<SynchronizedLimiter> limiter_;
+    std::unique_ptr<Limiter> limiter_;
 
    public:
     explicit Rule(const FinalizedSpanSamplerConfig::Rule&, const Clock&);
@@ -52,6 +45,7 @@ class SpanSampler {
 
  private:
   std::vector<Rule> rules_;
+  SpanMatcherIndex rule_index_;
 
  public:
   explicit SpanSampler(const FinalizedSpanSamplerConfig& config,
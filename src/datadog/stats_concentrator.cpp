@@ -0,0 +1,300 @@
+#include "stats_concentrator.h"
+
+#include <datadog/string_view.h>
+
+#include <initializer_list>
+#include <limits>
+
+#include "common/hash.h"
+#include "msgpack.h"
+#include "parse_util.h"
+#include "span_data.h"
+#include "string_util.h"
+#include "tags.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// Values of the "IsTraceRoot" field of a group, which is a `Trilean`.
+constexpr std::int32_t trace_root_true = 1;
+constexpr std::int32_t trace_root_false = 2;
+
+std::uint64_t nanoseconds(std::chrono::nanoseconds duration) {
+  return std::uint64_t(duration.count());
+}
+
+StringView tag_or_empty(const SpanData& span, const std::string& name) {
+  return span.find_tag(name).value_or("");
+}
+
+std::uint32_t http_status_code(const SpanData& span) {
+  const StringView tag = tag_or_empty(span, tags::http_status_code);
+  if (tag.empty()) {
+    return 0;
+  }
+  const auto status = parse_uint64(tag, 10);
+  if (!status || *status > std::numeric_limits<std::uint32_t>::max()) {
+    return 0;
+  }
+  return std::uint32_t(*status);
+}
+
+bool is_synthetics(const SpanData& span) {
+  return starts_with(tag_or_empty(span, tags::internal::origin), "synthetics");
+}
+
+bool is_measured(const SpanData& span) {
+  const auto found = span.numeric_tags.find(tags::internal::measured);
+  return found != span.numeric_tags.end() && found->second == 1;
+}
+
+// Return the specified `sketch` encoded as a "DDSketch" protocol buffers
+// message.
+std::string to_protobuf(const DDSketch& sketch) {
+  std::string encoded;
+  sketch.encode_protobuf(encoded);
+  return encoded;
+}
+
+Expected<void> msgpack_encode(std::string& destination,
+                              const StatsConcentrator::GroupKey& key,
+                              const StatsConcentrator::GroupStats& stats) {
+  return msgpack::pack_map(
+      destination, "Service",
+      [&](auto& buffer) { return msgpack::pack_string(buffer, key.service); },
+      "Name",
+      [&](auto& buffer) { return msgpack::pack_string(buffer, key.name); },
+      "Resource",
+      [&](auto& buffer) { return msgpack::pack_string(buffer, key.resource); },
+      "HTTPStatusCode",
+      [&](auto& buffer) {
+        msgpack::pack_integer(buffer, std::uint64_t(key.http_status_code));
+        return Expected<void>{};
+      },
+      "Type",
+      [&](auto& buffer) { return msgpack::pack_string(buffer, key.type); },
+      "Hits",
+      [&](auto& buffer) {
+        msgpack::pack_integer(buffer, stats.hits);
+        return Expected<void>{};
+      },
+      "Errors",
+      [&](auto& buffer) {
+        msgpack::pack_integer(buffer, stats.errors);
+        return Expected<void>{};
+      },
+      "Duration",
+      [&](auto& buffer) {
+        msgpack::pack_integer(buffer, stats.duration);
+        return Expected<void>{};
+      },
+      "OkSummary",
+      [&](auto& buffer) {
+        return msgpack::pack_binary(buffer, to_protobuf(stats.ok_summary));
+      },
+      "ErrorSummary",
+      [&](auto& buffer) {
+        return msgpack::pack_binary(buffer, to_protobuf(stats.error_summary));
+      },
+      "Synthetics",
+      [&](auto& buffer) {
+        msgpack::pack_bool(buffer, key.synthetics);
+        return Expected<void>{};
+      },
+      "TopLevelHits",
+      [&](auto& buffer) {
+        msgpack::pack_integer(buffer, stats.top_level_hits);
+        return Expected<void>{};
+      },
+      "IsTraceRoot", [&](auto& buffer) {
+        msgpack::pack_integer(
+            buffer, key.is_trace_root ? trace_root_true : trace_root_false);
+        return Expected<void>{};
+      });
+}
+
+}  // namespace
+
+bool StatsConcentrator::GroupKey::operator==(const GroupKey& other) const {
+  return service == other.service && name == other.name &&
+         resource == other.resource && type == other.type &&
+         http_status_code == other.http_status_code &&
+         synthetics == other.synthetics &&
+         is_trace_root == other.is_trace_root;
+}
+
+std::size_t StatsConcentrator::GroupKeyHash::operator()(
+    const GroupKey& key) const {
+  common::FastHash hash(0);
+  for (const std::string* field :
+       {&key.service, &key.name, &key.resource, &key.type}) {
+    // Include the length of each string, so that fields are not confused.
+    const std::size_t size = field->size();
+    hash.append(&size, sizeof size);
+    hash.append(field->data(), size);
+  }
+  hash.append(&key.http_status_code, sizeof key.http_status_code);
+  const char flags = char(key.synthetics) | char(key.is_trace_root << 1);
+  hash.append(&flags, sizeof flags);
+  return std::size_t(hash.final());
+}
+
+StatsConcentrator::StatsConcentrator(const TracerSignature& signature,
+                                     std::chrono::nanoseconds bucket_duration)
+    : signature_(signature), bucket_duration_(bucket_duration) {}
+
+void StatsConcentrator::add(
+    const std::vector<std::unique_ptr<SpanData>>& spans) {
+  // A span is top-level if its parent is not in the chunk, or if its parent
+  // belongs to another service.
+  std::unordered_map<std::uint64_t, const std::string*> services;
+  services.reserve(spans.size());
+  for (const auto& span : spans) {
+    services.emplace(span->span_id, &span->service);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& span_ptr : spans) {
+    const SpanData& span = *span_ptr;
+    const auto parent = services.find(span.parent_id);
+    const bool top_level =
+        parent == services.end() || *parent->second != span.service;
+    if (top_level || is_measured(span)) {
+      add(span, top_level);
+    }
+  }
+}
+
+void StatsConcentrator::add(const SpanData& span, bool top_level) {
+  const std::uint64_t duration = nanoseconds(span.duration);
+  const std::uint64_t end =
+      nanoseconds(span.start.wall.time_since_epoch()) + duration;
+  const std::uint64_t bucket_start =
+      end - end % nanoseconds(bucket_duration_);
+
+  Buckets& buckets = buckets_[EnvironmentAndVersion{
+      std::string(tag_or_empty(span, tags::environment)),
+      std::string(tag_or_empty(span, tags::version))}];
+  GroupKey key{span.service,
+               span.name,
+               span.resource,
+               span.service_type,
+               http_status_code(span),
+               is_synthetics(span),
+               span.parent_id == 0};
+  GroupStats& stats = buckets[bucket_start][std::move(key)];
+
+  ++stats.hits;
+  if (top_level) {
+    ++stats.top_level_hits;
+  }
+  stats.duration += duration;
+  if (span.error) {
+    ++stats.errors;
+    stats.error_summary.add(double(duration));
+  } else {
+    stats.ok_summary.add(double(duration));
+  }
+}
+
+Expected<std::vector<std::string>> StatsConcentrator::flush(
+    std::chrono::system_clock::time_point now, bool force) {
+  const std::uint64_t now_nanoseconds = nanoseconds(now.time_since_epoch());
+  const std::uint64_t bucket_nanoseconds = nanoseconds(bucket_duration_);
+
+  std::vector<std::pair<EnvironmentAndVersion, Buckets>> flushed;
+  std::uint64_t sequence;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto entry = buckets_.begin(); entry != buckets_.end();) {
+      Buckets& buckets = entry->second;
+      Buckets done;
+      while (!buckets.empty() &&
+             (force || buckets.begin()->first + bucket_nanoseconds <=
+                           now_nanoseconds)) {
+        done.insert(buckets.extract(buckets.begin()));
+      }
+      if (!done.empty()) {
+        flushed.emplace_back(entry->first, std::move(done));
+      }
+      if (buckets.empty()) {
+        entry = buckets_.erase(entry);
+      } else {
+        ++entry;
+      }
+    }
+    sequence = sequence_;
+    sequence_ += flushed.size();
+  }
+
+  std::vector<std::string> payloads;
+  for (const auto& [environment_and_version, buckets] : flushed) {
+    std::string payload;
+    auto result = msgpack::pack_map(
+        payload, "Hostname",
+        [&](auto& buffer) { return msgpack::pack_string(buffer, ""); }, "Env",
+        [&](auto& buffer) {
+          return msgpack::pack_string(buffer, environment_and_version.first);
+        },
+        "Version",
+        [&](auto& buffer) {
+          return msgpack::pack_string(buffer, environment_and_version.second);
+        },
+        "Stats",
+        [&](auto& buffer) {
+          return msgpack::pack_array(
+              buffer, buckets, [&](auto& buffer, const auto& entry) {
+                const auto& [start, bucket] = entry;
+                return msgpack::pack_map(
+                    buffer, "Start",
+                    [&](auto& buffer) {
+                      msgpack::pack_integer(buffer, start);
+                      return Expected<void>{};
+                    },
+                    "Duration",
+                    [&](auto& buffer) {
+                      msgpack::pack_integer(buffer, bucket_nanoseconds);
+                      return Expected<void>{};
+                    },
+                    "Stats", [&](auto& buffer) {
+                      return msgpack::pack_array(
+                          buffer, bucket, [](auto& buffer, const auto& group) {
+                            return msgpack_encode(buffer, group.first,
+                                                  group.second);
+                          });
+                    });
+              });
+        },
+        "Lang",
+        [&](auto& buffer) {
+          return msgpack::pack_string(buffer, signature_.library_language);
+        },
+        "TracerVersion",
+        [&](auto& buffer) {
+          return msgpack::pack_string(buffer, signature_.library_version);
+        },
+        "RuntimeID",
+        [&](auto& buffer) {
+          return msgpack::pack_string(buffer,
+                                      signature_.runtime_id.string());
+        },
+        "Sequence",
+        [&](auto& buffer) {
+          msgpack::pack_integer(buffer, ++sequence);
+          return Expected<void>{};
+        },
+        "Service", [&](auto& buffer) {
+          return msgpack::pack_string(buffer, signature_.default_service);
+        });
+    if (auto* error = result.if_error()) {
+      return std::move(*error);
+    }
+    payloads.push_back(std::move(payload));
+  }
+
+  return payloads;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,105 @@
+#pragma once
+
+// This component provides a class, `StatsConcentrator`, that computes trace
+// stats from finished spans on behalf of the Datadog Agent.
+//
+// Trace stats are the number of hits, the number of errors, and the
+// distribution of durations of spans, grouped by service, operation name,
+// resource, span type, and HTTP status code, in ten second buckets. The Agent
+// uses them to produce APM metrics. When the tracer computes trace stats, the
+// Agent needn't see every trace, and so traces that are sampled out (those
+// having a sampling priority of zero or less) needn't be sent to it.
+//
+// Only "top-level" spans and "measured" spans contribute to trace stats. A span
+// is top-level if it's the root of its trace chunk or if its parent belongs to
+// another service. A span is measured if its "_dd.measured" numeric tag is one.
+//
+// Each payload produced by `StatsConcentrator` is MessagePack encoded as
+// expected by the Agent's "/v0.6/stats" endpoint. The distributions of
+// durations are encoded as `DDSketch` protocol buffers. See `ddsketch.h`.
+
+#include <datadog/expected.h>
+#include <datadog/tracer_signature.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ddsketch.h"
+
+namespace datadog {
+namespace tracing {
+
+struct SpanData;
+
+class StatsConcentrator {
+ public:
+  // The spans of each group are described by these fields, in addition to the
+  // environment and version of the payload in which the group is sent.
+  struct GroupKey {
+    std::string service;
+    std::string name;
+    std::string resource;
+    std::string type;
+    std::uint32_t http_status_code;
+    bool synthetics;
+    bool is_trace_root;
+
+    bool operator==(const GroupKey& other) const;
+  };
+
+  struct GroupStats {
+    std::uint64_t hits = 0;
+    std::uint64_t top_level_hits = 0;
+    std::uint64_t errors = 0;
+    // Sum of the durations of the spans, in nanoseconds.
+    std::uint64_t duration = 0;
+    DDSketch ok_summary;
+    DDSketch error_summary;
+  };
+
+ private:
+  struct GroupKeyHash {
+    std::size_t operator()(const GroupKey& key) const;
+  };
+
+  using Bucket = std::unordered_map<GroupKey, GroupStats, GroupKeyHash>;
+  // Buckets are keyed by their start time, in nanoseconds since the epoch.
+  using Buckets = std::map<std::uint64_t, Bucket>;
+  // Spans of different environments and versions are sent in different
+  // payloads.
+  using EnvironmentAndVersion = std::pair<std::string, std::string>;
+
+  std::mutex mutex_;
+  std::map<EnvironmentAndVersion, Buckets> buckets_;
+  std::uint64_t sequence_ = 0;
+  const TracerSignature signature_;
+  const std::chrono::nanoseconds bucket_duration_;
+
+  void add(const SpanData& span, bool top_level);
+
+ public:
+  explicit StatsConcentrator(
+      const TracerSignature& signature,
+      std::chrono::nanoseconds bucket_duration = std::chrono::seconds(10));
+
+  // Add to the trace stats the top-level and measured spans among the
+  // specified `spans`, which make up a trace chunk. Each span is counted in
+  // the bucket containing the time at which it finished.
+  void add(const std::vector<std::unique_ptr<SpanData>>& spans);
+
+  // Remove the buckets that end at or before the specified `now`, or all
+  // buckets if `force` is true, and return a "/v0.6/stats" payload for each
+  // environment and version among them.
+  Expected<std::vector<std::string>> flush(
+      std::chrono::system_clock::time_point now, bool force);
+};
+
+}  // namespace tracing
+}  // namespace datadog
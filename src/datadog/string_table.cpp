@@ -0,0 +1,77 @@
+#include "string_table.h"
+
+#include "msgpack.h"
+
+namespace datadog {
+namespace tracing {
+
+StringTable::StringTable() { clear(); }
+
+std::uint32_t StringTable::index(StringView text) {
+  std::uint32_t index;
+  const auto found = indices_.find(text);
+  if (found != indices_.end()) {
+    index = found->second;
+  } else {
+    index = static_cast<std::uint32_t>(strings_.size());
+    const std::string& stored = strings_.emplace_back(text);
+    indices_.emplace(stored, index);
+    groups_.push_back(0);
+    // `pack_string` fails only for strings longer than four gigabytes, which
+    // `SpanData` cannot contain and still be encoded.
+    (void)msgpack::pack_string(encoded_strings_, stored);
+  }
+
+  if (recorded_ && groups_[index] != group_) {
+    groups_[index] = group_;
+    recorded_->push_back(index);
+  }
+  return index;
+}
+
+std::size_t StringTable::size() const { return strings_.size(); }
+
+std::size_t StringTable::encoded_size() const {
+  return msgpack::array_header_size(strings_.size()) + encoded_strings_.size();
+}
+
+void StringTable::clear() {
+  recorded_ = nullptr;
+  indices_.clear();
+  strings_.clear();
+  encoded_strings_.clear();
+  groups_.clear();
+  group_ = 0;
+  index("");
+}
+
+void StringTable::record(std::vector<std::uint32_t>* indices) {
+  recorded_ = indices;
+  ++group_;
+}
+
+void StringTable::retain(const std::vector<bool>& used) {
+  encoded_strings_.clear();
+  for (std::size_t i = 0; i < strings_.size(); ++i) {
+    std::string& text = strings_[i];
+    if (!text.empty() && (i >= used.size() || !used[i])) {
+      // The empty string keeps index zero.
+      indices_.erase(text);
+      text.clear();
+    }
+    (void)msgpack::pack_string(encoded_strings_, text);
+  }
+}
+
+Expected<void> msgpack_encode(std::string& destination,
+                              const StringTable& table) {
+  auto result = msgpack::pack_array(destination, table.size());
+  if (!result) {
+    return result;
+  }
+  destination += table.encoded_strings_;
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,91 @@
+#pragma once
+
+// This component provides a class, `StringTable`, that assigns a distinct
+// integer index to each distinct string added to it.
+//
+// `StringTable` is used to produce the version 0.5 trace payloads accepted by
+// the Datadog Agent at "/v0.5/traces". In that format, every string in a
+// payload is replaced by an index into an array of strings that prefixes the
+// payload. Strings that appear in many spans, such as service names, tag names,
+// and most tag values, are then sent only once per payload.
+//
+// The MessagePack encoding of each string is produced when the string is first
+// added, so that encoding the table is a single copy.
+//
+// A table that is filled over time, as trace chunks are encoded, can `record`
+// which strings each chunk uses. If some of the chunks are then dropped, the
+// table can `retain` only the strings of the chunks that remain.
+
+#include <datadog/expected.h>
+#include <datadog/string_view.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+class StringTable {
+  struct Hash {
+    std::size_t operator()(StringView text) const {
+      return std::hash<std::string_view>{}(
+          std::string_view(text.data(), text.size()));
+    }
+  };
+
+  // `strings_` owns the strings referred to by the keys of `indices_`. A
+  // `std::deque` does not move its elements when it grows.
+  std::deque<std::string> strings_;
+  std::unordered_map<StringView, std::uint32_t, Hash> indices_;
+  std::string encoded_strings_;
+  // `recorded_` is where `index` appends the indices of the strings used since
+  // the last call to `record`, or null if `record` isn't in effect. `group_`
+  // numbers the calls to `record`, and `groups_[i]` is the number of the call
+  // during which string `i` was last recorded.
+  std::vector<std::uint32_t>* recorded_ = nullptr;
+  std::uint32_t group_ = 0;
+  std::vector<std::uint32_t> groups_;
+
+ public:
+  // Create a table containing only the empty string, whose index is zero.
+  StringTable();
+
+  // Return the index of the specified `text`, adding it to the table if it
+  // isn't there already.
+  std::uint32_t index(StringView text);
+
+  // Return the number of strings in the table.
+  std::size_t size() const;
+
+  // Return the number of bytes that `msgpack_encode` appends for this table.
+  std::size_t encoded_size() const;
+
+  // Remove all strings from the table, except for the empty string.
+  void clear();
+
+  // Until the next call to `record` or `clear`, append to the specified
+  // `indices` the index of each distinct string passed to `index`. If
+  // `indices` is null, then stop recording.
+  void record(std::vector<std::uint32_t>* indices);
+
+  // Replace by the empty string each string whose index isn't marked in the
+  // specified `used`, and rebuild the table's encoding from the strings that
+  // remain. The other strings keep their indices.
+  void retain(const std::vector<bool>& used);
+
+  friend Expected<void> msgpack_encode(std::string& destination,
+                                       const StringTable& table);
+};
+
+// Append to the specified `destination` the MessagePack representation of the
+// specified `table`: an array of its strings, in order of their indices.
+Expected<void> msgpack_encode(std::string& destination,
+                              const StringTable& table);
+
+}  // namespace tracing
+}  // namespace datadog
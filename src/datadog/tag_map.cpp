@@ -0,0 +1,91 @@
+#include "tag_map.h"
+
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include "tags.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// The well-known tag names, grouped by length, so that a name need only be
+// compared with the few well-known names having the same length.
+class WellKnownNames {
+  static constexpr std::size_t max_size = 32;
+  std::array<std::vector<const std::string*>, max_size + 1> by_size_;
+
+ public:
+  WellKnownNames() {
+    // The tags that the tracer itself sets on every span, or on every local
+    // root span, are first.
+    for (const std::string* name : {
+             &tags::internal::language,
+             &tags::internal::runtime_id,
+             &tags::internal::process_id,
+             &tags::internal::sampling_priority,
+             &tags::internal::decision_maker,
+             &tags::internal::hostname,
+             &tags::internal::agent_sample_rate,
+             &tags::internal::rule_sample_rate,
+             &tags::internal::rule_limiter_sample_rate,
+             &tags::internal::origin,
+             &tags::internal::trace_id_high,
+             &tags::internal::apm_enabled,
+             &tags::internal::ksr,
+             &tags::environment,
+             &tags::version,
+             &tags::service_name,
+             &tags::span_type,
+             &tags::operation_name,
+             &tags::resource_name,
+             &tags::http_endpoint,
+             &tags::http_route,
+             &tags::http_url,
+             &tags::http_status_code,
+             &tags::error_message,
+             &tags::error_type,
+             &tags::error_stack,
+             &tags::internal::propagation_error,
+             &tags::internal::span_sampling_mechanism,
+             &tags::internal::span_sampling_rule_rate,
+             &tags::internal::span_sampling_limit,
+             &tags::internal::w3c_extraction_error,
+             &tags::internal::w3c_parent_id,
+             &tags::internal::trace_source,
+             &tags::internal::measured,
+         }) {
+      assert(name->size() <= max_size);
+      by_size_[name->size()].push_back(name);
+    }
+  }
+
+  // Return the well-known name equal to the specified `name`, or null if
+  // there is none.
+  const std::string* find(StringView name) const {
+    if (name.size() > max_size) {
+      return nullptr;
+    }
+    for (const std::string* candidate : by_size_[name.size()]) {
+      if (std::memcmp(candidate->data(), name.data(), name.size()) == 0) {
+        return candidate;
+      }
+    }
+    return nullptr;
+  }
+};
+
+}  // namespace
+
+TagKey::TagKey(StringView name) {
+  static const WellKnownNames well_known_names;
+  interned_ = well_known_names.find(name);
+  if (!interned_) {
+    owned_ = std::string(name);
+  }
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,354 @@
+#pragma once
+
+// This component provides a class template, `TagMap`, that holds the tags of
+// a span, and a class, `TagKey`, that is the name of a tag in a `TagMap`.
+//
+// A span typically has between five and thirty tags. They are set one at a
+// time, serialized in one pass, and seldom looked up. `TagMap` stores them
+// contiguously, in the order in which they were first set, with room for a
+// few of them inside the `TagMap` itself, so that most spans allocate no
+// storage for their tags beyond the strings. Lookup is a linear search, which
+// for so few elements is cheaper than hashing.
+//
+// A `TagKey` whose name is one of the well-known tag names in `tags.h` refers
+// to the corresponding string in `tags.h` instead of copying it.
+//
+// `TagMap` has the parts of the interface of `std::unordered_map` that are
+// used with span tags, and allocates its storage using an `ArenaAllocator`.
+
+#include <datadog/string_view.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "trace_arena.h"
+
+namespace datadog {
+namespace tracing {
+
+class TagKey {
+  // The well-known name that this key refers to, or null if this key owns its
+  // name.
+  const std::string* interned_;
+  std::string owned_;
+
+ public:
+  explicit TagKey(StringView name);
+
+  const std::string& str() const noexcept {
+    return interned_ ? *interned_ : owned_;
+  }
+  operator StringView() const noexcept { return str(); }
+  const char* data() const noexcept { return str().data(); }
+  std::size_t size() const noexcept { return str().size(); }
+  bool interned() const noexcept { return interned_ != nullptr; }
+};
+
+inline bool operator==(const TagKey& left, const TagKey& right) noexcept {
+  return StringView(left) == StringView(right);
+}
+inline bool operator==(const TagKey& left, StringView right) noexcept {
+  return StringView(left) == right;
+}
+inline bool operator==(StringView left, const TagKey& right) noexcept {
+  return left == StringView(right);
+}
+inline bool operator!=(const TagKey& left, const TagKey& right) noexcept {
+  return !(left == right);
+}
+inline bool operator!=(const TagKey& left, StringView right) noexcept {
+  return !(left == right);
+}
+inline bool operator!=(StringView left, const TagKey& right) noexcept {
+  return !(left == right);
+}
+
+template <typename Value, std::size_t InlineCapacity>
+class TagMap {
+ public:
+  using key_type = TagKey;
+  using mapped_type = Value;
+  using value_type = std::pair<TagKey, Value>;
+  using size_type = std::size_t;
+  using allocator_type = ArenaAllocator<value_type>;
+  using iterator = value_type*;
+  using const_iterator = const value_type*;
+
+ private:
+  value_type* data_;
+  size_type size_;
+  size_type capacity_;
+  allocator_type allocator_;
+  alignas(value_type) unsigned char
+      inline_[InlineCapacity * sizeof(value_type)];
+
+  value_type* inline_data() noexcept {
+    return reinterpret_cast<value_type*>(inline_);
+  }
+  bool is_inline() const noexcept {
+    return data_ == reinterpret_cast<const value_type*>(inline_);
+  }
+
+  // Return the capacity of new storage having room for at least the specified
+  // `minimum` elements.
+  size_type grown_capacity(size_type minimum) const noexcept {
+    return std::max(minimum, 2 * capacity_);
+  }
+
+  // Move the elements to the specified `data`, which has room for the
+  // specified `capacity` elements, and use it as their storage.
+  void relocate(value_type* data, size_type capacity) {
+    std::uninitialized_move(data_, data_ + size_, data);
+    std::destroy(data_, data_ + size_);
+    release_storage();
+    data_ = data;
+    capacity_ = capacity;
+  }
+
+  // Move the elements to new storage having room for at least the specified
+  // `minimum` elements.
+  void grow(size_type minimum) {
+    const size_type capacity = grown_capacity(minimum);
+    relocate(allocator_.allocate(capacity), capacity);
+  }
+
+  // Deallocate the storage of the elements, if it is not inline, and use the
+  // inline storage instead. The behavior is undefined unless there are no
+  // elements.
+  void release_storage() noexcept {
+    if (!is_inline()) {
+      allocator_.deallocate(data_, capacity_);
+      data_ = inline_data();
+      capacity_ = InlineCapacity;
+    }
+  }
+
+  // Take the elements of the specified `other`, which is empty afterward.
+  void take(TagMap& other) {
+    if (!other.is_inline() && allocator_ == other.allocator_) {
+      data_ = other.data_;
+      size_ = other.size_;
+      capacity_ = other.capacity_;
+      other.data_ = other.inline_data();
+      other.size_ = 0;
+      other.capacity_ = InlineCapacity;
+      return;
+    }
+    reserve(other.size_);
+    std::uninitialized_move(other.begin(), other.end(), data_);
+    size_ = other.size_;
+    other.clear();
+  }
+
+  template <typename... Args>
+  static void construct(value_type* slot, StringView key, Args&&... args) {
+    ::new (static_cast<void*>(slot))
+        value_type(std::piecewise_construct, std::forward_as_tuple(key),
+                   std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template <typename... Args>
+  iterator emplace_back(StringView key, Args&&... args) {
+    if (size_ < capacity_) {
+      construct(data_ + size_, key, std::forward<Args>(args)...);
+      return data_ + size_++;
+    }
+
+    // `key` or `args` might refer to an element, and so, as `std::vector`
+    // does, construct the new element in the new storage before moving the
+    // others there.
+    const size_type capacity = grown_capacity(size_ + 1);
+    value_type* const data = allocator_.allocate(capacity);
+    try {
+      construct(data + size_, key, std::forward<Args>(args)...);
+    } catch (...) {
+      allocator_.deallocate(data, capacity);
+      throw;
+    }
+    relocate(data, capacity);
+    return data_ + size_++;
+  }
+
+ public:
+  TagMap() noexcept : TagMap(allocator_type()) {}
+
+  explicit TagMap(const allocator_type& allocator) noexcept
+      : data_(inline_data()),
+        size_(0),
+        capacity_(InlineCapacity),
+        allocator_(allocator) {}
+
+  TagMap(std::initializer_list<std::pair<StringView, Value>> items)
+      : TagMap() {
+    for (const auto& [key, value] : items) {
+      insert_or_assign(key, value);
+    }
+  }
+
+  // A copy allocates from the heap, as `ArenaAllocator` prescribes.
+  TagMap(const TagMap& other)
+      : TagMap(other.allocator_.select_on_container_copy_construction()) {
+    reserve(other.size_);
+    std::uninitialized_copy(other.begin(), other.end(), data_);
+    size_ = other.size_;
+  }
+
+  TagMap(TagMap&& other) : TagMap(other.allocator_) { take(other); }
+
+  ~TagMap() {
+    clear();
+    release_storage();
+  }
+
+  TagMap& operator=(const TagMap& other) {
+    if (this != &other) {
+      clear();
+      reserve(other.size_);
+      std::uninitialized_copy(other.begin(), other.end(), data_);
+      size_ = other.size_;
+    }
+    return *this;
+  }
+
+  TagMap& operator=(TagMap&& other) {
+    if (this != &other) {
+      clear();
+      if (!other.is_inline() && allocator_ == other.allocator_) {
+        release_storage();
+      }
+      take(other);
+    }
+    return *this;
+  }
+
+  allocator_type get_allocator() const noexcept { return allocator_; }
+
+  iterator begin() noexcept { return data_; }
+  iterator end() noexcept { return data_ + size_; }
+  const_iterator begin() const noexcept { return data_; }
+  const_iterator end() const noexcept { return data_ + size_; }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+
+  size_type size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  void reserve(size_type capacity) {
+    if (capacity > capacity_) {
+      grow(capacity);
+    }
+  }
+
+  void clear() noexcept {
+    std::destroy(data_, data_ + size_);
+    size_ = 0;
+  }
+
+  iterator find(StringView key) noexcept {
+    return std::find_if(begin(), end(), [&](const value_type& item) {
+      return item.first == key;
+    });
+  }
+  const_iterator find(StringView key) const noexcept {
+    return const_cast<TagMap*>(this)->find(key);
+  }
+
+  size_type count(StringView key) const noexcept {
+    return find(key) == end() ? 0 : 1;
+  }
+
+  Value& at(StringView key) {
+    const iterator found = find(key);
+    if (found == end()) {
+      throw std::out_of_range("TagMap::at");
+    }
+    return found->second;
+  }
+  const Value& at(StringView key) const {
+    return const_cast<TagMap*>(this)->at(key);
+  }
+
+  Value& operator[](StringView key) {
+    const iterator found = find(key);
+    if (found != end()) {
+      return found->second;
+    }
+    return emplace_back(key)->second;
+  }
+
+  // Add a tag having the specified `key` and a value constructed from the
+  // specified `args`, unless there already is a tag having `key`. Return the
+  // tag having `key`, and whether it was added.
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(StringView key, Args&&... args) {
+    const iterator found = find(key);
+    if (found != end()) {
+      return {found, false};
+    }
+    return {emplace_back(key, std::forward<Args>(args)...), true};
+  }
+
+  template <typename Pair>
+  std::pair<iterator, bool> insert(const Pair& item) {
+    return emplace(item.first, item.second);
+  }
+
+  template <typename Iterator>
+  void insert(Iterator first, Iterator last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  template <typename Mapped>
+  std::pair<iterator, bool> insert_or_assign(StringView key, Mapped&& value) {
+    const iterator found = find(key);
+    if (found != end()) {
+      found->second = std::forward<Mapped>(value);
+      return {found, false};
+    }
+    return {emplace_back(key, std::forward<Mapped>(value)), true};
+  }
+
+  // Remove the specified `position`, preserving the order of the remaining
+  // tags. Return the tag following the removed one.
+  iterator erase(const_iterator position) {
+    const iterator removed = begin() + (position - begin());
+    std::move(removed + 1, end(), removed);
+    --size_;
+    std::destroy_at(end());
+    return removed;
+  }
+
+  size_type erase(StringView key) {
+    const iterator found = find(key);
+    if (found == end()) {
+      return 0;
+    }
+    erase(found);
+    return 1;
+  }
+
+  // Two maps are equal if they have the same tags, in any order.
+  friend bool operator==(const TagMap& left, const TagMap& right) {
+    return left.size() == right.size() &&
+           std::all_of(left.begin(), left.end(), [&](const value_type& item) {
+             const const_iterator found = right.find(item.first);
+             return found != right.end() && found->second == item.second;
+           });
+  }
+  friend bool operator!=(const TagMap& left, const TagMap& right) {
+    return !(left == right);
+  }
+};
+
+}  // namespace tracing
+}  // namespace datadog
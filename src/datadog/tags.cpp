@@ -13,6 +13,10 @@ const std::string version = "version";
 const std::string http_endpoint = "http.endpoint";
 const std::string http_route = "http.route";
 const std::string http_url = "http.url";
+const std::string http_status_code = "http.status_code";
+const std::string error_message = "error.message";
+const std::string error_type = "error.type";
+const std::string error_stack = "error.stack";
 
 namespace internal {
 
@@ -36,6 +40,7 @@ const std::string w3c_parent_id = "_dd.parent_id";
 const std::string trace_source = "_dd.p.ts";
 const std::string apm_enabled = "_dd.apm.enabled";
 const std::string ksr = "_dd.p.ksr";
+const std::string measured = "_dd.measured";
 
 }  // namespace internal
 
@@ -22,6 +22,10 @@ extern const std::string version;
 extern const std::string http_endpoint;
 extern const std::string http_route;
 extern const std::string http_url;
+extern const std::string http_status_code;
+extern const std::string error_message;
+extern const std::string error_type;
+extern const std::string error_stack;
 
 namespace internal {
 extern const std::string propagation_error;
@@ -44,6 +48,7 @@ extern const std::string w3c_parent_id;
 extern const std::string trace_source;  // _dd.p.ts
 extern const std::string apm_enabled;   // _dd.apm.enabled
 extern const std::string ksr;           // _dd.p.ksr
+extern const std::string measured;      // _dd.measured
 
 }  // namespace internal
 
@@ -132,6 +132,28 @@ void error(std::string message, std::string stacktrace) {
 }  // namespace log
 
 namespace counter {
+Handle::Handle(const Counter& counter, std::vector<std::string> tags)
+    : counter_(counter), tags_(std::move(tags)), cell_(nullptr) {}
+
+void increment(const Handle& handle) {
+  details::CounterCell* cell = handle.cell_.load(std::memory_order_acquire);
+  if (cell == nullptr) {
+    std::visit(details::Overload{
+                   [&](std::shared_ptr<Telemetry>& telemetry) {
+                     cell = &telemetry->counter_cell(handle.counter_,
+                                                     handle.tags_);
+                     handle.cell_.store(cell, std::memory_order_release);
+                   },
+                   [](auto&&) {},
+               },
+               instance());
+    if (cell == nullptr) {
+      return;
+    }
+  }
+  cell->add(1);
+}
+
 void increment(const Counter& counter) {
   std::visit(details::Overload{
                  [&](std::shared_ptr<Telemetry>& telemetry) {
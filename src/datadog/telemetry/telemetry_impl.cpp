@@ -9,8 +9,10 @@
 #include <datadog/tracer_signature.h>
 
 #include <chrono>
+#include <cmath>
 
 #include "datadog_agent.h"
+#include "gzip.h"
 #include "platform_util.h"
 
 using namespace datadog::tracing;
@@ -188,17 +190,26 @@ void encode_metrics(
   }
 }
 
+// The greatest number of points sent for one distribution in one heartbeat.
+// Distributions having more datapoints than this are sent as this many points
+// taken at evenly spaced ranks.
+constexpr std::size_t max_distribution_points = 1024;
+
 nlohmann::json encode_distributions(
-    const std::unordered_map<MetricContext<Distribution>,
-                             std::vector<uint64_t>>& distributions) {
+    const std::unordered_map<MetricContext<Distribution>, DDSketch>&
+        distributions) {
   auto j = nlohmann::json::array();
 
-  for (const auto& [metric_ctx, values] : distributions) {
+  for (const auto& [metric_ctx, sketch] : distributions) {
+    auto points = nlohmann::json::array();
+    for (const double value : sketch.values(max_distribution_points)) {
+      points.emplace_back(static_cast<uint64_t>(std::llround(value)));
+    }
     auto series = nlohmann::json{
         {"metric", metric_ctx.id.name},
         {"common", metric_ctx.id.common},
         {"namespace", metric_ctx.id.scope},
-        {"points", values},
+        {"points", std::move(points)},
     };
     if (!metric_ctx.tags.empty()) {
       series.emplace("tags", metric_ctx.tags);
@@ -245,7 +256,12 @@ void Telemetry::schedule_tasks() {
   tasks_.emplace_back(scheduler_->schedule_recurring_event(
       config_.heartbeat_interval, [weak = weak_from_this()]() {
         if (auto self = weak.lock()) {
-          self->send_payload("app-heartbeat", self->heartbeat_and_telemetry());
+          std::string payload;
+          {
+            std::lock_guard l{self->payload_mutex_};
+            payload = self->heartbeat_and_telemetry();
+          }
+          self->send_payload("app-heartbeat", std::move(payload));
         }
       }));
 
@@ -253,6 +269,7 @@ void Telemetry::schedule_tasks() {
     tasks_.emplace_back(scheduler_->schedule_recurring_event(
         config_.metrics_interval, [weak = weak_from_this()]() {
           if (auto self = weak.lock()) {
+            std::lock_guard l{self->payload_mutex_};
             self->capture_metrics();
           }
         }));
@@ -261,8 +278,12 @@ void Telemetry::schedule_tasks() {
   tasks_.emplace_back(scheduler_->schedule_recurring_event(
       config_.extended_heartbeat_interval, [weak = weak_from_this()]() {
         if (auto self = weak.lock()) {
-          self->send_payload("app-extended-heartbeat",
-                             self->extended_heartbeat_payload());
+          std::string payload;
+          {
+            std::lock_guard l{self->payload_mutex_};
+            payload = self->extended_heartbeat_payload();
+          }
+          self->send_payload("app-extended-heartbeat", std::move(payload));
         }
       }));
 }
@@ -293,7 +314,11 @@ void Telemetry::log_warning(std::string message) {
 }
 
 void Telemetry::app_started() {
-  auto payload = app_started_payload();
+  std::string payload;
+  {
+    std::lock_guard l{payload_mutex_};
+    payload = app_started_payload();
+  }
 
   auto on_headers = [payload_size = payload.size(),
                      debug_enabled = config_.debug,
@@ -351,10 +376,15 @@ void Telemetry::shutdown() {
 }
 
 void Telemetry::app_closing() {
-  // Capture metrics in-between two ticks to be sent with the last payload.
-  capture_metrics();
+  std::string payload;
+  {
+    std::lock_guard l{payload_mutex_};
+    // Capture metrics in-between two ticks to be sent with the last payload.
+    capture_metrics();
+    payload = app_closing_payload();
+  }
 
-  send_payload("app-closing", app_closing_payload());
+  send_payload("app-closing", std::move(payload));
   http_client_->drain(clock_().tick + request_timeout);
 }
 
@@ -366,11 +396,23 @@ void Telemetry::send_payload(StringView request_type, std::string payload) {
   }
   if (!client) return;
 
+  bool compressed = false;
+  if (config_.compression_level &&
+      payload.size() >= config_.compression_min_bytes) {
+    if (auto gzipped = tracing::gzip(payload, *config_.compression_level)) {
+      payload = std::move(*gzipped);
+      compressed = true;
+    }
+  }
+
   auto set_telemetry_headers = [request_type, payload_size = payload.size(),
-                                debug_enabled = config_.debug,
+                                compressed, debug_enabled = config_.debug,
                                 &signature =
                                     tracer_signature_](DictWriter& headers) {
     headers.set("Content-Type", "application/json");
+    if (compressed) {
+      headers.set("Content-Encoding", "gzip");
+    }
     headers.set("Content-Length", std::to_string(payload_size));
     headers.set("DD-Telemetry-API-Version", "v2");
     headers.set("DD-Client-Library-Language", "cpp");
@@ -439,6 +481,7 @@ void Telemetry::send_payload(StringView request_type, std::string payload) {
 }
 
 void Telemetry::send_configuration_change() {
+  std::unique_lock<std::mutex> lock(payload_mutex_);
   if (configuration_snapshot_.empty()) return;
 
   std::vector<ConfigMetadata> current_configuration;
@@ -454,6 +497,7 @@ void Telemetry::send_configuration_change() {
       generate_telemetry_body("app-client-configuration-change");
   telemetry_body["payload"] =
       nlohmann::json{{"configuration", configuration_json}};
+  lock.unlock();
 
   send_payload("app-client-configuration-change", telemetry_body.dump());
 }
@@ -466,8 +510,7 @@ std::string Telemetry::heartbeat_and_telemetry() {
   });
   batch_payloads.emplace_back(std::move(heartbeat));
 
-  std::unordered_map<MetricContext<Distribution>, std::vector<uint64_t>>
-      distributions;
+  std::unordered_map<MetricContext<Distribution>, DDSketch> distributions;
   {
     std::lock_guard l{distributions_mutex_};
     std::swap(distributions_, distributions);
@@ -790,6 +833,7 @@ nlohmann::json Telemetry::generate_configuration_field(
 
 void Telemetry::capture_configuration_change(
     const std::vector<tracing::ConfigMetadata>& new_configuration) {
+  std::lock_guard l{payload_mutex_};
   configuration_snapshot_.insert(configuration_snapshot_.begin(),
                                  new_configuration.begin(),
                                  new_configuration.end());
@@ -800,15 +844,16 @@ void Telemetry::capture_metrics() {
                               clock_().wall.time_since_epoch())
                               .count();
 
-  std::unordered_map<MetricContext<Counter>, uint64_t> counter_snapshot;
   {
     std::lock_guard l{counter_mutex_};
-    std::swap(counter_snapshot, counters_);
-  }
-
-  for (auto& [counter, value] : counter_snapshot) {
-    auto& counter_snapshots = counters_snapshot_[counter];
-    counter_snapshots.emplace_back(std::make_pair(timepoint, value));
+    for (auto& [counter, cell] : counters_) {
+      if (!cell->modified.exchange(false, std::memory_order_relaxed)) {
+        continue;
+      }
+      const uint64_t value = cell->value.exchange(0, std::memory_order_relaxed);
+      auto& counter_snapshots = counters_snapshot_[counter];
+      counter_snapshots.emplace_back(std::make_pair(timepoint, value));
+    }
   }
 
   std::unordered_map<MetricContext<Rate>, uint64_t> rate_snapshot;
@@ -833,14 +878,23 @@ void Telemetry::log(std::string message, telemetry::LogLevel level,
       telemetry::LogMessage{std::move(message), level, stacktrace, timestamp});
 }
 
+details::CounterCell& Telemetry::counter_cell(
+    const Counter& id, const std::vector<std::string>& tags) {
+  std::lock_guard l{counter_mutex_};
+  auto& cell = counters_[{id, tags}];
+  if (!cell) {
+    cell = std::make_unique<details::CounterCell>();
+  }
+  return *cell;
+}
+
 void Telemetry::increment_counter(const Counter& id) {
   increment_counter(id, {});
 }
 
 void Telemetry::increment_counter(const Counter& id,
                                   const std::vector<std::string>& tags) {
-  std::lock_guard l{counter_mutex_};
-  counters_[{id, tags}] += 1;
+  counter_cell(id, tags).add(1);
 }
 
 void Telemetry::decrement_counter(const Counter& id) {
@@ -849,9 +903,7 @@ void Telemetry::decrement_counter(const Counter& id) {
 
 void Telemetry::decrement_counter(const Counter& id,
                                   const std::vector<std::string>& tags) {
-  std::lock_guard l{counter_mutex_};
-  auto& v = counters_[{id, tags}];
-  if (v > 0) v -= 1;
+  counter_cell(id, tags).decrement();
 }
 
 void Telemetry::set_counter(const Counter& id, uint64_t value) {
@@ -861,8 +913,7 @@ void Telemetry::set_counter(const Counter& id, uint64_t value) {
 void Telemetry::set_counter(const Counter& id,
                             const std::vector<std::string>& tags,
                             uint64_t value) {
-  std::lock_guard l{counter_mutex_};
-  counters_[{id, tags}] = value;
+  counter_cell(id, tags).set(value);
 }
 
 void Telemetry::set_rate(const Rate& id, uint64_t value) {
@@ -883,7 +934,7 @@ void Telemetry::add_datapoint(const Distribution& id,
                               const std::vector<std::string>& tags,
                               uint64_t value) {
   std::lock_guard l{distributions_mutex_};
-  distributions_[{id, tags}].emplace_back(value);
+  distributions_[{id, tags}].add(static_cast<double>(value));
 }
 
 }  // namespace datadog::telemetry
@@ -9,9 +9,11 @@
 #include <datadog/telemetry/metrics.h>
 #include <datadog/tracer_signature.h>
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 
+#include "ddsketch.h"
 #include "json.hpp"
 #include "log.h"
 #include "metric_context.h"
@@ -21,6 +23,40 @@ namespace datadog::telemetry {
 
 using MetricSnapshot = std::vector<std::pair<std::time_t, uint64_t>>;
 
+namespace details {
+
+/// `CounterCell` is the value of a counter with a particular set of tags,
+/// accumulated since metrics were last captured. A cell is updated without
+/// locking, and is never deallocated while the `Telemetry` that owns it
+/// exists.
+struct CounterCell final {
+  std::atomic<uint64_t> value{0};
+  /// Whether `value` has been modified since metrics were last captured.
+  std::atomic<bool> modified{false};
+
+  void add(uint64_t amount) {
+    value.fetch_add(amount, std::memory_order_relaxed);
+    modified.store(true, std::memory_order_relaxed);
+  }
+
+  /// Decrement `value` by one, unless it is zero.
+  void decrement() {
+    uint64_t current = value.load(std::memory_order_relaxed);
+    while (current > 0 &&
+           !value.compare_exchange_weak(current, current - 1,
+                                        std::memory_order_relaxed)) {
+    }
+    modified.store(true, std::memory_order_relaxed);
+  }
+
+  void set(uint64_t new_value) {
+    value.store(new_value, std::memory_order_relaxed);
+    modified.store(true, std::memory_order_relaxed);
+  }
+};
+
+}  // namespace details
+
 /// The telemetry class is responsible for handling internal telemetry data to
 /// track Datadog product usage. It _can_ collect and report logs and metrics.
 ///
@@ -42,8 +78,11 @@ class Telemetry final : public std::enable_shared_from_this<Telemetry> {
   std::shared_ptr<tracing::EventScheduler> scheduler_;
 
   /// Counter
+  /// `counter_mutex_` guards the set of `counters_`, but not their values.
   std::mutex counter_mutex_;
-  std::unordered_map<MetricContext<Counter>, uint64_t> counters_;
+  std::unordered_map<MetricContext<Counter>,
+                     std::unique_ptr<details::CounterCell>>
+      counters_;
   std::unordered_map<MetricContext<Counter>, MetricSnapshot> counters_snapshot_;
 
   /// Rate
@@ -52,11 +91,18 @@ class Telemetry final : public std::enable_shared_from_this<Telemetry> {
   std::unordered_map<MetricContext<Rate>, MetricSnapshot> rates_snapshot_;
 
   /// Distribution
-  /// TODO: split distribution in array of N element?
+  /// Each distribution is summarized in a sketch, so that the memory it uses
+  /// is bounded no matter how many datapoints are added between heartbeats.
   std::mutex distributions_mutex_;
-  std::unordered_map<MetricContext<Distribution>, std::vector<uint64_t>>
+  std::unordered_map<MetricContext<Distribution>, tracing::DDSketch>
       distributions_;
 
+  /// `payload_mutex_` guards the state from which payloads are generated: the
+  /// metric snapshots, the configuration, and the sequence ids. The scheduled
+  /// tasks might run concurrently with each other, and with configuration
+  /// changes.
+  std::mutex payload_mutex_;
+
   /// Configuration
   std::vector<tracing::ConfigMetadata> configuration_snapshot_;
 
@@ -120,6 +166,11 @@ class Telemetry final : public std::enable_shared_from_this<Telemetry> {
   void shutdown();
 
   /// Counter
+  /// Return the storage for the specified `counter` with the specified `tags`,
+  /// creating it if necessary. The returned cell is valid for the lifetime of
+  /// this object.
+  details::CounterCell& counter_cell(const Counter& counter,
+                                     const std::vector<std::string>& tags);
   void increment_counter(const Counter& counter);
   void increment_counter(const Counter& counter,
                          const std::vector<std::string>& tags);
@@ -47,8 +47,15 @@ const telemetry::Distribution bytes_sent = {"trace_api.bytes", "tracers", true};
 const telemetry::Distribution request_duration = {"trace_api.ms", "tracers",
                                                   true};
 const telemetry::Counter errors = {"trace_api.errors", "tracers", true};
+const telemetry::Counter retries = {"trace_api.retries", "tracers", true};
+const telemetry::Counter retries_dropped = {"trace_api.retries_dropped",
+                                            "tracers", true};
 }  // namespace api
 
+namespace http_client {
+const telemetry::Counter requests = {"http_client.requests", "tracers", true};
+}  // namespace http_client
+
 namespace trace_context {
 const telemetry::Counter injected = {"context_header_style.injected", "tracers",
                                      true};
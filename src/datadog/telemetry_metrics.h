@@ -78,7 +78,9 @@ extern const telemetry::Counter requests;
 /// responses.
 extern const telemetry::Counter responses;
 
-/// The size of the payload sent to the endpoint in bytes.
+/// The size of the payload sent to the endpoint in bytes. Like any
+/// distribution, it's reported to within 1%, as at most 1024 sizes per
+/// heartbeat. See `telemetry::distribution`.
 extern const telemetry::Distribution bytes_sent;
 
 /// The time it takes to flush the trace payload to the agent. Note that this is
@@ -90,8 +92,26 @@ extern const telemetry::Distribution request_duration;
 /// `type:status_code`).
 extern const telemetry::Counter errors;
 
+/// The number of payloads queued to be sent to the trace endpoint again after
+/// a network error or a 5xx response.
+extern const telemetry::Counter retries;
+
+/// The number of payloads dropped instead of being sent to the trace endpoint
+/// again, tagged by reason: `reason:max_retries` (the payload failed too many
+/// times) or `reason:buffer_full` (there wasn't room to hold the payload).
+extern const telemetry::Counter retries_dropped;
+
 }  // namespace api
 
+namespace http_client {
+
+/// The number of requests completed by the libcurl HTTP client, tagged by
+/// whether the request reused an open connection (`connection:reused`) or
+/// opened a new one (`connection:new`).
+extern const telemetry::Counter requests;
+
+}  // namespace http_client
+
 namespace trace_context {
 
 /// The number of times distributed context is injected into an outgoing span,
@@ -0,0 +1,60 @@
+#include "thread_slots.h"
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// `ThreadNumbers` hands out the numbers returned by `this_thread_index`.
+class ThreadNumbers {
+  std::mutex mutex_;
+  std::size_t next_ = 0;
+  // Numbers given up by exited threads, smallest first.
+  std::priority_queue<std::size_t, std::vector<std::size_t>,
+                      std::greater<std::size_t>>
+      released_;
+
+ public:
+  std::size_t acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (released_.empty()) {
+      return next_++;
+    }
+    const std::size_t number = released_.top();
+    released_.pop();
+    return number;
+  }
+
+  void release(std::size_t number) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    released_.push(number);
+  }
+};
+
+// The numbers outlive every thread, including threads that exit while static
+// objects are being destroyed, so they are never destroyed.
+ThreadNumbers& thread_numbers() {
+  static ThreadNumbers* const numbers = new ThreadNumbers;
+  return *numbers;
+}
+
+// `ThreadIndex` holds a thread's number for as long as the thread runs.
+struct ThreadIndex {
+  const std::size_t value;
+
+  ThreadIndex() : value(thread_numbers().acquire()) {}
+  ~ThreadIndex() { thread_numbers().release(value); }
+};
+
+}  // namespace
+
+std::size_t this_thread_index() {
+  thread_local const ThreadIndex index;
+  return index.value;
+}
+
+}  // namespace tracing
+}  // namespace datadog
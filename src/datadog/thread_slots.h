@@ -0,0 +1,86 @@
+#pragma once
+
+// This component provides a class template, `ThreadSlots`, that holds one
+// `Slot` for each thread that uses it, and a function, `this_thread_index`,
+// that numbers the threads.
+//
+// A `thread_local` variable has one instance per thread for the whole program.
+// A `ThreadSlots` object instead owns its slots: there is one slot per thread
+// for each `ThreadSlots` object, and the slots are destroyed along with the
+// object. This suits a per-thread cache of a value that belongs to a
+// particular object, such as a `ConfigManager`'s configuration.
+//
+// A thread finds its slot without locking, except when it's the first of its
+// block of threads to use the object. Slots are allocated in blocks that never
+// move, indexed by `this_thread_index`.
+//
+// Threads that have exited give up their numbers to threads created later.
+// A slot is thus reused, as is, by the next thread to have its number. Whatever
+// a slot refers to remains alive until then, or until its `ThreadSlots` object
+// is destroyed.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+namespace datadog {
+namespace tracing {
+
+// Return a number that identifies the calling thread among the threads that
+// are running. The numbers of running threads are distinct, and are as small
+// as possible: a new thread takes the smallest number given up by an exited
+// thread, if any.
+std::size_t this_thread_index();
+
+template <typename Slot>
+class ThreadSlots {
+  static constexpr std::size_t block_size = 16;
+
+  struct Block {
+    std::array<Slot, block_size> slots;
+    std::atomic<Block*> next{nullptr};
+  };
+
+  // `mutex_` serializes the allocation of blocks after `first_`.
+  std::mutex mutex_;
+  Block first_;
+
+ public:
+  ThreadSlots() = default;
+  ThreadSlots(const ThreadSlots&) = delete;
+  ThreadSlots& operator=(const ThreadSlots&) = delete;
+
+  ~ThreadSlots() {
+    Block* block = first_.next.load(std::memory_order_relaxed);
+    while (block) {
+      Block* const next = block->next.load(std::memory_order_relaxed);
+      delete block;
+      block = next;
+    }
+  }
+
+  // Return the calling thread's slot. The slot may be used only by the calling
+  // thread, until it exits.
+  Slot& local() {
+    std::size_t index = this_thread_index();
+    Block* block = &first_;
+    while (index >= block_size) {
+      Block* next = block->next.load(std::memory_order_acquire);
+      if (!next) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        next = block->next.load(std::memory_order_relaxed);
+        if (!next) {
+          next = new Block;
+          block->next.store(next, std::memory_order_release);
+        }
+      }
+      block = next;
+      index -= block_size;
+    }
+    return block->slots[index];
+  }
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -1,115 +1,178 @@
 #include "threaded_event_scheduler.h"
 
+#include <cstdint>
 #include <thread>
 
 #include "json.hpp"
+#include "random.h"
 
 namespace datadog {
 namespace tracing {
 
-ThreadedEventScheduler::EventConfig::EventConfig(
-    std::function<void()> callback,
-    std::chrono::steady_clock::duration interval)
-    : callback(callback), interval(interval), cancelled(false) {}
-
-bool ThreadedEventScheduler::GreaterThan::operator()(
-    const ScheduledRun& left, const ScheduledRun& right) const {
-  return left.when > right.when;
-}
-
 ThreadedEventScheduler::ThreadedEventScheduler()
-    : running_current_(false),
+    : ThreadedEventScheduler(Config{}) {}
+
+ThreadedEventScheduler::ThreadedEventScheduler(const Config& config)
+    : config_(config),
+      upcoming_(config.resolution, std::chrono::steady_clock::now()),
       shutting_down_(false),
-      dispatcher_([this]() { run(); }) {}
+      dispatcher_([this]() { dispatch(); }) {
+  for (std::size_t i = 0; i < config_.num_workers; ++i) {
+    workers_.emplace_back([this]() { work(); });
+  }
+}
 
 ThreadedEventScheduler::~ThreadedEventScheduler() {
   {
     std::lock_guard guard(mutex_);
     shutting_down_ = true;
     schedule_or_shutdown_.notify_one();
+    ready_or_shutdown_.notify_all();
   }
   dispatcher_.join();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
 }
 
 EventScheduler::Cancel ThreadedEventScheduler::schedule_recurring_event(
     std::chrono::steady_clock::duration interval,
     std::function<void()> callback) {
-  const auto now = std::chrono::steady_clock::now();
-  auto config = std::make_shared<EventConfig>(std::move(callback), interval);
+  return schedule(interval, interval, std::move(callback));
+}
+
+EventScheduler::Cancel ThreadedEventScheduler::schedule_event(
+    std::chrono::steady_clock::duration delay, std::function<void()> callback) {
+  return schedule(delay, std::chrono::steady_clock::duration::zero(),
+                  std::move(callback));
+}
+
+EventScheduler::Cancel ThreadedEventScheduler::schedule(
+    std::chrono::steady_clock::duration delay,
+    std::chrono::steady_clock::duration interval,
+    std::function<void()> callback) {
+  auto event = std::make_shared<Event>();
+  event->callback = std::move(callback);
+  event->interval = interval;
 
   {
     std::lock_guard<std::mutex> guard(mutex_);
-    upcoming_.push(ScheduledRun{now + interval, config});
+    event->next = std::chrono::steady_clock::now() + delay;
+    add_upcoming(event);
     schedule_or_shutdown_.notify_one();
   }
 
-  // Return a cancellation function.
-  return [this, config = std::move(config)]() mutable {
-    if (!config) {
+  // Return a cancellation function. It waits for any running invocation of
+  // the callback to finish, unless it's called by that invocation.
+  return [this, event = std::move(event)]() mutable {
+    if (!event) {
       return;
     }
 
     std::unique_lock<std::mutex> lock(mutex_);
-    config->cancelled = true;
-    current_done_.wait(lock, [this, &config]() {
-      return !running_current_ || current_.config != config;
-    });
-    config.reset();
+    event->cancelled = true;
+    if (event->worker != std::this_thread::get_id()) {
+      event_done_.wait(lock, [&event]() { return !event->running; });
+    }
+    event.reset();
   };
 }
 
+void ThreadedEventScheduler::add_upcoming(const std::shared_ptr<Event>& event) {
+  auto when = event->next;
+  if (config_.max_jitter > 0 &&
+      event->interval > std::chrono::steady_clock::duration::zero()) {
+    const double fraction = config_.max_jitter *
+                            static_cast<double>(random_uint64() >> 11) /
+                            static_cast<double>(std::uint64_t(1) << 53);
+    when += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        event->interval * fraction);
+  }
+  upcoming_.add(when, event);
+}
+
 std::string ThreadedEventScheduler::config() const {
   return nlohmann::json::object(
-             {{"type", "datadog::tracing::ThreadedEventScheduler"}})
+             {{"type", "datadog::tracing::ThreadedEventScheduler"},
+              {"config",
+               nlohmann::json::object(
+                   {{"num_workers", workers_.size()},
+                    {"resolution_milliseconds",
+                     std::chrono::duration_cast<std::chrono::milliseconds>(
+                         config_.resolution)
+                         .count()},
+                    {"max_jitter", config_.max_jitter}})}})
       .dump();
 }
 
-void ThreadedEventScheduler::run() {
+void ThreadedEventScheduler::dispatch() {
   std::unique_lock<std::mutex> lock(mutex_);
 
-  for (;;) {
-    schedule_or_shutdown_.wait(
-        lock, [this]() { return shutting_down_ || !upcoming_.empty(); });
-    if (shutting_down_) {
-      return;
+  while (!shutting_down_) {
+    const auto now = std::chrono::steady_clock::now();
+    for (auto& event : upcoming_.advance(now)) {
+      if (event->cancelled) {
+        continue;
+      }
+      if (event->interval > std::chrono::steady_clock::duration::zero()) {
+        // Skip any recurrences that are already past, e.g. if the system was
+        // suspended.
+        do {
+          event->next += event->interval;
+        } while (event->next <= now);
+        add_upcoming(event);
+      }
+      if (!event->ready && !event->running) {
+        event->ready = true;
+        ready_.push_back(std::move(event));
+        ready_or_shutdown_.notify_one();
+      }
     }
 
-    current_ = upcoming_.top();
+    if (workers_.empty()) {
+      while (!shutting_down_ && !ready_.empty()) {
+        run_next_ready(lock);
+      }
+    }
 
-    if (current_.config->cancelled) {
-      upcoming_.pop();
-      continue;
+    if (const auto next = upcoming_.next_due()) {
+      schedule_or_shutdown_.wait_until(lock, *next);
+    } else {
+      schedule_or_shutdown_.wait(lock);
     }
+  }
+}
 
-    const bool changed =
-        schedule_or_shutdown_.wait_until(lock, current_.when, [this]() {
-          return shutting_down_ || upcoming_.top().config != current_.config;
-        });
+void ThreadedEventScheduler::work() {
+  std::unique_lock<std::mutex> lock(mutex_);
 
+  for (;;) {
+    ready_or_shutdown_.wait(
+        lock, [this]() { return shutting_down_ || !ready_.empty(); });
     if (shutting_down_) {
       return;
     }
+    run_next_ready(lock);
+  }
+}
 
-    if (changed) {
-      // A more recent event has been scheduled.
-      continue;
-    }
-
-    // We waited for `current_` and now it's its turn.
-    upcoming_.pop();
-    if (current_.config->cancelled) {
-      continue;
-    }
-
-    upcoming_.push(ScheduledRun{current_.when + current_.config->interval,
-                                current_.config});
-    running_current_ = true;
-    lock.unlock();
-    current_.config->callback();
-    lock.lock();
-    running_current_ = false;
-    current_done_.notify_all();
+void ThreadedEventScheduler::run_next_ready(
+    std::unique_lock<std::mutex>& lock) {
+  const auto event = std::move(ready_.front());
+  ready_.pop_front();
+  event->ready = false;
+  if (event->cancelled) {
+    return;
   }
+
+  event->running = true;
+  event->worker = std::this_thread::get_id();
+  lock.unlock();
+  event->callback();
+  lock.lock();
+  event->running = false;
+  event->worker = std::thread::id();
+  event_done_.notify_all();
 }
 
 }  // namespace tracing
@@ -3,59 +3,106 @@
 // The `ThreadedEventScheduler` class implements the `EventScheduler` interface
 // in terms of a dedicated event dispatching thread. It is the default
 // implementation used if `DatadogAgent::event_scheduler` is not specified.
+//
+// Scheduled events are kept in a `TimerWheel` (see `timer_wheel.h`), so events
+// due within the same tick of `resolution` are dispatched by a single wakeup
+// of the dispatching thread.
+//
+// By default, the dispatching thread runs the callbacks itself, so a slow
+// callback delays the events due after it. If `Config::num_workers` is
+// nonzero, then the dispatching thread instead hands due events to that many
+// worker threads, so that a slow callback, such as a large flush, delays
+// neither the dispatching of other events nor their callbacks, unless all of
+// the workers are busy.
+//
+// A callback is never invoked again while a previous invocation is still
+// running. If a recurring event is due while its callback is still running or
+// waiting for a worker, then that recurrence is skipped. Callbacks of
+// different events may run concurrently.
 
 #include <datadog/event_scheduler.h>
 
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 
+#include "timer_wheel.h"
+
 namespace datadog {
 namespace tracing {
 
 class ThreadedEventScheduler : public EventScheduler {
-  struct EventConfig {
-    std::function<void()> callback;
-    std::chrono::steady_clock::duration interval;
-    bool cancelled;
-
-    EventConfig(std::function<void()> callback,
-                std::chrono::steady_clock::duration interval);
-  };
-
-  struct ScheduledRun {
-    std::chrono::steady_clock::time_point when;
-    std::shared_ptr<const EventConfig> config;
+ public:
+  struct Config {
+    // The number of threads that run callbacks. If zero, the dispatching
+    // thread runs them.
+    std::size_t num_workers = 0;
+    // Events due within the same `resolution` are dispatched together.
+    std::chrono::steady_clock::duration resolution =
+        std::chrono::milliseconds(10);
+    // Each recurrence of a recurring event is delayed by a random fraction of
+    // its interval, up to `max_jitter`, so that processes started at the same
+    // time don't perform their recurring work in lockstep. The delay does not
+    // accumulate from one recurrence to the next.
+    double max_jitter = 0;
   };
 
-  struct GreaterThan {
-    bool operator()(const ScheduledRun&, const ScheduledRun&) const;
+ private:
+  struct Event {
+    std::function<void()> callback;
+    // `interval` is zero for a one-shot event.
+    std::chrono::steady_clock::duration interval;
+    // When the event is next due, before any jitter.
+    std::chrono::steady_clock::time_point next;
+    bool cancelled = false;
+    // Whether the event is in `ready_`.
+    bool ready = false;
+    // Whether a thread is running `callback`, and which one.
+    bool running = false;
+    std::thread::id worker;
   };
 
+  Config config_;
   std::mutex mutex_;
-  ScheduledRun current_;
   std::condition_variable schedule_or_shutdown_;
-  bool running_current_;
-  std::condition_variable current_done_;
-  std::priority_queue<ScheduledRun, std::vector<ScheduledRun>, GreaterThan>
-      upcoming_;
+  std::condition_variable ready_or_shutdown_;
+  std::condition_variable event_done_;
+  TimerWheel<std::shared_ptr<Event>> upcoming_;
+  std::deque<std::shared_ptr<Event>> ready_;
   bool shutting_down_;
   std::thread dispatcher_;
+  std::vector<std::thread> workers_;
 
-  void run();
+  Cancel schedule(std::chrono::steady_clock::duration delay,
+                  std::chrono::steady_clock::duration interval,
+                  std::function<void()> callback);
+  // Add the specified `event` to `upcoming_` at its next due time, plus any
+  // jitter. The behavior is undefined unless `mutex_` is locked.
+  void add_upcoming(const std::shared_ptr<Event>& event);
+  void dispatch();
+  void work();
+  // Remove the first event from `ready_` and, unless it's cancelled, invoke
+  // its callback with `lock` released. The behavior is undefined unless
+  // `lock` owns `mutex_` and `ready_` is not empty.
+  void run_next_ready(std::unique_lock<std::mutex>& lock);
 
  public:
   ThreadedEventScheduler();
+  explicit ThreadedEventScheduler(const Config& config);
   ~ThreadedEventScheduler();
 
   Cancel schedule_recurring_event(std::chrono::steady_clock::duration interval,
                                   std::function<void()> callback) override;
 
+  Cancel schedule_event(std::chrono::steady_clock::duration delay,
+                        std::function<void()> callback) override;
+
   std::string config() const override;
 };
 
@@ -0,0 +1,186 @@
+#pragma once
+
+// This component provides a class template, `TimerWheel`, that holds values
+// until a time at which each is due. `ThreadedEventScheduler` uses a
+// `TimerWheel` of its scheduled events.
+//
+// `TimerWheel` is a hierarchical timing wheel. Time is divided into ticks of a
+// fixed resolution, and timers due within the same tick are due together, so
+// that they're dispatched by a single wakeup. The wheel has `num_levels`
+// levels of `num_slots` slots each. A slot of the lowest level holds the
+// timers due at one tick, and a slot of each higher level holds the timers
+// due within `num_slots` times the span of a slot of the level below. When
+// the time reaches the beginning of a higher level's slot, its timers are
+// redistributed among the lower levels. Adding a timer and expiring a timer
+// take constant time, no matter how many timers there are. Timers due beyond
+// the span of the highest level wait in an overflow list.
+//
+// `TimerWheel` is not safe to use from multiple threads. Timers cannot be
+// removed; the values of cancelled timers are expected to be ignored once due.
+
+#include <datadog/optional.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+template <typename Value>
+class TimerWheel {
+ public:
+  using Duration = std::chrono::steady_clock::duration;
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  static constexpr int slot_bits = 6;
+  static constexpr std::size_t num_slots = std::size_t(1) << slot_bits;
+  static constexpr int num_levels = 4;
+
+ private:
+  struct Timer {
+    std::uint64_t due;
+    Value value;
+  };
+
+  static constexpr std::uint64_t slot_mask = num_slots - 1;
+
+  Duration resolution_;
+  TimePoint origin_;
+  // The next tick to expire. Every timer due before it has expired.
+  std::uint64_t now_ = 0;
+  std::vector<Timer> slots_[num_levels][num_slots];
+  std::vector<Timer> overflow_;
+  std::size_t size_ = 0;
+
+  static int shift(int level) { return slot_bits * level; }
+
+  void insert(Timer&& timer) {
+    if (timer.due < now_) {
+      timer.due = now_;
+    }
+    for (int level = 0; level < num_levels; ++level) {
+      if ((timer.due >> shift(level + 1)) == (now_ >> shift(level + 1))) {
+        slots_[level][(timer.due >> shift(level)) & slot_mask].push_back(
+            std::move(timer));
+        return;
+      }
+    }
+    overflow_.push_back(std::move(timer));
+  }
+
+  // Move the timers of the higher levels' slots that begin at `now_` down to
+  // the lower levels.
+  void cascade() {
+    if ((now_ & ((std::uint64_t(1) << shift(num_levels)) - 1)) == 0) {
+      for (auto& timer : std::exchange(overflow_, {})) {
+        insert(std::move(timer));
+      }
+    }
+    for (int level = num_levels - 1; level > 0; --level) {
+      if ((now_ & ((std::uint64_t(1) << shift(level)) - 1)) != 0) {
+        continue;
+      }
+      auto& slot = slots_[level][(now_ >> shift(level)) & slot_mask];
+      for (auto& timer : std::exchange(slot, {})) {
+        insert(std::move(timer));
+      }
+    }
+  }
+
+  // Return the first tick, not before `now_`, at which a slot holding timers
+  // is either expired or cascaded. The behavior is undefined if there are no
+  // timers.
+  std::uint64_t next_tick() const {
+    for (int level = 0; level < num_levels; ++level) {
+      // The slot containing `now_` is yet to be cascaded if `now_` is at its
+      // beginning.
+      const bool pending =
+          (now_ & ((std::uint64_t(1) << shift(level)) - 1)) == 0;
+      const std::uint64_t first =
+          ((now_ >> shift(level)) & slot_mask) + (pending ? 0 : 1);
+      const std::uint64_t block = (now_ >> shift(level + 1))
+                                  << shift(level + 1);
+      for (std::uint64_t index = first; index < num_slots; ++index) {
+        if (!slots_[level][index].empty()) {
+          return std::max(now_, block + (index << shift(level)));
+        }
+      }
+    }
+    // Only the overflow list has timers.
+    if ((now_ & ((std::uint64_t(1) << shift(num_levels)) - 1)) == 0) {
+      return now_;
+    }
+    return ((now_ >> shift(num_levels)) + 1) << shift(num_levels);
+  }
+
+  TimePoint time_of(std::uint64_t tick) const {
+    return origin_ + resolution_ * static_cast<Duration::rep>(tick);
+  }
+
+ public:
+  // Create a wheel whose ticks have the specified `resolution`, starting at
+  // the specified `origin`.
+  TimerWheel(Duration resolution, TimePoint origin)
+      : resolution_(resolution), origin_(origin) {}
+
+  // Add a timer for the specified `value`, due at the specified `when`. A
+  // timer is due at the end of the tick containing `when`, never earlier.
+  void add(TimePoint when, Value value) {
+    std::uint64_t due = 0;
+    if (when > origin_) {
+      due = static_cast<std::uint64_t>(
+          (when - origin_ + resolution_ - Duration(1)) / resolution_);
+    }
+    insert(Timer{due, std::move(value)});
+    ++size_;
+  }
+
+  // Remove and return the values of the timers due at the specified `now`, in
+  // the order of their due times.
+  std::vector<Value> advance(TimePoint now) {
+    std::vector<Value> due;
+    if (now < origin_) {
+      return due;
+    }
+    const auto target =
+        static_cast<std::uint64_t>((now - origin_) / resolution_);
+    while (now_ <= target) {
+      if (size_ == 0) {
+        now_ = target + 1;
+        break;
+      }
+      cascade();
+      for (auto& timer : std::exchange(slots_[0][now_ & slot_mask], {})) {
+        due.push_back(std::move(timer.value));
+        --size_;
+      }
+      ++now_;
+      if (size_ != 0) {
+        // Skip the ticks at which nothing would happen.
+        now_ = std::max(now_, std::min(next_tick(), target + 1));
+      }
+    }
+    return due;
+  }
+
+  // Return the time by which `advance` must next be called for timers to
+  // expire on time, or null if there are no timers. The returned time might
+  // be earlier than when the next timer is due, since the timers of a higher
+  // level slot are not sorted.
+  Optional<TimePoint> next_due() const {
+    if (size_ == 0) {
+      return nullopt;
+    }
+    return time_of(next_tick());
+  }
+
+  // Return the number of timers.
+  std::size_t size() const { return size_; }
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,79 @@
+#include "trace_arena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// Blocks begin small, so that short traces use little memory, and double in
+// size up to a limit.
+constexpr std::size_t initial_block_size = 4 * 1024;
+constexpr std::size_t max_block_size = 64 * 1024;
+
+constexpr std::size_t max_alignment = alignof(std::max_align_t);
+
+std::size_t align_up(std::size_t value, std::size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
+TraceArena::TraceArena()
+    : references_(1), next_block_size_(initial_block_size) {}
+
+TraceArena::~TraceArena() {
+  while (blocks_) {
+    Block* const previous = blocks_->previous;
+    ::operator delete(blocks_);
+    blocks_ = previous;
+  }
+}
+
+std::unique_ptr<TraceArena, TraceArena::Release> TraceArena::make() {
+  return std::unique_ptr<TraceArena, Release>(new TraceArena());
+}
+
+void TraceArena::retain() {
+  references_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TraceArena::release() {
+  if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+void TraceArena::add_block(std::size_t minimum_size) {
+  const std::size_t header_size = align_up(sizeof(Block), max_alignment);
+  const std::size_t size =
+      std::max(next_block_size_, header_size + minimum_size);
+  next_block_size_ = std::min(next_block_size_ * 2, max_block_size);
+
+  Block* const block = static_cast<Block*>(::operator new(size));
+  block->previous = blocks_;
+  blocks_ = block;
+  next_ = reinterpret_cast<char*>(block) + header_size;
+  end_ = reinterpret_cast<char*>(block) + size;
+}
+
+void* TraceArena::allocate(std::size_t size, std::size_t alignment) {
+  assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+  assert(alignment <= max_alignment);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(next_);
+  std::size_t padding = align_up(address, alignment) - address;
+  if (!next_ || std::size_t(end_ - next_) < padding + size) {
+    add_block(size);
+    padding = 0;
+  }
+  char* const result = next_ + padding;
+  next_ = result + size;
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,124 @@
+#pragma once
+
+// This component provides a class, `TraceArena`, from which the spans of a
+// trace segment and their tags can be allocated, and an allocator,
+// `ArenaAllocator`, that allocates from a `TraceArena` when it has one.
+//
+// Each span would otherwise cost many small heap allocations: the `SpanData`
+// itself, and a node for each of its tags. A `TraceArena` instead carves
+// allocations out of a few large blocks, and frees the blocks all at once
+// when the arena is no longer referenced. Memory given back to the arena
+// before then is not reused.
+//
+// A `TraceArena` is referenced by each `SpanData` allocated from it. The arena
+// is destroyed when the last of those spans is destroyed, which is typically
+// after its trace chunk is serialized by the `Collector`.
+//
+// A `TraceArena` may be allocated from by multiple threads concurrently.
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+namespace datadog {
+namespace tracing {
+
+class TraceArena {
+  struct Block {
+    Block* previous;
+  };
+
+  std::mutex mutex_;
+  std::atomic<std::size_t> references_;
+  Block* blocks_ = nullptr;
+  // The unused part of the most recent block.
+  char* next_ = nullptr;
+  char* end_ = nullptr;
+  std::size_t next_block_size_;
+
+  TraceArena();
+  ~TraceArena();
+
+  void add_block(std::size_t minimum_size);
+
+ public:
+  // `Release` is a deleter that releases a reference to an arena.
+  struct Release {
+    void operator()(TraceArena* arena) const { arena->release(); }
+  };
+
+  // Return a new arena, having one reference that is released when the
+  // returned pointer is destroyed.
+  static std::unique_ptr<TraceArena, Release> make();
+
+  TraceArena(const TraceArena&) = delete;
+  TraceArena& operator=(const TraceArena&) = delete;
+
+  void retain();
+  // Release a reference to this arena. Destroy the arena, freeing all memory
+  // allocated from it, if that was the last reference.
+  void release();
+
+  // Return storage for `size` bytes aligned to `alignment`, which must be a
+  // power of two no greater than `alignof(std::max_align_t)`.
+  void* allocate(std::size_t size, std::size_t alignment);
+};
+
+// `ArenaAllocator` is an allocator that allocates from a `TraceArena`, if it
+// has one, or from the heap otherwise. Containers using it keep the allocator
+// they were constructed with: it does not propagate on assignment or swap, and
+// a copy of a container allocates from the heap.
+template <typename Value>
+class ArenaAllocator {
+  template <typename Other>
+  friend class ArenaAllocator;
+
+  TraceArena* arena_;
+
+ public:
+  using value_type = Value;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::false_type;
+  using propagate_on_container_swap = std::false_type;
+
+  ArenaAllocator() noexcept : arena_(nullptr) {}
+  explicit ArenaAllocator(TraceArena* arena) noexcept : arena_(arena) {}
+  template <typename Other>
+  ArenaAllocator(const ArenaAllocator<Other>& other) noexcept
+      : arena_(other.arena_) {}
+
+  TraceArena* arena() const noexcept { return arena_; }
+
+  Value* allocate(std::size_t count) {
+    if (arena_) {
+      return static_cast<Value*>(
+          arena_->allocate(count * sizeof(Value), alignof(Value)));
+    }
+    return static_cast<Value*>(::operator new(count * sizeof(Value)));
+  }
+
+  void deallocate(Value* pointer, std::size_t) noexcept {
+    if (!arena_) {
+      ::operator delete(pointer);
+    }
+  }
+
+  ArenaAllocator select_on_container_copy_construction() const noexcept {
+    return ArenaAllocator();
+  }
+
+  template <typename Other>
+  bool operator==(const ArenaAllocator<Other>& other) const noexcept {
+    return arena_ == other.arena_;
+  }
+  template <typename Other>
+  bool operator!=(const ArenaAllocator<Other>& other) const noexcept {
+    return arena_ != other.arena_;
+  }
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -14,22 +14,28 @@
 
 namespace datadog {
 namespace tracing {
-
 nlohmann::json to_json(const TraceSamplerRule& rule) {
   nlohmann::json j = rule.matcher;
   j["sample_rate"] = rule.rate.value();
   return j;
 }
 
+TraceSampler::Rules::Rules(std::vector<TraceSamplerRule> sampling_rules)
+    : rules(std::move(sampling_rules)) {
+  for (const auto& rule : rules) {
+    index.add(rule.matcher);
+  }
+}
+
 TraceSampler::TraceSampler(const FinalizedTraceSamplerConfig& config,
                            const Clock& clock)
-    : rules_(config.rules),
+    : agent_rates_(std::make_shared<const AgentSampleRates>()),
+      rules_(std::make_shared<const Rules>(config.rules)),
       limiter_(clock, config.max_per_second),
       limiter_max_per_second_(config.max_per_second) {}
 
 void TraceSampler::set_rules(std::vector<TraceSamplerRule> rules) {
-  std::lock_guard lock(mutex_);
-  rules_ = std::move(rules);
+  rules_.publish(std::make_shared<const Rules>(std::move(rules)));
 }
 
 SamplingDecision TraceSampler::decide(const SpanData& span) {
@@ -37,22 +43,17 @@ SamplingDecision TraceSampler::decide(const SpanData& span) {
   decision.origin = SamplingDecision::Origin::LOCAL;
 
   // First check sampling rules.
-  const auto found_rule =
-      std::find_if(rules_.cbegin(), rules_.cend(),
-                   [&](const auto& it) { return it.matcher.match(span); });
-
-  // `mutex_` protects `limiter_`, `collector_sample_rates_`, and
-  // `collector_default_sample_rate_`, so let's lock it here.
-  std::lock_guard lock(mutex_);
-
-  if (found_rule != rules_.end()) {
-    const auto& rule = *found_rule;
+  const Rules& rules = rules_.get();
+  if (const auto found_rule = rules.index.find(span)) {
+    const auto& rule = rules.rules[*found_rule];
     decision.mechanism = int(rule.mechanism);
     decision.limiter_max_per_second = limiter_max_per_second_;
     decision.configured_rate = rule.rate;
-    const std::uint64_t threshold = max_id_from_rate(rule.rate);
+    const bool bypass_limiter = rule.bypass_limiter;
+
+    const std::uint64_t threshold = max_id_from_rate(*decision.configured_rate);
     if (knuth_hash(span.trace_id.low) <= threshold) {
-      if (rule.bypass_limiter) {
+      if (bypass_limiter) {
         decision.priority = int(SamplingPriority::USER_KEEP);
         return decision;
       }
@@ -73,21 +74,19 @@ SamplingDecision TraceSampler::decide(const SpanData& span) {
 
   // No sampling rule matched. Find the appropriate collector-controlled
   // sample rate.
-  auto found_rate = collector_sample_rates_.find(
-      CollectorResponse::key(span.service, span.environment().value_or("")));
-  if (found_rate != collector_sample_rates_.end()) {
-    decision.configured_rate = found_rate->second;
+  const AgentSampleRates& agent_rates = agent_rates_.get();
+  if (const auto rate = agent_rates.find(
+          span.service, span.environment().value_or(""))) {
+    decision.configured_rate = *rate;
+    decision.mechanism = int(SamplingMechanism::AGENT_RATE);
+  } else if (const auto& default_rate = agent_rates.default_rate()) {
+    decision.configured_rate = *default_rate;
     decision.mechanism = int(SamplingMechanism::AGENT_RATE);
   } else {
-    if (collector_default_sample_rate_) {
-      decision.configured_rate = *collector_default_sample_rate_;
-      decision.mechanism = int(SamplingMechanism::AGENT_RATE);
-    } else {
-      // We have yet to receive a default rate from the collector. This
-      // corresponds to the `DEFAULT` sampling mechanism.
-      decision.configured_rate = Rate::one();
-      decision.mechanism = int(SamplingMechanism::DEFAULT);
-    }
+    // We have yet to receive a default rate from the collector. This
+    // corresponds to the `DEFAULT` sampling mechanism.
+    decision.configured_rate = Rate::one();
+    decision.mechanism = int(SamplingMechanism::DEFAULT);
   }
 
   const std::uint64_t threshold = max_id_from_rate(*decision.configured_rate);
@@ -102,20 +101,14 @@ SamplingDecision TraceSampler::decide(const SpanData& span) {
 
 void TraceSampler::handle_collector_response(
     const CollectorResponse& response) {
-  const auto found =
-      response.sample_rate_by_key.find(response.key_of_default_rate);
-  std::lock_guard<std::mutex> lock(mutex_);
-
-  if (found != response.sample_rate_by_key.end()) {
-    collector_default_sample_rate_ = found->second;
-  }
-
-  collector_sample_rates_ = response.sample_rate_by_key;
+  std::lock_guard<std::mutex> lock(update_mutex_);
+  agent_rates_.publish(std::make_shared<const AgentSampleRates>(
+      response, agent_rates_.get().default_rate()));
 }
 
 nlohmann::json TraceSampler::config_json() const {
   std::vector<nlohmann::json> rules;
-  for (const auto& rule : rules_) {
+  for (const auto& rule : rules_.get().rules) {
     rules.push_back(to_json(rule));
   }
 
@@ -89,11 +89,13 @@
 #include <datadog/trace_sampler_config.h>
 
 #include <mutex>
-#include <string>
-#include <unordered_map>
+#include <vector>
 
+#include "agent_sample_rates.h"
 #include "json.hpp"
 #include "limiter.h"
+#include "published.h"
+#include "span_matcher_index.h"
 
 namespace datadog {
 namespace tracing {
@@ -103,12 +105,19 @@ struct SamplingDecision;
 struct SpanData;
 
 class TraceSampler {
- private:
-  std::mutex mutex_;
+  struct Rules {
+    std::vector<TraceSamplerRule> rules;
+    SpanMatcherIndex index;
 
-  Optional<Rate> collector_default_sample_rate_;
-  std::unordered_map<std::string, Rate> collector_sample_rates_;
-  std::vector<TraceSamplerRule> rules_;
+    explicit Rules(std::vector<TraceSamplerRule>);
+  };
+
+  // `update_mutex_` serializes updates to `agent_rates_`. Sampling decisions
+  // read `rules_` and `agent_rates_` without locking.
+  std::mutex update_mutex_;
+
+  Published<AgentSampleRates> agent_rates_;
+  Published<Rules> rules_;
   Limiter limiter_;
   double limiter_max_per_second_;
 
@@ -53,6 +53,30 @@ int Cache::process_id;
 // `cache_singleton.process_id`.
 Cache cache_singleton;
 
+// Telemetry counters that are incremented for every span or trace segment.
+namespace counters {
+const telemetry::counter::Handle spans_created{metrics::tracer::spans_created,
+                                               {"integration_name:datadog"}};
+const telemetry::counter::Handle spans_finished{metrics::tracer::spans_finished,
+                                                {"integration_name:datadog"}};
+const telemetry::counter::Handle spans_dropped_p0{
+    metrics::tracer::spans_dropped, {"reason:p0_drop"}};
+const telemetry::counter::Handle trace_chunks_enqueued{
+    metrics::tracer::trace_chunks_enqueued};
+const telemetry::counter::Handle trace_chunks_dropped_p0{
+    metrics::tracer::trace_chunks_dropped, {"reason:p0_drop"}};
+const telemetry::counter::Handle trace_chunks_sent{
+    metrics::tracer::trace_chunks_sent};
+const telemetry::counter::Handle trace_segments_closed{
+    metrics::tracer::trace_segments_closed};
+const telemetry::counter::Handle injected_datadog{
+    metrics::tracer::trace_context::injected, {"header_style:datadog"}};
+const telemetry::counter::Handle injected_b3{
+    metrics::tracer::trace_context::injected, {"header_style:b3multi"}};
+const telemetry::counter::Handle injected_tracecontext{
+    metrics::tracer::trace_context::injected, {"header_style:tracecontext"}};
+}  // namespace counters
+
 // Encode the specified `trace_tags`. If the encoded value is not longer than
 // the specified `tags_header_max_size`, then set it as the "x-datadog-tags"
 // header using the specified `writer`. If the encoded value is oversized, then
@@ -61,8 +85,7 @@ Cache cache_singleton;
 void inject_trace_tags(
     DictWriter& writer,
     const std::vector<std::pair<std::string, std::string>>& trace_tags,
-    std::size_t tags_header_max_size,
-    std::unordered_map<std::string, std::string>& local_root_tags,
+    std::size_t tags_header_max_size, SpanTags& local_root_tags,
     Logger& logger) {
   const std::string encoded_trace_tags = encode_tags(trace_tags);
 
@@ -112,8 +135,7 @@ void maybe_calculate_http_endpoint(HttpEndpointCalculationMode renaming_mode,
 
 // If `local_root_tags` contains the `tags::internal::trace_source` tag,
 // return its value; otherwise return `nullopt`.
-Optional<std::string> find_trace_source_tag(
-    const std::unordered_map<std::string, std::string>& local_root_tags) {
+Optional<std::string> find_trace_source_tag(const SpanTags& local_root_tags) {
   const auto trace_source_tag_found =
       local_root_tags.find(tags::internal::trace_source);
   if (trace_source_tag_found == local_root_tags.cend()) {
@@ -202,6 +224,11 @@ TraceSegment::TraceSegment(
 
 const SpanDefaults& TraceSegment::defaults() const { return *defaults_; }
 
+const std::shared_ptr<const SpanDefaults>& TraceSegment::shared_defaults()
+    const {
+  return defaults_;
+}
+
 const Optional<std::string>& TraceSegment::hostname() const {
   return hostname_;
 }
@@ -243,8 +270,7 @@ Optional<std::pair<std::string, std::uint32_t>> TraceSegment::w3c_link_context(
 Logger& TraceSegment::logger() const { return *logger_; }
 
 void TraceSegment::register_span(std::unique_ptr<SpanData> span) {
-  telemetry::counter::increment(metrics::tracer::spans_created,
-                                {"integration_name:datadog"});
+  telemetry::counter::increment(counters::spans_created);
 
   std::lock_guard<std::mutex> lock(mutex_);
   assert(spans_.empty() || num_finished_spans_ < spans_.size());
@@ -253,8 +279,7 @@ void TraceSegment::register_span(std::unique_ptr<SpanData> span) {
 
 void TraceSegment::span_finished() {
   {
-    telemetry::counter::increment(metrics::tracer::spans_finished,
-                                  {"integration_name:datadog"});
+    telemetry::counter::increment(counters::spans_finished);
     std::lock_guard<std::mutex> lock(mutex_);
     ++num_finished_spans_;
     assert(num_finished_spans_ <= spans_.size());
@@ -263,7 +288,7 @@ void TraceSegment::span_finished() {
     }
   }
 
-  telemetry::counter::increment(metrics::tracer::trace_chunks_enqueued);
+  telemetry::counter::increment(counters::trace_chunks_enqueued);
 
   // We don't need the lock anymore. There's nobody left to call our methods.
   // On the other hand, there's nobody left to contend for the mutex, so it
@@ -274,8 +299,7 @@ void TraceSegment::span_finished() {
   // All of our spans are finished. Run the span sampler, finalize the spans,
   // and then send the spans to the collector.
   if (sampling_decision_->priority <= 0) {
-    telemetry::counter::increment(metrics::tracer::trace_chunks_dropped,
-                                  {"reason:p0_drop"});
+    telemetry::counter::increment(counters::trace_chunks_dropped_p0);
     // Span sampling happens when the trace is dropped.
     for (const auto& span_ptr : spans_) {
       SpanData& span = *span_ptr;
@@ -285,8 +309,7 @@ void TraceSegment::span_finished() {
       }
       const SamplingDecision decision = rule->decide(span);
       if (decision.priority <= 0) {
-        telemetry::counter::increment(metrics::tracer::spans_dropped,
-                                      {"reason:p0_drop"});
+        telemetry::counter::increment(counters::spans_dropped_p0);
         continue;
       }
 
@@ -328,18 +351,21 @@ void TraceSegment::span_finished() {
     }
   }
 
-  // Some tags are repeated on all spans.
+  // Some tags are repeated on all spans. The spans share one copy of them.
+  auto segment_tags = std::make_shared<SharedSpanTags>();
+  if (!tracing_enabled_) {
+    segment_tags->numeric_tags.emplace_back(tags::internal::apm_enabled, 0);
+  }
+  if (origin_) {
+    segment_tags->tags.emplace_back(tags::internal::origin, *origin_);
+  }
+  segment_tags->numeric_tags.emplace_back(tags::internal::process_id,
+                                          Cache::process_id);
+  segment_tags->tags.emplace_back(tags::internal::language, "cpp");
+  segment_tags->tags.emplace_back(tags::internal::runtime_id,
+                                  runtime_id_.string());
   for (const auto& span_ptr : spans_) {
-    SpanData& span = *span_ptr;
-    if (!tracing_enabled_) {
-      span.numeric_tags[tags::internal::apm_enabled] = 0;
-    }
-    if (origin_) {
-      span.tags[tags::internal::origin] = *origin_;
-    }
-    span.numeric_tags[tags::internal::process_id] = Cache::process_id;
-    span.tags[tags::internal::language] = "cpp";
-    span.tags[tags::internal::runtime_id] = runtime_id_.string();
+    span_ptr->segment_tags = segment_tags;
   }
 
   maybe_calculate_http_endpoint(resource_renaming_mode_, local_root);
@@ -348,7 +374,7 @@ void TraceSegment::span_finished() {
     telemetry::distribution::add(metrics::tracer::trace_chunk_size,
                                  spans_.size());
 
-    telemetry::counter::increment(metrics::tracer::trace_chunks_sent);
+    telemetry::counter::increment(counters::trace_chunks_sent);
     const auto result = collector_->send(std::move(spans_), trace_sampler_);
     if (auto* error = result.if_error()) {
       logger_->log_error(
@@ -356,7 +382,7 @@ void TraceSegment::span_finished() {
     }
   }
 
-  telemetry::counter::increment(metrics::tracer::trace_segments_closed);
+  telemetry::counter::increment(counters::trace_segments_closed);
 }
 
 void TraceSegment::override_sampling_priority(SamplingPriority priority) {
@@ -453,8 +479,7 @@ bool TraceSegment::inject(DictWriter& writer, const SpanData& span,
     trace_tags = trace_tags_;
   }
 
-  std::unordered_map<std::string, std::string>& local_root_tags =
-      spans_.front()->tags;
+  SpanTags& local_root_tags = spans_.front()->tags;
 
   const Optional<std::string> trace_source_tag =
       find_trace_source_tag(local_root_tags);
@@ -499,8 +524,7 @@ bool TraceSegment::inject(DictWriter& writer, const SpanData& span,
         inject_trace_tags(writer, trace_tags, tags_header_max_size_,
                           local_root_tags, *logger_);
 
-        telemetry::counter::increment(metrics::tracer::trace_context::injected,
-                                      {"header_style:datadog"});
+        telemetry::counter::increment(counters::injected_datadog);
         break;
       case PropagationStyle::B3:
         if (span.trace_id.high) {
@@ -515,8 +539,7 @@ bool TraceSegment::inject(DictWriter& writer, const SpanData& span,
         }
         inject_trace_tags(writer, trace_tags, tags_header_max_size_,
                           local_root_tags, *logger_);
-        telemetry::counter::increment(metrics::tracer::trace_context::injected,
-                                      {"header_style:b3multi"});
+        telemetry::counter::increment(counters::injected_b3);
         break;
       case PropagationStyle::W3C:
         writer.set(
@@ -527,8 +550,7 @@ bool TraceSegment::inject(DictWriter& writer, const SpanData& span,
             encode_tracestate(span.span_id, sampling_priority, origin_,
                               trace_tags, additional_datadog_w3c_tracestate_,
                               additional_w3c_tracestate_));
-        telemetry::counter::increment(metrics::tracer::trace_context::injected,
-                                      {"header_style:tracecontext"});
+        telemetry::counter::increment(counters::injected_tracecontext);
         break;
       default:
         break;
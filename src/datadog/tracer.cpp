@@ -38,6 +38,27 @@ namespace fs = std::filesystem;
 
 namespace datadog {
 namespace tracing {
+namespace {
+
+namespace counters {
+const telemetry::counter::Handle trace_segments_new{
+    metrics::tracer::trace_segments_created, {"new_continued:new"}};
+const telemetry::counter::Handle trace_segments_continued{
+    metrics::tracer::trace_segments_created, {"new_continued:continued"}};
+}  // namespace counters
+
+// Return the data for the local root span of a new trace segment. If
+// `use_trace_arena` is true, the span is allocated from a new arena, which the
+// other spans of the segment share, and which the spans keep alive.
+std::unique_ptr<SpanData> make_local_root(bool use_trace_arena) {
+  if (!use_trace_arena) {
+    return std::make_unique<SpanData>();
+  }
+  const auto arena = TraceArena::make();
+  return SpanData::make(arena.get());
+}
+
+}  // namespace
 
 void to_json(nlohmann::json& j, const PropagationStyle& style) {
   j = to_string_view(style);
@@ -69,7 +90,8 @@ Tracer::Tracer(const FinalizedTracerConfig& config,
       baggage_injection_enabled_(false),
       baggage_extraction_enabled_(false),
       tracing_enabled_(config.tracing_enabled),
-      resource_renaming_mode_(config.resource_renaming_mode) {
+      resource_renaming_mode_(config.resource_renaming_mode),
+      use_trace_arena_(config.use_trace_arena) {
   telemetry::init(config.telemetry, signature_, logger_, config.http_client,
                   config.event_scheduler, config.agent_url);
   if (config.report_hostname) {
@@ -139,6 +161,7 @@ std::string Tracer::config() const {
     {"injection_styles", injection_styles_},
     {"extraction_styles", extraction_styles_},
     {"tags_header_size", tags_header_max_size_},
+    {"use_trace_arena", use_trace_arena_},
     {"environment_variables", nlohmann::json::parse(environment::to_json())},
     {"baggage", nlohmann::json{
       {"max_bytes", baggage_opts_.max_bytes},
@@ -228,8 +251,8 @@ Span Tracer::create_span() { return create_span(SpanConfig{}); }
 
 Span Tracer::create_span(const SpanConfig& config) {
   auto defaults = config_manager_->span_defaults();
-  auto span_data = std::make_unique<SpanData>();
-  span_data->apply_config(*defaults, config, clock_);
+  auto span_data = make_local_root(use_trace_arena_);
+  span_data->apply_config(defaults, config, clock_);
   span_data->trace_id = generator_->trace_id(span_data->start);
   span_data->span_id = span_data->trace_id.low;
   span_data->parent_id = 0;
@@ -241,8 +264,7 @@ Span Tracer::create_span(const SpanConfig& config) {
   }
 
   const auto span_data_ptr = span_data.get();
-  telemetry::counter::increment(metrics::tracer::trace_segments_created,
-                                {"new_continued:new"});
+  telemetry::counter::increment(counters::trace_segments_new);
   const auto segment = std::make_shared<TraceSegment>(
       logger_, collector_, config_manager_->trace_sampler(), span_sampler_,
       defaults, config_manager_, runtime_id_, injection_styles_, hostname_,
@@ -273,7 +295,7 @@ Expected<Span> Tracer::extract_span(const DictReader& reader,
 
   AuditedReader audited_reader{reader};
 
-  auto span_data = std::make_unique<SpanData>();
+  auto span_data = make_local_root(use_trace_arena_);
   Optional<PropagationStyle> first_style_with_trace_id;
   Optional<PropagationStyle> first_style_with_parent_id;
   std::unordered_map<PropagationStyle, ExtractedData> extracted_contexts;
@@ -401,7 +423,7 @@ Expected<Span> Tracer::extract_span(const DictReader& reader,
 
   // We're done extracting fields. Now create the span.
   // This is similar to what we do in `create_span`.
-  span_data->apply_config(*config_manager_->span_defaults(), config, clock_);
+  span_data->apply_config(config_manager_->span_defaults(), config, clock_);
   span_data->span_id = generator_->span_id();
   span_data->trace_id = *merged_context.trace_id;
   span_data->parent_id = *merged_context.parent_id;
@@ -475,8 +497,7 @@ Expected<Span> Tracer::extract_span(const DictReader& reader,
       }
 
       const auto span_data_ptr = span_data.get();
-      telemetry::counter::increment(metrics::tracer::trace_segments_created,
-                                    {"new_continued:continued"});
+      telemetry::counter::increment(counters::trace_segments_continued);
       const auto segment = std::make_shared<TraceSegment>(
           logger_, collector_, config_manager_->trace_sampler(), span_sampler_,
           config_manager_->span_defaults(), config_manager_, runtime_id_,
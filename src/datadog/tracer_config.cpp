@@ -424,6 +424,7 @@ Expected<FinalizedTracerConfig> finalize_config(const TracerConfig &user_config,
   final_config.runtime_id = user_config.runtime_id;
   final_config.root_session_id = user_config.root_session_id;
   final_config.process_tags = user_config.process_tags;
+  final_config.use_trace_arena = user_config.use_trace_arena.value_or(false);
 
   auto agent_finalized =
       finalize_config(user_config.agent, final_config.logger, clock);
@@ -458,7 +459,12 @@ Expected<FinalizedTracerConfig> finalize_config(const TracerConfig &user_config,
   final_config.agent_url = agent_finalized->url;
 
   if (user_config.event_scheduler == nullptr) {
-    final_config.event_scheduler = std::make_shared<ThreadedEventScheduler>();
+    if (agent_finalized->shared_event_loop ||
+        agent_finalized->host_event_loop) {
+      final_config.event_scheduler = agent_finalized->event_scheduler;
+    } else {
+      final_config.event_scheduler = std::make_shared<ThreadedEventScheduler>();
+    }
   } else {
     final_config.event_scheduler = user_config.event_scheduler;
   }
@@ -472,6 +478,10 @@ Expected<FinalizedTracerConfig> finalize_config(const TracerConfig &user_config,
     final_config.telemetry.products.emplace_back(telemetry::Product{
         telemetry::Product::Name::tracing, true, tracer_version, nullopt,
         nullopt, final_config.metadata});
+    final_config.telemetry.compression_level =
+        agent_finalized->compression_level;
+    final_config.telemetry.compression_min_bytes =
+        agent_finalized->compression_min_bytes;
   } else {
     return std::move(telemetry_final_config.error());
   }
@@ -514,7 +524,8 @@ Expected<FinalizedTracerConfig> finalize_config(const TracerConfig &user_config,
   // Whether APM tracing is enabled. This affects whether the
   // "Datadog-Client-Computed-Stats: yes" header is sent with trace requests.
   if (!final_config.tracing_enabled) {
-    agent_finalized->stats_computation_enabled = !final_config.tracing_enabled;
+    agent_finalized->stats_computation_enabled = false;
+    agent_finalized->client_computed_stats = true;
 
     // Overwrite the trace sampler configuration with a specific trace sampler
     // configuration which:
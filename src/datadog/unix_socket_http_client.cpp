@@ -0,0 +1,982 @@
+#include "unix_socket_http_client.h"
+
+#include <datadog/dict_reader.h>
+#include <datadog/dict_writer.h>
+#include <datadog/logger.h>
+#include <datadog/optional.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "json.hpp"
+#include "parse_util.h"
+#include "string_util.h"
+
+namespace datadog {
+namespace tracing {
+namespace {
+
+// Responses whose status line and headers are larger than this are rejected.
+constexpr std::size_t max_header_bytes = 64 * 1024;
+// The most buffers passed to one call to `sendmsg`. Each request contributes
+// two: its head and its body.
+constexpr std::size_t max_buffers_per_write = 64;
+constexpr auto max_wait = std::chrono::milliseconds(10'000);
+// How long to wait before connecting again when the server isn't accepting
+// connections as fast as they're made.
+constexpr auto reconnect_delay = std::chrono::milliseconds(10);
+
+#ifdef MSG_NOSIGNAL
+constexpr int send_flags = MSG_NOSIGNAL;
+#else
+// `SO_NOSIGPIPE` is set on the socket instead.
+constexpr int send_flags = 0;
+#endif
+
+bool equals_ignore_case(StringView left, StringView right) {
+  return left.size() == right.size() &&
+         std::equal(left.begin(), left.end(), right.begin(),
+                    [](unsigned char left_char, unsigned char right_char) {
+                      return std::tolower(left_char) ==
+                             std::tolower(right_char);
+                    });
+}
+
+Error socket_error(StringView action, const std::string& socket_path,
+                   int error_number) {
+  std::string message;
+  message += "Unable to ";
+  append(message, action);
+  message += " unix://";
+  message += socket_path;
+  message += ": ";
+  message += std::strerror(error_number);
+  return Error{Error::UNIX_SOCKET_REQUEST_FAILURE, std::move(message)};
+}
+
+Error closed_error(const std::string& socket_path) {
+  std::string message;
+  message += "The Datadog Agent at unix://";
+  message += socket_path;
+  message += " closed the connection before responding to the request.";
+  return Error{Error::UNIX_SOCKET_REQUEST_FAILURE, std::move(message)};
+}
+
+Error deadline_error(const std::string& socket_path) {
+  std::string message;
+  message += "Request to unix://";
+  message += socket_path;
+  message += " exceeded its deadline before a response was received.";
+  return Error{Error::UNIX_SOCKET_DEADLINE_EXCEEDED, std::move(message)};
+}
+
+// A non-blocking socket that is connected, or connecting, to a unix domain
+// socket. `fd` is -1 if the server's queue of pending connections is full.
+struct Connecting {
+  int fd;
+  // Whether the connection completes once `fd` is writable.
+  bool in_progress;
+};
+
+// Start connecting a non-blocking socket to the unix domain socket at the
+// specified `socket_path`.
+Expected<Connecting> connect_unix_socket(const std::string& socket_path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    std::string message;
+    message += "Unix domain socket path is too long: ";
+    message += socket_path;
+    return Error{Error::UNIX_SOCKET_REQUEST_FAILURE, std::move(message)};
+  }
+  std::memcpy(address.sun_path, socket_path.data(), socket_path.size());
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return socket_error("create a socket for", socket_path, errno);
+  }
+  ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+  ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+  const int enabled = 1;
+  ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof enabled);
+#endif
+
+  int result;
+  do {
+    result = ::connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                       sizeof address);
+  } while (result != 0 && errno == EINTR);
+  if (result == 0) {
+    return Connecting{fd, false};
+  }
+  const int error_number = errno;
+  if (error_number == EINPROGRESS) {
+    return Connecting{fd, true};
+  }
+  ::close(fd);
+  if (error_number == EAGAIN) {
+    // Linux doesn't wait for a full queue of pending connections to drain
+    // when the socket is non-blocking. The caller tries again later.
+    return Connecting{-1, false};
+  }
+  return socket_error("connect to", socket_path, error_number);
+}
+
+// `RequestHeadWriter` appends request header lines to a string. The
+// "Content-Length" and "Host" headers are always written by
+// `UnixSocketHTTPClient` itself, so the caller's are ignored.
+class RequestHeadWriter : public DictWriter {
+  std::string& head_;
+
+ public:
+  explicit RequestHeadWriter(std::string& head) : head_(head) {}
+
+  void set(StringView key, StringView value) override {
+    if (equals_ignore_case(key, "Content-Length") ||
+        equals_ignore_case(key, "Host")) {
+      return;
+    }
+    append(head_, key);
+    head_ += ": ";
+    append(head_, value);
+    head_ += "\r\n";
+  }
+};
+
+struct Response {
+  int status = 0;
+  // Header names are lower case.
+  std::unordered_map<std::string, std::string> headers;
+  std::string body;
+  // Whether the server will close the connection after this response.
+  bool close = false;
+};
+
+class ResponseHeaderReader : public DictReader {
+  const std::unordered_map<std::string, std::string>& headers_;
+
+ public:
+  explicit ResponseHeaderReader(
+      const std::unordered_map<std::string, std::string>& headers)
+      : headers_(headers) {}
+
+  Optional<StringView> lookup(StringView key) const override {
+    const auto found = headers_.find(to_lower(key));
+    if (found == headers_.end()) {
+      return nullopt;
+    }
+    return found->second;
+  }
+
+  void visit(const std::function<void(StringView key, StringView value)>&
+                 visitor) const override {
+    for (const auto& [key, value] : headers_) {
+      visitor(key, value);
+    }
+  }
+};
+
+// `ResponseParser` parses HTTP/1.1 responses from the bytes received on a
+// connection, as they are received. The body of a response is delimited by
+// its "Content-Length" header, by chunked transfer encoding, or by the end of
+// the connection. Informational (1xx) responses are skipped.
+class ResponseParser {
+  enum class State {
+    STATUS_LINE,
+    HEADERS,
+    BODY,
+    CHUNK_SIZE,
+    CHUNK,
+    CHUNK_END,
+    TRAILERS,
+    BODY_UNTIL_CLOSE
+  };
+
+  State state_ = State::STATUS_LINE;
+  std::string input_;
+  // `input_` before `position_` has been parsed.
+  std::size_t position_ = 0;
+  // The number of bytes remaining in the current body or chunk.
+  std::uint64_t remaining_ = 0;
+  std::size_t header_bytes_ = 0;
+  Response response_;
+
+  Optional<StringView> next_line() {
+    const auto end = input_.find('\n', position_);
+    if (end == std::string::npos) {
+      return nullopt;
+    }
+    StringView line{input_.data() + position_, end - position_};
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    position_ = end + 1;
+    header_bytes_ += line.size();
+    return line;
+  }
+
+  void take_body() {
+    const auto size = static_cast<std::size_t>(
+        std::min<std::uint64_t>(remaining_, input_.size() - position_));
+    response_.body.append(input_, position_, size);
+    position_ += size;
+    remaining_ -= size;
+  }
+
+  void complete(Response& response) {
+    response = std::move(response_);
+    response_ = Response{};
+    state_ = State::STATUS_LINE;
+    header_bytes_ = 0;
+  }
+
+  Expected<bool> parse_line(StringView line, Response& response);
+  Expected<bool> begin_body(Response& response);
+
+ public:
+  void receive(const char* data, std::size_t size) {
+    input_.append(data, size);
+  }
+
+  // Parse the input received so far. Return whether a complete response was
+  // parsed into the specified `response`, or return an error if the input is
+  // not a valid response.
+  Expected<bool> next(Response& response);
+
+  // Handle the end of the input. Return whether this completes a response,
+  // which is then parsed into the specified `response`.
+  bool finish(Response& response) {
+    if (state_ != State::BODY_UNTIL_CLOSE) {
+      return false;
+    }
+    response_.body.append(input_, position_, std::string::npos);
+    complete(response);
+    return true;
+  }
+};
+
+Expected<bool> ResponseParser::next(Response& response) {
+  const auto too_large = [] {
+    return Error{Error::UNIX_SOCKET_REQUEST_FAILURE,
+                 "Response headers from the Datadog Agent are too large."};
+  };
+
+  Expected<bool> result = false;
+  while (result && !*result) {
+    if (state_ == State::BODY || state_ == State::CHUNK) {
+      take_body();
+      if (remaining_ != 0) {
+        break;
+      }
+      if (state_ == State::CHUNK) {
+        state_ = State::CHUNK_END;
+      } else {
+        complete(response);
+        result = true;
+      }
+    } else if (state_ == State::BODY_UNTIL_CLOSE) {
+      response_.body.append(input_, position_, std::string::npos);
+      position_ = input_.size();
+      break;
+    } else if (const auto line = next_line()) {
+      result = parse_line(*line, response);
+      if (result && header_bytes_ > max_header_bytes) {
+        result = too_large();
+      }
+    } else {
+      if (header_bytes_ + (input_.size() - position_) > max_header_bytes) {
+        result = too_large();
+      }
+      break;
+    }
+  }
+
+  input_.erase(0, position_);
+  position_ = 0;
+  return result;
+}
+
+Expected<bool> ResponseParser::parse_line(StringView line, Response& response) {
+  switch (state_) {
+    case State::STATUS_LINE: {
+      if (line.empty()) {
+        // Tolerate extra line breaks between responses.
+        return false;
+      }
+      // e.g. "HTTP/1.1 200 OK"
+      if (line.size() < 12 || !starts_with(line, "HTTP/1.") ||
+          line[8] != ' ') {
+        std::string message;
+        message += "Invalid status line in response from the Datadog Agent: ";
+        append(message, line.substr(0, 80));
+        return Error{Error::UNIX_SOCKET_REQUEST_FAILURE, std::move(message)};
+      }
+      auto status = parse_int(line.substr(9, 3), 10);
+      if (auto* error = status.if_error()) {
+        return error->with_prefix(
+            "Invalid status code in response from the Datadog Agent: ");
+      }
+      response_.status = *status;
+      state_ = State::HEADERS;
+      return false;
+    }
+    case State::HEADERS: {
+      if (line.empty()) {
+        return begin_body(response);
+      }
+      // Lines without a colon are ignored.
+      const auto colon = line.find(':');
+      if (colon == StringView::npos) {
+        return false;
+      }
+      std::string key = to_lower(trim(line.substr(0, colon)));
+      const StringView value = trim(line.substr(colon + 1));
+      const auto [entry, inserted] =
+          response_.headers.emplace(std::move(key), std::string(value));
+      if (!inserted) {
+        entry->second += ", ";
+        append(entry->second, value);
+      }
+      return false;
+    }
+    case State::CHUNK_SIZE: {
+      // Chunk extensions, after a semicolon, are ignored.
+      auto size = parse_uint64(trim(line.substr(0, line.find(';'))), 16);
+      if (auto* error = size.if_error()) {
+        return error->with_prefix(
+            "Invalid chunk size in response from the Datadog Agent: ");
+      }
+      remaining_ = *size;
+      header_bytes_ = 0;
+      state_ = remaining_ == 0 ? State::TRAILERS : State::CHUNK;
+      return false;
+    }
+    case State::CHUNK_END:
+      if (!line.empty()) {
+        return Error{Error::UNIX_SOCKET_REQUEST_FAILURE,
+                     "Chunk in response from the Datadog Agent is longer than "
+                     "its size."};
+      }
+      state_ = State::CHUNK_SIZE;
+      return false;
+    case State::TRAILERS:
+      if (!line.empty()) {
+        return false;
+      }
+      complete(response);
+      return true;
+    default:
+      return false;
+  }
+}
+
+Expected<bool> ResponseParser::begin_body(Response& response) {
+  if (response_.status >= 100 && response_.status < 200) {
+    response_ = Response{};
+    state_ = State::STATUS_LINE;
+    header_bytes_ = 0;
+    return false;
+  }
+
+  const auto& headers = response_.headers;
+  if (const auto found = headers.find("connection"); found != headers.end()) {
+    response_.close =
+        to_lower(found->second).find("close") != std::string::npos;
+  }
+
+  if (response_.status == 204 || response_.status == 304) {
+    complete(response);
+    return true;
+  }
+
+  if (const auto found = headers.find("transfer-encoding");
+      found != headers.end() &&
+      to_lower(found->second).find("chunked") != std::string::npos) {
+    state_ = State::CHUNK_SIZE;
+    return false;
+  }
+
+  if (const auto found = headers.find("content-length");
+      found != headers.end()) {
+    auto length = parse_uint64(found->second, 10);
+    if (auto* error = length.if_error()) {
+      return error->with_prefix(
+          "Invalid Content-Length in response from the Datadog Agent: ");
+    }
+    remaining_ = *length;
+    state_ = State::BODY;
+    return false;
+  }
+
+  response_.close = true;
+  state_ = State::BODY_UNTIL_CLOSE;
+  return false;
+}
+
+}  // namespace
+
+struct UnixSocketHTTPClient::Request {
+  std::string socket_path;
+  // `head` is the request line and headers, and `body` follows it. `body`
+  // might be shared with the caller of `post_shared`.
+  std::string head;
+  std::shared_ptr<const std::string> body;
+  ResponseHandler on_response;
+  ErrorHandler on_error;
+  std::chrono::steady_clock::time_point deadline;
+  // The number of bytes of `head` and `body` written to the connection.
+  std::size_t written = 0;
+  // Whether writing this request already failed once before any of it could
+  // be written.
+  bool retried = false;
+
+  std::size_t size() const { return head.size() + body->size(); }
+};
+
+struct UnixSocketHTTPClient::Connection {
+  std::string socket_path;
+  int fd = -1;
+  // Whether `fd` is still connecting, in which case it's writable once it's
+  // done.
+  bool connecting = false;
+  // When `fd` may next be opened, if it's closed.
+  std::chrono::steady_clock::time_point reconnect_after;
+  // `requests` are in the order in which they are written. The first
+  // `num_written` of them have been written completely and await responses.
+  // The one after those might have been written partially.
+  std::deque<std::unique_ptr<Request>> requests;
+  std::size_t num_written = 0;
+  ResponseParser parser;
+
+  ~Connection() {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+};
+
+UnixSocketHTTPClient::UnixSocketHTTPClient(
+    const std::shared_ptr<Logger>& logger, const Clock& clock)
+    : logger_(logger), clock_(clock) {
+  int fds[2];
+  if (::pipe(fds) != 0) {
+    std::string message;
+    message += "Unable to create a pipe for the unix domain socket HTTP "
+               "client: ";
+    message += std::strerror(errno);
+    logger_->log_error(Error{Error::UNIX_SOCKET_HTTP_CLIENT_SETUP_FAILED,
+                             std::move(message)});
+    return;
+  }
+  for (const int fd : fds) {
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+  wake_read_fd_ = fds[0];
+  wake_write_fd_ = fds[1];
+
+  try {
+    event_loop_ = std::thread([this]() { run(); });
+  } catch (const std::system_error& error) {
+    logger_->log_error(
+        Error{Error::UNIX_SOCKET_HTTP_CLIENT_SETUP_FAILED, error.what()});
+    ::close(wake_read_fd_);
+    ::close(wake_write_fd_);
+    // Mark this object as not working.
+    wake_read_fd_ = -1;
+    wake_write_fd_ = -1;
+  }
+}
+
+UnixSocketHTTPClient::~UnixSocketHTTPClient() {
+  if (wake_write_fd_ < 0) {
+    // We're not running; nothing to shut down.
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  wake();
+  event_loop_.join();
+
+  ::close(wake_read_fd_);
+  ::close(wake_write_fd_);
+}
+
+bool UnixSocketHTTPClient::supports(const URL& url) {
+  return url.scheme == "unix" || url.scheme == "http+unix";
+}
+
+Expected<void> UnixSocketHTTPClient::post(
+    const URL& url, HeadersSetter set_headers, std::string body,
+    ResponseHandler on_response, ErrorHandler on_error,
+    std::chrono::steady_clock::time_point deadline) {
+  return post_shared(url, std::move(set_headers),
+                     std::make_shared<const std::string>(std::move(body)),
+                     std::move(on_response), std::move(on_error), deadline);
+}
+
+Expected<void> UnixSocketHTTPClient::post_shared(
+    const URL& url, HeadersSetter set_headers,
+    std::shared_ptr<const std::string> body, ResponseHandler on_response,
+    ErrorHandler on_error, std::chrono::steady_clock::time_point deadline) {
+  if (wake_write_fd_ < 0) {
+    return Error{Error::UNIX_SOCKET_HTTP_CLIENT_NOT_RUNNING,
+                 "Unable to send request via unix domain socket because the "
+                 "HTTP client failed to start."};
+  }
+  if (!supports(url)) {
+    std::string message;
+    message += "Unable to send request to a URL having the scheme \"";
+    message += url.scheme;
+    message += "\" via unix domain socket. Only \"unix\" and \"http+unix\" "
+               "are supported.";
+    return Error{Error::UNIX_SOCKET_REQUEST_SETUP_FAILED, std::move(message)};
+  }
+
+  auto request = std::make_unique<Request>();
+  request->socket_path = url.authority;
+  std::string& head = request->head;
+  head += "POST ";
+  head += url.path.empty() ? "/" : url.path;
+  if (!url.query.empty()) {
+    head += '?';
+    head += url.query;
+  }
+  head += " HTTP/1.1\r\nHost: localhost\r\nContent-Length: ";
+  head += std::to_string(body->size());
+  head += "\r\n";
+  if (set_headers) {
+    RequestHeadWriter writer{head};
+    set_headers(writer);
+  }
+  head += "\r\n";
+  request->body = std::move(body);
+  request->on_response = std::move(on_response);
+  request->on_error = std::move(on_error);
+  request->deadline = deadline;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    new_requests_.push_back(std::move(request));
+    ++num_requests_;
+  }
+  wake();
+  return nullopt;
+}
+
+void UnixSocketHTTPClient::drain(
+    std::chrono::steady_clock::time_point deadline) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  no_requests_.wait_until(lock, deadline,
+                          [this]() { return num_requests_ == 0; });
+}
+
+std::string UnixSocketHTTPClient::config() const {
+  return nlohmann::json::object(
+             {{"type", "datadog::tracing::UnixSocketHTTPClient"}})
+      .dump();
+}
+
+void UnixSocketHTTPClient::wake() {
+  // If the pipe is full, then the event loop is already going to wake up.
+  const char byte = 0;
+  [[maybe_unused]] const auto result = ::write(wake_write_fd_, &byte, 1);
+}
+
+void UnixSocketHTTPClient::finish(std::size_t num_finished) {
+  bool none_remaining;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_requests_ -= num_finished;
+    none_remaining = num_requests_ == 0;
+  }
+  if (none_remaining) {
+    no_requests_.notify_all();
+  }
+}
+
+void UnixSocketHTTPClient::deliver_error(Request& request, Error error) {
+  request.on_error(std::move(error));
+  finish(1);
+}
+
+void UnixSocketHTTPClient::run() {
+  std::deque<std::unique_ptr<Request>> posted;
+  std::vector<pollfd> poll_fds;
+  std::vector<Connection*> polled;
+
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (shutting_down_) {
+        break;
+      }
+      posted.swap(new_requests_);
+    }
+    start_requests(posted);
+
+    // Send what can be sent, and wait until there's more to send, something
+    // to receive, or a deadline.
+    const auto now = clock_().tick;
+    std::chrono::milliseconds wait = max_wait;
+    poll_fds.clear();
+    polled.clear();
+    poll_fds.push_back(pollfd{wake_read_fd_, POLLIN, 0});
+    for (auto entry = connections_.begin(); entry != connections_.end();) {
+      Connection& connection = *entry->second;
+      expire_requests(connection);
+      if (connection.fd < 0 && !connection.requests.empty() &&
+          now >= connection.reconnect_after) {
+        open_connection(connection);
+      }
+      if (connection.fd >= 0 && !connection.connecting &&
+          connection.num_written < connection.requests.size()) {
+        write_requests(connection);
+      }
+
+      if (connection.fd < 0 && connection.requests.empty()) {
+        entry = connections_.erase(entry);
+        continue;
+      }
+      if (connection.fd < 0) {
+        // Either writing failed, or the server wasn't accepting connections,
+        // and the connection will be reopened.
+        wait = std::min(
+            wait, std::max(std::chrono::milliseconds::zero(),
+                           std::chrono::ceil<std::chrono::milliseconds>(
+                               connection.reconnect_after - now)));
+      } else if (connection.connecting) {
+        poll_fds.push_back(pollfd{connection.fd, POLLOUT, 0});
+        polled.push_back(&connection);
+      } else {
+        short events = POLLIN;
+        if (connection.num_written < connection.requests.size()) {
+          events |= POLLOUT;
+        }
+        poll_fds.push_back(pollfd{connection.fd, events, 0});
+        polled.push_back(&connection);
+      }
+      for (const auto& request : connection.requests) {
+        wait = std::min(
+            wait, std::max(std::chrono::milliseconds::zero(),
+                           std::chrono::ceil<std::chrono::milliseconds>(
+                               request->deadline - now)));
+      }
+      ++entry;
+    }
+
+    if (::poll(poll_fds.data(), poll_fds.size(),
+               static_cast<int>(wait.count())) < 0) {
+      if (errno != EINTR) {
+        logger_->log_error(
+            Error{Error::UNIX_SOCKET_REQUEST_FAILURE,
+                  std::string("Unable to wait on unix domain sockets: ") +
+                      std::strerror(errno)});
+      }
+      continue;
+    }
+
+    if (poll_fds.front().revents & POLLIN) {
+      char buffer[64];
+      while (::read(wake_read_fd_, buffer, sizeof buffer) > 0) {
+      }
+    }
+    for (std::size_t i = 0; i < polled.size(); ++i) {
+      Connection& connection = *polled[i];
+      const short events = poll_fds[i + 1].revents;
+      if (connection.connecting) {
+        if (events & (POLLOUT | POLLHUP | POLLERR)) {
+          finish_connecting(connection);
+        }
+        continue;
+      }
+      if (events & (POLLIN | POLLHUP | POLLERR)) {
+        read_responses(connection);
+      }
+      if (connection.fd >= 0 && (events & POLLOUT)) {
+        write_requests(connection);
+      }
+    }
+  }
+
+  // We're shutting down. Remaining requests are dropped without invoking
+  // their handlers.
+  connections_.clear();
+}
+
+void UnixSocketHTTPClient::start_requests(
+    std::deque<std::unique_ptr<Request>>& requests) {
+  for (auto& request : requests) {
+    auto& connection = connections_[request->socket_path];
+    if (!connection) {
+      connection = std::make_unique<Connection>();
+      connection->socket_path = request->socket_path;
+    }
+    connection->requests.push_back(std::move(request));
+  }
+  requests.clear();
+}
+
+void UnixSocketHTTPClient::open_connection(Connection& connection) {
+  auto connecting = connect_unix_socket(connection.socket_path);
+  if (auto* error = connecting.if_error()) {
+    fail_requests(connection, *error);
+    return;
+  }
+  if (connecting->fd < 0) {
+    connection.reconnect_after = clock_().tick + reconnect_delay;
+    return;
+  }
+  connection.fd = connecting->fd;
+  connection.connecting = connecting->in_progress;
+}
+
+void UnixSocketHTTPClient::finish_connecting(Connection& connection) {
+  connection.connecting = false;
+  int error_number = 0;
+  socklen_t size = sizeof error_number;
+  if (::getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error_number,
+                   &size) != 0) {
+    error_number = errno;
+  }
+  if (error_number != 0) {
+    ::close(connection.fd);
+    connection.fd = -1;
+    fail_requests(connection, socket_error("connect to", connection.socket_path,
+                                           error_number));
+  }
+}
+
+void UnixSocketHTTPClient::fail_requests(Connection& connection,
+                                         const Error& error) {
+  auto requests = std::move(connection.requests);
+  connection.requests.clear();
+  for (const auto& request : requests) {
+    deliver_error(*request, error);
+  }
+}
+
+void UnixSocketHTTPClient::write_requests(Connection& connection) {
+  auto& requests = connection.requests;
+  iovec buffers[max_buffers_per_write];
+  while (connection.num_written < requests.size()) {
+    std::size_t num_buffers = 0;
+    for (std::size_t i = connection.num_written;
+         i < requests.size() && num_buffers + 2 <= max_buffers_per_write;
+         ++i) {
+      const Request& request = *requests[i];
+      std::size_t offset = request.written;
+      if (offset < request.head.size()) {
+        buffers[num_buffers++] = iovec{
+            const_cast<char*>(request.head.data()) + offset,
+            request.head.size() - offset};
+        offset = request.head.size();
+      }
+      offset -= request.head.size();
+      if (offset < request.body->size()) {
+        buffers[num_buffers++] = iovec{
+            const_cast<char*>(request.body->data()) + offset,
+            request.body->size() - offset};
+      }
+    }
+
+    msghdr message{};
+    message.msg_iov = buffers;
+    message.msg_iovlen = num_buffers;
+    const auto sent = ::sendmsg(connection.fd, &message, send_flags);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;
+      }
+      const Error error =
+          socket_error("write to", connection.socket_path, errno);
+      // A connection that the server closed while it was idle fails on the
+      // first write. Retry a request once on a new connection, but no more,
+      // so that a server that can't accept requests doesn't cause a loop.
+      const auto current = requests.begin() + connection.num_written;
+      if ((*current)->written == 0) {
+        if (!(*current)->retried) {
+          (*current)->retried = true;
+        } else {
+          auto request = std::move(*current);
+          requests.erase(current);
+          deliver_error(*request, error);
+        }
+      }
+      close_connection(connection, error);
+      return;
+    }
+
+    auto remaining = static_cast<std::size_t>(sent);
+    while (remaining != 0) {
+      Request& request = *requests[connection.num_written];
+      const auto size = std::min(remaining, request.size() - request.written);
+      request.written += size;
+      remaining -= size;
+      if (request.written == request.size()) {
+        ++connection.num_written;
+      }
+    }
+  }
+}
+
+void UnixSocketHTTPClient::read_responses(Connection& connection) {
+  char buffer[16 * 1024];
+  while (true) {
+    const auto received = ::recv(connection.fd, buffer, sizeof buffer, 0);
+    if (received > 0) {
+      connection.parser.receive(buffer, static_cast<std::size_t>(received));
+      if (!deliver_responses(connection)) {
+        return;
+      }
+      continue;
+    }
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+
+    if (received == 0) {
+      Response response;
+      if (connection.parser.finish(response)) {
+        // The response was delimited by the end of the connection, and
+        // delivering it closes the connection.
+        deliver_response(connection, response.status,
+                         ResponseHeaderReader{response.headers},
+                         std::move(response.body), response.close);
+        return;
+      }
+      close_connection(connection, closed_error(connection.socket_path));
+      return;
+    }
+    close_connection(connection,
+                     socket_error("read from", connection.socket_path, errno));
+    return;
+  }
+}
+
+bool UnixSocketHTTPClient::deliver_responses(Connection& connection) {
+  while (true) {
+    Response response;
+    auto complete = connection.parser.next(response);
+    if (auto* error = complete.if_error()) {
+      close_connection(connection, std::move(*error));
+      return false;
+    }
+    if (!*complete) {
+      return true;
+    }
+    if (!deliver_response(connection, response.status,
+                          ResponseHeaderReader{response.headers},
+                          std::move(response.body), response.close)) {
+      return false;
+    }
+  }
+}
+
+bool UnixSocketHTTPClient::deliver_response(Connection& connection,
+                                            int status,
+                                            const DictReader& headers,
+                                            std::string body, bool close) {
+  auto& requests = connection.requests;
+  if (requests.empty() || requests.front()->written == 0) {
+    close_connection(
+        connection,
+        Error{Error::UNIX_SOCKET_REQUEST_FAILURE,
+              "Received an unexpected response from the Datadog Agent at "
+              "unix://" +
+                  connection.socket_path + '.'});
+    return false;
+  }
+
+  auto request = std::move(requests.front());
+  requests.pop_front();
+  // The server might respond before it has read all of the request, e.g. if
+  // the request is too large. Then the rest of the request can't be sent.
+  const bool written_completely = request->written == request->size();
+  if (written_completely) {
+    --connection.num_written;
+  }
+  request->on_response(status, headers, std::move(body));
+  finish(1);
+
+  if (!written_completely || close) {
+    close_connection(connection, closed_error(connection.socket_path));
+    return false;
+  }
+  return true;
+}
+
+void UnixSocketHTTPClient::close_connection(Connection& connection,
+                                            const Error& error) {
+  ::close(connection.fd);
+  connection.fd = -1;
+  connection.connecting = false;
+  connection.parser = ResponseParser{};
+  connection.num_written = 0;
+
+  const auto now = clock_().tick;
+  auto& requests = connection.requests;
+  while (!requests.empty() && requests.front()->written != 0) {
+    auto request = std::move(requests.front());
+    requests.pop_front();
+    deliver_error(*request, request->deadline <= now
+                                ? deadline_error(connection.socket_path)
+                                : error);
+  }
+}
+
+void UnixSocketHTTPClient::expire_requests(Connection& connection) {
+  const auto now = clock_().tick;
+  auto& requests = connection.requests;
+  const auto expired = [&](const std::unique_ptr<Request>& request) {
+    return request->deadline <= now;
+  };
+
+  // A request that was written can't be abandoned without abandoning the
+  // connection, since its response would still arrive.
+  if (std::any_of(requests.begin(), requests.end(),
+                  [&](const std::unique_ptr<Request>& request) {
+                    return request->written != 0 && expired(request);
+                  })) {
+    close_connection(
+        connection,
+        Error{Error::UNIX_SOCKET_REQUEST_FAILURE,
+              "Connection to unix://" + connection.socket_path +
+                  " was closed because an earlier request exceeded its "
+                  "deadline."});
+  }
+
+  for (auto entry = requests.begin(); entry != requests.end();) {
+    if ((*entry)->written == 0 && expired(*entry)) {
+      auto request = std::move(*entry);
+      entry = requests.erase(entry);
+      deliver_error(*request, deadline_error(connection.socket_path));
+    } else {
+      ++entry;
+    }
+  }
+}
+
+}  // namespace tracing
+}  // namespace datadog
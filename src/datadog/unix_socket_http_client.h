@@ -0,0 +1,120 @@
+#pragma once
+
+// This component provides a class, `UnixSocketHTTPClient`, that implements the
+// `HTTPClient` interface for URLs having the "unix" or "http+unix" scheme,
+// i.e. for a Datadog Agent listening on a unix domain socket, without libcurl.
+//
+// `UnixSocketHTTPClient` keeps one connection open per socket, and writes
+// requests to it as soon as they are posted, without waiting for the responses
+// to earlier requests ("pipelining"). The header and body of each request are
+// written together, from their own buffers, with one system call. Responses
+// are delivered in the order in which the requests were written. A
+// connection that fails or is closed by the server is reopened for the next
+// request. Requests that were not yet written to a failed connection are
+// retried on the new connection, and the others are delivered an error.
+//
+// A thread owned by `UnixSocketHTTPClient` waits on the sockets with `poll`,
+// and invokes the response and error handlers.
+//
+// `finalize_config` uses `UnixSocketHTTPClient` only as a fallback, when this
+// library was built without libcurl and no `HTTPClient` was configured.
+//
+// This component is not available on Windows.
+
+#include <datadog/clock.h>
+#include <datadog/http_client.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace datadog {
+namespace tracing {
+
+class DictReader;
+class Logger;
+
+class UnixSocketHTTPClient : public HTTPClient {
+  struct Request;
+  struct Connection;
+
+  std::shared_ptr<Logger> logger_;
+  Clock clock_;
+
+  // The following are guarded by `mutex_`.
+  std::mutex mutex_;
+  // `new_requests_` are the requests posted since the event loop last
+  // checked. `num_requests_` is the number of requests whose response or
+  // error has not yet been delivered.
+  std::deque<std::unique_ptr<Request>> new_requests_;
+  std::size_t num_requests_ = 0;
+  bool shutting_down_ = false;
+  std::condition_variable no_requests_;
+
+  // The event loop is woken by writing to `wake_write_fd_`.
+  int wake_read_fd_ = -1;
+  int wake_write_fd_ = -1;
+  // `connections_`, by socket path, are used only by the event loop.
+  std::unordered_map<std::string, std::unique_ptr<Connection>> connections_;
+  std::thread event_loop_;
+
+  void run();
+  void wake();
+  void start_requests(std::deque<std::unique_ptr<Request>>& requests);
+  // Start connecting the specified `connection`, unless the server isn't
+  // accepting connections yet.
+  void open_connection(Connection& connection);
+  void finish_connecting(Connection& connection);
+  // Deliver the specified `error` to all of the requests of the specified
+  // `connection`, which is not open.
+  void fail_requests(Connection& connection, const Error& error);
+  void write_requests(Connection& connection);
+  void read_responses(Connection& connection);
+  // Deliver the responses parsed so far on the specified `connection`. Return
+  // whether the connection remains open.
+  bool deliver_responses(Connection& connection);
+  bool deliver_response(Connection& connection, int status,
+                        const DictReader& headers, std::string body,
+                        bool close);
+  // Close the specified `connection`. Deliver the specified `error` to the
+  // requests that were written to it, and retry the others.
+  void close_connection(Connection& connection, const Error& error);
+  void expire_requests(Connection& connection);
+  void deliver_error(Request& request, Error error);
+  void finish(std::size_t num_finished);
+
+ public:
+  UnixSocketHTTPClient(const std::shared_ptr<Logger>& logger,
+                       const Clock& clock);
+  ~UnixSocketHTTPClient();
+
+  UnixSocketHTTPClient(const UnixSocketHTTPClient&) = delete;
+  UnixSocketHTTPClient& operator=(const UnixSocketHTTPClient&) = delete;
+
+  // Return whether the specified `url` refers to a unix domain socket that
+  // this client can send requests to.
+  static bool supports(const URL& url);
+
+  Expected<void> post(const URL& url, HeadersSetter set_headers,
+                      std::string body, ResponseHandler on_response,
+                      ErrorHandler on_error,
+                      std::chrono::steady_clock::time_point deadline) override;
+
+  Expected<void> post_shared(
+      const URL& url, HeadersSetter set_headers,
+      std::shared_ptr<const std::string> body, ResponseHandler on_response,
+      ErrorHandler on_error,
+      std::chrono::steady_clock::time_point deadline) override;
+
+  void drain(std::chrono::steady_clock::time_point deadline) override;
+
+  std::string config() const override;
+};
+
+}  // namespace tracing
+}  // namespace datadog
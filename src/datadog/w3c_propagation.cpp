@@ -278,9 +278,8 @@ void parse_datadog_tracestate(ExtractedData& result, StringView datadog_value) {
 // `extract_tracestate` populates the `additional_w3c_tracestate` field of
 // `ExtractedData`, in addition to those populated by
 // `parse_datadog_tracestate`.
-void extract_tracestate(
-    ExtractedData& result, const DictReader& headers,
-    std::unordered_map<std::string, std::string>& span_tags) {
+void extract_tracestate(ExtractedData& result, const DictReader& headers,
+                        SpanTags& span_tags) {
   const auto maybe_tracestate = headers.lookup("tracestate");
   if (!maybe_tracestate || maybe_tracestate->empty()) {
     return;
@@ -315,9 +314,8 @@ void extract_tracestate(
 
 }  // namespace
 
-Expected<ExtractedData> extract_w3c(
-    const DictReader& headers,
-    std::unordered_map<std::string, std::string>& span_tags, Logger&) {
+Expected<ExtractedData> extract_w3c(const DictReader& headers,
+                                    SpanTags& span_tags, Logger&) {
   ExtractedData result;
   result.style = PropagationStyle::W3C;
 
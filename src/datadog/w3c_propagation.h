@@ -14,6 +14,7 @@
 #include <unordered_map>
 
 #include "extracted_data.h"
+#include "span_data.h"
 
 namespace datadog {
 namespace tracing {
@@ -26,9 +27,8 @@ class Logger;
 // `tags::internal::w3c_extraction_error` tag in the specified `span_tags`.
 // `extract_w3c` will not return an error; instead, it returns an empty
 // `ExtractedData` when extraction fails.
-Expected<ExtractedData> extract_w3c(
-    const DictReader& headers,
-    std::unordered_map<std::string, std::string>& span_tags, Logger&);
+Expected<ExtractedData> extract_w3c(const DictReader& headers,
+                                    SpanTags& span_tags, Logger&);
 
 // Return a value for the "traceparent" header consisting of the specified
 // `trace_id` or the optionally specified `full_w3c_trace_id_hex` as the trace
@@ -0,0 +1,65 @@
+#include "worker_pool.h"
+
+namespace datadog {
+namespace tracing {
+
+WorkerPool::WorkerPool(std::size_t concurrency) {
+  for (std::size_t i = 1; i < concurrency; ++i) {
+    workers_.emplace_back([this]() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      for (;;) {
+        work_available_.wait(lock, [this]() {
+          return shutting_down_ || (task_ && next_task_ < num_tasks_);
+        });
+        if (shutting_down_) {
+          return;
+        }
+        work(lock);
+      }
+    });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+std::size_t WorkerPool::concurrency() const { return workers_.size() + 1; }
+
+void WorkerPool::run(std::size_t num_tasks,
+                     const std::function<void(std::size_t)>& task) {
+  std::lock_guard<std::mutex> one_batch_at_a_time(run_mutex_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  task_ = &task;
+  num_tasks_ = num_tasks;
+  next_task_ = 0;
+  unfinished_tasks_ = num_tasks;
+  work_available_.notify_all();
+
+  work(lock);
+  work_done_.wait(lock, [this]() { return unfinished_tasks_ == 0; });
+  task_ = nullptr;
+}
+
+void WorkerPool::work(std::unique_lock<std::mutex>& lock) {
+  while (task_ && next_task_ < num_tasks_) {
+    const std::size_t index = next_task_++;
+    const auto& task = *task_;
+    lock.unlock();
+    task(index);
+    lock.lock();
+    if (--unfinished_tasks_ == 0) {
+      work_done_.notify_all();
+    }
+  }
+}
+
+}  // namespace tracing
+}  // namespace datadog
@@ -0,0 +1,55 @@
+#pragma once
+
+// This component provides a `class`, `WorkerPool`, that runs a batch of tasks
+// on a fixed set of threads and waits for them to finish.
+//
+// `DatadogAgent` uses a `WorkerPool` to encode the trace chunks of a large
+// flush in parallel (see `DatadogAgentConfig::encoding_threads`).
+//
+// The thread that calls `run` works on the batch, too, so a pool of
+// concurrency `n` has `n - 1` threads of its own. Batches run one at a time.
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace datadog {
+namespace tracing {
+
+class WorkerPool {
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_done_;
+  // The batch being run, if any. `task_` is null when there is none.
+  const std::function<void(std::size_t)>* task_ = nullptr;
+  std::size_t num_tasks_ = 0;
+  std::size_t next_task_ = 0;
+  std::size_t unfinished_tasks_ = 0;
+  bool shutting_down_ = false;
+  std::vector<std::thread> workers_;
+
+  // Perform tasks of the current batch until none remain to be started.
+  // `lock` must hold `mutex_`.
+  void work(std::unique_lock<std::mutex>& lock);
+
+ public:
+  // Create a pool that runs tasks on the specified `concurrency` threads,
+  // including the caller of `run`.
+  explicit WorkerPool(std::size_t concurrency);
+  ~WorkerPool();
+
+  std::size_t concurrency() const;
+
+  // Invoke the specified `task` with each index from zero up to, but not
+  // including, the specified `num_tasks`, in parallel. Return once all of the
+  // invocations have returned.
+  void run(std::size_t num_tasks,
+           const std::function<void(std::size_t)>& task);
+};
+
+}  // namespace tracing
+}  // namespace datadog
@@ -26,7 +26,12 @@ class ContainsSubset : public Catch::MatcherBase<Map> {
  public:
   ContainsSubset(const Map& subset) : subset_(&subset) {}
 
-  bool match(const Map& other) const override {
+  bool match(const Map& other) const override { return match<Map>(other); }
+
+  // Match a container of a different type than `Map`, such as the tags of a
+  // span, whose allocator differs.
+  template <typename Other>
+  bool match(const Other& other) const {
     return std::all_of(subset_->begin(), subset_->end(), [&](const auto& item) {
       const auto& [key, value] = item;
       auto found = find(other, key);
@@ -17,7 +17,7 @@
 using namespace datadog::tracing;
 
 // `MockHTTPClient` handles at most one request (the most recent call to
-// `post`), doing so in the `drain` member function.
+// `post` or `post_shared`), doing so in the `drain` member function.
 //
 // Customize the behavior of `MockHTTPClient` by setting any combination of the
 // following data members:
@@ -36,10 +36,13 @@ struct MockHTTPClient : public HTTPClient {
   std::unordered_map<std::string, std::string> response_headers;
   Optional<Error> response_error;
   MockDictWriter request_headers;
+  URL request_url;
   std::mutex mutex_;
   ResponseHandler on_response_;
   ErrorHandler on_error_;
   std::string request_body;
+  // The body most recently passed to `post_shared`, if any.
+  std::shared_ptr<const std::string> shared_request_body;
 
   void clear() {
     request_body = "";
@@ -47,10 +50,11 @@ struct MockHTTPClient : public HTTPClient {
   }
 
   Expected<void> post(
-      const URL&, HeadersSetter set_headers, std::string body,
+      const URL& url, HeadersSetter set_headers, std::string body,
       ResponseHandler on_response, ErrorHandler on_error,
       std::chrono::steady_clock::time_point /*deadline*/) override {
     std::lock_guard<std::mutex> lock{mutex_};
+    request_url = url;
     request_body = body;
     if (!post_error) {
       on_response_ = on_response;
@@ -60,6 +64,19 @@ struct MockHTTPClient : public HTTPClient {
     return Expected<void>(post_error);
   }
 
+  Expected<void> post_shared(
+      const URL& url, HeadersSetter set_headers,
+      std::shared_ptr<const std::string> body, ResponseHandler on_response,
+      ErrorHandler on_error,
+      std::chrono::steady_clock::time_point deadline) override {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      shared_request_body = body;
+    }
+    return post(url, std::move(set_headers), *body, std::move(on_response),
+                std::move(on_error), deadline);
+  }
+
   void drain(std::chrono::steady_clock::time_point /*deadline*/) override {
     std::lock_guard<std::mutex> lock{mutex_};
     if (response_error && on_error_) {
@@ -5,8 +5,12 @@
 #include <datadog/clock.h>
 #include <datadog/span_defaults.h>
 
+#include <algorithm>
+#include <cmath>
 #include <datadog/json.hpp>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 
 #include "../common/environment.h"
 #include "datadog/runtime_id.h"
@@ -42,6 +46,20 @@ std::optional<nlohmann::json> find_payload(const nlohmann::json& messages,
   return std::nullopt;
 };
 
+// Distributions are summarized in a sketch, so their points are the values
+// added, in increasing order, to within one percent.
+bool points_near(const nlohmann::json& points, std::vector<double> expected) {
+  std::sort(expected.begin(), expected.end());
+  if (points.size() != expected.size()) return false;
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    if (std::abs(points[i].get<double>() - expected[i]) >
+        0.01 * expected[i] + 0.5) {
+      return false;
+    }
+  }
+  return true;
+}
+
 struct FakeEventScheduler : public EventScheduler {
   size_t count_tasks = 0;
   std::function<void()> heartbeat_callback = nullptr;
@@ -661,6 +679,42 @@ TELEMETRY_IMPLEMENTATION_TEST("Tracer telemetry API") {
       }
     }
 
+    SECTION("counters incremented from many threads are all counted") {
+      client->clear();
+      const Counter shared_counter{"shared_counter", "counter-test3", true};
+      std::vector<std::thread> threads;
+      for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&]() {
+          for (int j = 0; j < 1000; ++j) {
+            telemetry->increment_counter(shared_counter, {"thread:any"});
+          }
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      CHECK(&telemetry->counter_cell(shared_counter, {"thread:any"}) ==
+            &telemetry->counter_cell(shared_counter, {"thread:any"}));
+
+      scheduler->trigger_metrics_capture();
+      scheduler->trigger_heartbeat();
+
+      auto message_batch = nlohmann::json::parse(client->request_body);
+      REQUIRE(is_valid_telemetry_payload(message_batch) == true);
+      auto generate_metrics =
+          find_payload(message_batch["payload"], "generate-metrics");
+      REQUIRE(generate_metrics);
+
+      bool found = false;
+      for (const auto& s : (*generate_metrics)["payload"]["series"]) {
+        if (s["metric"] == "shared_counter") {
+          found = true;
+          CHECK(s["points"] == nlohmann::json::parse("[[1672484400, 4000]]"));
+        }
+      }
+      CHECK(found);
+    }
+
     SECTION("rate") {
       client->clear();
 
@@ -774,32 +828,34 @@ TELEMETRY_IMPLEMENTATION_TEST("Tracer telemetry API") {
            "common":false,
            "metric":"response_time",
            "namespace":"dist-test",
-           "points": [6530],
            "tags":["status:200","method:GET"]
         },
         {
            "common":true,
            "metric": "request_size",
-           "namespace":"dist-test-2",
-           "points":[1843,4135]
+           "namespace":"dist-test-2"
         },
         {
            "common": false,
            "metric":"response_time",
-           "namespace":"dist-test",
-           "points":[128,42,3000]
+           "namespace":"dist-test"
         }
       ])");
 
-      for (const auto& s : distribution_series) {
+      for (auto s : distribution_series) {
+        const auto points = s["points"];
+        s.erase("points");
         if (s["metric"] == "response_time") {
           if (s.contains("tags")) {
             CHECK(s == expected_series[0]);
+            CHECK(points_near(points, {6530}));
           } else {
             CHECK(s == expected_series[2]);
+            CHECK(points_near(points, {128, 42, 3000}));
           }
         } else if (s["metric"] == "request_size") {
           CHECK(s == expected_series[1]);
+          CHECK(points_near(points, {1843, 4135}));
         }
       }
 
@@ -814,6 +870,31 @@ TELEMETRY_IMPLEMENTATION_TEST("Tracer telemetry API") {
       CHECK(find_payload(message_batch["payload"], "app-heartbeat"));
     }
 
+    SECTION("distribution having many datapoints") {
+      client->clear();
+
+      Distribution chunk_size{"chunk_size", "dist-test", false};
+      for (uint64_t i = 1; i <= 100000; ++i) {
+        telemetry->add_datapoint(chunk_size, i);
+      }
+      scheduler->trigger_heartbeat();
+
+      auto message_batch = nlohmann::json::parse(client->request_body);
+      auto distributions =
+          find_payload(message_batch["payload"], "distributions");
+      REQUIRE(distributions);
+      nlohmann::json points;
+      for (const auto& s : (*distributions)["payload"]["series"]) {
+        if (s["metric"] == "chunk_size") {
+          points = s["points"];
+        }
+      }
+      REQUIRE(points.size() == 1024);
+      CHECK(std::is_sorted(points.begin(), points.end()));
+      // The median datapoint is 50000.
+      CHECK(std::abs(points[512].get<double>() - 50000) <= 600);
+    }
+
     SECTION("dtor sends metrics and distributions") {
       // metrics captured before the aggregation task
       const Distribution response_time{"response_time", "dist-test", false};
@@ -873,13 +954,14 @@ TELEMETRY_IMPLEMENTATION_TEST("Tracer telemetry API") {
             {
               "common":false,
               "metric":"response_time",
-              "namespace":"dist-test",
-              "points": [128]
+              "namespace":"dist-test"
             }
           )");
 
-          for (const auto& d : distribution_series) {
+          for (auto d : distribution_series) {
             if (d["metric"] == "response_time") {
+              CHECK(points_near(d["points"], {128}));
+              d.erase("points");
               CHECK(d == expected_d0);
             };
           }
@@ -1,4 +1,7 @@
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include "catch.hpp"
 #include "datadog/config_manager.h"
@@ -703,3 +706,72 @@ CONFIG_MANAGER_TEST("remote configuration handling") {
     }
   }
 }
+
+CONFIG_MANAGER_TEST("updates are visible to readers on every thread") {
+  TracerConfig config;
+  config.service = "testsvc";
+  auto final_cfg = *finalize_config(config);
+
+  ConfigManager first(final_cfg);
+  ConfigManager second(final_cfg);
+
+  ConfigManager::Update update;
+  update.report_traces = false;
+  update.tags = std::unordered_map<std::string, std::string>{{"foo", "bar"}};
+
+  SECTION("each manager has its own configuration") {
+    // Alternate between the managers. The calling thread caches each
+    // manager's snapshot separately.
+    CHECK(first.report_traces());
+    CHECK(second.report_traces());
+    first.apply_update(update);
+    CHECK(!first.report_traces());
+    CHECK(second.report_traces());
+    CHECK(first.span_defaults()->tags.count("foo") == 1);
+    CHECK(second.span_defaults()->tags.empty());
+    first.apply_update({});
+    CHECK(first.report_traces());
+    CHECK(first.span_defaults()->tags.empty());
+  }
+
+  SECTION("snapshots cached by threads are released with their manager") {
+    std::weak_ptr<TraceSampler> sampler;
+    {
+      ConfigManager third(final_cfg);
+      sampler = third.trace_sampler();
+      std::thread([&]() { CHECK(third.trace_sampler()); }).join();
+      CHECK(third.report_traces());
+    }
+    CHECK(sampler.expired());
+  }
+
+  SECTION("readers see either the old or the new configuration") {
+    std::atomic<bool> done{false};
+    std::atomic<int> inconsistent{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+      readers.emplace_back([&]() {
+        while (!done) {
+          // Each update replaces all of the tags, so a reader sees either
+          // all or none of them.
+          const auto defaults = first.span_defaults();
+          if (!defaults->tags.empty() && defaults->tags != *update.tags) {
+            ++inconsistent;
+          }
+        }
+      });
+    }
+
+    for (int i = 0; i < 200; ++i) {
+      first.apply_update(i % 2 == 0 ? update : ConfigManager::Update{});
+    }
+    done = true;
+    for (auto& reader : readers) {
+      reader.join();
+    }
+
+    CHECK(inconsistent == 0);
+    CHECK(first.report_traces());
+    CHECK(first.span_defaults()->tags.empty());
+  }
+}
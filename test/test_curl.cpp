@@ -1,9 +1,12 @@
 #include <datadog/curl.h>
+#include <datadog/datadog_agent_config.h>
 #include <datadog/tracer.h>
 #include <datadog/tracer_config.h>
 
 #include <list>
+#include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "common/environment.h"
 #include "mocks/loggers.h"
@@ -460,15 +463,124 @@ CURL_TEST("handles are always cleaned up") {
         client->post(url, ignore, "whatever", ignore, ignore, dummy_deadline);
 
     REQUIRE(result);
-    // Destroy the `Curl` object.
-    client.reset();
   }
 
+  // Finished requests leave their handles in a pool, which is cleaned up when
+  // the `Curl` object is destroyed.
+  client.reset();
+
   // Here are the checks relevant to this test.
   REQUIRE(library.created_handles_.size() == 1);
   REQUIRE(library.created_handles_ == library.destroyed_handles_);
 }
 
+CURL_TEST("a driven client makes progress only when performed") {
+  const auto clock = default_clock;
+  const auto logger = std::make_shared<MockLogger>();
+  SingleRequestMockCurlLibrary library;
+  auto client = std::make_shared<Curl>(logger, clock, library, Curl::Driven{});
+
+  const HTTPClient::URL url = {"http", "whatever", "", ""};
+  const auto dummy_deadline = clock().tick + std::chrono::seconds(10);
+
+  SECTION("the response is delivered by `perform`") {
+    int status = 0;
+    const auto result = client->post(
+        url, ignore, "whatever",
+        [&](int response_status, const DictReader &, std::string) {
+          status = response_status;
+        },
+        ignore, dummy_deadline);
+    REQUIRE(result);
+    // Nothing happens until the client is driven.
+    client->wait(std::chrono::milliseconds(10));
+    CHECK(library.state_ == SingleRequestMockCurlLibrary::state::unknown);
+    CHECK(status == 0);
+
+    client->perform();
+    CHECK(status == 200);
+  }
+
+  SECTION("a request posted but never performed is cleaned up") {
+    const auto result =
+        client->post(url, ignore, "whatever", ignore, ignore, dummy_deadline);
+    REQUIRE(result);
+  }
+
+  client.reset();
+  REQUIRE(library.created_handles_.size() == 1);
+  REQUIRE(library.created_handles_ == library.destroyed_handles_);
+}
+
+CURL_TEST("handles are reused by requests to the same endpoint") {
+  class HeaderCapturingCurlLibrary : public SingleRequestMockCurlLibrary {
+   public:
+    int num_appended_ = 0;
+    std::vector<std::string> headers_;
+
+    curl_slist *slist_append(curl_slist *list, const char *string) override {
+      ++num_appended_;
+      return CurlLibrary::slist_append(list, string);
+    }
+    CURLcode easy_setopt_httpheader(CURL *, curl_slist *headers) override {
+      headers_.clear();
+      for (; headers; headers = headers->next) {
+        headers_.push_back(headers->data);
+      }
+      return CURLE_OK;
+    }
+  };
+
+  const auto clock = default_clock;
+  const auto logger = std::make_shared<NullLogger>();
+  HeaderCapturingCurlLibrary library;
+  auto client = std::make_shared<Curl>(logger, clock, library);
+
+  const auto post = [&](const HTTPClient::URL &url, int count) {
+    const auto set_headers = [&](DictWriter &writer) {
+      writer.set("Content-Type", "application/msgpack");
+      writer.set("Datadog-Meta-Lang", "cpp");
+      writer.set("X-Datadog-Trace-Count", std::to_string(count));
+    };
+    REQUIRE(client->post(url, set_headers, "body", ignore, ignore,
+                         clock().tick + 10s));
+    client->drain(clock().tick + 1s);
+  };
+
+  const HTTPClient::URL agent{"http", "agent:8126", "/v0.4/traces", ""};
+  post(agent, 1);
+  CHECK(library.created_handles_.size() == 1);
+  CHECK(library.num_appended_ == 3);
+
+  SECTION("unchanged headers are kept") {
+    post(agent, 1);
+    CHECK(library.created_handles_.size() == 1);
+    CHECK(library.num_appended_ == 3);
+    CHECK(library.headers_ ==
+          std::vector<std::string>{"Content-Type: application/msgpack",
+                                   "Datadog-Meta-Lang: cpp",
+                                   "X-Datadog-Trace-Count: 1"});
+  }
+
+  SECTION("only changed headers are replaced") {
+    post({"http", "agent:8126", "/v0.7/config", ""}, 2);
+    CHECK(library.created_handles_.size() == 1);
+    CHECK(library.num_appended_ == 4);
+    CHECK(library.headers_ ==
+          std::vector<std::string>{"Content-Type: application/msgpack",
+                                   "Datadog-Meta-Lang: cpp",
+                                   "X-Datadog-Trace-Count: 2"});
+  }
+
+  SECTION("another endpoint has its own handle") {
+    post({"http", "other:8126", "/v0.4/traces", ""}, 1);
+    CHECK(library.created_handles_.size() == 2);
+  }
+
+  client.reset();
+  CHECK(library.created_handles_ == library.destroyed_handles_);
+}
+
 CURL_TEST("post() deadline exceeded before request start") {
   const auto clock = default_clock;
   Curl client{std::make_shared<NullLogger>(), clock};
@@ -571,3 +683,13 @@ CURL_TEST("proxy is taken from the environment and forwarded to libcurl") {
     REQUIRE(library.proxy_ == "");
   }
 }
+
+CURL_TEST("unix socket URLs use Curl when it's available") {
+  DatadogAgentConfig config;
+  config.url = "unix:///var/run/datadog/apm.socket";
+  const auto finalized =
+      finalize_config(config, std::make_shared<NullLogger>(), default_clock);
+  REQUIRE(finalized);
+  CHECK(finalized->http_client->config().find("datadog::tracing::Curl") !=
+        std::string::npos);
+}
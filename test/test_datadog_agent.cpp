@@ -6,12 +6,22 @@
 #include <datadog/tracer.h>
 #include <datadog/tracer_config.h>
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <map>
+#include <msgpack.hpp>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 #include "mocks/event_schedulers.h"
 #include "mocks/http_clients.h"
+#include "gzip.h"
 #include "mocks/loggers.h"
+#include "null_logger.h"
+#include "span_data.h"
 #include "test.h"
 
 using namespace datadog;
@@ -20,6 +30,23 @@ using namespace std::chrono_literals;
 
 #define DATADOG_AGENT_TEST(x) TEST_CASE(x, "[datadog_agent]")
 
+namespace {
+
+// A "/v0.5/traces" payload: a table of strings followed by trace chunks.
+using V05Span =
+    std::tuple<std::uint32_t, std::uint32_t, std::uint32_t, std::uint64_t,
+               std::uint64_t, std::uint64_t, std::int64_t, std::int64_t,
+               std::int32_t, std::map<std::uint32_t, std::uint32_t>,
+               std::map<std::uint32_t, double>, std::uint32_t>;
+using V05Payload =
+    std::tuple<std::vector<std::string>, std::vector<std::vector<V05Span>>>;
+
+V05Payload decode_v05(const std::string& body) {
+  return ::msgpack::unpack(body.data(), body.size()).get().as<V05Payload>();
+}
+
+}  // namespace
+
 DATADOG_AGENT_TEST("CollectorResponse") {
   TracerConfig config;
   config.service = "testsvc";
@@ -281,3 +308,956 @@ DATADOG_AGENT_TEST("Datadog-Client-Computed-Stats header") {
               "Datadog-Client-Computed-Stats") == 0);
   }
 }
+
+DATADOG_AGENT_TEST("payload compression") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockHTTPClient>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.telemetry.enabled = false;
+  config.agent.compression_enabled = true;
+
+  if (!gzip_available) {
+    auto finalized = finalize_config(config);
+    REQUIRE(!finalized);
+    CHECK(finalized.error().code == Error::DATADOG_AGENT_INVALID_COMPRESSION);
+    return;
+  }
+
+  SECTION("level must be between 1 and 9") {
+    config.agent.compression_level = GENERATE(0, 10);
+    auto finalized = finalize_config(config);
+    REQUIRE(!finalized);
+    CHECK(finalized.error().code == Error::DATADOG_AGENT_INVALID_COMPRESSION);
+  }
+
+  SECTION("bodies at least the minimum size are gzip compressed") {
+    config.agent.compression_min_bytes = 0;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    {
+      http_client->response_status = 200;
+      http_client->response_body << "{}";
+      Tracer tracer{*finalized};
+      Span span = tracer.create_span();
+    }
+
+    const auto& headers = http_client->request_headers.items;
+    const auto found = headers.find("Content-Encoding");
+    REQUIRE(found != headers.end());
+    CHECK(found->second == "gzip");
+    // The gzip magic number.
+    REQUIRE(http_client->request_body.size() > 2);
+    CHECK(http_client->request_body.substr(0, 2) == "\x1f\x8b");
+  }
+
+  SECTION("smaller bodies are sent uncompressed") {
+    config.agent.compression_min_bytes = 1 << 20;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    {
+      http_client->response_status = 200;
+      http_client->response_body << "{}";
+      Tracer tracer{*finalized};
+      Span span = tracer.create_span();
+    }
+
+    CHECK(http_client->request_headers.items.count("Content-Encoding") == 0);
+    CHECK(http_client->request_body.substr(0, 2) != "\x1f\x8b");
+  }
+}
+
+DATADOG_AGENT_TEST("adaptive flushing") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  logger->echo = nullptr;
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockHTTPClient>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.agent.remote_configuration_enabled = false;
+  config.agent.flush_interval_milliseconds = 1000;
+  config.agent.adaptive_flush_enabled = true;
+  config.agent.flush_max_spans = 3;
+  config.agent.serialize_on_send = GENERATE(false, true);
+  config.telemetry.enabled = false;
+
+  TimePoint now{std::chrono::system_clock::time_point(1700000000s),
+                std::chrono::steady_clock::time_point()};
+  const Clock clock = [&now]() { return now; };
+
+  SECTION("minimum payload must not exceed maximum payload") {
+    config.agent.flush_min_payload_bytes = 2;
+    config.agent.flush_max_payload_bytes = 1;
+    auto finalized = finalize_config(config, clock);
+    REQUIRE(!finalized);
+    CHECK(finalized.error().code == Error::DATADOG_AGENT_INVALID_FLUSH_POLICY);
+
+    // The limits aren't used, and so aren't checked, unless adaptive flushing
+    // is enabled.
+    config.agent.adaptive_flush_enabled = false;
+    config.agent.flush_max_spans = 0;
+    CHECK(finalize_config(config, clock));
+  }
+
+  SECTION("flushes per the flush policy") {
+    auto finalized = finalize_config(config, clock);
+    REQUIRE(finalized);
+    const auto& agent_config =
+        std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+    const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+    DatadogAgent agent(agent_config, config.logger, signature, {});
+    REQUIRE(event_scheduler->recurrence_interval == 250ms);
+
+    const auto send_spans = [&](int num_spans) {
+      for (int i = 0; i < num_spans; ++i) {
+        auto span = std::make_unique<SpanData>();
+        span->service = "testsvc";
+        span->name = "test.op";
+        span->span_id = 42;
+        std::vector<std::unique_ptr<SpanData>> chunk;
+        chunk.push_back(std::move(span));
+        REQUIRE(agent.send(std::move(chunk), nullptr));
+      }
+    };
+
+    // The interval hasn't elapsed, and not enough spans are buffered.
+    send_spans(2);
+    event_scheduler->event_callback();
+    CHECK(http_client->request_body.empty());
+
+    // Enough spans are buffered.
+    send_spans(1);
+    event_scheduler->event_callback();
+    CHECK(!http_client->request_body.empty());
+    http_client->clear();
+
+    SECTION("the interval elapses") {
+      send_spans(1);
+      now.tick += 499ms;
+      event_scheduler->event_callback();
+      CHECK(http_client->request_body.empty());
+      // The previous flush halved the interval.
+      now.tick += 1ms;
+      event_scheduler->event_callback();
+      CHECK(!http_client->request_body.empty());
+    }
+
+    SECTION("backs off while the Agent is overloaded") {
+      http_client->response_status = 429;
+      http_client->drain(now.tick);
+      send_spans(3);
+      event_scheduler->event_callback();
+      CHECK(http_client->request_body.empty());
+      now.tick += 999ms;
+      event_scheduler->event_callback();
+      CHECK(http_client->request_body.empty());
+      now.tick += 1ms;
+      event_scheduler->event_callback();
+      CHECK(!http_client->request_body.empty());
+    }
+  }
+}
+
+DATADOG_AGENT_TEST("trace retries") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  logger->echo = nullptr;
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockHTTPClient>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.agent.remote_configuration_enabled = false;
+  config.agent.flush_interval_milliseconds = 1000;
+  config.agent.serialize_on_send = GENERATE(false, true);
+  config.telemetry.enabled = false;
+
+  TimePoint now{std::chrono::system_clock::time_point(1700000000s),
+                std::chrono::steady_clock::time_point()};
+  const Clock clock = [&now]() { return now; };
+
+  SECTION("maximum retries must not be negative") {
+    config.agent.max_trace_retries = -1;
+    auto finalized = finalize_config(config, clock);
+    REQUIRE(!finalized);
+    CHECK(finalized.error().code ==
+          Error::DATADOG_AGENT_INVALID_MAX_TRACE_RETRIES);
+  }
+
+  const auto dropped_p0_traces = [&]() {
+    const auto& headers = http_client->request_headers.items;
+    const auto found = headers.find("Datadog-Client-Dropped-P0-Traces");
+    return found == headers.end() ? std::string{} : found->second;
+  };
+
+  SECTION("retries failed payloads") {
+    const auto max_retries = GENERATE(0, 1);
+    config.agent.max_trace_retries = max_retries;
+    CAPTURE(max_retries);
+    config.agent.max_buffered_spans = 1;
+    auto finalized = finalize_config(config, clock);
+    REQUIRE(finalized);
+    const auto& agent_config =
+        std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+    const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+    DatadogAgent agent(agent_config, config.logger, signature, {});
+
+    const auto make_chunk = [](std::uint64_t span_id, double priority) {
+      auto span = std::make_unique<SpanData>();
+      span->service = "testsvc";
+      span->name = "test.op";
+      span->span_id = span_id;
+      span->numeric_tags.emplace("_sampling_priority_v1", priority);
+      std::vector<std::unique_ptr<SpanData>> chunk;
+      chunk.push_back(std::move(span));
+      return chunk;
+    };
+    REQUIRE(agent.send(make_chunk(42, 1), nullptr));
+    // The buffer is full, so this sampled out chunk is dropped, and the drop
+    // is reported with the payload.
+    REQUIRE(agent.send(make_chunk(43, 0), nullptr));
+    event_scheduler->event_callback();
+    const std::string body = http_client->request_body;
+    REQUIRE(!body.empty());
+    CHECK(dropped_p0_traces() == "1");
+    const auto shared_body = http_client->shared_request_body;
+    http_client->clear();
+
+    SECTION("after a 5xx response") {
+      http_client->response_status = 503;
+      http_client->drain(now.tick);
+    }
+
+    SECTION("after a network error") {
+      http_client->response_error =
+          Error{Error::CURL_REQUEST_FAILURE, "connection refused"};
+      http_client->drain(now.tick);
+    }
+
+    // The retry isn't due yet.
+    event_scheduler->event_callback();
+    CHECK(http_client->request_body.empty());
+
+    // The first retry is due within a flush interval, and sends the same
+    // payload without encoding it again. Then there are no retries left.
+    now.tick += 1s;
+    event_scheduler->event_callback();
+    if (max_retries == 0) {
+      CHECK(http_client->request_body.empty());
+    } else {
+      CHECK(http_client->request_body == body);
+      // The retry shares the body of the failed request, but doesn't report
+      // the drops again.
+      CHECK(http_client->shared_request_body == shared_body);
+      CHECK(dropped_p0_traces().empty());
+      http_client->clear();
+      http_client->drain(now.tick);
+      now.tick += 1min;
+      event_scheduler->event_callback();
+      CHECK(http_client->request_body.empty());
+    }
+  }
+
+  SECTION("retries payloads that the HTTP client fails to send") {
+    config.agent.max_trace_retries = 1;
+    auto finalized = finalize_config(config, clock);
+    REQUIRE(finalized);
+    const auto& agent_config =
+        std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+    const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+    DatadogAgent agent(agent_config, config.logger, signature, {});
+
+    auto span = std::make_unique<SpanData>();
+    span->service = "testsvc";
+    span->name = "test.op";
+    span->span_id = 42;
+    std::vector<std::unique_ptr<SpanData>> chunk;
+    chunk.push_back(std::move(span));
+    REQUIRE(agent.send(std::move(chunk), nullptr));
+    http_client->post_error =
+        Error{Error::CURL_REQUEST_SETUP_FAILED, "out of handles"};
+    event_scheduler->event_callback();
+    const std::string body = http_client->request_body;
+    REQUIRE(!body.empty());
+    http_client->clear();
+    http_client->post_error = nullopt;
+
+    now.tick += 1s;
+    event_scheduler->event_callback();
+    CHECK(http_client->request_body == body);
+  }
+
+  SECTION("v0.5 payloads are not retried after falling back to v0.4") {
+    config.agent.trace_api_version = TraceApiVersion::V0_5;
+    auto finalized = finalize_config(config, clock);
+    REQUIRE(finalized);
+    const auto& agent_config =
+        std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+    const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+    DatadogAgent agent(agent_config, config.logger, signature, {});
+
+    const auto send_span = [&]() {
+      auto span = std::make_unique<SpanData>();
+      span->service = "testsvc";
+      span->name = "test.op";
+      span->span_id = 42;
+      std::vector<std::unique_ptr<SpanData>> chunk;
+      chunk.push_back(std::move(span));
+      REQUIRE(agent.send(std::move(chunk), nullptr));
+    };
+
+    // The first payload fails, and is to be retried.
+    send_span();
+    event_scheduler->event_callback();
+    REQUIRE(http_client->request_url.path == "/v0.5/traces");
+    http_client->response_status = 503;
+    http_client->drain(now.tick);
+
+    // The next payload finds that the Agent doesn't support v0.5.
+    http_client->clear();
+    send_span();
+    event_scheduler->event_callback();
+    REQUIRE(http_client->request_url.path == "/v0.5/traces");
+    http_client->response_status = 404;
+    http_client->drain(now.tick);
+
+    // The first payload is dropped rather than sent to "/v0.5/traces" again.
+    http_client->clear();
+    now.tick += 1s;
+    event_scheduler->event_callback();
+    CHECK(http_client->request_body.empty());
+  }
+
+  SECTION("client errors are not retried") {
+    auto finalized = finalize_config(config, clock);
+    REQUIRE(finalized);
+    const auto& agent_config =
+        std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+    const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+    DatadogAgent agent(agent_config, config.logger, signature, {});
+
+    auto span = std::make_unique<SpanData>();
+    span->service = "testsvc";
+    span->name = "test.op";
+    span->span_id = 42;
+    std::vector<std::unique_ptr<SpanData>> chunk;
+    chunk.push_back(std::move(span));
+    REQUIRE(agent.send(std::move(chunk), nullptr));
+    event_scheduler->event_callback();
+    REQUIRE(!http_client->request_body.empty());
+    http_client->clear();
+
+    http_client->response_status = 400;
+    http_client->drain(now.tick);
+    now.tick += 1min;
+    event_scheduler->event_callback();
+    CHECK(http_client->request_body.empty());
+  }
+}
+
+DATADOG_AGENT_TEST("parallel encoding") {
+  SECTION("needs at least one thread") {
+    TracerConfig config;
+    config.service = "testsvc";
+    config.agent.encoding_threads = 0;
+    auto finalized = finalize_config(config);
+    REQUIRE(!finalized);
+    CHECK(finalized.error().code ==
+          Error::DATADOG_AGENT_INVALID_ENCODING_THREADS);
+  }
+
+  SECTION("produces the same payload as one thread") {
+    // Flush the same large batch of chunks using one thread, and then using
+    // several.
+    std::vector<std::string> bodies;
+    for (const int threads : {1, 3}) {
+      const auto event_scheduler = std::make_shared<MockEventScheduler>();
+      const auto http_client = std::make_shared<MockHTTPClient>();
+
+      TracerConfig config;
+      config.service = "testsvc";
+      config.logger = std::make_shared<NullLogger>();
+      config.agent.event_scheduler = event_scheduler;
+      config.agent.http_client = http_client;
+      config.agent.remote_configuration_enabled = false;
+      config.agent.encoding_threads = threads;
+      config.telemetry.enabled = false;
+
+      auto finalized = finalize_config(config);
+      REQUIRE(finalized);
+      const auto& agent_config =
+          std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+      const TracerSignature signature(RuntimeID::generate(), "testsvc",
+                                      "test");
+      DatadogAgent agent(agent_config, config.logger, signature, {});
+
+      for (std::uint64_t i = 1; i <= 1000; ++i) {
+        std::vector<std::unique_ptr<SpanData>> chunk;
+        for (std::uint64_t j = 0; j < i % 5 + 1; ++j) {
+          auto span = std::make_unique<SpanData>();
+          span->service = "testsvc";
+          span->name = "test.op";
+          span->resource = "resource " + std::to_string(i) +
+                           std::string(static_cast<std::size_t>(i % 300), 'x');
+          span->trace_id = TraceID(i);
+          span->span_id = i * 10 + j;
+          chunk.push_back(std::move(span));
+        }
+        REQUIRE(agent.send(std::move(chunk), nullptr));
+      }
+
+      event_scheduler->event_callback();
+      bodies.push_back(http_client->request_body);
+    }
+
+    REQUIRE(bodies[0].size() > 256 * 1024);
+    CHECK(bodies[0] == bodies[1]);
+  }
+}
+
+DATADOG_AGENT_TEST("v0.5 traces API") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  logger->echo = nullptr;
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockHTTPClient>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  // With Remote Configuration disabled, the only scheduled event is the flush.
+  config.agent.remote_configuration_enabled = false;
+  config.agent.trace_api_version = TraceApiVersion::V0_5;
+  config.telemetry.enabled = false;
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  DatadogAgent agent(agent_config, config.logger, signature, {});
+
+  const auto send_span = [&](std::string resource) {
+    auto span = std::make_unique<SpanData>();
+    span->service = "testsvc";
+    span->name = "test.op";
+    span->resource = std::move(resource);
+    span->span_id = 42;
+    span->tags = {{"env", "dev"}, {"version", "1.0"}};
+    span->numeric_tags = {{"_sampling_priority_v1", 1}};
+    std::vector<std::unique_ptr<SpanData>> chunk;
+    chunk.push_back(std::move(span));
+    REQUIRE(agent.send(std::move(chunk), nullptr));
+  };
+
+  SECTION("payload is a string table followed by trace chunks") {
+    send_span("first");
+    send_span("second");
+    event_scheduler->event_callback();
+
+    REQUIRE(http_client->request_url.path == "/v0.5/traces");
+
+    const auto [strings, chunks] = decode_v05(http_client->request_body);
+
+    REQUIRE(strings.at(0) == "");
+    REQUIRE(chunks.size() == 2);
+    std::vector<std::string> resources;
+    for (const auto& chunk : chunks) {
+      REQUIRE(chunk.size() == 1);
+      const auto& span = chunk[0];
+      CHECK(strings.at(std::get<0>(span)) == "testsvc");
+      CHECK(strings.at(std::get<1>(span)) == "test.op");
+      resources.push_back(strings.at(std::get<2>(span)));
+      CHECK(std::get<4>(span) == 42);
+
+      std::map<std::string, std::string> meta;
+      for (const auto& [key, value] : std::get<9>(span)) {
+        meta.emplace(strings.at(key), strings.at(value));
+      }
+      CHECK(meta == std::map<std::string, std::string>{{"env", "dev"},
+                                                       {"version", "1.0"}});
+
+      std::map<std::string, double> metrics;
+      for (const auto& [key, value] : std::get<10>(span)) {
+        metrics.emplace(strings.at(key), value);
+      }
+      CHECK(metrics ==
+            std::map<std::string, double>{{"_sampling_priority_v1", 1}});
+    }
+    CHECK(resources == std::vector<std::string>{"first", "second"});
+
+    // Strings shared by both spans appear in the table only once.
+    std::set<std::string> distinct(strings.begin(), strings.end());
+    CHECK(distinct.size() == strings.size());
+  }
+
+  SECTION("falls back to v0.4 when the Agent does not support v0.5") {
+    http_client->response_status = 404;
+    send_span("first");
+    event_scheduler->event_callback();
+    REQUIRE(http_client->request_url.path == "/v0.5/traces");
+    http_client->drain(std::chrono::steady_clock::now());
+    CHECK(logger->error_count() == 1);
+
+    http_client->response_status = 200;
+    http_client->response_body << "{}";
+    send_span("second");
+    event_scheduler->event_callback();
+    REQUIRE(http_client->request_url.path == "/v0.4/traces");
+    const auto decoded =
+        nlohmann::json::from_msgpack(http_client->request_body);
+    REQUIRE(decoded.size() == 1);
+    CHECK(decoded[0][0]["resource"] == "second");
+  }
+}
+
+DATADOG_AGENT_TEST("serialize on send") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockHTTPClient>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.agent.remote_configuration_enabled = false;
+  config.agent.trace_api_version =
+      GENERATE(TraceApiVersion::V0_4, TraceApiVersion::V0_5);
+  config.telemetry.enabled = false;
+
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+
+  // Send the same chunks to a `DatadogAgent` that serializes on send, and to
+  // one that serializes on flush, and compare their payloads.
+  std::vector<std::string> payloads;
+  for (const bool serialize_on_send : {true, false}) {
+    config.agent.serialize_on_send = serialize_on_send;
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    const auto& agent_config =
+        std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+    DatadogAgent agent(agent_config, config.logger, signature, {});
+
+    for (int num_spans = 1; num_spans <= 3; ++num_spans) {
+      std::vector<std::unique_ptr<SpanData>> chunk;
+      for (int i = 0; i < num_spans; ++i) {
+        auto span = std::make_unique<SpanData>();
+        span->service = "testsvc";
+        span->name = "span" + std::to_string(i);
+        span->span_id = 100 * num_spans + i;
+        span->tags = {{"env", "dev"}, {"chunk", std::to_string(num_spans)}};
+        chunk.push_back(std::move(span));
+      }
+      REQUIRE(agent.send(std::move(chunk), nullptr));
+    }
+
+    http_client->clear();
+    event_scheduler->event_callback();
+    CHECK(http_client->request_headers.items.at("X-Datadog-Trace-Count") ==
+          "3");
+    payloads.push_back(http_client->request_body);
+
+    // Nothing more to flush.
+    http_client->clear();
+    event_scheduler->event_callback();
+    CHECK(http_client->request_body.empty());
+  }
+
+  if (config.agent.trace_api_version == TraceApiVersion::V0_5) {
+    CHECK(decode_v05(payloads[0]) == decode_v05(payloads[1]));
+  } else {
+    CHECK(nlohmann::json::from_msgpack(payloads[0]) ==
+          nlohmann::json::from_msgpack(payloads[1]));
+  }
+}
+
+DATADOG_AGENT_TEST("trace buffer limits") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockHTTPClient>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.agent.remote_configuration_enabled = false;
+  config.agent.serialize_on_send = GENERATE(false, true);
+  config.telemetry.enabled = false;
+
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+
+  // Each chunk is a single span, identified by its span ID.
+  const auto make_chunk = [](std::uint64_t span_id, double priority) {
+    auto span = std::make_unique<SpanData>();
+    span->service = "testsvc";
+    span->name = "test.span";
+    span->span_id = span_id;
+    span->numeric_tags.emplace("_sampling_priority_v1", priority);
+    std::vector<std::unique_ptr<SpanData>> chunk;
+    chunk.push_back(std::move(span));
+    return chunk;
+  };
+
+  const auto flush = [&]() {
+    http_client->clear();
+    event_scheduler->event_callback();
+    std::vector<std::uint64_t> span_ids;
+    if (http_client->request_body.empty()) {
+      return span_ids;
+    }
+    const auto payload =
+        nlohmann::json::from_msgpack(http_client->request_body);
+    for (const auto& chunk : payload) {
+      span_ids.push_back(chunk.at(0).at("span_id"));
+    }
+    return span_ids;
+  };
+
+  const auto dropped_p0_header = [&](const std::string& name) {
+    const auto& headers = http_client->request_headers.items;
+    const auto found = headers.find(name);
+    return found == headers.end() ? std::string{} : found->second;
+  };
+
+  const auto make_agent = [&]() {
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    const auto& agent_config =
+        std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+    const std::vector<std::shared_ptr<remote_config::Listener>> listeners;
+    return std::make_unique<DatadogAgent>(agent_config, config.logger,
+                                          signature, listeners);
+  };
+
+  // Chunks 2 and 4 are sampled out. Only three spans fit in the buffer.
+  const std::vector<std::pair<std::uint64_t, double>> chunks = {
+      {1, 1}, {2, 0}, {3, 2}, {4, -1}, {5, 1}};
+  config.agent.max_buffered_spans = 3;
+
+  SECTION("drop newest") {
+    config.agent.buffer_overflow_policy =
+        TraceBufferOverflowPolicy::DROP_NEWEST;
+    auto agent = make_agent();
+    for (const auto& [span_id, priority] : chunks) {
+      REQUIRE(agent->send(make_chunk(span_id, priority), nullptr));
+    }
+    CHECK(flush() == std::vector<std::uint64_t>{1, 2, 3});
+    CHECK(dropped_p0_header("Datadog-Client-Dropped-P0-Traces") == "1");
+    CHECK(dropped_p0_header("Datadog-Client-Dropped-P0-Spans") == "1");
+
+    // Drops are reported only once, and the buffer has room again.
+    for (const auto& [span_id, priority] : chunks) {
+      REQUIRE(agent->send(make_chunk(span_id + 10, priority), nullptr));
+    }
+    CHECK(flush() == std::vector<std::uint64_t>{11, 12, 13});
+    CHECK(dropped_p0_header("Datadog-Client-Dropped-P0-Traces") == "1");
+  }
+
+  SECTION("drop oldest") {
+    config.agent.buffer_overflow_policy =
+        TraceBufferOverflowPolicy::DROP_OLDEST;
+    auto agent = make_agent();
+    for (const auto& [span_id, priority] : chunks) {
+      REQUIRE(agent->send(make_chunk(span_id, priority), nullptr));
+    }
+    CHECK(flush() == std::vector<std::uint64_t>{3, 4, 5});
+    CHECK(dropped_p0_header("Datadog-Client-Dropped-P0-Traces") == "1");
+    CHECK(dropped_p0_header("Datadog-Client-Dropped-P0-Spans") == "1");
+  }
+
+  SECTION("drop unsampled first") {
+    config.agent.buffer_overflow_policy =
+        TraceBufferOverflowPolicy::DROP_UNSAMPLED_FIRST;
+    auto agent = make_agent();
+    for (const auto& [span_id, priority] : chunks) {
+      REQUIRE(agent->send(make_chunk(span_id, priority), nullptr));
+    }
+    CHECK(flush() == std::vector<std::uint64_t>{1, 3, 5});
+    CHECK(dropped_p0_header("Datadog-Client-Dropped-P0-Traces") == "2");
+    CHECK(dropped_p0_header("Datadog-Client-Dropped-P0-Spans") == "2");
+
+    // A sampled out chunk containing a span kept by a span sampling rule is
+    // not dropped in favor of other chunks. When nothing can be dropped, the
+    // new chunk is.
+    auto span_sampled = make_chunk(6, 0);
+    span_sampled.front()->numeric_tags.emplace("_dd.span_sampling.mechanism",
+                                               8);
+    REQUIRE(agent->send(std::move(span_sampled), nullptr));
+    REQUIRE(agent->send(make_chunk(7, 1), nullptr));
+    REQUIRE(agent->send(make_chunk(8, 1), nullptr));
+    REQUIRE(agent->send(make_chunk(9, 1), nullptr));
+    CHECK(flush() == std::vector<std::uint64_t>{6, 7, 8});
+    CHECK(dropped_p0_header("Datadog-Client-Dropped-P0-Traces").empty());
+  }
+
+  SECTION("byte limit") {
+    config.agent.buffer_overflow_policy =
+        TraceBufferOverflowPolicy::DROP_OLDEST;
+    config.agent.max_buffered_spans = nullopt;
+    // Each chunk is an array containing one span.
+    const auto chunk = make_chunk(1, 1);
+    const std::size_t chunk_size = 1 + msgpack_encoded_size(*chunk.front());
+    config.agent.max_buffered_bytes = 2 * chunk_size;
+    auto agent = make_agent();
+    for (const auto& [span_id, priority] : chunks) {
+      REQUIRE(agent->send(make_chunk(span_id, priority), nullptr));
+    }
+    CHECK(flush() == std::vector<std::uint64_t>{4, 5});
+    CHECK(dropped_p0_header("Datadog-Client-Dropped-P0-Traces") == "1");
+
+    // A chunk that is too large by itself is dropped without dropping others.
+    auto large = make_chunk(6, 1);
+    large.front()->tags.emplace("large", std::string(chunk_size, 'x'));
+    REQUIRE(agent->send(make_chunk(7, 1), nullptr));
+    REQUIRE(agent->send(std::move(large), nullptr));
+    CHECK(flush() == std::vector<std::uint64_t>{7});
+  }
+
+  SECTION("v0.5 payloads don't include the strings of dropped chunks") {
+    config.agent.trace_api_version = TraceApiVersion::V0_5;
+    config.agent.buffer_overflow_policy =
+        GENERATE(TraceBufferOverflowPolicy::DROP_NEWEST,
+                 TraceBufferOverflowPolicy::DROP_OLDEST,
+                 TraceBufferOverflowPolicy::DROP_UNSAMPLED_FIRST);
+    auto agent = make_agent();
+    for (const auto& [span_id, priority] : chunks) {
+      auto chunk = make_chunk(span_id, priority);
+      chunk.front()->resource = "resource-" + std::to_string(span_id);
+      REQUIRE(agent->send(std::move(chunk), nullptr));
+    }
+    http_client->clear();
+    event_scheduler->event_callback();
+    const std::string& body = http_client->request_body;
+    int num_resources = 0;
+    for (const auto& [span_id, priority] : chunks) {
+      const auto resource = "resource-" + std::to_string(span_id);
+      num_resources += body.find(resource) != std::string::npos;
+    }
+    CHECK(num_resources == 3);
+  }
+
+  SECTION("limits must be positive") {
+    SECTION("spans") { config.agent.max_buffered_spans = 0; }
+    SECTION("bytes") { config.agent.max_buffered_bytes = 0; }
+    auto finalized = finalize_config(config);
+    REQUIRE(!finalized);
+    CHECK(finalized.error().code ==
+          Error::DATADOG_AGENT_INVALID_TRACE_BUFFER_LIMIT);
+  }
+}
+
+DATADOG_AGENT_TEST("concurrent senders") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockHTTPClient>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.agent.remote_configuration_enabled = false;
+  config.agent.serialize_on_send = GENERATE(false, true);
+  config.telemetry.enabled = false;
+
+  const std::size_t num_threads = 8;
+  const std::size_t chunks_per_thread = 500;
+  std::size_t expected_chunks = num_threads * chunks_per_thread;
+  SECTION("unlimited") {}
+  SECTION("limited") {
+    expected_chunks = 1000;
+    config.agent.max_buffered_spans = expected_chunks;
+  }
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  const std::vector<std::shared_ptr<remote_config::Listener>> listeners;
+  DatadogAgent agent(agent_config, config.logger, signature, listeners);
+
+  // Each thread sends chunks of one span, whose ID encodes the thread and the
+  // order in which the thread sent it. Catch2 assertions are not thread-safe,
+  // so errors are counted instead.
+  std::atomic<std::size_t> num_errors{0};
+  std::vector<std::thread> threads;
+  for (std::size_t thread = 0; thread < num_threads; ++thread) {
+    threads.emplace_back([&, thread]() {
+      for (std::size_t i = 0; i < chunks_per_thread; ++i) {
+        auto span = std::make_unique<SpanData>();
+        span->service = "testsvc";
+        span->name = "test.span";
+        span->span_id = thread * chunks_per_thread + i + 1;
+        std::vector<std::unique_ptr<SpanData>> chunk;
+        chunk.push_back(std::move(span));
+        if (!agent.send(std::move(chunk), nullptr)) {
+          ++num_errors;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  REQUIRE(num_errors == 0);
+
+  event_scheduler->event_callback();
+  const auto payload = nlohmann::json::from_msgpack(http_client->request_body);
+  REQUIRE(payload.size() == expected_chunks);
+
+  // The chunks sent by each thread are in the order that the thread sent them.
+  std::vector<std::uint64_t> last_span_ids(num_threads, 0);
+  bool in_order = true;
+  for (const auto& chunk : payload) {
+    const std::uint64_t span_id = chunk.at(0).at("span_id");
+    const std::size_t thread = (span_id - 1) / chunks_per_thread;
+    in_order = in_order && span_id > last_span_ids[thread];
+    last_span_ids[thread] = span_id;
+  }
+  CHECK(in_order);
+}
+
+DATADOG_AGENT_TEST("client-side trace stats") {
+  const auto logger =
+      std::make_shared<MockLogger>(std::cerr, MockLogger::ERRORS_ONLY);
+  const auto event_scheduler = std::make_shared<MockEventScheduler>();
+  const auto http_client = std::make_shared<MockHTTPClient>();
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = logger;
+  config.agent.event_scheduler = event_scheduler;
+  config.agent.http_client = http_client;
+  config.agent.remote_configuration_enabled = false;
+  config.agent.stats_computation_enabled = true;
+  config.agent.serialize_on_send = GENERATE(false, true);
+  config.telemetry.enabled = false;
+
+  TimePoint now{std::chrono::system_clock::time_point(1700000000s),
+                std::chrono::steady_clock::time_point()};
+  const Clock clock = [&now]() { return now; };
+
+  auto finalized = finalize_config(config, clock);
+  REQUIRE(finalized);
+  const auto& agent_config =
+      std::get<FinalizedDatadogAgentConfig>(finalized->collector);
+  REQUIRE(agent_config.stats_computation_enabled);
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "test");
+  const std::vector<std::shared_ptr<remote_config::Listener>> listeners;
+  DatadogAgent agent(agent_config, config.logger, signature, listeners);
+
+  // Each chunk has a root span and a child span.
+  std::uint64_t next_span_id = 1;
+  const auto make_chunk = [&](double priority) {
+    std::vector<std::unique_ptr<SpanData>> chunk;
+    for (int i = 0; i < 2; ++i) {
+      auto span = std::make_unique<SpanData>();
+      span->service = "testsvc";
+      span->name = "test.span";
+      span->span_id = next_span_id++;
+      span->parent_id = i == 0 ? 0 : chunk.front()->span_id;
+      span->start = now;
+      chunk.push_back(std::move(span));
+    }
+    chunk.front()->numeric_tags.emplace("_sampling_priority_v1", priority);
+    return chunk;
+  };
+
+  REQUIRE(agent.send(make_chunk(1), nullptr));
+  REQUIRE(agent.send(make_chunk(0), nullptr));
+  // A sampled out chunk whose child span is kept by a span sampling rule.
+  auto span_sampled = make_chunk(-1);
+  span_sampled.back()->numeric_tags.emplace("_dd.span_sampling.mechanism", 8);
+  REQUIRE(agent.send(std::move(span_sampled), nullptr));
+
+  // Sampled out spans are not sent, but are reported as dropped.
+  http_client->clear();
+  event_scheduler->event_callback();
+  REQUIRE(http_client->request_url.path == "/v0.4/traces");
+  const auto payload = nlohmann::json::from_msgpack(http_client->request_body);
+  REQUIRE(payload.size() == 2);
+  CHECK(payload.at(0).size() == 2);
+  REQUIRE(payload.at(1).size() == 1);
+  CHECK(payload.at(1).at(0).at("span_id") == 6);
+  const auto& headers = http_client->request_headers.items;
+  CHECK(headers.at("Datadog-Client-Computed-Stats") == "yes");
+  CHECK(headers.at("Datadog-Client-Dropped-P0-Traces") == "1");
+  CHECK(headers.at("Datadog-Client-Dropped-P0-Spans") == "3");
+
+  // Trace stats are sent once their ten second bucket has ended. Every root
+  // span is counted, including those that were not sent.
+  now.wall += 10s;
+  http_client->clear();
+  event_scheduler->event_callback();
+  REQUIRE(http_client->request_url.path == "/v0.6/stats");
+  const auto stats = nlohmann::json::from_msgpack(http_client->request_body);
+  const auto& groups = stats.at("Stats").at(0).at("Stats");
+  REQUIRE(groups.size() == 1);
+  CHECK(groups.at(0).at("Name") == "test.span");
+  CHECK(groups.at(0).at("Hits") == 3);
+}
+
+DATADOG_AGENT_TEST("shared event loop") {
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = std::make_shared<NullLogger>();
+
+  SECTION("is shared by tracers that enable it") {
+    config.agent.shared_event_loop = true;
+    const auto first = finalize_config(config);
+    REQUIRE(first);
+    const auto second = finalize_config(config);
+    REQUIRE(second);
+
+    // Telemetry uses the same scheduler and HTTP client as the agent.
+    REQUIRE(first->event_scheduler != nullptr);
+    CHECK(first->event_scheduler == second->event_scheduler);
+    CHECK(first->http_client == second->http_client);
+    const auto loop_config =
+        nlohmann::json::parse(first->event_scheduler->config());
+    CHECK(loop_config["type"] == "datadog::tracing::EventLoop");
+  }
+
+  SECTION("doesn't replace a specified event scheduler or HTTP client") {
+    const auto event_scheduler = std::make_shared<MockEventScheduler>();
+    const auto http_client = std::make_shared<MockHTTPClient>();
+    config.agent.shared_event_loop = true;
+    config.agent.event_scheduler = event_scheduler;
+    config.agent.http_client = http_client;
+    config.event_scheduler = event_scheduler;
+    const auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    CHECK(finalized->event_scheduler == event_scheduler);
+    CHECK(finalized->http_client == http_client);
+  }
+
+  SECTION("is not used by default") {
+    const auto first = finalize_config(config);
+    REQUIRE(first);
+    const auto second = finalize_config(config);
+    REQUIRE(second);
+    CHECK(first->event_scheduler != second->event_scheduler);
+  }
+}
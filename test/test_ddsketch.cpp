@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ddsketch.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+
+#define DDSKETCH_TEST(x) TEST_CASE(x, "[ddsketch]")
+
+namespace {
+
+std::string little_endian(double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof bits);
+  std::string result;
+  for (int i = 0; i < 8; ++i) {
+    result += char((bits >> (8 * i)) & 0xFF);
+  }
+  return result;
+}
+
+}  // namespace
+
+DDSKETCH_TEST("empty sketch") {
+  DDSketch sketch;
+  CHECK(sketch.empty());
+  CHECK(sketch.count() == 0);
+  CHECK(sketch.quantile(0.5) == 0);
+}
+
+DDSKETCH_TEST("quantiles are within the relative accuracy") {
+  const double relative_accuracy = GENERATE(0.01, 0.05);
+  DDSketch sketch(relative_accuracy);
+
+  // Durations, in nanoseconds, between one microsecond and ten milliseconds.
+  std::vector<double> values;
+  for (int i = 1; i <= 10000; ++i) {
+    values.push_back(i * 1000.0 + (i % 7) * 13.0);
+  }
+  for (const double value : values) {
+    sketch.add(value);
+  }
+  std::sort(values.begin(), values.end());
+
+  REQUIRE(sketch.count() == values.size());
+  for (const double quantile : {0.0, 0.25, 0.5, 0.75, 0.9, 0.99, 1.0}) {
+    CAPTURE(quantile);
+    const double expected =
+        values[std::size_t(quantile * double(values.size() - 1))];
+    const double actual = sketch.quantile(quantile);
+    CHECK(std::abs(actual - expected) <= relative_accuracy * expected * 1.0001);
+  }
+}
+
+DDSKETCH_TEST("zero and negative values") {
+  DDSketch sketch;
+  sketch.add(0);
+  sketch.add(-5);
+  sketch.add(100);
+  CHECK(sketch.count() == 3);
+  CHECK(sketch.quantile(0) == 0);
+  CHECK(sketch.quantile(0.5) == 0);
+  CHECK(std::abs(sketch.quantile(1) - 100) <= 1);
+}
+
+DDSKETCH_TEST("lowest bins are collapsed") {
+  DDSketch sketch(0.01, 16);
+  for (double value = 1; value < 1e6; value *= 1.5) {
+    sketch.add(value);
+  }
+  // The highest quantiles remain accurate.
+  const double max =
+      std::pow(1.5, std::ceil(std::log(1e6) / std::log(1.5)) - 1);
+  CHECK(std::abs(sketch.quantile(1) - max) <= 0.01 * max * 1.0001);
+  // The lowest values were counted in the lowest remaining bin.
+  CHECK(sketch.quantile(0) > 1000);
+}
+
+DDSKETCH_TEST("values") {
+  DDSketch sketch;
+  CHECK(sketch.values(10).empty());
+
+  sketch.add(0);
+  for (int i = 1; i <= 1000; ++i) {
+    sketch.add(i);
+  }
+
+  SECTION("one for each counted value") {
+    const std::vector<double> values = sketch.values(2000);
+    REQUIRE(values.size() == 1001);
+    CHECK(values[0] == 0);
+    for (int i = 1; i <= 1000; ++i) {
+      CHECK(std::abs(values[i] - i) <= 0.01 * i * 1.0001);
+    }
+  }
+
+  SECTION("at most the maximum") {
+    const std::vector<double> values = sketch.values(10);
+    REQUIRE(values.size() == 10);
+    CHECK(std::is_sorted(values.begin(), values.end()));
+    // The values are near the 5th, 15th, ..., 95th percentiles.
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      const double expected = 50.05 + 100.1 * i;
+      CHECK(std::abs(values[i] - expected) <= 0.01 * expected + 1);
+    }
+  }
+}
+
+DDSKETCH_TEST("clear") {
+  DDSketch sketch;
+  sketch.add(42);
+  sketch.clear();
+  CHECK(sketch.empty());
+  CHECK(sketch.quantile(1) == 0);
+}
+
+DDSKETCH_TEST("protocol buffers encoding") {
+  const double gamma = 1.01 / 0.99;
+  DDSketch sketch;
+
+  // The mapping has only its `gamma` field (1, fixed64).
+  std::string mapping;
+  mapping += '\x0A';  // field 1, length delimited
+  mapping += '\x09';  // length
+  mapping += '\x09';  // field 1, fixed64
+  mapping += little_endian(gamma);
+
+  SECTION("empty") {
+    std::string encoded;
+    sketch.encode_protobuf(encoded);
+    CHECK(encoded == mapping);
+  }
+
+  SECTION("zero count and positive values") {
+    sketch.add(0);
+    sketch.add(1);  // index zero
+    sketch.add(1);
+
+    std::string expected = mapping;
+    expected += '\x12';  // field 2 (positive values), length delimited
+    expected += '\x0C';  // length
+    expected += '\x12';  // field 2 (contiguous bin counts), length delimited
+    expected += '\x08';  // length
+    expected += little_endian(2);
+    expected += '\x18';  // field 3 (contiguous bin index offset), varint
+    expected += '\x00';  // ZigZag encoded zero
+    expected += '\x21';  // field 4 (zero count), fixed64
+    expected += little_endian(1);
+
+    std::string encoded;
+    sketch.encode_protobuf(encoded);
+    CHECK(encoded == expected);
+  }
+
+  SECTION("negative index offset") {
+    // floor(log(0.5) / log(gamma)) is -35, which is 69 ZigZag encoded.
+    sketch.add(0.5);
+    std::string encoded;
+    sketch.encode_protobuf(encoded);
+    REQUIRE(encoded.size() == mapping.size() + 14);
+    CHECK(encoded.substr(encoded.size() - 2) == "\x18\x45");
+  }
+}
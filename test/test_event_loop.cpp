@@ -0,0 +1,256 @@
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "event_loop.h"
+#include "mocks/loggers.h"
+#include "null_logger.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+#define EVENT_LOOP_TEST(x) TEST_CASE(x, "[event_loop]")
+
+namespace {
+
+// Wait up to a few seconds for the specified `condition` to become true, and
+// return whether it did.
+template <typename Condition>
+bool eventually(Condition&& condition) {
+  const auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+
+// `FakeDrivenHTTPClient` counts the calls made by the thread that drives it.
+// Its `wait` blocks like a real client's would.
+struct FakeDrivenHTTPClient : public DrivenHTTPClient {
+  std::atomic<int> performs{0};
+  std::atomic<int> wakeups{0};
+  std::thread::id driver;
+  std::mutex mutex;
+  std::condition_variable woken_or_timeout;
+  bool woken = false;
+
+  Expected<void> post(const URL&, HeadersSetter, std::string, ResponseHandler,
+                      ErrorHandler,
+                      std::chrono::steady_clock::time_point) override {
+    return nullopt;
+  }
+
+  void drain(std::chrono::steady_clock::time_point) override {}
+
+  std::size_t perform() override {
+    std::lock_guard<std::mutex> lock(mutex);
+    driver = std::this_thread::get_id();
+    ++performs;
+    return 0;
+  }
+
+  void wait(std::chrono::steady_clock::duration timeout) override {
+    std::unique_lock<std::mutex> lock(mutex);
+    woken_or_timeout.wait_for(lock, timeout, [this]() { return woken; });
+    woken = false;
+  }
+
+  void wakeup() override {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++wakeups;
+    woken = true;
+    woken_or_timeout.notify_one();
+  }
+
+  void file_descriptors(std::vector<FileDescriptor>&) override {}
+
+  Optional<std::chrono::steady_clock::duration> timeout() override {
+    return nullopt;
+  }
+
+  std::string config() const override {
+    return R"({"type": "FakeDrivenHTTPClient"})";
+  }
+};
+
+}  // namespace
+
+EVENT_LOOP_TEST("events are invoked on the loop's thread") {
+  const auto loop = std::make_shared<EventLoop>(nullptr);
+  std::mutex mutex;
+  std::thread::id recurring_thread;
+  std::thread::id one_shot_thread;
+  std::atomic<int> count{0};
+
+  auto cancel_recurring = loop->schedule_recurring_event(10ms, [&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    recurring_thread = std::this_thread::get_id();
+    ++count;
+  });
+  auto cancel_one_shot = loop->schedule_event(5ms, [&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    one_shot_thread = std::this_thread::get_id();
+  });
+
+  CHECK(eventually([&]() { return count >= 3; }));
+  cancel_recurring();
+  cancel_one_shot();
+
+  const int final_count = count;
+  std::this_thread::sleep_for(50ms);
+  CHECK(count == final_count);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  CHECK(recurring_thread == one_shot_thread);
+  CHECK(recurring_thread != std::this_thread::get_id());
+  CHECK(loop->http_client() == nullptr);
+}
+
+EVENT_LOOP_TEST("cancelled one-shot events don't happen") {
+  const auto loop = std::make_shared<EventLoop>(nullptr);
+  std::atomic<int> count{0};
+  loop->schedule_event(20ms, [&]() { ++count; })();
+  auto cancel = loop->schedule_event(10ms, [&]() { ++count; });
+  CHECK(eventually([&]() { return count == 1; }));
+  std::this_thread::sleep_for(50ms);
+  CHECK(count == 1);
+  cancel();
+}
+
+EVENT_LOOP_TEST("event loop callbacks can cancel their own event") {
+  const auto loop = std::make_shared<EventLoop>(nullptr);
+  std::atomic<int> count{0};
+  EventScheduler::Cancel cancel;
+  std::mutex mutex;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    cancel = loop->schedule_recurring_event(5ms, [&]() {
+      ++count;
+      std::lock_guard<std::mutex> guard(mutex);
+      cancel();
+    });
+  }
+  CHECK(eventually([&]() { return count == 1; }));
+  std::this_thread::sleep_for(30ms);
+  CHECK(count == 1);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  cancel = nullptr;
+}
+
+EVENT_LOOP_TEST("event loop callbacks can release the last reference") {
+  auto loop = std::make_shared<EventLoop>(nullptr);
+  const std::weak_ptr<EventLoop> weak_loop = loop;
+  std::mutex mutex;
+  std::condition_variable released_cv;
+  bool released = false;
+  std::shared_ptr<EventLoop> last;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    loop->schedule_event(5ms, [&]() {
+      std::lock_guard<std::mutex> guard(mutex);
+      last.reset();
+      released = true;
+      released_cv.notify_one();
+    });
+    last = std::move(loop);
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  CHECK(released_cv.wait_for(lock, 5s, [&]() { return released; }));
+  CHECK(weak_loop.expired());
+}
+
+EVENT_LOOP_TEST("the loop drives its HTTP client") {
+  const auto client = std::make_shared<FakeDrivenHTTPClient>();
+  auto loop = std::make_shared<EventLoop>(client);
+  std::atomic<bool> called{false};
+  std::thread::id event_thread;
+
+  auto cancel = loop->schedule_event(10ms, [&]() {
+    event_thread = std::this_thread::get_id();
+    called = true;
+  });
+  CHECK(eventually([&]() { return called.load(); }));
+  CHECK(client->wakeups >= 1);
+  CHECK(eventually([&]() { return client->performs >= 2; }));
+  {
+    std::lock_guard<std::mutex> lock(client->mutex);
+    CHECK(client->driver == event_thread);
+  }
+  cancel();
+
+  SECTION("and its HTTP client shares ownership of the loop") {
+    const auto http_client = loop->http_client();
+    REQUIRE(http_client.get() == client.get());
+    const std::weak_ptr<EventLoop> weak_loop = loop;
+    loop.reset();
+    CHECK(!weak_loop.expired());
+    CHECK(http_client->post({}, nullptr, "", nullptr, nullptr, {}));
+  }
+}
+
+EVENT_LOOP_TEST("the shared loop is shared while it's held") {
+  const auto logger = std::make_shared<MockLogger>();
+  const Clock clock = default_clock;
+
+  auto first = EventLoop::shared(logger, clock);
+  auto second = EventLoop::shared(logger, clock);
+  CHECK(first == second);
+
+  const std::weak_ptr<EventLoop> weak = first;
+  first.reset();
+  CHECK(EventLoop::shared(logger, clock) == second);
+  second.reset();
+  CHECK(weak.expired());
+  CHECK(EventLoop::shared(logger, clock) != nullptr);
+}
+
+EVENT_LOOP_TEST("tracers can be destroyed by the shared loop's callbacks") {
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = std::make_shared<NullLogger>();
+  config.agent.shared_event_loop = true;
+  config.agent.remote_configuration_enabled = false;
+  config.agent.shutdown_timeout_milliseconds = 2000;
+  config.telemetry.enabled = false;
+  const auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  if (!finalized->http_client) {
+    // This library was built without libcurl.
+    return;
+  }
+
+  auto tracer = std::make_unique<Tracer>(*finalized);
+  // Give the tracer something to send while it's destroyed.
+  tracer->create_span();
+
+  // Destroying the tracer drains the loop's HTTP client on the loop's own
+  // thread, which must not wait for requests that only it can perform.
+  std::mutex mutex;
+  std::condition_variable destroyed_cv;
+  Optional<std::chrono::steady_clock::duration> elapsed;
+  auto cancel = finalized->event_scheduler->schedule_event(0ms, [&]() {
+    const auto before = std::chrono::steady_clock::now();
+    tracer.reset();
+    std::lock_guard<std::mutex> lock(mutex);
+    elapsed = std::chrono::steady_clock::now() - before;
+    destroyed_cv.notify_one();
+  });
+
+  std::unique_lock<std::mutex> lock(mutex);
+  REQUIRE(destroyed_cv.wait_for(lock, 5s, [&]() { return bool(elapsed); }));
+  CHECK(*elapsed < 1s);
+  lock.unlock();
+  cancel();
+}
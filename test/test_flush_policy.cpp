@@ -0,0 +1,80 @@
+#include <chrono>
+
+#include "flush_policy.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+#define FLUSH_POLICY_TEST(x) TEST_CASE(x, "[flush_policy]")
+
+namespace {
+
+const FlushPolicy::Config config{/*interval=*/1s, /*min_payload_bytes=*/100,
+                                 /*max_payload_bytes=*/1000,
+                                 /*max_spans=*/10};
+
+}  // namespace
+
+FLUSH_POLICY_TEST("flushes when the interval elapses") {
+  auto now = std::chrono::steady_clock::time_point{};
+  FlushPolicy policy{config, now};
+  CHECK(policy.tick() == 250ms);
+
+  CHECK(!policy.should_flush(now + 999ms, 500, 1));
+  now += 1s;
+  CHECK(policy.should_flush(now, 500, 1));
+  // The payload was within the target range.
+  CHECK(policy.interval() == 1s);
+  CHECK(!policy.should_flush(now + 999ms, 500, 1));
+}
+
+FLUSH_POLICY_TEST("small payloads lengthen the interval") {
+  auto now = std::chrono::steady_clock::time_point{};
+  FlushPolicy policy{config, now};
+
+  for (const auto expected : {2s, 4s, 4s}) {
+    now += policy.interval();
+    CHECK(policy.should_flush(now, 99, 1));
+    CHECK(policy.interval() == expected);
+  }
+}
+
+FLUSH_POLICY_TEST("full buffers flush early and shorten the interval") {
+  const auto now = std::chrono::steady_clock::time_point{};
+  FlushPolicy policy{config, now};
+
+  CHECK(policy.should_flush(now, 1000, 1));
+  CHECK(policy.interval() == 500ms);
+  CHECK(policy.should_flush(now, 0, 10));
+  CHECK(policy.interval() == 250ms);
+  CHECK(policy.should_flush(now, 1000, 10));
+  CHECK(policy.interval() == 250ms);
+}
+
+FLUSH_POLICY_TEST("overload responses back off") {
+  auto now = std::chrono::steady_clock::time_point{};
+  FlushPolicy policy{config, now};
+
+  const auto status = GENERATE(429, 503);
+  CAPTURE(status);
+  policy.on_response(status);
+  CHECK(policy.interval() == 2s);
+  // Full buffers wait for the interval, too.
+  CHECK(!policy.should_flush(now + 1s, 1000, 10));
+  CHECK(policy.should_flush(now + 2s, 1000, 10));
+  now += 2s;
+
+  for (int i = 0; i < 4; ++i) {
+    policy.on_response(status);
+  }
+  CHECK(policy.interval() == 1s * FlushPolicy::max_backoff);
+
+  // Other errors don't affect the backoff.
+  policy.on_response(500);
+  CHECK(policy.interval() == 1s * FlushPolicy::max_backoff);
+
+  policy.on_response(200);
+  CHECK(policy.interval() == 1s);
+  CHECK(policy.should_flush(now, 1000, 10));
+}
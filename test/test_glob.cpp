@@ -1,5 +1,5 @@
 // This test covers the glob-style string pattern matching function,
-// `glob_match`, defined in `glob.h`.
+// `glob_match`, and the equivalent `GlobPattern`, defined in `glob.h`.
 
 #include <datadog/glob.h>
 #include <datadog/string_view.h>
@@ -43,6 +43,18 @@ TEST_CASE("glob", "[glob]") {
     {"", "a", false},
     {"*", "", true},
     {"?", "", false},
+    {"**", "", true},
+    {"*?", "", false},
+
+    // prefixes, suffixes, and both
+    {"foo*", "foo", true},
+    {"foo**", "FOObar", true},
+    {"foo*", "fo", false},
+    {"*bar", "bar", true},
+    {"**bar", "fooBAR", true},
+    {"*bar", "ar", false},
+    {"*oo*", "foobar", true},
+    {"*oo*", "bar", false},
 
     // case sensitivity
     {"true", "TRUE", true},
@@ -57,4 +69,15 @@ TEST_CASE("glob", "[glob]") {
   CAPTURE(test_case.expected);
   REQUIRE(glob_match(test_case.pattern, test_case.subject) ==
           test_case.expected);
+  REQUIRE(GlobPattern(test_case.pattern).match(test_case.subject) ==
+          test_case.expected);
+}
+
+TEST_CASE("glob patterns without wildcards are exact", "[glob]") {
+  CHECK(GlobPattern("MySQL").is_exact());
+  CHECK(GlobPattern("MySQL").literal() == "mysql");
+  CHECK(GlobPattern("").is_exact());
+  CHECK(!GlobPattern("mysql*").is_exact());
+  CHECK(!GlobPattern("my?ql").is_exact());
+  CHECK(!GlobPattern("*").is_exact());
 }
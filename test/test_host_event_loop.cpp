@@ -0,0 +1,199 @@
+#include <datadog/event_scheduler.h>
+#include <datadog/host_event_loop.h>
+#include <datadog/http_client.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+#include <poll.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "null_logger.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+#define HOST_EVENT_LOOP_TEST(x) TEST_CASE(x, "[host_event_loop]")
+
+namespace {
+
+// Wait, as a program's event loop would, until one of the `loop`'s file
+// descriptors is ready or its timeout elapses, but for no longer than the
+// specified `max_wait`. Return whether a file descriptor is ready.
+bool wait_on(const HostEventLoop& loop,
+             std::chrono::milliseconds max_wait = 1000ms) {
+  std::vector<HostEventLoop::FileDescriptor> fds;
+  loop.file_descriptors(fds);
+  std::vector<pollfd> poll_fds;
+  for (const auto& fd : fds) {
+    short events = 0;
+    if (fd.readable) events |= POLLIN;
+    if (fd.writable) events |= POLLOUT;
+    poll_fds.push_back(pollfd{fd.fd, events, 0});
+  }
+
+  auto timeout = max_wait;
+  if (const auto loop_timeout = loop.timeout()) {
+    timeout = std::min(
+        timeout, std::chrono::ceil<std::chrono::milliseconds>(*loop_timeout));
+  }
+  return ::poll(poll_fds.data(), poll_fds.size(),
+                static_cast<int>(timeout.count())) > 0;
+}
+
+// Run the `loop` on this thread until the specified `condition` is true, for
+// up to a few seconds, and return whether it became true.
+template <typename Condition>
+bool run_until(HostEventLoop& loop, Condition&& condition) {
+  const auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    wait_on(loop, 100ms);
+    loop.process_events();
+  }
+  return true;
+}
+
+}  // namespace
+
+HOST_EVENT_LOOP_TEST("events run only when the host processes them") {
+  HostEventLoop loop{std::make_shared<NullLogger>()};
+  const auto scheduler = loop.event_scheduler();
+  REQUIRE(scheduler);
+
+  CHECK(!loop.timeout());
+
+  int count = 0;
+  std::thread::id event_thread;
+  auto cancel = scheduler->schedule_recurring_event(10ms, [&]() {
+    event_thread = std::this_thread::get_id();
+    ++count;
+  });
+
+  const auto timeout = loop.timeout();
+  REQUIRE(timeout);
+  // Events are due within the loop's resolution of 10 milliseconds.
+  CHECK(*timeout <= 30ms);
+
+  std::this_thread::sleep_for(50ms);
+  CHECK(count == 0);
+
+  CHECK(run_until(loop, [&]() { return count >= 3; }));
+  CHECK(event_thread == std::this_thread::get_id());
+
+  cancel();
+  const int final_count = count;
+  std::this_thread::sleep_for(30ms);
+  loop.process_events();
+  CHECK(count == final_count);
+}
+
+HOST_EVENT_LOOP_TEST("scheduling from another thread wakes the host") {
+  HostEventLoop loop{std::make_shared<NullLogger>()};
+  const auto scheduler = loop.event_scheduler();
+
+  CHECK(!wait_on(loop, 0ms));
+
+  std::atomic<bool> called{false};
+  EventScheduler::Cancel cancel;
+  std::thread([&]() {
+    cancel = scheduler->schedule_event(0ms, [&]() { called = true; });
+  }).join();
+
+  CHECK(wait_on(loop, 0ms));
+  CHECK(run_until(loop, [&]() { return called.load(); }));
+  CHECK(!wait_on(loop, 0ms));
+  cancel();
+}
+
+HOST_EVENT_LOOP_TEST("the host performs HTTP requests") {
+  HostEventLoop loop{std::make_shared<NullLogger>()};
+  const auto client = loop.http_client();
+  if (!client) {
+    // This library was built without libcurl.
+    return;
+  }
+
+  // Nothing listens on port 1, so the request fails quickly.
+  const auto url = HTTPClient::URL::parse("http://127.0.0.1:1");
+  REQUIRE(url);
+
+  std::atomic<int> num_errors{0};
+  const auto post = [&]() {
+    REQUIRE(client->post(
+        *url, [](DictWriter&) {}, "", [](int, const DictReader&, std::string) {},
+        [&](Error) { ++num_errors; },
+        std::chrono::steady_clock::now() + 5s));
+  };
+
+  SECTION("as the host's thread waits on them") {
+    post();
+    CHECK(wait_on(loop, 0ms));
+    CHECK(run_until(loop, [&]() { return num_errors == 1; }));
+  }
+
+  SECTION("or while draining, without the host") {
+    post();
+    client->drain(std::chrono::steady_clock::now() + 5s);
+    CHECK(num_errors == 1);
+  }
+}
+
+HOST_EVENT_LOOP_TEST("tracers configured with a host event loop use it") {
+  const auto loop =
+      std::make_shared<HostEventLoop>(std::make_shared<NullLogger>());
+  if (!loop->http_client()) {
+    // This library was built without libcurl.
+    return;
+  }
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = std::make_shared<NullLogger>();
+  config.agent.host_event_loop = loop;
+  // `host_event_loop` takes precedence.
+  config.agent.shared_event_loop = true;
+
+  const auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  // Telemetry uses the same scheduler and HTTP client as the agent.
+  CHECK(finalized->event_scheduler == loop->event_scheduler());
+  REQUIRE(finalized->http_client);
+  CHECK(finalized->http_client->config() == loop->http_client()->config());
+}
+
+HOST_EVENT_LOOP_TEST("tracers can be destroyed by the host loop's callbacks") {
+  const auto loop =
+      std::make_shared<HostEventLoop>(std::make_shared<NullLogger>());
+  if (!loop->http_client()) {
+    // This library was built without libcurl.
+    return;
+  }
+
+  TracerConfig config;
+  config.service = "testsvc";
+  config.logger = std::make_shared<NullLogger>();
+  config.agent.host_event_loop = loop;
+  config.agent.remote_configuration_enabled = false;
+  config.telemetry.enabled = false;
+  const auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+
+  auto tracer = std::make_unique<Tracer>(*finalized);
+  // Give the tracer something to send while it's destroyed.
+  tracer->create_span();
+
+  bool destroyed = false;
+  auto cancel = loop->event_scheduler()->schedule_event(0ms, [&]() {
+    tracer.reset();
+    destroyed = true;
+  });
+  CHECK(run_until(*loop, [&]() { return destroyed; }));
+  cancel();
+}
@@ -1,8 +1,11 @@
 #include <datadog/clock.h>
 #include <datadog/limiter.h>
 
+#include <atomic>
 #include <chrono>
 #include <ctime>
+#include <thread>
+#include <vector>
 
 #include "test.h"
 
@@ -141,4 +144,25 @@ TEST_CASE("limiter") {
     result = lim.allow();
     REQUIRE(!result.allowed);
   }
+
+  SECTION("allows exactly the available tokens across threads") {
+    const int max_tokens = 1000;
+    Limiter lim(clock, max_tokens, 1.0, 1);
+    std::atomic<int> allowed{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+      threads.emplace_back([&]() {
+        for (int j = 0; j < 500; ++j) {
+          const auto result = lim.allow();
+          if (result.allowed) {
+            ++allowed;
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    REQUIRE(allowed == max_tokens);
+  }
 }
@@ -1,7 +1,12 @@
 #include <datadog/error.h>
+#include <datadog/json.hpp>
 #include <datadog/msgpack.h>
+#include <datadog/span_data.h>
+#include <datadog/span_defaults.h>
 
 #include <cstdint>
+#include <limits>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -55,6 +60,200 @@ TEST_CASE("map element fails to encode") {
   }
 }
 
+TEST_CASE("integers use their smallest encoding") {
+  struct TestCase {
+    int line;
+    std::int64_t value;
+    std::string expected;
+  };
+
+  // clang-format off
+  auto test_case = GENERATE(values<TestCase>({
+    {__LINE__, 0, std::string(1, '\x00')},
+    {__LINE__, 127, "\x7F"},
+    {__LINE__, 128, "\xCC\x80"},
+    {__LINE__, 255, "\xCC\xFF"},
+    {__LINE__, 256, std::string("\xCD\x01\x00", 3)},
+    {__LINE__, 65535, "\xCD\xFF\xFF"},
+    {__LINE__, 65536, std::string("\xCE\x00\x01\x00\x00", 5)},
+    {__LINE__, 4294967295, "\xCE\xFF\xFF\xFF\xFF"},
+    {__LINE__, 4294967296, std::string("\xCF\x00\x00\x00\x01\x00\x00\x00\x00", 9)},
+    {__LINE__, -1, "\xFF"},
+    {__LINE__, -32, "\xE0"},
+    {__LINE__, -33, "\xD0\xDF"},
+    {__LINE__, -128, "\xD0\x80"},
+    {__LINE__, -129, "\xD1\xFF\x7F"},
+    {__LINE__, -32768, std::string("\xD1\x80\x00", 3)},
+    {__LINE__, -32769, "\xD2\xFF\xFF\x7F\xFF"},
+    {__LINE__, std::numeric_limits<std::int32_t>::min(), std::string("\xD2\x80\x00\x00\x00", 5)},
+    {__LINE__, std::numeric_limits<std::int64_t>::min(), std::string("\xD3\x80\x00\x00\x00\x00\x00\x00\x00", 9)},
+  }));
+  // clang-format on
+
+  CAPTURE(test_case.line);
+  CAPTURE(test_case.value);
+
+  std::string destination;
+  msgpack::pack_integer(destination, test_case.value);
+  REQUIRE(destination == test_case.expected);
+  REQUIRE(nlohmann::json::from_msgpack(destination) == test_case.value);
+
+  if (test_case.value >= 0) {
+    destination.clear();
+    msgpack::pack_integer(destination, std::uint64_t(test_case.value));
+    REQUIRE(destination == test_case.expected);
+  }
+}
+
+TEST_CASE("largest unsigned integer") {
+  std::string destination;
+  msgpack::pack_integer(destination, std::numeric_limits<std::uint64_t>::max());
+  REQUIRE(destination == "\xCF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF");
+}
+
+TEST_CASE("strings, arrays, and maps use their smallest header") {
+  struct TestCase {
+    int line;
+    std::size_t size;
+    std::string expected_string_header;
+    std::string expected_array_header;
+    std::string expected_map_header;
+  };
+
+  // clang-format off
+  auto test_case = GENERATE(values<TestCase>({
+    {__LINE__, 0, "\xA0", "\x90", "\x80"},
+    {__LINE__, 15, "\xAF", "\x9F", "\x8F"},
+    {__LINE__, 16, "\xB0", std::string("\xDC\x00\x10", 3), std::string("\xDE\x00\x10", 3)},
+    {__LINE__, 31, "\xBF", std::string("\xDC\x00\x1F", 3), std::string("\xDE\x00\x1F", 3)},
+    {__LINE__, 32, "\xD9\x20", std::string("\xDC\x00\x20", 3), std::string("\xDE\x00\x20", 3)},
+    {__LINE__, 255, "\xD9\xFF", std::string("\xDC\x00\xFF", 3), std::string("\xDE\x00\xFF", 3)},
+    {__LINE__, 256, std::string("\xDA\x01\x00", 3), std::string("\xDC\x01\x00", 3), std::string("\xDE\x01\x00", 3)},
+    {__LINE__, 65535, "\xDA\xFF\xFF", "\xDC\xFF\xFF", "\xDE\xFF\xFF"},
+    {__LINE__, 65536, std::string("\xDB\x00\x01\x00\x00", 5), std::string("\xDD\x00\x01\x00\x00", 5), std::string("\xDF\x00\x01\x00\x00", 5)},
+  }));
+  // clang-format on
+
+  CAPTURE(test_case.line);
+  CAPTURE(test_case.size);
+
+  const std::string value(test_case.size, 'x');
+  std::string destination;
+  REQUIRE(msgpack::pack_string(destination, value));
+  REQUIRE(destination == test_case.expected_string_header + value);
+  REQUIRE(nlohmann::json::from_msgpack(destination) == value);
+
+  destination.clear();
+  REQUIRE(msgpack::pack_array(destination, test_case.size));
+  REQUIRE(destination == test_case.expected_array_header);
+
+  destination.clear();
+  REQUIRE(msgpack::pack_map(destination, test_case.size));
+  REQUIRE(destination == test_case.expected_map_header);
+}
+
+TEST_CASE("compact encoding round trips") {
+  const std::pair<std::string, std::int64_t> pairs[] = {
+      {"small", 1}, {"negative", -1000}, {"large", 1LL << 40}};
+  std::string destination;
+  REQUIRE(msgpack::pack_map(destination, pairs,
+                            [](std::string& buffer, std::int64_t value) {
+                              msgpack::pack_integer(buffer, value);
+                              return Expected<void>{};
+                            }));
+
+  const auto decoded = nlohmann::json::from_msgpack(destination);
+  REQUIRE(decoded == nlohmann::json{{"small", 1},
+                                    {"negative", -1000},
+                                    {"large", 1LL << 40}});
+}
+
+TEST_CASE("pre-encoded keys match pack_string") {
+  constexpr auto encoded = msgpack::make_fixstr("trace_id");
+  std::string expected;
+  REQUIRE(msgpack::pack_string(expected, "trace_id"));
+  REQUIRE(std::string(encoded.data(), encoded.size()) == expected);
+}
+
+TEST_CASE("span encoding") {
+  SpanData span;
+  span.service = "testsvc";
+  span.name = "test.op";
+  span.resource = "GET /";
+  span.service_type = "web";
+  span.trace_id = TraceID{0xCAFEBABE, 0xDEADBEEF};
+  span.span_id = 1234;
+  span.parent_id = 0;
+  span.start.wall = std::chrono::system_clock::time_point(
+      std::chrono::nanoseconds(1'700'000'000'000'000'000));
+  span.duration = std::chrono::microseconds(250);
+  span.error = true;
+  span.tags = {{"foo", "bar"}, {"long", std::string(300, 'x')}};
+  span.numeric_tags = {{"_sampling_priority_v1", 2.0}};
+
+  std::vector<std::unique_ptr<SpanData>> spans;
+  spans.push_back(std::make_unique<SpanData>(span));
+  spans.push_back(std::make_unique<SpanData>(span));
+
+  std::string destination;
+  REQUIRE(msgpack_encode(destination, spans));
+
+  const auto decoded = nlohmann::json::from_msgpack(destination);
+  REQUIRE(decoded.size() == 2);
+  for (const auto& item : decoded) {
+    REQUIRE(item.size() == 12);
+    REQUIRE(item["service"] == "testsvc");
+    REQUIRE(item["name"] == "test.op");
+    REQUIRE(item["resource"] == "GET /");
+    REQUIRE(item["type"] == "web");
+    REQUIRE(item["trace_id"] == 0xCAFEBABE);
+    REQUIRE(item["span_id"] == 1234);
+    REQUIRE(item["parent_id"] == 0);
+    REQUIRE(item["start"] == 1'700'000'000'000'000'000);
+    REQUIRE(item["duration"] == 250'000);
+    REQUIRE(item["error"] == 1);
+    REQUIRE(item["meta"] == nlohmann::json{{"foo", "bar"},
+                                           {"long", std::string(300, 'x')}});
+    REQUIRE(item["metrics"] == nlohmann::json{{"_sampling_priority_v1", 2.0}});
+  }
+}
+
+TEST_CASE("span encoding includes shared tags") {
+  auto defaults = std::make_shared<SpanDefaults>();
+  defaults->tags = {{"foo", "default"}, {"team", "core"}};
+  auto segment_tags = std::make_shared<SharedSpanTags>();
+  segment_tags->tags = {{"language", "cpp"}};
+  segment_tags->numeric_tags = {{"process_id", 42}};
+
+  SpanData span;
+  span.defaults = defaults;
+  span.segment_tags = segment_tags;
+  // A span's tag overrides a default tag, and a segment tag overrides both.
+  span.tags = {{"foo", "bar"}, {"language", "overridden"}};
+  span.numeric_tags = {{"process_id", 1}, {"_sampling_priority_v1", 2}};
+
+  std::string destination;
+  REQUIRE(msgpack_encode(destination, span));
+  CHECK(msgpack_encoded_size(span) == destination.size());
+
+  const auto decoded = nlohmann::json::from_msgpack(destination);
+  CHECK(decoded["meta"] == nlohmann::json{{"foo", "bar"},
+                                          {"team", "core"},
+                                          {"language", "cpp"}});
+  CHECK(decoded["metrics"] ==
+        nlohmann::json{{"process_id", 42}, {"_sampling_priority_v1", 2}});
+  CHECK(span.find_tag("team") == "core");
+  CHECK(span.find_tag("language") == "cpp");
+  CHECK(span.find_numeric_tag("process_id") == 42);
+
+  SECTION("copied default tags are no longer shared") {
+    span.copy_default_tags();
+    CHECK(span.defaults == nullptr);
+    CHECK(span.tags.at("foo") == "bar");
+    CHECK(span.tags.at("team") == "core");
+  }
+}
+
 // The following group of tests verify that encoding routines return an error
 // if the size of their input cannot fit in 32 bits.
 // This is impossible to do on a 32-bit system, so these tests are excluded by
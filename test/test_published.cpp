@@ -0,0 +1,42 @@
+#include <memory>
+#include <thread>
+
+#include "published.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+
+#define PUBLISHED_TEST(x) TEST_CASE(x, "[published]")
+
+PUBLISHED_TEST("each object's value is cached separately by each thread") {
+  Published<int> first{std::make_shared<const int>(1)};
+  Published<int> second{std::make_shared<const int>(2)};
+
+  // Reading one object doesn't disturb a value read from another.
+  const int& first_value = first.get();
+  const int& second_value = second.get();
+  CHECK(&first.get() == &first_value);
+  CHECK(&second.get() == &second_value);
+  CHECK(first_value == 1);
+  CHECK(second_value == 2);
+
+  first.publish(std::make_shared<const int>(3));
+  CHECK(first.get() == 3);
+  CHECK(second.get() == 2);
+  std::thread([&]() {
+    CHECK(first.get() == 3);
+    CHECK(second.get() == 2);
+  }).join();
+}
+
+PUBLISHED_TEST("cached values are released with their object") {
+  auto value = std::make_shared<const int>(1);
+  const std::weak_ptr<const int> weak_value = value;
+  {
+    Published<int> published{std::move(value)};
+    CHECK(published.get() == 1);
+    std::thread([&]() { CHECK(published.get() == 1); }).join();
+    CHECK(!weak_value.expired());
+  }
+  CHECK(weak_value.expired());
+}
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <string>
+
+#include "retry_queue.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+#define RETRY_QUEUE_TEST(x) TEST_CASE(x, "[retry_queue]")
+
+namespace {
+
+using Queue = RetryQueue<std::string>;
+
+const Queue::Config config{/*initial_delay=*/1s, /*max_delay=*/4s,
+                           /*max_retries=*/3, /*max_bytes=*/10};
+
+}  // namespace
+
+RETRY_QUEUE_TEST("delays grow exponentially, with jitter") {
+  Queue queue{config};
+  for (int i = 0; i < 100; ++i) {
+    const auto first = queue.delay(1);
+    CHECK(first >= 500ms);
+    CHECK(first <= 1s);
+    const auto second = queue.delay(2);
+    CHECK(second >= 1s);
+    CHECK(second <= 2s);
+    // The delay is capped.
+    const auto tenth = queue.delay(10);
+    CHECK(tenth >= 2s);
+    CHECK(tenth <= 4s);
+  }
+}
+
+RETRY_QUEUE_TEST("payloads are dropped after too many failures") {
+  Queue queue{config};
+  const auto now = std::chrono::steady_clock::time_point{};
+  CHECK(queue.push("abc", 3, 3, now) == Queue::Outcome::QUEUED);
+  CHECK(queue.push("abc", 3, 4, now) == Queue::Outcome::TOO_MANY_FAILURES);
+  CHECK(queue.size() == 3);
+}
+
+RETRY_QUEUE_TEST("payloads are dropped when the queue is full") {
+  Queue queue{config};
+  const auto now = std::chrono::steady_clock::time_point{};
+  CHECK(queue.push("abcdef", 6, 1, now) == Queue::Outcome::QUEUED);
+  CHECK(queue.push("abcde", 5, 1, now) == Queue::Outcome::FULL);
+  CHECK(queue.push("abcd", 4, 1, now) == Queue::Outcome::QUEUED);
+  CHECK(queue.size() == 10);
+  CHECK(queue.push("a", 1, 1, now) == Queue::Outcome::FULL);
+
+  // Taking payloads makes room for more.
+  CHECK(queue.take_due(now + 1s).size() == 2);
+  CHECK(queue.size() == 0);
+  CHECK(queue.push("abcde", 5, 1, now) == Queue::Outcome::QUEUED);
+}
+
+RETRY_QUEUE_TEST("due payloads are taken in the order queued") {
+  Queue queue{config};
+  const auto now = std::chrono::steady_clock::time_point{};
+  REQUIRE(queue.push("a", 1, 3, now) == Queue::Outcome::QUEUED);
+  REQUIRE(queue.push("b", 1, 1, now) == Queue::Outcome::QUEUED);
+  REQUIRE(queue.push("c", 1, 1, now) == Queue::Outcome::QUEUED);
+
+  CHECK(queue.take_due(now + 499ms).empty());
+
+  // "b" and "c" are due after at most a second, but "a" after at least two.
+  auto due = queue.take_due(now + 1s);
+  REQUIRE(due.size() == 2);
+  CHECK(due[0].payload == "b");
+  CHECK(due[0].failures == 1);
+  CHECK(due[1].payload == "c");
+  CHECK(queue.size() == 1);
+
+  due = queue.take_due(now + 4s);
+  REQUIRE(due.size() == 1);
+  CHECK(due[0].payload == "a");
+  CHECK(due[0].failures == 3);
+  CHECK(queue.size() == 0);
+}
@@ -168,6 +168,20 @@ TEST_SPAN("remove_tag") {
     REQUIRE(!span.lookup_tag("_dd.mayfly"));
     REQUIRE(!span.lookup_tag("foo"));
   }
+
+  SECTION("default tags can be removed") {
+    config.tags = {{"mayfly", "carpe diem"}, {"team", "core"}};
+    auto finalized = finalize_config(config);
+    REQUIRE(finalized);
+    Tracer tracer_with_tags{*finalized};
+    auto span = tracer_with_tags.create_span();
+    REQUIRE(span.lookup_tag("mayfly") == "carpe diem");
+
+    span.remove_tag("mayfly");
+
+    REQUIRE(!span.lookup_tag("mayfly"));
+    REQUIRE(span.lookup_tag("team") == "core");
+  }
 }
 
 TEST_SPAN("set_metric") {
@@ -142,3 +142,20 @@ TEST_SPAN_LINK("SpanData emits span_links array when present") {
   REQUIRE(encoded["span_id"].get<std::uint64_t>() == 123);
   REQUIRE(encoded["attributes"]["link.key"].get<std::string>() == "value");
 }
+
+TEST_SPAN_LINK("JSON representation for the _dd.span_links tag") {
+  SpanLink minimal{SpanContext(TraceID(/*low=*/0x99, /*high=*/0x11), 123)};
+  SpanLink full{SpanContext(TraceID(1), 2, "dd=s:1", 1)};
+  full.attributes = {{"link.key", "value"}};
+
+  const auto j = nlohmann::json::parse(to_json({minimal, full}));
+
+  REQUIRE(j.is_array());
+  REQUIRE(j.size() == 2);
+  REQUIRE(j[0] ==
+          nlohmann::json{{"trace_id", "00000000000000110000000000000099"},
+                         {"span_id", "000000000000007b"}});
+  REQUIRE(j[1]["attributes"]["link.key"] == "value");
+  REQUIRE(j[1]["tracestate"] == "dd=s:1");
+  REQUIRE(j[1]["flags"] == 1);
+}
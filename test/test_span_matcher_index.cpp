@@ -0,0 +1,123 @@
+// This test covers `SpanMatcherIndex`, defined in `span_matcher_index.h`.
+
+#include <datadog/span_matcher.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "span_data.h"
+#include "span_matcher_index.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+
+#define SPAN_MATCHER_INDEX_TEST(x) TEST_CASE(x, "[span_matcher_index]")
+
+namespace {
+
+SpanMatcher make_matcher(std::string service, std::string name,
+                         std::string resource = "*") {
+  SpanMatcher matcher;
+  matcher.service = std::move(service);
+  matcher.name = std::move(name);
+  matcher.resource = std::move(resource);
+  return matcher;
+}
+
+SpanData make_span(std::string service, std::string name,
+                   std::string resource = "") {
+  SpanData span;
+  span.service = std::move(service);
+  span.name = std::move(name);
+  span.resource = std::move(resource);
+  return span;
+}
+
+}  // namespace
+
+SPAN_MATCHER_INDEX_TEST("first match in the order added") {
+  SpanMatcherIndex index;
+  // indexed by name
+  index.add(make_matcher("*", "http.request"));
+  // not indexed
+  index.add(make_matcher("w*", "*", "GET /x"));
+  // indexed by service
+  index.add(make_matcher("web", "*"));
+  index.add(make_matcher("*", "*"));
+  REQUIRE(index.size() == 4);
+
+  CHECK(index.find(make_span("Web", "http.request", "GET /x")) == 0);
+  CHECK(index.find(make_span("web", "db.query", "GET /x")) == 1);
+  CHECK(index.find(make_span("WEB", "db.query", "GET /y")) == 2);
+  CHECK(index.find(make_span("db", "db.query")) == 3);
+}
+
+SPAN_MATCHER_INDEX_TEST("no match") {
+  SpanMatcherIndex index;
+  CHECK(!index.find(make_span("web", "http.request")));
+
+  index.add(make_matcher("web", "*"));
+  index.add(make_matcher("*", "http.request"));
+  index.add(make_matcher("db*", "*"));
+  CHECK(!index.find(make_span("cache", "get")));
+  CHECK(!index.find(make_span("webapp", "http.requests")));
+}
+
+SPAN_MATCHER_INDEX_TEST("tag patterns") {
+  SpanMatcher matcher = make_matcher("web", "*");
+  matcher.tags.emplace("env", "prod*");
+  SpanMatcherIndex index;
+  index.add(matcher);
+
+  SpanData span = make_span("web", "http.request");
+  CHECK(!index.find(span));
+  span.tags["env"] = "staging";
+  CHECK(!index.find(span));
+  span.tags["env"] = "Production";
+  CHECK(index.find(span) == 0);
+}
+
+SPAN_MATCHER_INDEX_TEST("agrees with SpanMatcher::match") {
+  const std::vector<SpanMatcher> matchers = {
+      make_matcher("web", "http.request", "GET /users/?"),
+      make_matcher("web", "*", "POST *"),
+      make_matcher("*-worker", "job.*"),
+      make_matcher("*", "db.query", "*users*"),
+      make_matcher("api", "?ttp.request"),
+      make_matcher("API", "grpc.*"),
+      make_matcher("*", "*", "*health"),
+  };
+  const std::vector<SpanData> spans = {
+      make_span("web", "http.request", "GET /users/1"),
+      make_span("web", "http.request", "GET /users/12"),
+      make_span("Web", "http.request", "post /users"),
+      make_span("mail-worker", "job.send", ""),
+      make_span("mail-worker", "task.send", ""),
+      make_span("pg", "db.query", "select * from users"),
+      make_span("api", "http.request", "GET /"),
+      make_span("Api", "grpc.server", ""),
+      make_span("lb", "http.request", "GET /healthz"),
+      make_span("lb", "http.request", "GET /Health"),
+      make_span("", "", ""),
+  };
+
+  SpanMatcherIndex index;
+  for (const auto& matcher : matchers) {
+    index.add(matcher);
+  }
+
+  for (const auto& span : spans) {
+    CAPTURE(span.service);
+    CAPTURE(span.name);
+    CAPTURE(span.resource);
+    const auto found =
+        std::find_if(matchers.begin(), matchers.end(),
+                     [&](const SpanMatcher& m) { return m.match(span); });
+    const auto expected = found == matchers.end()
+                              ? nullopt
+                              : Optional<std::size_t>(found - matchers.begin());
+    CHECK(index.find(span) == expected);
+  }
+}
@@ -25,23 +25,28 @@ std::ostream& operator<<(std::ostream& stream, Optional<double> value) {
   return stream << "null";
 }
 
-std::ostream& operator<<(
-    std::ostream& stream,
-    const std::unordered_map<std::string, double>& numeric_tags) {
+}  // namespace std
+
+namespace datadog {
+namespace tracing {
+
+std::ostream& operator<<(std::ostream& stream,
+                         const SpanNumericTags& numeric_tags) {
   stream << "{";
   auto iter = numeric_tags.begin();
   const auto end = numeric_tags.end();
   if (iter != end) {
-    stream << '\"' << iter->first << "\": " << iter->second;
+    stream << '\"' << StringView(iter->first) << "\": " << iter->second;
     for (++iter; iter != end; ++iter) {
       stream << ", ";
-      stream << '\"' << iter->first << "\": " << iter->second;
+      stream << '\"' << StringView(iter->first) << "\": " << iter->second;
     }
   }
   return stream << "}";
 }
 
-}  // namespace std
+}  // namespace tracing
+}  // namespace datadog
 
 namespace {
 
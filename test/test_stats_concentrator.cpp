@@ -0,0 +1,176 @@
+#include <datadog/runtime_id.h>
+#include <datadog/tracer_signature.h>
+
+#include <chrono>
+#include <datadog/json.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "span_data.h"
+#include "stats_concentrator.h"
+#include "test.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+#define STATS_CONCENTRATOR_TEST(x) TEST_CASE(x, "[stats_concentrator]")
+
+namespace {
+
+// The start of a ten second bucket.
+const auto bucket_start =
+    std::chrono::system_clock::time_point(std::chrono::seconds(1700000000));
+
+std::unique_ptr<SpanData> make_span(std::string service, std::string name,
+                                    std::uint64_t span_id,
+                                    std::uint64_t parent_id) {
+  auto span = std::make_unique<SpanData>();
+  span->service = std::move(service);
+  span->name = name;
+  span->resource = "GET /";
+  span->service_type = "web";
+  span->span_id = span_id;
+  span->parent_id = parent_id;
+  span->start.wall = bucket_start + 1s;
+  span->duration = 2ms;
+  span->tags["env"] = "prod";
+  span->tags["version"] = "1.0";
+  return span;
+}
+
+// Return the group named `name` in the first bucket of the specified
+// `payload`, or a null JSON value if there is none.
+nlohmann::json find_group(const nlohmann::json& payload,
+                          const std::string& name) {
+  for (const auto& group : payload.at("Stats").at(0).at("Stats")) {
+    if (group.at("Name") == name) {
+      return group;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+STATS_CONCENTRATOR_TEST("trace stats") {
+  const TracerSignature signature(RuntimeID::generate(), "testsvc", "prod");
+  StatsConcentrator concentrator(signature);
+
+  std::vector<std::unique_ptr<SpanData>> chunk;
+  chunk.push_back(make_span("web", "root", 1, 0));
+  chunk.back()->tags["http.status_code"] = "200";
+  // Same service as its parent: not top-level.
+  chunk.push_back(make_span("web", "internal", 2, 1));
+  // Same service as its parent, but measured.
+  chunk.push_back(make_span("web", "measured", 3, 1));
+  chunk.back()->numeric_tags["_dd.measured"] = 1;
+  // Different service than its parent: top-level.
+  chunk.push_back(make_span("db", "query", 4, 1));
+  chunk.back()->error = true;
+  concentrator.add(chunk);
+  concentrator.add(chunk);
+
+  SECTION("buckets are flushed once they end") {
+    auto payloads = concentrator.flush(bucket_start + 9s, false);
+    REQUIRE(payloads);
+    CHECK(payloads->empty());
+
+    payloads = concentrator.flush(bucket_start + 10s, false);
+    REQUIRE(payloads);
+    REQUIRE(payloads->size() == 1);
+
+    payloads = concentrator.flush(bucket_start + 20s, false);
+    REQUIRE(payloads);
+    CHECK(payloads->empty());
+  }
+
+  SECTION("payload") {
+    auto payloads = concentrator.flush(bucket_start, true);
+    REQUIRE(payloads);
+    REQUIRE(payloads->size() == 1);
+    const auto payload = nlohmann::json::from_msgpack(payloads->front());
+
+    CHECK(payload.at("Env") == "prod");
+    CHECK(payload.at("Version") == "1.0");
+    CHECK(payload.at("Lang") == "cpp");
+    CHECK(payload.at("Service") == "testsvc");
+    CHECK(payload.at("RuntimeID") == signature.runtime_id.string());
+    CHECK(payload.at("Sequence") == 1);
+
+    REQUIRE(payload.at("Stats").size() == 1);
+    const auto& bucket = payload.at("Stats").at(0);
+    CHECK(bucket.at("Start") ==
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              bucket_start.time_since_epoch())
+              .count());
+    CHECK(bucket.at("Duration") == 10'000'000'000);
+    CHECK(bucket.at("Stats").size() == 3);
+
+    CHECK(find_group(payload, "internal").is_null());
+
+    const auto root = find_group(payload, "root");
+    REQUIRE(!root.is_null());
+    CHECK(root.at("Service") == "web");
+    CHECK(root.at("Resource") == "GET /");
+    CHECK(root.at("Type") == "web");
+    CHECK(root.at("HTTPStatusCode") == 200);
+    CHECK(root.at("Hits") == 2);
+    CHECK(root.at("TopLevelHits") == 2);
+    CHECK(root.at("Errors") == 0);
+    CHECK(root.at("Duration") == 4'000'000);
+    CHECK(root.at("IsTraceRoot") == 1);
+    CHECK(root.at("Synthetics") == false);
+    CHECK(root.at("OkSummary").is_binary());
+    CHECK(root.at("ErrorSummary").is_binary());
+
+    const auto measured = find_group(payload, "measured");
+    REQUIRE(!measured.is_null());
+    CHECK(measured.at("Hits") == 2);
+    CHECK(measured.at("TopLevelHits") == 0);
+    CHECK(measured.at("IsTraceRoot") == 2);
+
+    const auto query = find_group(payload, "query");
+    REQUIRE(!query.is_null());
+    CHECK(query.at("Service") == "db");
+    CHECK(query.at("Hits") == 2);
+    CHECK(query.at("TopLevelHits") == 2);
+    CHECK(query.at("Errors") == 2);
+    CHECK(query.at("HTTPStatusCode") == 0);
+
+    // Buckets are flushed only once.
+    payloads = concentrator.flush(bucket_start + 1h, true);
+    REQUIRE(payloads);
+    CHECK(payloads->empty());
+  }
+
+  SECTION("environments and versions have separate payloads") {
+    std::vector<std::unique_ptr<SpanData>> other;
+    other.push_back(make_span("web", "root", 5, 0));
+    other.back()->tags["version"] = "2.0";
+    concentrator.add(other);
+
+    auto payloads = concentrator.flush(bucket_start, true);
+    REQUIRE(payloads);
+    REQUIRE(payloads->size() == 2);
+    const auto first = nlohmann::json::from_msgpack(payloads->at(0));
+    const auto second = nlohmann::json::from_msgpack(payloads->at(1));
+    CHECK(first.at("Version") == "1.0");
+    CHECK(first.at("Sequence") == 1);
+    CHECK(second.at("Version") == "2.0");
+    CHECK(second.at("Sequence") == 2);
+  }
+
+  SECTION("spans are counted in the bucket in which they finish") {
+    std::vector<std::unique_ptr<SpanData>> later;
+    later.push_back(make_span("web", "root", 5, 0));
+    later.back()->duration = 10s;
+    concentrator.add(later);
+
+    auto payloads = concentrator.flush(bucket_start, true);
+    REQUIRE(payloads);
+    REQUIRE(payloads->size() == 1);
+    const auto payload = nlohmann::json::from_msgpack(payloads->front());
+    CHECK(payload.at("Stats").size() == 2);
+  }
+}
@@ -0,0 +1,162 @@
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tag_map.h"
+#include "tags.h"
+#include "test.h"
+#include "trace_arena.h"
+
+using namespace datadog::tracing;
+
+#define TAG_MAP_TEST(x) TEST_CASE(x, "[tag_map]")
+
+namespace {
+
+using Map = TagMap<std::string, 2>;
+
+std::vector<std::string> keys_of(const Map& map) {
+  std::vector<std::string> keys;
+  for (const auto& [key, value] : map) {
+    keys.push_back(key.str());
+  }
+  return keys;
+}
+
+}  // namespace
+
+TAG_MAP_TEST("tag keys") {
+  SECTION("well-known names are interned") {
+    const TagKey key{"_sampling_priority_v1"};
+    CHECK(key.interned());
+    CHECK(key.data() == tags::internal::sampling_priority.data());
+  }
+
+  SECTION("other names are copied") {
+    const std::string name = "http.method.custom";
+    const TagKey key{name};
+    CHECK(!key.interned());
+    CHECK(key.data() != name.data());
+    CHECK(key == name);
+  }
+}
+
+TAG_MAP_TEST("tags are kept in the order they were added") {
+  Map map;
+  map["c"] = "1";
+  map.emplace("a", "2");
+  map.insert_or_assign("b", "3");
+  // Beyond the inline capacity.
+  map.insert(std::make_pair(std::string("d"), std::string("4")));
+  map["a"] = "5";
+
+  CHECK(keys_of(map) == std::vector<std::string>{"c", "a", "b", "d"});
+  CHECK(map.size() == 4);
+  CHECK(map.at("a") == "5");
+  CHECK(map.count("b") == 1);
+  CHECK(map.count("e") == 0);
+  CHECK(map.find("e") == map.end());
+  CHECK_THROWS(map.at("e"));
+
+  SECTION("emplace doesn't replace an existing tag") {
+    const auto [iter, inserted] = map.emplace("c", "6");
+    CHECK(!inserted);
+    CHECK(iter->second == "1");
+  }
+
+  SECTION("erase preserves the order of the rest") {
+    CHECK(map.erase("a") == 1);
+    CHECK(map.erase("a") == 0);
+    CHECK(keys_of(map) == std::vector<std::string>{"c", "b", "d"});
+  }
+}
+
+TAG_MAP_TEST("tag map equality ignores order") {
+  const Map first{{"a", "1"}, {"b", "2"}, {"c", "3"}};
+  const Map second{{"c", "3"}, {"a", "1"}, {"b", "2"}};
+  const Map third{{"c", "3"}, {"a", "1"}, {"b", "x"}};
+  CHECK(first == second);
+  CHECK(first != third);
+  CHECK(first != Map{});
+}
+
+TAG_MAP_TEST("tag map copy and move") {
+  // Each case covers tags stored inline, and tags stored out of line.
+  const auto size = GENERATE(1, 5);
+  CAPTURE(size);
+  Map original;
+  for (int i = 0; i < size; ++i) {
+    original[std::to_string(i)] = std::string(40, 'x');
+  }
+
+  SECTION("copy construction") {
+    const Map copy{original};
+    CHECK(copy == original);
+  }
+
+  SECTION("move construction") {
+    const Map copy{original};
+    const Map moved{std::move(original)};
+    CHECK(moved == copy);
+    CHECK(original.empty());
+  }
+
+  SECTION("copy assignment") {
+    Map copy{{"y", "z"}};
+    copy = original;
+    CHECK(copy == original);
+  }
+
+  SECTION("move assignment") {
+    const Map copy{original};
+    Map moved{{"y", "z"}};
+    moved = std::move(original);
+    CHECK(moved == copy);
+    CHECK(original.empty());
+    original["a"] = "b";
+    CHECK(original.size() == 1);
+  }
+}
+
+TAG_MAP_TEST("tag map allocated from an arena") {
+  const auto arena = TraceArena::make();
+  Map map{Map::allocator_type(arena.get())};
+  for (int i = 0; i < 10; ++i) {
+    map[std::to_string(i)] = "value";
+  }
+  CHECK(map.get_allocator().arena() == arena.get());
+
+  SECTION("moving to a heap map copies the tags") {
+    Map heap_map;
+    heap_map = std::move(map);
+    CHECK(heap_map.get_allocator().arena() == nullptr);
+    CHECK(heap_map.size() == 10);
+    CHECK(keys_of(heap_map).front() == "0");
+  }
+
+  SECTION("moving from a heap map keeps the arena") {
+    Map heap_map{{"a", "b"}, {"c", "d"}, {"e", "f"}};
+    map = std::move(heap_map);
+    CHECK(map.get_allocator().arena() == arena.get());
+    CHECK(map == Map{{"a", "b"}, {"c", "d"}, {"e", "f"}});
+  }
+}
+
+TAG_MAP_TEST("tag map values can refer to the same map") {
+  const std::string long_value(100, 'x');
+  Map map;
+  map.insert_or_assign("first", long_value);
+  map.insert_or_assign("second", "2");
+  REQUIRE(map.size() == 2);
+
+  // The storage is full, and so adding a tag moves the others while the new
+  // value refers to one of them.
+  map.insert_or_assign("third", map.at("first"));
+  CHECK(map.at("third") == long_value);
+
+  map.insert_or_assign("fourth", "4");
+  map.emplace("fifth", map.at("first"));
+  CHECK(map.at("fifth") == long_value);
+  CHECK(keys_of(map) ==
+        std::vector<std::string>{"first", "second", "third", "fourth", "fifth"});
+}
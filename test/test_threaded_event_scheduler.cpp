@@ -0,0 +1,159 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "mocks/event_schedulers.h"
+#include "test.h"
+#include "threaded_event_scheduler.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+#define THREADED_EVENT_SCHEDULER_TEST(x) \
+  TEST_CASE(x, "[threaded_event_scheduler]")
+
+namespace {
+
+// Wait up to a few seconds for the specified `condition` to become true, and
+// return whether it did.
+template <typename Condition>
+bool eventually(Condition&& condition) {
+  const auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+
+}  // namespace
+
+THREADED_EVENT_SCHEDULER_TEST("recurring events recur until cancelled") {
+  ThreadedEventScheduler scheduler;
+  std::atomic<int> count{0};
+  auto cancel = scheduler.schedule_recurring_event(10ms, [&]() { ++count; });
+  CHECK(eventually([&]() { return count >= 3; }));
+  cancel();
+  const int final_count = count;
+  std::this_thread::sleep_for(50ms);
+  CHECK(count == final_count);
+}
+
+THREADED_EVENT_SCHEDULER_TEST("one-shot events happen once") {
+  ThreadedEventScheduler scheduler;
+  std::atomic<int> count{0};
+  auto cancel = scheduler.schedule_event(10ms, [&]() { ++count; });
+  CHECK(eventually([&]() { return count == 1; }));
+  std::this_thread::sleep_for(50ms);
+  CHECK(count == 1);
+  cancel();
+
+  SECTION("unless cancelled first") {
+    scheduler.schedule_event(20ms, [&]() { ++count; })();
+    std::this_thread::sleep_for(60ms);
+    CHECK(count == 1);
+  }
+}
+
+THREADED_EVENT_SCHEDULER_TEST("callbacks run on the dispatcher by default") {
+  ThreadedEventScheduler scheduler;
+  CHECK(scheduler.config().find("\"num_workers\":0") != std::string::npos);
+
+  std::atomic<int> count{0};
+  auto cancel_one_shot = scheduler.schedule_event(1ms, [&]() { ++count; });
+  auto cancel_recurring =
+      scheduler.schedule_recurring_event(5ms, [&]() { ++count; });
+  CHECK(eventually([&]() { return count >= 3; }));
+  cancel_recurring();
+  cancel_one_shot();
+}
+
+THREADED_EVENT_SCHEDULER_TEST("a slow callback doesn't delay other events") {
+  ThreadedEventScheduler::Config config;
+  config.num_workers = 2;
+  ThreadedEventScheduler scheduler{config};
+  std::mutex mutex;
+  std::condition_variable released;
+  bool release = false;
+  std::atomic<bool> slow_started{false};
+  std::atomic<int> fast_count{0};
+
+  auto cancel_slow = scheduler.schedule_event(1ms, [&]() {
+    slow_started = true;
+    std::unique_lock<std::mutex> lock(mutex);
+    released.wait(lock, [&]() { return release; });
+  });
+  REQUIRE(eventually([&]() { return slow_started.load(); }));
+
+  auto cancel_fast =
+      scheduler.schedule_recurring_event(10ms, [&]() { ++fast_count; });
+  CHECK(eventually([&]() { return fast_count >= 3; }));
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  released.notify_one();
+  cancel_fast();
+  cancel_slow();
+}
+
+THREADED_EVENT_SCHEDULER_TEST("callbacks can cancel their own event") {
+  ThreadedEventScheduler scheduler;
+  std::atomic<int> count{0};
+  EventScheduler::Cancel cancel;
+  std::mutex mutex;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    cancel = scheduler.schedule_recurring_event(5ms, [&]() {
+      ++count;
+      std::lock_guard<std::mutex> guard(mutex);
+      cancel();
+    });
+  }
+  CHECK(eventually([&]() { return count == 1; }));
+  std::this_thread::sleep_for(30ms);
+  CHECK(count == 1);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  cancel = nullptr;
+}
+
+THREADED_EVENT_SCHEDULER_TEST("recurrences can be jittered") {
+  ThreadedEventScheduler::Config config;
+  config.max_jitter = 0.5;
+  ThreadedEventScheduler scheduler{config};
+  std::atomic<int> count{0};
+  auto cancel = scheduler.schedule_recurring_event(10ms, [&]() { ++count; });
+  CHECK(eventually([&]() { return count >= 3; }));
+  cancel();
+  CHECK(scheduler.config().find("\"max_jitter\":0.5") != std::string::npos);
+}
+
+THREADED_EVENT_SCHEDULER_TEST("default one-shot events stop recurring") {
+  MockEventScheduler scheduler;
+  int count = 0;
+  auto cancel = scheduler.schedule_event(10ms, [&]() { ++count; });
+  REQUIRE(scheduler.event_callback);
+  CHECK(scheduler.recurrence_interval == 10ms);
+  CHECK(!scheduler.cancelled);
+
+  SECTION("after the first invocation") {
+    scheduler.event_callback();
+    CHECK(count == 1);
+    CHECK(scheduler.cancelled);
+    scheduler.event_callback();
+    CHECK(count == 1);
+  }
+
+  SECTION("or when cancelled first") {
+    cancel();
+    CHECK(scheduler.cancelled);
+    scheduler.event_callback();
+    CHECK(count == 0);
+  }
+}
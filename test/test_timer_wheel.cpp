@@ -0,0 +1,94 @@
+#include <chrono>
+#include <vector>
+
+#include "test.h"
+#include "timer_wheel.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+#define TIMER_WHEEL_TEST(x) TEST_CASE(x, "[timer_wheel]")
+
+namespace {
+
+using Wheel = TimerWheel<int>;
+const auto origin = std::chrono::steady_clock::time_point{} + 1h;
+
+}  // namespace
+
+TIMER_WHEEL_TEST("timers expire when due, in order") {
+  Wheel wheel{1ms, origin};
+  CHECK(!wheel.next_due());
+
+  wheel.add(origin + 5ms, 5);
+  wheel.add(origin + 2ms, 2);
+  wheel.add(origin + 3ms, 3);
+  CHECK(wheel.size() == 3);
+  CHECK(wheel.next_due() == origin + 2ms);
+
+  CHECK(wheel.advance(origin + 1ms).empty());
+  CHECK(wheel.advance(origin + 3ms) == std::vector<int>{2, 3});
+  CHECK(wheel.next_due() == origin + 5ms);
+  CHECK(wheel.advance(origin + 1s) == std::vector<int>{5});
+  CHECK(wheel.size() == 0);
+  CHECK(!wheel.next_due());
+}
+
+TIMER_WHEEL_TEST("timers within a tick are coalesced, and never early") {
+  Wheel wheel{10ms, origin};
+  wheel.add(origin + 11ms, 1);
+  wheel.add(origin + 20ms, 2);
+  wheel.add(origin + 21ms, 3);
+
+  // The first two are due at the end of the second tick.
+  CHECK(wheel.next_due() == origin + 20ms);
+  CHECK(wheel.advance(origin + 19ms).empty());
+  CHECK(wheel.advance(origin + 20ms) == std::vector<int>{1, 2});
+  CHECK(wheel.advance(origin + 30ms) == std::vector<int>{3});
+}
+
+TIMER_WHEEL_TEST("timers in the past are due right away") {
+  Wheel wheel{1ms, origin};
+  REQUIRE(wheel.advance(origin + 100ms).empty());
+  wheel.add(origin, 1);
+  wheel.add(origin - 1s, 2);
+  CHECK(wheel.next_due() == origin + 101ms);
+  CHECK(wheel.advance(origin + 101ms) == std::vector<int>{1, 2});
+}
+
+TIMER_WHEEL_TEST("distant timers cascade through the levels") {
+  Wheel wheel{1ms, origin};
+  // Due in each level of the wheel, and beyond.
+  const std::vector<std::chrono::milliseconds> delays{
+      1ms, 63ms, 64ms, 100ms, 4095ms, 4096ms, 300000ms, 20000000ms};
+  for (std::size_t i = 0; i < delays.size(); ++i) {
+    wheel.add(origin + delays[i], static_cast<int>(i));
+  }
+
+  // Advance in steps, as a dispatching thread would, and check that each
+  // timer expires exactly when it's due.
+  auto now = origin;
+  std::vector<int> expired;
+  while (const auto next = wheel.next_due()) {
+    REQUIRE(*next > now);
+    now = *next;
+    for (const int value : wheel.advance(now)) {
+      CHECK(now == origin + delays[value]);
+      expired.push_back(value);
+    }
+  }
+  CHECK(expired == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7});
+}
+
+TIMER_WHEEL_TEST("a late advance expires every due timer, in order") {
+  Wheel wheel{1ms, origin};
+  wheel.add(origin + 20000000ms, 4);
+  wheel.add(origin + 4096ms, 2);
+  wheel.add(origin + 1ms, 0);
+  wheel.add(origin + 300000ms, 3);
+  wheel.add(origin + 64ms, 1);
+
+  CHECK(wheel.advance(origin + 300000ms) == std::vector<int>{0, 1, 2, 3});
+  CHECK(wheel.size() == 1);
+  CHECK(wheel.advance(origin + 30000000ms) == std::vector<int>{4});
+}
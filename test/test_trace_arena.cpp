@@ -0,0 +1,136 @@
+#include <datadog/span.h>
+#include <datadog/tracer.h>
+#include <datadog/tracer_config.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mocks/collectors.h"
+#include "null_logger.h"
+#include "span_data.h"
+#include "test.h"
+#include "trace_arena.h"
+
+using namespace datadog::tracing;
+
+#define TRACE_ARENA_TEST(x) TEST_CASE(x, "[trace_arena]")
+
+TRACE_ARENA_TEST("allocations are aligned and do not overlap") {
+  const auto arena = TraceArena::make();
+
+  struct Allocation {
+    char* begin;
+    std::size_t size;
+  };
+  std::vector<Allocation> allocations;
+  // The last allocation is larger than any block.
+  for (const std::size_t size : {1, 3, 8, 24, 100, 1000, 5000, 200000}) {
+    for (const std::size_t alignment : {1, 2, 4, 8, 16}) {
+      void* const pointer = arena->allocate(size, alignment);
+      CHECK(reinterpret_cast<std::uintptr_t>(pointer) % alignment == 0);
+      allocations.push_back(Allocation{static_cast<char*>(pointer), size});
+      // Write to the whole allocation, so that a sanitizer would notice if
+      // it's out of bounds.
+      std::fill_n(static_cast<char*>(pointer), size, 'x');
+    }
+  }
+
+  bool overlapping = false;
+  for (std::size_t i = 0; i < allocations.size(); ++i) {
+    for (std::size_t j = i + 1; j < allocations.size(); ++j) {
+      const Allocation& first = allocations[i];
+      const Allocation& second = allocations[j];
+      overlapping = overlapping ||
+                    (first.begin < second.begin + second.size &&
+                     second.begin < first.begin + first.size);
+    }
+  }
+  CHECK(!overlapping);
+}
+
+TRACE_ARENA_TEST("spans allocated from an arena") {
+  std::unique_ptr<SpanData> span;
+  TraceArena* arena_pointer;
+  {
+    const auto arena = TraceArena::make();
+    arena_pointer = arena.get();
+    span = SpanData::make(arena.get());
+  }
+  // The span keeps the arena alive.
+  CHECK(span->arena() == arena_pointer);
+  span->tags["foo"] = "bar";
+  span->numeric_tags["baz"] = 1;
+  CHECK(span->tags.get_allocator().arena() == arena_pointer);
+  CHECK(span->numeric_tags.get_allocator().arena() == arena_pointer);
+
+  SECTION("children share the arena") {
+    auto child = SpanData::make(span->arena());
+    CHECK(child->arena() == arena_pointer);
+    // Destroy the parent before the child.
+    span.reset();
+    child->tags["foo"] = "bar";
+    CHECK(child->tags.at("foo") == "bar");
+  }
+
+  SECTION("copies are allocated from the heap") {
+    const SpanData copy = *span;
+    CHECK(copy.arena() == nullptr);
+    CHECK(copy.tags == span->tags);
+  }
+
+  SECTION("assignment keeps the arena") {
+    SpanData heap_span;
+    heap_span.tags["hello"] = "world";
+    span->tags = std::move(heap_span.tags);
+    CHECK(span->arena() == arena_pointer);
+    CHECK(span->tags.at("hello") == "world");
+  }
+
+  SECTION("spans without an arena") {
+    auto heap_span = SpanData::make(nullptr);
+    CHECK(heap_span->arena() == nullptr);
+    CHECK(std::make_unique<SpanData>()->arena() == nullptr);
+  }
+}
+
+TRACE_ARENA_TEST("tracer allocates each trace segment from its own arena") {
+  TracerConfig config;
+  config.service = "testsvc";
+  const auto collector = std::make_shared<MockCollector>();
+  config.collector = collector;
+  config.logger = std::make_shared<NullLogger>();
+  config.use_trace_arena = GENERATE(true, false);
+
+  auto finalized = finalize_config(config);
+  REQUIRE(finalized);
+  Tracer tracer{*finalized};
+
+  for (int i = 0; i < 2; ++i) {
+    auto root = tracer.create_span();
+    root.set_tag("root", "yes");
+    auto child = root.create_child();
+    child.set_tag("child", "yes");
+  }
+
+  REQUIRE(collector->chunks.size() == 2);
+  const auto& first = collector->chunks[0];
+  const auto& second = collector->chunks[1];
+  REQUIRE(first.size() == 2);
+  REQUIRE(second.size() == 2);
+  CHECK(first[0]->tags.at("root") == "yes");
+  CHECK(first[1]->tags.at("child") == "yes");
+
+  if (*config.use_trace_arena) {
+    CHECK(first[0]->arena() != nullptr);
+    CHECK(first[1]->arena() == first[0]->arena());
+    CHECK(second[0]->arena() != first[0]->arena());
+  } else {
+    CHECK(first[0]->arena() == nullptr);
+    CHECK(first[1]->arena() == nullptr);
+  }
+}
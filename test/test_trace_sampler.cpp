@@ -10,6 +10,8 @@
 #include <map>
 #include <ostream>
 
+#include "agent_sample_rates.h"
+#include "collector_response.h"
 #include "mocks/collectors.h"
 #include "null_logger.h"
 #include "test.h"
@@ -286,3 +288,28 @@ TEST_CASE("sampling rules") {
     REQUIRE(collector->count_of(SamplingPriority::USER_DROP) == 1);
   }
 }
+
+TEST_CASE("agent sample rates") {
+  CollectorResponse response;
+  response.sample_rate_by_key["service:web,env:prod"] = assert_rate(0.5);
+  response.sample_rate_by_key["service:web,env:"] = assert_rate(0.25);
+  response.sample_rate_by_key[CollectorResponse::key_of_default_rate] =
+      assert_rate(0.75);
+
+  const AgentSampleRates rates{response, nullopt};
+  REQUIRE(rates.find("web", "prod"));
+  CHECK(rates.find("web", "prod")->value() == 0.5);
+  REQUIRE(rates.find("web", ""));
+  CHECK(rates.find("web", "")->value() == 0.25);
+  CHECK(!rates.find("web", "staging"));
+  CHECK(!rates.find("we", "b,env:prod"));
+  REQUIRE(rates.default_rate());
+  CHECK(rates.default_rate()->value() == 0.75);
+
+  SECTION("a response without a default rate keeps the previous one") {
+    const AgentSampleRates next{CollectorResponse{}, rates.default_rate()};
+    CHECK(!next.find("web", "prod"));
+    REQUIRE(next.default_rate());
+    CHECK(next.default_rate()->value() == 0.75);
+  }
+}
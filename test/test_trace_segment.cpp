@@ -458,24 +458,21 @@ TEST_CASE("TraceSegment finalization of spans") {
       for (const auto& span : chunk) {
         REQUIRE(span);
 
-        auto found_string = span->tags.find(tags::internal::origin);
-        REQUIRE(found_string != span->tags.end());
-        REQUIRE(found_string->second == "พัทยา");
-
-        found_string = span->tags.find(tags::internal::language);
-        REQUIRE(found_string != span->tags.end());
-        REQUIRE(found_string->second == "cpp");
-
-        found_string = span->tags.find(tags::internal::runtime_id);
-        REQUIRE(found_string != span->tags.end());
-        const auto found_uuid = found_string->second;
-        CAPTURE(found_uuid);
-        REQUIRE(std::regex_match(found_uuid, uuid_regex));
-
-        const auto found_number =
-            span->numeric_tags.find(tags::internal::process_id);
-        REQUIRE(found_number != span->numeric_tags.end());
-        REQUIRE(found_number->second == process_id);
+        // The spans share the tags rather than each having a copy.
+        REQUIRE(span->segment_tags);
+        REQUIRE(span->segment_tags == chunk.front()->segment_tags);
+        REQUIRE(span->tags.count(tags::internal::language) == 0);
+
+        REQUIRE(span->find_tag(tags::internal::origin) == "พัทยา");
+        REQUIRE(span->find_tag(tags::internal::language) == "cpp");
+
+        const auto found_uuid = span->find_tag(tags::internal::runtime_id);
+        REQUIRE(found_uuid);
+        CAPTURE(*found_uuid);
+        REQUIRE(std::regex_match(std::string(*found_uuid), uuid_regex));
+
+        REQUIRE(span->find_numeric_tag(tags::internal::process_id) ==
+                process_id);
       }
     }
   }
@@ -138,7 +138,9 @@ TEST_TRACER("tracer span defaults") {
     REQUIRE(root.environment() == config.environment);
     REQUIRE(root.version() == config.version);
     REQUIRE(root.name == config.name);
-    REQUIRE_THAT(root.tags, ContainsSubset(*config.tags));
+    for (const auto& [name, value] : *config.tags) {
+      REQUIRE(root.find_tag(name) == value);
+    }
 
     REQUIRE(root.tags.count(tags::version) == 1);
     REQUIRE(root.tags.find(tags::version)->second == config.version);
@@ -192,7 +194,9 @@ TEST_TRACER("tracer span defaults") {
     REQUIRE(span.environment() == config.environment);
     REQUIRE(span.version() == config.version);
     REQUIRE(span.name == config.name);
-    REQUIRE_THAT(span.tags, ContainsSubset(*config.tags));
+    for (const auto& [name, value] : *config.tags) {
+      REQUIRE(span.find_tag(name) == value);
+    }
 
     REQUIRE(span.tags.count(tags::version) == 1);
     REQUIRE(span.tags.find(tags::version)->second == config.version);
@@ -249,7 +253,9 @@ TEST_TRACER("tracer span defaults") {
     REQUIRE(child.environment() == config.environment);
     REQUIRE(child.version() == config.version);
     REQUIRE(child.name == config.name);
-    REQUIRE_THAT(child.tags, ContainsSubset(*config.tags));
+    for (const auto& [name, value] : *config.tags) {
+      REQUIRE(child.find_tag(name) == value);
+    }
 
     REQUIRE(child.tags.count(tags::version) == 1);
     REQUIRE(child.tags.find(tags::version)->second == config.version);
@@ -310,7 +316,9 @@ TEST_TRACER("tracer span defaults") {
     REQUIRE(child.version() == nullopt);  // version is not inherited since the
                                           // service name is different
     REQUIRE(child.name == config.name);
-    REQUIRE_THAT(child.tags, ContainsSubset(*config.tags));
+    for (const auto& [name, value] : *config.tags) {
+      REQUIRE(child.find_tag(name) == value);
+    }
 
     REQUIRE(child.tags.count(tags::version) == 0);
   }
@@ -1219,7 +1227,7 @@ TEST_TRACER("span extraction") {
     CAPTURE(test_case.traceparent);
     CAPTURE(test_case.tracestate);
 
-    std::unordered_map<std::string, std::string> span_tags;
+    SpanTags span_tags;
     MockLogger logger;
     CAPTURE(logger.entries);
     CAPTURE(span_tags);
@@ -1252,7 +1260,7 @@ TEST_TRACER("span extraction") {
   SECTION(
       "'extract_max_size' propagation error if tracestate \"dd\" vendor "
       "value is oversized on extract") {
-    std::unordered_map<std::string, std::string> span_tags;
+    SpanTags span_tags;
     MockLogger logger;
     CAPTURE(logger.entries);
     CAPTURE(span_tags);
@@ -2147,7 +2155,7 @@ TEST_TRACER("APM tracing enabled") {
   REQUIRE(collector->chunks.front().size() == 1);
   const SpanData& span = *collector->chunks.front().front();
   // tracing needs to be disabled for this tag to be set
-  CHECK(span.numeric_tags.count(tags::internal::apm_enabled) == 0);
+  CHECK(!span.find_numeric_tag(tags::internal::apm_enabled));
 }
 
 TEST_TRACER("APM tracing disabled") {
@@ -2181,7 +2189,7 @@ TEST_TRACER("APM tracing disabled") {
     const auto& chunk = collector->chunks.front();
     REQUIRE(chunk.size() == 3);
     for (const auto& span : chunk) {
-      CHECK(span->numeric_tags.at(tags::internal::apm_enabled) == 0);
+      CHECK(span->find_numeric_tag(tags::internal::apm_enabled) == 0);
     }
   }
 
@@ -2203,7 +2211,7 @@ TEST_TRACER("APM tracing disabled") {
           *collector->chunks.front().front();
 
       CHECK(span_data.tags.at("_dd.p.dm") == "-5");
-      CHECK(span_data.numeric_tags.at(tags::internal::apm_enabled) == 0);
+      CHECK(span_data.find_numeric_tag(tags::internal::apm_enabled) == 0);
       CHECK(span_data.numeric_tags.at(tags::internal::sampling_priority) == 2);
     }
 
@@ -2220,7 +2228,7 @@ TEST_TRACER("APM tracing disabled") {
             *collector->chunks.front().front();
         CHECK(span1_data.numeric_tags.at(tags::internal::sampling_priority) ==
               2);
-        CHECK(span1_data.numeric_tags.at(tags::internal::apm_enabled) == 0);
+        CHECK(span1_data.find_numeric_tag(tags::internal::apm_enabled) == 0);
         CHECK(span1_data.tags.at("_dd.p.dm") == "-0");
       }
 
@@ -2241,7 +2249,7 @@ TEST_TRACER("APM tracing disabled") {
             *collector->chunks.front().front();
         CHECK(span2_data.numeric_tags.at(tags::internal::sampling_priority) ==
               -1);
-        CHECK(span2_data.numeric_tags.at(tags::internal::apm_enabled) == 0);
+        CHECK(span2_data.find_numeric_tag(tags::internal::apm_enabled) == 0);
       }
 
       collector->chunks.clear();
@@ -2260,7 +2268,7 @@ TEST_TRACER("APM tracing disabled") {
             *collector->chunks.front().front();
         CHECK(span2_data.numeric_tags.at(tags::internal::sampling_priority) ==
               2);
-        CHECK(span2_data.numeric_tags.at(tags::internal::apm_enabled) == 0);
+        CHECK(span2_data.find_numeric_tag(tags::internal::apm_enabled) == 0);
       }
 
       collector->chunks.clear();
@@ -2278,7 +2286,7 @@ TEST_TRACER("APM tracing disabled") {
         const auto& span3_data = *collector->chunks.front().front();
         CHECK(span3_data.numeric_tags.at(tags::internal::sampling_priority) ==
               2);
-        CHECK(span3_data.numeric_tags.at(tags::internal::apm_enabled) == 0);
+        CHECK(span3_data.find_numeric_tag(tags::internal::apm_enabled) == 0);
       }
     }
   }
@@ -2320,7 +2328,7 @@ TEST_TRACER("APM tracing disabled") {
           const SpanData& span_data = *collector->chunks.front().front();
           CHECK(span_data.numeric_tags.at(tags::internal::sampling_priority) ==
                 -1);
-          CHECK(span_data.numeric_tags.at(tags::internal::apm_enabled) == 0.);
+          CHECK(span_data.find_numeric_tag(tags::internal::apm_enabled) == 0.);
           collector->chunks.clear();
         }
 
@@ -2343,7 +2351,7 @@ TEST_TRACER("APM tracing disabled") {
           CHECK(span_data.tags.at(tags::internal::decision_maker) == "-5");
           CHECK(span_data.tags.at(tags::internal::trace_source) ==
                 to_tag(Source::appsec));
-          CHECK(span_data.numeric_tags.at(tags::internal::apm_enabled) == 0.);
+          CHECK(span_data.find_numeric_tag(tags::internal::apm_enabled) == 0.);
           collector->chunks.clear();
         }
 
@@ -2366,7 +2374,7 @@ TEST_TRACER("APM tracing disabled") {
           CHECK(span_data.numeric_tags.at(tags::internal::sampling_priority) ==
                 2);
           CHECK(span_data.tags.at(tags::internal::decision_maker) == "-0");
-          CHECK(span_data.numeric_tags.at(tags::internal::apm_enabled) == 0.);
+          CHECK(span_data.find_numeric_tag(tags::internal::apm_enabled) == 0.);
           collector->chunks.clear();
         }
       }
@@ -2396,7 +2404,7 @@ TEST_TRACER("APM tracing disabled") {
         const SpanData& span2_data = *collector->chunks.front().front();
         CHECK(span2_data.numeric_tags.at(tags::internal::sampling_priority) ==
               2);
-        CHECK(span2_data.numeric_tags.at(tags::internal::apm_enabled) == 0);
+        CHECK(span2_data.find_numeric_tag(tags::internal::apm_enabled) == 0);
       }
     }
   }
@@ -0,0 +1,394 @@
+#include <datadog/datadog_agent_config.h>
+#include <datadog/dict_reader.h>
+#include <datadog/dict_writer.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "default_http_client.h"
+#include "null_logger.h"
+#include "test.h"
+#include "unix_socket_http_client.h"
+
+using namespace datadog::tracing;
+using namespace std::chrono_literals;
+
+#define UNIX_SOCKET_TEST(x) TEST_CASE(x, "[unix_socket_http_client]")
+
+namespace {
+
+struct ReceivedRequest {
+  std::string head;
+  std::string body;
+};
+
+// `StandInAgent` listens on a unix domain socket and passes each connection
+// that it accepts, one at a time, to a `serve` function. The connection is
+// closed when `serve` returns.
+class StandInAgent {
+  std::string path_;
+  int listen_fd_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<int> num_connections_{0};
+  std::thread thread_;
+
+ public:
+  using Serve = std::function<void(int fd, int connection_index)>;
+
+  explicit StandInAgent(Serve serve) {
+    static std::atomic<int> instance{0};
+    path_ = (std::filesystem::temp_directory_path() /
+             ("dd-trace-cpp-test-" + std::to_string(::getpid()) + "-" +
+              std::to_string(instance++) + ".sock"))
+                .string();
+    ::unlink(path_.c_str());
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path_.c_str(),
+                 sizeof(address.sun_path) - 1);
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    REQUIRE(listen_fd_ >= 0);
+    REQUIRE(::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address),
+                   sizeof address) == 0);
+    REQUIRE(::listen(listen_fd_, 8) == 0);
+
+    thread_ = std::thread([this, serve = std::move(serve)]() {
+      while (true) {
+        const int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0 || stopping_) {
+          if (fd >= 0) ::close(fd);
+          return;
+        }
+        serve(fd, num_connections_++);
+        ::close(fd);
+      }
+    });
+  }
+
+  ~StandInAgent() {
+    stopping_ = true;
+    ::shutdown(listen_fd_, SHUT_RDWR);
+    // Some platforms don't wake `accept` on `shutdown`, so connect instead.
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path_.c_str(),
+                 sizeof(address.sun_path) - 1);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof address);
+    thread_.join();
+    ::close(fd);
+    ::close(listen_fd_);
+    ::unlink(path_.c_str());
+  }
+
+  HTTPClient::URL url() const { return {"unix", path_, "/v0.4/traces", ""}; }
+  int num_connections() const { return num_connections_; }
+};
+
+// Read the next request from the specified `fd`, where the specified `buffer`
+// holds anything already read but not yet parsed. Return `false` if the
+// connection was closed first.
+bool read_request(int fd, std::string& buffer, ReceivedRequest& request) {
+  char chunk[4096];
+  const auto read_more = [&]() {
+    const auto received = ::recv(fd, chunk, sizeof chunk, 0);
+    if (received <= 0) return false;
+    buffer.append(chunk, static_cast<std::size_t>(received));
+    return true;
+  };
+
+  std::size_t head_end;
+  while ((head_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+    if (!read_more()) return false;
+  }
+  request.head = buffer.substr(0, head_end + 4);
+  const auto length_begin = request.head.find("Content-Length: ") + 16;
+  const auto length = std::stoul(request.head.substr(
+      length_begin, request.head.find('\r', length_begin) - length_begin));
+  while (buffer.size() < request.head.size() + length) {
+    if (!read_more()) return false;
+  }
+  request.body = buffer.substr(request.head.size(), length);
+  buffer.erase(0, request.head.size() + length);
+  return true;
+}
+
+void send_all(int fd, const std::string& data) {
+  REQUIRE(::send(fd, data.data(), data.size(), 0) ==
+          static_cast<ssize_t>(data.size()));
+}
+
+struct Outcome {
+  int status = -1;
+  std::string body;
+  std::string header;
+  Optional<Error> error;
+};
+
+// Post the specified `body` to the specified `url` using the specified
+// `client`, and record the response or error in the returned object, which
+// is complete once `client` is drained.
+std::shared_ptr<Outcome> post(UnixSocketHTTPClient& client,
+                              const HTTPClient::URL& url, std::string body,
+                              std::chrono::steady_clock::duration timeout) {
+  auto outcome = std::make_shared<Outcome>();
+  const auto result = client.post(
+      url,
+      [](DictWriter& headers) {
+        headers.set("Content-Type", "text/plain");
+        headers.set("Content-Length", "not used");
+      },
+      std::move(body),
+      [outcome](int status, const DictReader& headers, std::string body) {
+        outcome->status = status;
+        outcome->body = std::move(body);
+        outcome->header = std::string(headers.lookup("X-Thing").value_or(""));
+      },
+      [outcome](Error error) { outcome->error = std::move(error); },
+      std::chrono::steady_clock::now() + timeout);
+  REQUIRE(result);
+  return outcome;
+}
+
+}  // namespace
+
+UNIX_SOCKET_TEST("unix socket HTTP client responses") {
+  std::mutex mutex;
+  std::vector<ReceivedRequest> received;
+  std::string response;
+
+  SECTION("delimited by Content-Length") {
+    response =
+        "HTTP/1.1 200 OK\r\nx-thing:  yes \r\nContent-Length: 5\r\n\r\nhello";
+  }
+  SECTION("in chunks, after an informational response") {
+    response =
+        "HTTP/1.1 100 Continue\r\n\r\n"
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nX-Thing: yes\r\n\r\n"
+        "3;name=value\r\nhel\r\n2\r\nlo\r\n0\r\nTrailer: ignored\r\n\r\n";
+  }
+  SECTION("delimited by the end of the connection") {
+    response = "HTTP/1.1 200 OK\r\nX-Thing: yes\r\n\r\nhello";
+  }
+
+  StandInAgent agent{[&](int fd, int) {
+    std::string buffer;
+    ReceivedRequest request;
+    if (read_request(fd, buffer, request)) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(request);
+      }
+      send_all(fd, response);
+    }
+  }};
+
+  UnixSocketHTTPClient client{std::make_shared<NullLogger>(), default_clock};
+  const auto outcome = post(client, agent.url(), "{\"data\": 1}", 5s);
+  client.drain(std::chrono::steady_clock::now() + 5s);
+
+  CHECK(!outcome->error);
+  CHECK(outcome->status == 200);
+  CHECK(outcome->body == "hello");
+  CHECK(outcome->header == "yes");
+
+  std::lock_guard<std::mutex> lock(mutex);
+  REQUIRE(received.size() == 1);
+  CHECK(received[0].head ==
+        "POST /v0.4/traces HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "Content-Length: 11\r\n"
+        "Content-Type: text/plain\r\n"
+        "\r\n");
+  CHECK(received[0].body == "{\"data\": 1}");
+}
+
+UNIX_SOCKET_TEST("unix socket HTTP client pipelines requests") {
+  constexpr int num_requests = 3;
+  // Read all of the requests before responding to any of them, which would
+  // time out if the client waited for each response before sending the next
+  // request.
+  StandInAgent agent{[&](int fd, int) {
+    std::string buffer;
+    std::vector<ReceivedRequest> requests(num_requests);
+    for (auto& request : requests) {
+      if (!read_request(fd, buffer, request)) return;
+    }
+    std::string responses;
+    for (const auto& request : requests) {
+      responses += "HTTP/1.1 200 OK\r\nContent-Length: ";
+      responses += std::to_string(request.body.size());
+      responses += "\r\n\r\n";
+      responses += request.body;
+    }
+    send_all(fd, responses);
+    // Keep the connection open for one more request.
+    ReceivedRequest request;
+    if (read_request(fd, buffer, request)) {
+      send_all(fd, "HTTP/1.1 204 No Content\r\n\r\n");
+    }
+  }};
+
+  UnixSocketHTTPClient client{std::make_shared<NullLogger>(), default_clock};
+  std::vector<std::shared_ptr<Outcome>> outcomes;
+  for (int i = 0; i < num_requests; ++i) {
+    outcomes.push_back(post(client, agent.url(), std::to_string(i), 5s));
+  }
+  client.drain(std::chrono::steady_clock::now() + 5s);
+
+  for (int i = 0; i < num_requests; ++i) {
+    CHECK(!outcomes[i]->error);
+    CHECK(outcomes[i]->status == 200);
+    CHECK(outcomes[i]->body == std::to_string(i));
+  }
+
+  const auto last = post(client, agent.url(), "last", 5s);
+  client.drain(std::chrono::steady_clock::now() + 5s);
+  CHECK(!last->error);
+  CHECK(last->status == 204);
+  CHECK(agent.num_connections() == 1);
+}
+
+UNIX_SOCKET_TEST("unix socket HTTP client errors") {
+  SECTION("the agent closes the connection without responding") {
+    StandInAgent agent{[](int fd, int connection_index) {
+      std::string buffer;
+      ReceivedRequest request;
+      if (read_request(fd, buffer, request) && connection_index > 0) {
+        send_all(fd, "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+      }
+    }};
+
+    UnixSocketHTTPClient client{std::make_shared<NullLogger>(), default_clock};
+    const auto first = post(client, agent.url(), "first", 5s);
+    client.drain(std::chrono::steady_clock::now() + 5s);
+    REQUIRE(first->error);
+    CHECK(first->error->code == Error::UNIX_SOCKET_REQUEST_FAILURE);
+    CHECK(first->status == -1);
+
+    // The next request uses a new connection.
+    const auto second = post(client, agent.url(), "second", 5s);
+    client.drain(std::chrono::steady_clock::now() + 5s);
+    CHECK(!second->error);
+    CHECK(second->status == 200);
+    CHECK(agent.num_connections() == 2);
+  }
+
+  SECTION("the agent doesn't respond before the deadline") {
+    StandInAgent agent{[](int fd, int) {
+      std::string buffer;
+      ReceivedRequest request;
+      // Wait until the client closes the connection.
+      while (read_request(fd, buffer, request)) {
+      }
+    }};
+
+    UnixSocketHTTPClient client{std::make_shared<NullLogger>(), default_clock};
+    const auto outcome = post(client, agent.url(), "body", 100ms);
+    client.drain(std::chrono::steady_clock::now() + 5s);
+    REQUIRE(outcome->error);
+    CHECK(outcome->error->code == Error::UNIX_SOCKET_DEADLINE_EXCEEDED);
+  }
+
+  SECTION("the agent responds with an invalid response") {
+    StandInAgent agent{[](int fd, int) {
+      std::string buffer;
+      ReceivedRequest request;
+      if (read_request(fd, buffer, request)) {
+        send_all(fd, "SPDY/3 200 OK\r\n\r\n");
+      }
+    }};
+
+    UnixSocketHTTPClient client{std::make_shared<NullLogger>(), default_clock};
+    const auto outcome = post(client, agent.url(), "body", 5s);
+    client.drain(std::chrono::steady_clock::now() + 5s);
+    REQUIRE(outcome->error);
+    CHECK(outcome->error->code == Error::UNIX_SOCKET_REQUEST_FAILURE);
+  }
+
+  SECTION("the agent isn't accepting connections") {
+    const auto path = (std::filesystem::temp_directory_path() /
+                       ("dd-trace-cpp-test-" + std::to_string(::getpid()) +
+                        "-backlog.sock"))
+                          .string();
+    ::unlink(path.c_str());
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    const int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    REQUIRE(::bind(listen_fd, reinterpret_cast<const sockaddr*>(&address),
+                   sizeof address) == 0);
+    REQUIRE(::listen(listen_fd, 0) == 0);
+
+    // Fill the queue of pending connections, which is never accepted.
+    std::vector<int> pending;
+    while (pending.size() < 64) {
+      const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+      pending.push_back(fd);
+      if (::connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                    sizeof address) != 0) {
+        break;
+      }
+    }
+
+    // The client's thread doesn't block connecting, and so the request
+    // expires.
+    UnixSocketHTTPClient client{std::make_shared<NullLogger>(), default_clock};
+    const auto outcome = post(client, {"unix", path, "/", ""}, "", 200ms);
+    client.drain(std::chrono::steady_clock::now() + 5s);
+    CHECK(outcome->error);
+
+    for (const int fd : pending) {
+      ::close(fd);
+    }
+    ::close(listen_fd);
+    ::unlink(path.c_str());
+  }
+
+  SECTION("there is no agent") {
+    UnixSocketHTTPClient client{std::make_shared<NullLogger>(), default_clock};
+    const auto outcome =
+        post(client, {"unix", "/nonexistent/apm.socket", "/", ""}, "", 5s);
+    client.drain(std::chrono::steady_clock::now() + 5s);
+    REQUIRE(outcome->error);
+    CHECK(outcome->error->code == Error::UNIX_SOCKET_REQUEST_FAILURE);
+  }
+
+  SECTION("the URL isn't for a unix domain socket") {
+    UnixSocketHTTPClient client{std::make_shared<NullLogger>(), default_clock};
+    const auto result =
+        client.post({"http", "localhost:8126", "/", ""}, nullptr, "", nullptr,
+                    nullptr, std::chrono::steady_clock::now() + 5s);
+    REQUIRE(result.if_error());
+    CHECK(result.error().code == Error::UNIX_SOCKET_REQUEST_SETUP_FAILED);
+  }
+}
+
+UNIX_SOCKET_TEST("unix socket URLs use the unix socket HTTP client") {
+  const auto logger = std::make_shared<NullLogger>();
+  if (default_http_client(logger, default_clock)) {
+    // This library was built with libcurl, which is used instead. See
+    // `test_curl.cpp`.
+    return;
+  }
+
+  DatadogAgentConfig config;
+  config.url = "unix:///var/run/datadog/apm.socket";
+  const auto finalized = finalize_config(config, logger, default_clock);
+  REQUIRE(finalized);
+  CHECK(finalized->http_client->config().find(
+            "datadog::tracing::UnixSocketHTTPClient") != std::string::npos);
+}
@@ -0,0 +1,58 @@
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "worker_pool.h"
+
+using namespace datadog::tracing;
+
+#define WORKER_POOL_TEST(x) TEST_CASE(x, "[worker_pool]")
+
+WORKER_POOL_TEST("runs every task once, and waits for them") {
+  const std::size_t concurrency = GENERATE(1, 2, 8);
+  CAPTURE(concurrency);
+  WorkerPool pool{concurrency};
+  CHECK(pool.concurrency() == concurrency);
+
+  for (const std::size_t num_tasks : {0, 1, 3, 100}) {
+    CAPTURE(num_tasks);
+    std::vector<std::atomic<int>> runs(num_tasks);
+    pool.run(num_tasks, [&](std::size_t index) { ++runs[index]; });
+    for (const auto& count : runs) {
+      CHECK(count == 1);
+    }
+  }
+}
+
+WORKER_POOL_TEST("tasks run in parallel") {
+  WorkerPool pool{4};
+  // Each task waits until all of them have started, which would never happen
+  // if they ran one after another.
+  std::atomic<int> started{0};
+  pool.run(4, [&](std::size_t) {
+    ++started;
+    while (started < 4) {
+      std::this_thread::yield();
+    }
+  });
+  CHECK(started == 4);
+}
+
+WORKER_POOL_TEST("batches from several threads run one at a time") {
+  WorkerPool pool{2};
+  std::atomic<int> total{0};
+  std::vector<std::thread> callers;
+  for (int i = 0; i < 4; ++i) {
+    callers.emplace_back([&]() {
+      for (int j = 0; j < 50; ++j) {
+        pool.run(10, [&](std::size_t) { ++total; });
+      }
+    });
+  }
+  for (auto& caller : callers) {
+    caller.join();
+  }
+  CHECK(total == 4 * 50 * 10);
+}